@@ -0,0 +1,645 @@
+/**
+ * @file MidiFilePlayer.cpp
+ * @brief Implementation of MidiFilePlayer class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "MidiFilePlayer.h"
+
+#include "SolenoidTimebase.h"
+
+// Error strings
+static const char STR_OK[] = "OK";
+static const char STR_OPEN[] = "File could not be opened";
+static const char STR_NOT_SMF[] = "Not a Standard MIDI File";
+static const char STR_FORMAT[] = "SMF format 2 not supported";
+static const char STR_TRACKS[] = "Too many tracks";
+static const char STR_READ[] = "SD read failed";
+static const char STR_EVENT[] = "Malformed track data";
+static const char STR_TEMPO[] = "Tempo map full";
+static const char STR_UNKNOWN[] = "Unknown error";
+
+static_assert((MIDI_SMF_CONTROL_QUEUE_CAPACITY & (MIDI_SMF_CONTROL_QUEUE_CAPACITY - 1)) == 0,
+              "MIDI_SMF_CONTROL_QUEUE_CAPACITY must be a power of two");
+
+MidiFilePlayer::MidiFilePlayer(SolenoidDriverBase& driver, const MidiKeymap& keymap)
+    : _driver(driver)
+    , _keymap(keymap)
+    , _heapSize(0)
+    , _format(0)
+    , _trackCount(0)
+    , _open(false)
+    , _playing(false)
+    , _startUs(0)
+    , _lookaheadUs(MIDI_SMF_DEFAULT_LOOKAHEAD_US)
+    , _controlHandler(nullptr)
+    , _error(MidiFileError::OK)
+    , _eventCount(0)
+    , _controlHead(0)
+    , _controlTail(0)
+    , _pedalHoldMs(MIDI_DEFAULT_PEDAL_HOLD_MS)
+{
+    for (uint8_t i = 0; i < MIDI_SMF_MAX_TRACKS; i++) {
+        _trackOffset[i] = 0;
+        _trackLength[i] = 0;
+    }
+    resetPedals();
+}
+
+// =============================================================================
+// FILE
+// =============================================================================
+
+bool MidiFilePlayer::open(const char* path) {
+    close();
+    _error = MidiFileError::OK;
+
+    _file = SD.open(path, FILE_READ);
+    if (!_file) {
+        _error = MidiFileError::OPEN_FAILED;
+        return false;
+    }
+
+    if (!readHeader()) {
+        _file.close();
+        return false;
+    }
+
+    buildTempoMap();
+    _open = true;
+    return true;
+}
+
+void MidiFilePlayer::close() {
+    if (_playing) {
+        stop();
+    }
+    if (_open) {
+        _file.close();
+        _open = false;
+    }
+    _heapSize = 0;
+    _trackCount = 0;
+}
+
+bool MidiFilePlayer::isOpen() const {
+    return _open;
+}
+
+// =============================================================================
+// TRANSPORT
+// =============================================================================
+
+bool MidiFilePlayer::play() {
+    if (!_open) {
+        return false;
+    }
+    if (_playing) {
+        stop();
+    }
+
+    if (!rewind()) {
+        return false;
+    }
+
+    // Start one look-ahead out, so the first notes are not already late
+    _startUs = SolenoidTimebase::nowUs32() + _lookaheadUs;
+    _eventCount = 0;
+    _controlHead = 0;
+    _controlTail = 0;
+    resetPedals();
+    _playing = true;
+    return true;
+}
+
+void MidiFilePlayer::stop() {
+    _playing = false;
+    _heapSize = 0;
+    _controlHead = 0;
+    _controlTail = 0;
+    resetPedals();
+
+    _driver.cancelScheduledNotes();
+    _driver.allOff();
+}
+
+bool MidiFilePlayer::isPlaying() const {
+    return _playing;
+}
+
+void MidiFilePlayer::update() {
+    if (!_playing) {
+        return;
+    }
+
+    // Card reads happen here, between events, not while parsing them
+    for (uint8_t i = 0; i < _trackCount; i++) {
+        _tracks[i].service();
+    }
+
+    uint32_t nowUs = SolenoidTimebase::nowUs32();
+    uint8_t budget = MIDI_SMF_MAX_EVENTS_PER_UPDATE;
+    serviceControls(nowUs);
+
+    while (_heapSize > 0 && budget > 0) {
+        uint8_t track = _heap[0];
+        const MidiFileEvent& event = _head[track];
+        uint32_t dueUs = _startUs + static_cast<uint32_t>(_tempoMap.tickToUs(event.tick));
+        int32_t aheadUs = static_cast<int32_t>(dueUs - nowUs);
+
+        // Everything is read the same look-ahead before it is due
+        if (aheadUs > static_cast<int32_t>(_lookaheadUs)) {
+            break;
+        }
+
+        // Pedal-held note-offs due by now go ahead of this event
+        scheduleHeldReleases(dueUs);
+
+        uint8_t type = event.status & 0xF0;
+        if (type == 0x80 || type == 0x90) {
+            // Notes go to the scheduler
+            if (_driver.getScheduledEventCount() >= SOLENOID_SCHEDULER_CAPACITY - MIDI_SMF_SCHEDULER_RESERVE) {
+                break;
+            }
+            dispatch(event, dueUs);
+        } else if (type == 0xB0 && !applyPedal(event, dueUs)) {
+            // Other control changes wait in the queue for their time; a full
+            // queue holds the merge back so none is lost or reordered
+            if (static_cast<uint8_t>(_controlHead - _controlTail) >= MIDI_SMF_CONTROL_QUEUE_CAPACITY) {
+                break;
+            }
+            MidiFileControl& control = _controls[_controlHead & (MIDI_SMF_CONTROL_QUEUE_CAPACITY - 1)];
+            control.dueUs = dueUs;
+            control.midiChannel = (event.status & 0x0F) + 1;
+            control.control = event.data1;
+            control.value = event.data2;
+            _controlHead++;
+        }
+
+        budget--;
+        advance(track);
+    }
+
+    // Held note-offs coming due within the look-ahead are queued like the
+    // notes, but never past an event not read yet that could still change them
+    uint32_t heldUntilUs = nowUs + _lookaheadUs;
+    if (_heapSize > 0) {
+        uint32_t nextUs = _startUs + static_cast<uint32_t>(_tempoMap.tickToUs(_head[_heap[0]].tick));
+        if (static_cast<int32_t>(nextUs - heldUntilUs) < 0) {
+            heldUntilUs = nextUs;
+        }
+    }
+    scheduleHeldReleases(heldUntilUs);
+
+    // Changes due at a tick just read apply now, not a pass later
+    serviceControls(nowUs);
+
+    if (_heapSize == 0 && _controlHead == _controlTail && !hasHeldReleases()) {
+        // Last event queued (or a track failed) - the driver plays the rest
+        for (uint8_t i = 0; i < _trackCount; i++) {
+            if (_tracks[i].hasFailed()) {
+                _error = _tracks[i].getError();
+            }
+        }
+        _playing = false;
+    }
+}
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+
+void MidiFilePlayer::setLookaheadUs(uint32_t lookaheadUs) {
+    _lookaheadUs = lookaheadUs;
+}
+
+uint32_t MidiFilePlayer::getLookaheadUs() const {
+    return _lookaheadUs;
+}
+
+void MidiFilePlayer::setControlChangeHandler(MidiFileControlHandler handler) {
+    _controlHandler = handler;
+}
+
+void MidiFilePlayer::setPedalHoldMs(uint32_t holdMs) {
+    _pedalHoldMs = holdMs;
+}
+
+uint32_t MidiFilePlayer::getPedalHoldMs() const {
+    return _pedalHoldMs;
+}
+
+// =============================================================================
+// STATUS
+// =============================================================================
+
+MidiFileError MidiFilePlayer::getError() const {
+    return _error;
+}
+
+const char* MidiFilePlayer::getErrorString(MidiFileError error) {
+    switch (error) {
+        case MidiFileError::OK:                 return STR_OK;
+        case MidiFileError::OPEN_FAILED:        return STR_OPEN;
+        case MidiFileError::NOT_SMF:            return STR_NOT_SMF;
+        case MidiFileError::UNSUPPORTED_FORMAT: return STR_FORMAT;
+        case MidiFileError::TOO_MANY_TRACKS:    return STR_TRACKS;
+        case MidiFileError::READ_FAILED:        return STR_READ;
+        case MidiFileError::BAD_EVENT:          return STR_EVENT;
+        case MidiFileError::TEMPO_MAP_FULL:     return STR_TEMPO;
+        default:                                return STR_UNKNOWN;
+    }
+}
+
+uint8_t MidiFilePlayer::getFormat() const {
+    return _format;
+}
+
+uint8_t MidiFilePlayer::getTrackCount() const {
+    return _trackCount;
+}
+
+uint32_t MidiFilePlayer::getPositionMs() const {
+    if (!_playing) {
+        return 0;
+    }
+    int32_t elapsedUs = static_cast<int32_t>(SolenoidTimebase::nowUs32() - _startUs);
+    return (elapsedUs > 0) ? static_cast<uint32_t>(elapsedUs) / 1000 : 0;
+}
+
+uint32_t MidiFilePlayer::getEventCount() const {
+    return _eventCount;
+}
+
+uint32_t MidiFilePlayer::getUnderrunCount() const {
+    uint32_t count = 0;
+    for (uint8_t i = 0; i < _trackCount; i++) {
+        count += _tracks[i].getUnderrunCount();
+    }
+    return count;
+}
+
+// =============================================================================
+// PRIVATE
+// =============================================================================
+
+bool MidiFilePlayer::readHeader() {
+    uint32_t id, length, format, tracks, division;
+    if (!readBigEndian(4, id) || !readBigEndian(4, length)) {
+        _error = MidiFileError::READ_FAILED;
+        return false;
+    }
+    if (id != 0x4D546864 || length < 6) {   // "MThd"
+        _error = MidiFileError::NOT_SMF;
+        return false;
+    }
+    if (!readBigEndian(2, format) || !readBigEndian(2, tracks) || !readBigEndian(2, division)) {
+        _error = MidiFileError::READ_FAILED;
+        return false;
+    }
+    if (format > 1) {
+        _error = MidiFileError::UNSUPPORTED_FORMAT;
+        return false;
+    }
+    if (tracks == 0 || (format == 0 && tracks != 1)) {
+        _error = MidiFileError::NOT_SMF;
+        return false;
+    }
+    if (tracks > MIDI_SMF_MAX_TRACKS) {
+        _error = MidiFileError::TOO_MANY_TRACKS;
+        return false;
+    }
+
+    // Walk the chunk list; unknown chunk types are skipped per the spec
+    uint32_t offset = 8 + length;
+    uint8_t found = 0;
+    while (found < tracks) {
+        if (!_file.seek(offset) || !readBigEndian(4, id) || !readBigEndian(4, length)) {
+            _error = MidiFileError::READ_FAILED;
+            return false;
+        }
+        offset += 8;
+        if (id == 0x4D54726B) {   // "MTrk"
+            _trackOffset[found] = offset;
+            _trackLength[found] = length;
+            found++;
+        }
+        offset += length;
+    }
+
+    _format = static_cast<uint8_t>(format);
+    _trackCount = static_cast<uint8_t>(tracks);
+    _tempoMap.reset(static_cast<uint16_t>(division));
+    return true;
+}
+
+void MidiFilePlayer::buildTempoMap() {
+    // Borrow track 0's reader; rewind() restarts it before playback
+    MidiFileTrack& scan = _tracks[0];
+    scan.begin(&_file, _trackOffset[0], _trackLength[0]);
+
+    MidiFileEvent event;
+    while (scan.next(event)) {
+        if (event.status == MIDI_SMF_STATUS_TEMPO && !_tempoMap.addTempo(event.tick, event.tempo)) {
+            _error = MidiFileError::TEMPO_MAP_FULL;
+        }
+        scan.service();
+    }
+}
+
+bool MidiFilePlayer::rewind() {
+    _heapSize = 0;
+    for (uint8_t i = 0; i < _trackCount; i++) {
+        if (!_tracks[i].begin(&_file, _trackOffset[i], _trackLength[i])) {
+            _error = MidiFileError::READ_FAILED;
+            _heapSize = 0;
+            return false;
+        }
+        if (_tracks[i].next(_head[i])) {
+            _heap[_heapSize++] = i;
+        }
+    }
+
+    for (int8_t k = static_cast<int8_t>(_heapSize / 2) - 1; k >= 0; k--) {
+        siftDown(static_cast<uint8_t>(k));
+    }
+    return true;
+}
+
+void MidiFilePlayer::advance(uint8_t track) {
+    if (!_tracks[track].next(_head[track])) {
+        // Track finished - move the last entry to the root
+        _heap[0] = _heap[--_heapSize];
+    }
+    if (_heapSize > 0) {
+        siftDown(0);
+    }
+}
+
+void MidiFilePlayer::dispatch(const MidiFileEvent& event, uint32_t dueUs) {
+    uint8_t type = event.status & 0xF0;
+    uint8_t midiChannel = (event.status & 0x0F) + 1;
+
+    switch (type) {
+        case 0x90:
+            if (event.data2 != 0) {
+                uint8_t solenoid = _keymap.lookup(midiChannel, event.data1);
+                if (solenoid < SOLENOID_MAX_CHANNELS) {
+                    // A held note struck again keeps its coil for the new strike
+                    clearBit(_heldRelease, solenoid);
+                    setBit(_keyDown, solenoid);
+                    _keyChannel[solenoid] = midiChannel;
+
+                    // A pedal-held coil is let go no earlier than the end of the kick
+                    uint32_t kickUs = _driver.getVelocityMap().lookup(solenoid, event.data2).kickUs;
+                    uint32_t holdUs = _pedalHoldMs * 1000;
+                    _releaseUs[solenoid] = dueUs + ((holdUs > kickUs) ? holdUs : kickUs);
+
+                    _driver.scheduleNoteOn(solenoid, event.data2, dueUs);
+                }
+                break;
+            }
+            // Velocity 0 is a note-off
+            // fall through
+        case 0x80: {
+            uint8_t solenoid = _keymap.lookup(midiChannel, event.data1);
+            if (solenoid < SOLENOID_MAX_CHANNELS) {
+                releaseKey(solenoid, dueUs);
+            }
+            break;
+        }
+        default:
+            // Tempo is already in the tempo map; other messages do not
+            // drive solenoids
+            return;
+    }
+    _eventCount++;
+}
+
+bool MidiFilePlayer::applyPedal(const MidiFileEvent& event, uint32_t dueUs) {
+    uint8_t midiChannel = (event.status & 0x0F) + 1;
+    uint16_t channelBit = static_cast<uint16_t>(1U << (midiChannel - 1));
+    bool down = event.data2 >= MIDI_PEDAL_DOWN_THRESHOLD;
+
+    switch (event.data1) {
+        case MIDI_CC_SUSTAIN:
+            if (down) {
+                _sustainDown |= channelBit;
+            } else if ((_sustainDown & channelBit) != 0) {
+                _sustainDown &= ~channelBit;
+                releasePedal(midiChannel, dueUs);
+            }
+            break;
+
+        case MIDI_CC_SOSTENUTO:
+            if (down) {
+                if ((_sostenutoDown & channelBit) == 0) {
+                    // Catch the keys that are down right now, and only those
+                    _sostenutoDown |= channelBit;
+                    for (uint8_t i = 0; i < SOLENOID_MAX_CHANNELS; i++) {
+                        if (_keyChannel[i] == midiChannel && testBit(_keyDown, i)) {
+                            setBit(_caught, i);
+                        }
+                    }
+                }
+            } else if ((_sostenutoDown & channelBit) != 0) {
+                _sostenutoDown &= ~channelBit;
+                for (uint8_t i = 0; i < SOLENOID_MAX_CHANNELS; i++) {
+                    if (_keyChannel[i] == midiChannel) {
+                        clearBit(_caught, i);
+                    }
+                }
+                releasePedal(midiChannel, dueUs);
+            }
+            break;
+
+        case MIDI_CC_RESET_CONTROLLERS:
+            _sustainDown &= ~channelBit;
+            _sostenutoDown &= ~channelBit;
+            for (uint8_t i = 0; i < SOLENOID_MAX_CHANNELS; i++) {
+                if (_keyChannel[i] == midiChannel) {
+                    clearBit(_caught, i);
+                }
+            }
+            releasePedal(midiChannel, dueUs);
+            break;
+
+        case MIDI_CC_ALL_NOTES_OFF:
+            // Keys are let up; the pedals still hold what they hold
+            for (uint8_t i = 0; i < SOLENOID_MAX_CHANNELS; i++) {
+                if (_keyChannel[i] == midiChannel) {
+                    releaseKey(i, dueUs);
+                }
+            }
+            break;
+
+        case MIDI_CC_ALL_SOUND_OFF:
+            for (uint8_t i = 0; i < SOLENOID_MAX_CHANNELS; i++) {
+                if (_keyChannel[i] == midiChannel && (testBit(_keyDown, i) || testBit(_heldRelease, i))) {
+                    clearBit(_keyDown, i);
+                    clearBit(_caught, i);
+                    setBit(_heldRelease, i);
+                    _releaseUs[i] = dueUs;
+                }
+            }
+            scheduleHeldReleases(dueUs);
+            break;
+
+        default:
+            return false;
+    }
+
+    _eventCount++;
+    return true;
+}
+
+void MidiFilePlayer::releaseKey(uint8_t solenoid, uint32_t dueUs) {
+    if (!testBit(_keyDown, solenoid)) {
+        return;
+    }
+    clearBit(_keyDown, solenoid);
+
+    // Held by a pedal: the note-off waits for the hold time or the pedal
+    if (isDamperRaised(solenoid) && static_cast<int32_t>(dueUs - _releaseUs[solenoid]) < 0) {
+        setBit(_heldRelease, solenoid);
+        return;
+    }
+    _driver.scheduleNoteOff(solenoid, dueUs);
+}
+
+void MidiFilePlayer::releasePedal(uint8_t midiChannel, uint32_t dueUs) {
+    for (uint8_t word = 0; word < SOLENOID_MASK_WORDS; word++) {
+        uint32_t bits = _heldRelease[word];
+        while (bits != 0) {
+            uint8_t solenoid = (word << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            if (_keyChannel[solenoid] == midiChannel && !isDamperRaised(solenoid) &&
+                static_cast<int32_t>(dueUs - _releaseUs[solenoid]) < 0) {
+                _releaseUs[solenoid] = dueUs;
+            }
+        }
+    }
+    scheduleHeldReleases(dueUs);
+}
+
+void MidiFilePlayer::scheduleHeldReleases(uint32_t untilUs) {
+    for (uint8_t word = 0; word < SOLENOID_MASK_WORDS; word++) {
+        uint32_t bits = _heldRelease[word];
+        while (bits != 0) {
+            uint8_t solenoid = (word << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            if (static_cast<int32_t>(untilUs - _releaseUs[solenoid]) < 0) {
+                continue;
+            }
+
+            // A full scheduler keeps the note held for the next pass
+            if (_driver.scheduleNoteOff(solenoid, _releaseUs[solenoid]) == SolenoidError::BUSY) {
+                continue;
+            }
+            clearBit(_heldRelease, solenoid);
+        }
+    }
+}
+
+void MidiFilePlayer::resetPedals() {
+    for (uint8_t word = 0; word < SOLENOID_MASK_WORDS; word++) {
+        _keyDown[word] = 0;
+        _caught[word] = 0;
+        _heldRelease[word] = 0;
+    }
+    for (uint8_t i = 0; i < SOLENOID_MAX_CHANNELS; i++) {
+        _keyChannel[i] = 0;
+        _releaseUs[i] = 0;
+    }
+    _sustainDown = 0;
+    _sostenutoDown = 0;
+}
+
+bool MidiFilePlayer::isDamperRaised(uint8_t solenoid) const {
+    uint8_t midiChannel = _keyChannel[solenoid];
+    bool sustained = midiChannel >= 1 && midiChannel <= MIDI_CHANNEL_COUNT &&
+        ((_sustainDown >> (midiChannel - 1)) & 0x01);
+    return sustained || testBit(_caught, solenoid);
+}
+
+bool MidiFilePlayer::hasHeldReleases() const {
+    for (uint8_t word = 0; word < SOLENOID_MASK_WORDS; word++) {
+        if (_heldRelease[word] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MidiFilePlayer::testBit(const uint32_t mask[], uint8_t solenoid) {
+    return (mask[solenoid >> 5] >> (solenoid & 31)) & 0x01;
+}
+
+void MidiFilePlayer::setBit(uint32_t mask[], uint8_t solenoid) {
+    mask[solenoid >> 5] |= (1UL << (solenoid & 31));
+}
+
+void MidiFilePlayer::clearBit(uint32_t mask[], uint8_t solenoid) {
+    mask[solenoid >> 5] &= ~(1UL << (solenoid & 31));
+}
+
+void MidiFilePlayer::serviceControls(uint32_t nowUs) {
+    while (_controlTail != _controlHead) {
+        const MidiFileControl& control = _controls[_controlTail & (MIDI_SMF_CONTROL_QUEUE_CAPACITY - 1)];
+        if (static_cast<int32_t>(nowUs - control.dueUs) < 0) {
+            return;
+        }
+        if (_controlHandler != nullptr) {
+            _controlHandler(control.midiChannel, control.control, control.value);
+        }
+        _controlTail++;
+        _eventCount++;
+    }
+}
+
+bool MidiFilePlayer::isEarlier(uint8_t a, uint8_t b) const {
+    if (_head[a].tick != _head[b].tick) {
+        return _head[a].tick < _head[b].tick;
+    }
+    return a < b;
+}
+
+void MidiFilePlayer::siftDown(uint8_t index) {
+    while (true) {
+        uint8_t left = (2 * index) + 1;
+        uint8_t right = left + 1;
+        uint8_t smallest = index;
+
+        if (left < _heapSize && isEarlier(_heap[left], _heap[smallest])) {
+            smallest = left;
+        }
+        if (right < _heapSize && isEarlier(_heap[right], _heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+
+        uint8_t tmp = _heap[index];
+        _heap[index] = _heap[smallest];
+        _heap[smallest] = tmp;
+        index = smallest;
+    }
+}
+
+bool MidiFilePlayer::readBigEndian(uint8_t bytes, uint32_t& value) {
+    uint8_t buffer[4];
+    if (bytes > 4 || _file.read(buffer, bytes) != bytes) {
+        return false;
+    }
+
+    value = 0;
+    for (uint8_t i = 0; i < bytes; i++) {
+        value = (value << 8) | buffer[i];
+    }
+    return true;
+}
@@ -0,0 +1,424 @@
+/**
+ * @file MidiFilePlayer.h
+ * @brief Standard MIDI File (type 0/1) player streaming from an SD card
+ *
+ * Tracks are streamed through small double buffers, merged in time order
+ * with a k-way min-heap (one entry per track), and handed to the driver's
+ * scheduler a short look-ahead before they are due, so notes keep their
+ * timing however long loop() spends elsewhere. Tempo changes are turned
+ * into a MidiTempoMap when the file is opened.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef MIDI_FILE_PLAYER_H
+#define MIDI_FILE_PLAYER_H
+
+#include <stdint.h>
+
+#include <SD.h>
+
+#include "PianoMidiConfig.h"
+#include "MidiFileTrack.h"
+#include "MidiKeymap.h"
+#include "MidiTempoMap.h"
+#include "SolenoidDriver.h"
+
+/**
+ * @brief Callback for control changes read from the file
+ *
+ * @param midiChannel MIDI channel (1-16)
+ * @param control Controller number
+ * @param value Controller value (0-127)
+ *
+ * Called from update() when the event is due (not ahead of time). The
+ * pedal and channel mode controllers the player applies itself (see
+ * MidiFilePlayer) are not passed on.
+ */
+typedef void (*MidiFileControlHandler)(uint8_t midiChannel, uint8_t control, uint8_t value);
+
+/**
+ * @struct MidiFileControl
+ * @brief A control change read from the file, waiting for its time
+ */
+struct MidiFileControl {
+    uint32_t dueUs;         ///< Timebase time the change applies
+    uint8_t midiChannel;    ///< MIDI channel (1-16)
+    uint8_t control;        ///< Controller number
+    uint8_t value;          ///< Controller value
+};
+
+/**
+ * @class MidiFilePlayer
+ * @brief Plays a Standard MIDI File through SolenoidDriver's scheduler
+ *
+ * Note events are looked up in the keymap and queued with
+ * SolenoidDriver::scheduleNoteOn()/scheduleNoteOff() up to the look-ahead
+ * before they are due. Other control changes are read ahead with the notes
+ * but held in a small queue and passed to the control handler when due, so
+ * a change lands between the notes it belongs between without holding back
+ * the notes behind it. Other messages are ignored.
+ *
+ * The file's own pedals are applied here, on the file's timeline, with the
+ * same rules as MidiPedals: sustain (CC64) and sostenuto (CC66) keep a
+ * released note sounding, and its note-off is scheduled at the pedal hold
+ * time after the strike, at the pedal lift, or at its next strike if that
+ * comes first. Reset controllers (CC121), all notes off (CC123) and all
+ * sound off (CC120) end and lift only the file's notes and pedals. None of
+ * these reach the control handler, so a file cannot change the pedal state
+ * of live MIDI notes, and live pedals do not hold the file's notes.
+ *
+ * RAM use is fixed: 2 x MIDI_SMF_CHUNK_BYTES per track plus the tempo map,
+ * whatever the file size.
+ *
+ * Example usage:
+ * @code
+ * MidiFilePlayer player(driver, KEYMAP);
+ *
+ * void setup() {
+ *     SD.begin(BUILTIN_SDCARD);
+ *     if (player.open("/song.mid")) {
+ *         player.play();
+ *     }
+ * }
+ *
+ * void loop() {
+ *     player.update();
+ *     driver.update();
+ * }
+ * @endcode
+ */
+class MidiFilePlayer {
+public:
+    /**
+     * @brief Construct a player with no file open
+     *
+     * @param driver Driver whose scheduler receives the notes
+     * @param keymap (MIDI channel, note) to solenoid table
+     */
+    MidiFilePlayer(SolenoidDriverBase& driver, const MidiKeymap& keymap);
+
+    // =========================================================================
+    // FILE
+    // =========================================================================
+
+    /**
+     * @brief Open a file and prepare it for playback
+     *
+     * @param path Path on the SD card (SD.begin() must have succeeded)
+     * @return true if the file can be played; see getError() otherwise
+     *
+     * Reads the header and track table and builds the tempo map (one pass
+     * over the tempo track). Stops and closes any file already open.
+     * TEMPO_MAP_FULL is reported but still returns true.
+     */
+    bool open(const char* path);
+
+    /**
+     * @brief Stop playback and close the file
+     */
+    void close();
+
+    /**
+     * @brief Check if a file is open
+     */
+    bool isOpen() const;
+
+    // =========================================================================
+    // TRANSPORT
+    // =========================================================================
+
+    /**
+     * @brief Start playback from the beginning of the file
+     *
+     * @return false if no file is open or the tracks cannot be read
+     *
+     * The first events sound one look-ahead after the call.
+     */
+    bool play();
+
+    /**
+     * @brief Stop playback
+     *
+     * Drops notes already queued in the driver and turns every channel off.
+     */
+    void stop();
+
+    /**
+     * @brief Check if playback is running
+     *
+     * @return false once stopped, or once the last note was queued and the
+     *         last control change applied
+     */
+    bool isPlaying() const;
+
+    /**
+     * @brief Refill track buffers and queue the events coming due
+     *
+     * Call from loop(). Hands at most MIDI_SMF_MAX_EVENTS_PER_UPDATE events
+     * to the driver per call, and leaves MIDI_SMF_SCHEDULER_RESERVE
+     * scheduler slots free for strike and hold edges. Control changes
+     * that have come due are passed to the control handler; call update()
+     * at least every few milliseconds so pedal timing stays tight.
+     */
+    void update();
+
+    // =========================================================================
+    // CONFIGURATION
+    // =========================================================================
+
+    /**
+     * @brief Set how far ahead of time notes are handed to the driver
+     *
+     * @param lookaheadUs Look-ahead in microseconds. Must cover the largest
+     *                    strike latency plus the longest loop() pass.
+     *                    Default: MIDI_SMF_DEFAULT_LOOKAHEAD_US
+     */
+    void setLookaheadUs(uint32_t lookaheadUs);
+
+    /**
+     * @brief Get the look-ahead
+     *
+     * @return Look-ahead in microseconds
+     */
+    uint32_t getLookaheadUs() const;
+
+    /**
+     * @brief Set the callback for control changes in the file
+     *
+     * @param handler Function to call, or nullptr to ignore control changes
+     */
+    void setControlChangeHandler(MidiFileControlHandler handler);
+
+    /**
+     * @brief Set how long a note held by the file's pedals keeps its coil energized
+     *
+     * @param holdMs Time from the strike (ms). The kick always completes,
+     *               so 0 releases the coil as soon as the strike is over.
+     *               Default: MIDI_DEFAULT_PEDAL_HOLD_MS
+     *
+     * Applies to notes read after the call.
+     */
+    void setPedalHoldMs(uint32_t holdMs);
+
+    /**
+     * @brief Get the pedal hold time
+     *
+     * @return Time from the strike (ms)
+     */
+    uint32_t getPedalHoldMs() const;
+
+    // =========================================================================
+    // STATUS
+    // =========================================================================
+
+    /**
+     * @brief Get the last error
+     *
+     * @return Error from open(), or from reading the tracks during playback
+     */
+    MidiFileError getError() const;
+
+    /**
+     * @brief Get a human-readable error description
+     *
+     * @param error Error code
+     * @return Static string describing the error
+     */
+    static const char* getErrorString(MidiFileError error);
+
+    /**
+     * @brief Get the SMF format of the open file
+     *
+     * @return 0 (single track) or 1 (simultaneous tracks)
+     */
+    uint8_t getFormat() const;
+
+    /**
+     * @brief Get the number of tracks of the open file
+     */
+    uint8_t getTrackCount() const;
+
+    /**
+     * @brief Get the playback position
+     *
+     * @return Milliseconds since the first tick sounded (0 if not playing)
+     */
+    uint32_t getPositionMs() const;
+
+    /**
+     * @brief Get the number of events handed to the driver or handler
+     *
+     * @return Events since play()
+     */
+    uint32_t getEventCount() const;
+
+    /**
+     * @brief Get how often a track ran out of buffered data
+     *
+     * @return Synchronous card reads during playback (0 when update() is
+     *         called often enough)
+     */
+    uint32_t getUnderrunCount() const;
+
+private:
+    SolenoidDriverBase& _driver;                         ///< Receives the notes
+    const MidiKeymap& _keymap;                           ///< Note to solenoid table
+    File _file;                                          ///< Open file (shared by the tracks)
+    MidiFileTrack _tracks[MIDI_SMF_MAX_TRACKS];          ///< Streaming readers
+    uint32_t _trackOffset[MIDI_SMF_MAX_TRACKS];          ///< File offset of each track's data
+    uint32_t _trackLength[MIDI_SMF_MAX_TRACKS];          ///< Length of each track's data
+    MidiFileEvent _head[MIDI_SMF_MAX_TRACKS];            ///< Next event of each track
+    uint8_t _heap[MIDI_SMF_MAX_TRACKS];                  ///< Min-heap of tracks by next event
+    uint8_t _heapSize;                                   ///< Tracks with events left
+    MidiTempoMap _tempoMap;                              ///< Tick to microsecond conversion
+    uint8_t _format;                                     ///< SMF format (0 or 1)
+    uint8_t _trackCount;                                 ///< Tracks in the file
+    bool _open;                                          ///< A file is open
+    bool _playing;                                       ///< Playback running
+    uint32_t _startUs;                                   ///< Timebase time of tick 0
+    uint32_t _lookaheadUs;                               ///< Queue notes this far ahead
+    MidiFileControlHandler _controlHandler;              ///< Receives control changes
+    MidiFileError _error;                                ///< Last error
+    uint32_t _eventCount;                                ///< Events dispatched since play()
+    MidiFileControl _controls[MIDI_SMF_CONTROL_QUEUE_CAPACITY];   ///< Control changes not yet due
+    uint8_t _controlHead;                                ///< Next control slot to fill
+    uint8_t _controlTail;                                ///< Oldest pending control change
+    uint32_t _pedalHoldMs;                               ///< Coil hold time of pedal-held notes
+    uint32_t _keyDown[SOLENOID_MASK_WORDS];              ///< Bit set = file note struck, note-off not read
+    uint32_t _caught[SOLENOID_MASK_WORDS];               ///< Bit set = held by the file's sostenuto
+    uint32_t _heldRelease[SOLENOID_MASK_WORDS];          ///< Bit set = key up, note-off not yet scheduled
+    uint8_t _keyChannel[SOLENOID_MAX_CHANNELS];          ///< MIDI channel (1-16) that struck the note
+    uint32_t _releaseUs[SOLENOID_MAX_CHANNELS];          ///< When a held note-off is due (timebase us)
+    uint16_t _sustainDown;                               ///< Bit per MIDI channel (bit 0 = channel 1)
+    uint16_t _sostenutoDown;                             ///< Bit per MIDI channel
+
+    /**
+     * @brief Pass the queued control changes that are due to the handler
+     *
+     * @param nowUs Current timebase time
+     */
+    void serviceControls(uint32_t nowUs);
+
+    /**
+     * @brief Read the MThd header and locate the MTrk chunks
+     *
+     * @return false on an error (_error set)
+     */
+    bool readHeader();
+
+    /**
+     * @brief Collect the Set Tempo events of the tempo track
+     *
+     * Track 0 for both formats (format 1 keeps the tempo map there).
+     */
+    void buildTempoMap();
+
+    /**
+     * @brief Restart every track and refill the heap
+     *
+     * @return false if a track could not be read
+     */
+    bool rewind();
+
+    /**
+     * @brief Read a track's next event into the heap, or drop the track
+     *
+     * @param track Track index at the heap root
+     */
+    void advance(uint8_t track);
+
+    /**
+     * @brief Queue one note event in the driver
+     *
+     * @param event Event read from the file
+     * @param dueUs Timebase time at which it should sound
+     */
+    void dispatch(const MidiFileEvent& event, uint32_t dueUs);
+
+    /**
+     * @brief Apply a pedal or channel mode controller on the file's timeline
+     *
+     * @param event Control change read from the file
+     * @param dueUs Timebase time it applies
+     * @return true if the controller is one the player handles itself
+     */
+    bool applyPedal(const MidiFileEvent& event, uint32_t dueUs);
+
+    /**
+     * @brief Key up: schedule the note-off, or hold it while a pedal is down
+     *
+     * @param solenoid Global solenoid index
+     * @param dueUs Timebase time of the note-off
+     */
+    void releaseKey(uint8_t solenoid, uint32_t dueUs);
+
+    /**
+     * @brief End the held notes of a channel no pedal holds any more
+     *
+     * @param midiChannel MIDI channel (1-16)
+     * @param dueUs Timebase time of the pedal change
+     */
+    void releasePedal(uint8_t midiChannel, uint32_t dueUs);
+
+    /**
+     * @brief Schedule the held note-offs due at or before a time
+     *
+     * @param untilUs Timebase time; later releases keep waiting
+     *
+     * A note-off the scheduler has no room for stays held and is retried.
+     */
+    void scheduleHeldReleases(uint32_t untilUs);
+
+    /**
+     * @brief Forget the file's notes and lift its pedals
+     */
+    void resetPedals();
+
+    /**
+     * @brief Check if the file's pedals keep a released note sounding
+     */
+    bool isDamperRaised(uint8_t solenoid) const;
+
+    /**
+     * @brief Check if a pedal-held note-off is still waiting
+     */
+    bool hasHeldReleases() const;
+
+    /**
+     * @brief Test a solenoid's bit in a mask
+     */
+    static bool testBit(const uint32_t mask[], uint8_t solenoid);
+
+    /**
+     * @brief Set a solenoid's bit in a mask
+     */
+    static void setBit(uint32_t mask[], uint8_t solenoid);
+
+    /**
+     * @brief Clear a solenoid's bit in a mask
+     */
+    static void clearBit(uint32_t mask[], uint8_t solenoid);
+
+    /**
+     * @brief Heap order: earlier tick first, lower track first on a tie
+     */
+    bool isEarlier(uint8_t a, uint8_t b) const;
+
+    /**
+     * @brief Restore heap order from an index downwards
+     */
+    void siftDown(uint8_t index);
+
+    /**
+     * @brief Read a big-endian value from the file
+     *
+     * @param bytes Number of bytes (1-4)
+     * @param value Output: the value
+     * @return false on a read error
+     */
+    bool readBigEndian(uint8_t bytes, uint32_t& value);
+};
+
+#endif // MIDI_FILE_PLAYER_H
@@ -0,0 +1,231 @@
+/**
+ * @file MidiFileTrack.cpp
+ * @brief Implementation of MidiFileTrack class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "MidiFileTrack.h"
+
+MidiFileTrack::MidiFileTrack()
+    : _file(nullptr)
+    , _fileOffset(0)
+    , _remaining(0)
+    , _pos(0)
+    , _active(0)
+    , _runningStatus(0)
+    , _tick(0)
+    , _ended(true)
+    , _error(MidiFileError::OK)
+    , _underrunCount(0)
+{
+    _fill[0] = 0;
+    _fill[1] = 0;
+}
+
+bool MidiFileTrack::begin(File* file, uint32_t offset, uint32_t length) {
+    _file = file;
+    _fileOffset = offset;
+    _remaining = length;
+    _fill[0] = 0;
+    _fill[1] = 0;
+    _pos = 0;
+    _active = 0;
+    _runningStatus = 0;
+    _tick = 0;
+    _ended = false;
+    _error = MidiFileError::OK;
+    _underrunCount = 0;
+
+    return load(0) && load(1);
+}
+
+bool MidiFileTrack::next(MidiFileEvent& event) {
+    while (!_ended) {
+        uint32_t delta;
+        uint8_t value;
+        if (!readVarLen(delta) || !readByte(value)) {
+            // Data ran out without End of Track - treat as the end
+            _ended = true;
+            return false;
+        }
+        _tick += delta;
+
+        if (value == 0xFF) {
+            // Meta event: type, length, data
+            uint8_t type;
+            uint32_t length;
+            if (!readByte(type) || !readVarLen(length)) {
+                return fail(MidiFileError::BAD_EVENT);
+            }
+            _runningStatus = 0;
+
+            if (type == 0x2F) {
+                _ended = true;
+                return false;
+            }
+            if (type == 0x51 && length == 3) {
+                uint8_t b0, b1, b2;
+                if (!readByte(b0) || !readByte(b1) || !readByte(b2)) {
+                    return fail(MidiFileError::BAD_EVENT);
+                }
+                event.tick = _tick;
+                event.status = MIDI_SMF_STATUS_TEMPO;
+                event.data1 = 0;
+                event.data2 = 0;
+                event.tempo = (static_cast<uint32_t>(b0) << 16) | (static_cast<uint32_t>(b1) << 8) | b2;
+                return true;
+            }
+            if (!skip(length)) {
+                return fail(MidiFileError::BAD_EVENT);
+            }
+            continue;
+        }
+
+        if (value == 0xF0 || value == 0xF7) {
+            // SysEx: length, data
+            uint32_t length;
+            if (!readVarLen(length) || !skip(length)) {
+                return fail(MidiFileError::BAD_EVENT);
+            }
+            _runningStatus = 0;
+            continue;
+        }
+
+        uint8_t status;
+        uint8_t data1;
+        if (value & 0x80) {
+            status = value;
+            _runningStatus = value;
+            if (!readByte(data1)) {
+                return fail(MidiFileError::BAD_EVENT);
+            }
+        } else {
+            if (_runningStatus == 0) {
+                return fail(MidiFileError::BAD_EVENT);
+            }
+            status = _runningStatus;
+            data1 = value;
+        }
+
+        // Program change and channel pressure carry one data byte
+        uint8_t data2 = 0;
+        uint8_t type = status & 0xF0;
+        if (type != 0xC0 && type != 0xD0 && !readByte(data2)) {
+            return fail(MidiFileError::BAD_EVENT);
+        }
+
+        event.tick = _tick;
+        event.status = status;
+        event.data1 = data1;
+        event.data2 = data2;
+        event.tempo = 0;
+        return true;
+    }
+    return false;
+}
+
+void MidiFileTrack::service() {
+    uint8_t idle = _active ^ 1;
+    if (!_ended && _fill[idle] == 0 && _remaining > 0) {
+        if (!load(idle)) {
+            fail(MidiFileError::READ_FAILED);
+        }
+    }
+}
+
+bool MidiFileTrack::hasFailed() const {
+    return _error != MidiFileError::OK;
+}
+
+MidiFileError MidiFileTrack::getError() const {
+    return _error;
+}
+
+uint32_t MidiFileTrack::getUnderrunCount() const {
+    return _underrunCount;
+}
+
+bool MidiFileTrack::load(uint8_t half) {
+    uint16_t count = (_remaining < MIDI_SMF_CHUNK_BYTES) ? _remaining : MIDI_SMF_CHUNK_BYTES;
+    if (count == 0) {
+        return true;
+    }
+
+    if (_file == nullptr || !_file->seek(_fileOffset) ||
+        _file->read(_buffer[half], count) != static_cast<int>(count)) {
+        _error = MidiFileError::READ_FAILED;
+        return false;
+    }
+
+    _fileOffset += count;
+    _remaining -= count;
+    _fill[half] = count;
+    return true;
+}
+
+bool MidiFileTrack::readByte(uint8_t& value) {
+    if (_pos >= _fill[_active]) {
+        // Active half consumed - hand it to service() and switch over
+        _fill[_active] = 0;
+        _active ^= 1;
+        _pos = 0;
+
+        if (_fill[_active] == 0) {
+            if (_remaining == 0) {
+                return false;
+            }
+            // service() did not get to it in time
+            _underrunCount++;
+            if (!load(_active)) {
+                return false;
+            }
+        }
+    }
+
+    value = _buffer[_active][_pos++];
+    return true;
+}
+
+bool MidiFileTrack::readVarLen(uint32_t& value) {
+    value = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        uint8_t b;
+        if (!readByte(b)) {
+            return false;
+        }
+        value = (value << 7) | (b & 0x7F);
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MidiFileTrack::skip(uint32_t count) {
+    uint8_t b;
+    while (count > 0) {
+        // Whole buffered spans are skipped without a byte loop
+        uint16_t buffered = _fill[_active] - _pos;
+        if (buffered > 0) {
+            uint16_t step = (count < buffered) ? count : buffered;
+            _pos += step;
+            count -= step;
+            continue;
+        }
+        if (!readByte(b)) {
+            return false;
+        }
+        count--;
+    }
+    return true;
+}
+
+bool MidiFileTrack::fail(MidiFileError error) {
+    if (_error == MidiFileError::OK) {
+        _error = error;
+    }
+    _ended = true;
+    return false;
+}
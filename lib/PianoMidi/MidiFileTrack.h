@@ -0,0 +1,157 @@
+/**
+ * @file MidiFileTrack.h
+ * @brief Streaming reader for one MTrk chunk of a Standard MIDI File
+ *
+ * A track is read through a small double buffer instead of being loaded
+ * into RAM: events are parsed from one half while the other half is
+ * refilled from the card by service(), outside the time-critical part of
+ * playback.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef MIDI_FILE_TRACK_H
+#define MIDI_FILE_TRACK_H
+
+#include <stdint.h>
+
+#include <SD.h>
+
+#include "PianoMidiConfig.h"
+
+/** MidiFileEvent::status of a Set Tempo meta event */
+constexpr uint8_t MIDI_SMF_STATUS_TEMPO = 0xFF;
+
+/**
+ * @struct MidiFileEvent
+ * @brief A channel message or tempo change read from a track
+ */
+struct MidiFileEvent {
+    uint32_t tick;     ///< Absolute time in ticks from the start of the track
+    uint8_t status;    ///< Channel message status byte, or MIDI_SMF_STATUS_TEMPO
+    uint8_t data1;     ///< First data byte (0 for tempo)
+    uint8_t data2;     ///< Second data byte (0 for one-byte messages and tempo)
+    uint32_t tempo;    ///< Microseconds per quarter note (tempo only)
+};
+
+/**
+ * @class MidiFileTrack
+ * @brief Double-buffered event parser over one track of an open file
+ *
+ * Running status is followed; SysEx and meta events other than Set Tempo
+ * and End of Track are skipped. Several tracks may share one File - every
+ * refill seeks to the track's own position first.
+ */
+class MidiFileTrack {
+public:
+    /**
+     * @brief Construct an empty (ended) track
+     */
+    MidiFileTrack();
+
+    /**
+     * @brief Start reading a track
+     *
+     * @param file Open file shared by the tracks
+     * @param offset File offset of the first event (after the MTrk header)
+     * @param length Track data length (bytes)
+     * @return false if the first read failed
+     *
+     * Fills both halves of the buffer.
+     */
+    bool begin(File* file, uint32_t offset, uint32_t length);
+
+    /**
+     * @brief Parse the next event
+     *
+     * @param event Output: the event
+     * @return false at the end of the track or on an error (see hasFailed())
+     */
+    bool next(MidiFileEvent& event);
+
+    /**
+     * @brief Refill the half of the buffer that has been consumed
+     *
+     * Cheap when there is nothing to do. Call often enough that next()
+     * never runs out of buffered data.
+     */
+    void service();
+
+    /**
+     * @brief Check if reading stopped on a read error or malformed data
+     *
+     * @return true if failed (see getError())
+     */
+    bool hasFailed() const;
+
+    /**
+     * @brief Get why reading stopped
+     *
+     * @return OK, READ_FAILED or BAD_EVENT
+     */
+    MidiFileError getError() const;
+
+    /**
+     * @brief Get how often next() had to wait on the card
+     *
+     * @return Refills done synchronously because service() had not run
+     */
+    uint32_t getUnderrunCount() const;
+
+private:
+    File* _file;                                        ///< File shared by the tracks
+    uint32_t _fileOffset;                               ///< Next file offset to load
+    uint32_t _remaining;                                ///< Track bytes not yet loaded
+    uint8_t _buffer[2][MIDI_SMF_CHUNK_BYTES];           ///< Double buffer
+    uint16_t _fill[2];                                  ///< Valid bytes per half (0 = needs a load)
+    uint16_t _pos;                                      ///< Read position in the active half
+    uint8_t _active;                                    ///< Half being parsed
+    uint8_t _runningStatus;                             ///< Status of the last channel message
+    uint32_t _tick;                                     ///< Absolute tick of the last event
+    bool _ended;                                        ///< End of Track reached (or failed)
+    MidiFileError _error;                               ///< Why reading stopped early
+    uint32_t _underrunCount;                            ///< Synchronous refills in next()
+
+    /**
+     * @brief Load the next chunk of track data into a half
+     *
+     * @param half Buffer half (0 or 1)
+     * @return false on a read error
+     */
+    bool load(uint8_t half);
+
+    /**
+     * @brief Read one byte of track data
+     *
+     * @param value Output: the byte
+     * @return false at the end of the data or on a read error
+     */
+    bool readByte(uint8_t& value);
+
+    /**
+     * @brief Read a variable-length quantity (at most 4 bytes)
+     *
+     * @param value Output: the value
+     * @return false at the end of the data or on a malformed quantity
+     */
+    bool readVarLen(uint32_t& value);
+
+    /**
+     * @brief Discard track data
+     *
+     * @param count Bytes to skip
+     * @return false if the track ended first
+     */
+    bool skip(uint32_t count);
+
+    /**
+     * @brief Stop reading with an error
+     *
+     * @param error Error to report
+     * @return false, for use in return statements
+     */
+    bool fail(MidiFileError error);
+};
+
+#endif // MIDI_FILE_TRACK_H
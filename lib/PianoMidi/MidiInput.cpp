@@ -0,0 +1,315 @@
+/**
+ * @file MidiInput.cpp
+ * @brief Implementation of MidiInput class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "MidiInput.h"
+
+#include "SolenoidTimebase.h"
+
+// =============================================================================
+// POLLING TIMER
+// =============================================================================
+
+#if defined(__IMXRT1062__)
+
+/** The polling timer serves one MidiInput */
+static IntervalTimer s_pollTimer;
+
+/** Input drained by the timer */
+static MidiInput* volatile s_pollInput = nullptr;
+
+static void midiInputPollIsr() {
+    MidiInput* input = s_pollInput;
+    if (input != nullptr) {
+        input->poll();
+    }
+}
+
+#endif
+
+#if defined(TEENSYDUINO)
+
+/** Extra UART receive buffers, one per possible source */
+static uint8_t s_serialRxMemory[MIDI_INPUT_MAX_SOURCES][MIDI_INPUT_SERIAL_RX_BYTES];
+
+#endif
+
+MidiInput::MidiInput()
+    : _sourceCount(0)
+    , _polling(false)
+    , _pollHz(0)
+{
+    for (uint8_t i = 0; i < MIDI_INPUT_MAX_SOURCES; i++) {
+        _sources[i].type = MidiSourceType::NONE;
+        _sources[i].port = nullptr;
+        _sources[i].cable = 0;
+    }
+    resetStats();
+}
+
+// =============================================================================
+// SOURCES
+// =============================================================================
+
+uint8_t MidiInput::addSerial(HardwareSerial& port) {
+    uint8_t index = addSource(MidiSourceType::DIN);
+    if (index == MIDI_INPUT_NO_SOURCE) {
+        return index;
+    }
+
+    _sources[index].port = &port;
+    port.begin(MIDI_DIN_BAUD);
+#if defined(TEENSYDUINO)
+    port.addMemoryForRead(s_serialRxMemory[index], MIDI_INPUT_SERIAL_RX_BYTES);
+#endif
+    return index;
+}
+
+uint8_t MidiInput::addUsb(uint8_t cable) {
+#if defined(MIDI_INTERFACE)
+    uint8_t index = addSource(MidiSourceType::USB);
+    if (index != MIDI_INPUT_NO_SOURCE) {
+        _sources[index].cable = cable;
+    }
+    return index;
+#else
+    (void)cable;  // No USB MIDI in this build
+    return MIDI_INPUT_NO_SOURCE;
+#endif
+}
+
+uint8_t MidiInput::getSourceCount() const {
+    return _sourceCount;
+}
+
+MidiSourceType MidiInput::getSourceType(uint8_t source) const {
+    return (source < _sourceCount) ? _sources[source].type : MidiSourceType::NONE;
+}
+
+// =============================================================================
+// POLLING
+// =============================================================================
+
+bool MidiInput::begin(uint32_t pollHz) {
+    end();
+    if (pollHz == 0) {
+        return false;
+    }
+
+#if defined(__IMXRT1062__)
+    if (s_pollInput != nullptr) {
+        return false;
+    }
+    s_pollInput = this;
+    if (!s_pollTimer.begin(midiInputPollIsr, 1000000.0f / pollHz)) {
+        s_pollInput = nullptr;
+        return false;
+    }
+    s_pollTimer.priority(MIDI_INPUT_IRQ_PRIORITY);
+    _pollHz = pollHz;
+    _polling = true;
+#endif
+    return _polling;
+}
+
+void MidiInput::end() {
+#if defined(__IMXRT1062__)
+    if (_polling) {
+        s_pollTimer.end();
+        s_pollInput = nullptr;
+    }
+#endif
+    _polling = false;
+}
+
+bool MidiInput::isPolling() const {
+    return _polling;
+}
+
+void MidiInput::poll() {
+    for (uint8_t i = 0; i < _sourceCount; i++) {
+        Source& source = _sources[i];
+        if (source.type != MidiSourceType::DIN) {
+            continue;
+        }
+
+        HardwareSerial& port = *source.port;
+        uint32_t nowUs = SolenoidTimebase::nowUs32();
+        MidiMessage message;
+        while (port.available() > 0) {
+            int value = port.read();
+            if (value < 0) {
+                break;
+            }
+            if (source.parser.feed(static_cast<uint8_t>(value), message)) {
+                message.timeUs = nowUs;
+                message.source = i;
+                source.ring.push(message);
+            }
+        }
+    }
+}
+
+// =============================================================================
+// MERGE
+// =============================================================================
+
+uint8_t MidiInput::update(MidiMessageHandler handler) {
+    if (!_polling) {
+        poll();
+    }
+    pollUsb();
+
+    uint8_t dispatched = 0;
+    while (dispatched < MIDI_INPUT_MAX_MESSAGES_PER_UPDATE) {
+        // Oldest head across the rings (wrap-safe comparison)
+        uint8_t oldest = MIDI_INPUT_NO_SOURCE;
+        uint32_t oldestUs = 0;
+        for (uint8_t i = 0; i < _sourceCount; i++) {
+            MidiMessage head;
+            if (!_sources[i].ring.peek(head)) {
+                continue;
+            }
+            if (oldest == MIDI_INPUT_NO_SOURCE || static_cast<int32_t>(head.timeUs - oldestUs) < 0) {
+                oldest = i;
+                oldestUs = head.timeUs;
+            }
+        }
+        if (oldest == MIDI_INPUT_NO_SOURCE) {
+            break;
+        }
+
+        Source& source = _sources[oldest];
+        MidiMessage message;
+        source.ring.pop(message);
+
+        // A message stamped after this update started counts as on time
+        int32_t latencyUs = static_cast<int32_t>(SolenoidTimebase::nowUs32() - message.timeUs);
+        uint32_t delayUs = (latencyUs > 0) ? static_cast<uint32_t>(latencyUs) : 0;
+        if (delayUs > source.maxLatencyUs) {
+            source.maxLatencyUs = delayUs;
+        }
+        source.totalLatencyUs += delayUs;
+        source.messageCount++;
+
+        if (handler != nullptr) {
+            handler(message);
+        }
+        dispatched++;
+    }
+    return dispatched;
+}
+
+void MidiInput::flush() {
+    // Stop the timer so the rings have no producer while emptied
+    uint32_t pollHz = _polling ? _pollHz : 0;
+    end();
+
+    for (uint8_t i = 0; i < _sourceCount; i++) {
+        Source& source = _sources[i];
+        if (source.type == MidiSourceType::DIN) {
+            while (source.port->available() > 0) {
+                source.port->read();
+            }
+        }
+        source.parser.reset();
+        source.ring.clear();
+    }
+#if defined(MIDI_INTERFACE)
+    while (usbMIDI.read()) {
+    }
+#endif
+
+    if (pollHz != 0) {
+        begin(pollHz);
+    }
+}
+
+// =============================================================================
+// STATISTICS
+// =============================================================================
+
+uint32_t MidiInput::getMessageCount(uint8_t source) const {
+    return (source < _sourceCount) ? _sources[source].messageCount : 0;
+}
+
+uint32_t MidiInput::getOverflowCount(uint8_t source) const {
+    if (source >= _sourceCount) {
+        return 0;
+    }
+    return _sources[source].ring.dropCount() - _sources[source].overflowBase;
+}
+
+uint32_t MidiInput::getMaxLatencyUs(uint8_t source) const {
+    return (source < _sourceCount) ? _sources[source].maxLatencyUs : 0;
+}
+
+uint32_t MidiInput::getAverageLatencyUs(uint8_t source) const {
+    if (source >= _sourceCount || _sources[source].messageCount == 0) {
+        return 0;
+    }
+    return static_cast<uint32_t>(_sources[source].totalLatencyUs / _sources[source].messageCount);
+}
+
+uint8_t MidiInput::getPendingCount(uint8_t source) const {
+    return (source < _sourceCount) ? _sources[source].ring.pending() : 0;
+}
+
+void MidiInput::resetStats() {
+    for (uint8_t i = 0; i < MIDI_INPUT_MAX_SOURCES; i++) {
+        _sources[i].messageCount = 0;
+        _sources[i].overflowBase = _sources[i].ring.dropCount();
+        _sources[i].maxLatencyUs = 0;
+        _sources[i].totalLatencyUs = 0;
+    }
+}
+
+// =============================================================================
+// PRIVATE
+// =============================================================================
+
+void MidiInput::pollUsb() {
+#if defined(MIDI_INTERFACE)
+    // Bounded: at most one ring's worth per update
+    for (uint8_t n = 0; n < MIDI_INPUT_RING_CAPACITY && usbMIDI.read(); n++) {
+        uint8_t type = usbMIDI.getType();
+        if (type < 0x80 || type >= 0xF0) {
+            // SysEx and system messages do not drive solenoids
+            continue;
+        }
+
+        uint8_t cable = usbMIDI.getCable();
+        for (uint8_t i = 0; i < _sourceCount; i++) {
+            Source& source = _sources[i];
+            if (source.type != MidiSourceType::USB || source.cable != cable) {
+                continue;
+            }
+
+            MidiMessage message;
+            message.timeUs = SolenoidTimebase::nowUs32();
+            message.source = i;
+            message.status = type | ((usbMIDI.getChannel() - 1) & 0x0F);
+            message.data1 = usbMIDI.getData1();
+            message.data2 = usbMIDI.getData2();
+            source.ring.push(message);
+            break;
+        }
+    }
+#endif
+}
+
+uint8_t MidiInput::addSource(MidiSourceType type) {
+    if (_polling || _sourceCount >= MIDI_INPUT_MAX_SOURCES) {
+        return MIDI_INPUT_NO_SOURCE;
+    }
+
+    uint8_t index = _sourceCount++;
+    _sources[index].type = type;
+    _sources[index].parser.reset();
+    _sources[index].ring.clear();
+    return index;
+}
@@ -0,0 +1,263 @@
+/**
+ * @file MidiInput.h
+ * @brief Merges MIDI from DIN serial ports and USB cables in arrival order
+ *
+ * Every source gets its own parser and MidiMessageRing. Serial ports are
+ * drained by a periodic interrupt, so bytes are timestamped when they
+ * arrive rather than when loop() gets round to them; update() then hands
+ * the messages of all sources to one handler, oldest first. The interrupt
+ * does no more than parse, so the worst-case delay from wire to handler
+ * is one poll period plus one loop() pass.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef MIDI_INPUT_H
+#define MIDI_INPUT_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "PianoMidiConfig.h"
+#include "MidiMessageRing.h"
+#include "MidiStreamParser.h"
+
+/**
+ * @enum MidiSourceType
+ * @brief Where a source's messages come from
+ */
+enum class MidiSourceType : uint8_t {
+    NONE = 0,    ///< No source at this index
+    DIN = 1,     ///< UART at MIDI_DIN_BAUD (5-pin DIN or TRS)
+    USB = 2      ///< One cable of the USB MIDI device
+};
+
+/**
+ * @brief Callback for merged messages
+ *
+ * @param message Complete channel message; status & 0xF0 is the type and
+ *                (status & 0x0F) + 1 the MIDI channel
+ *
+ * Called from update(), in loop() context.
+ */
+typedef void (*MidiMessageHandler)(const MidiMessage& message);
+
+/**
+ * @class MidiInput
+ * @brief Multi-source MIDI input with per-source rings and statistics
+ *
+ * Messages from different sources are dispatched in timestamp order.
+ * Because each source has its own ring, a flood on one port can only
+ * overflow that port's ring; the other sources keep their messages and
+ * still get dispatched in turn. Overflows and the delay from arrival to
+ * dispatch are tracked per source.
+ *
+ * USB messages are read with usbMIDI.read() in update() (the USB stack
+ * already buffers them in interrupt context), so usbMIDI.setHandle...()
+ * callbacks must not also be used. Extra cables need a multi-cable USB
+ * type such as "MIDIx4".
+ *
+ * Example usage:
+ * @code
+ * MidiInput midiInput;
+ *
+ * void handleMessage(const MidiMessage& message) { ... }
+ *
+ * void setup() {
+ *     midiInput.addUsb();
+ *     midiInput.addSerial(Serial1);   // DIN MIDI on pin 0
+ *     midiInput.begin();
+ * }
+ *
+ * void loop() {
+ *     midiInput.update(handleMessage);
+ * }
+ * @endcode
+ */
+class MidiInput {
+public:
+    /**
+     * @brief Construct an input with no sources
+     */
+    MidiInput();
+
+    // =========================================================================
+    // SOURCES
+    // =========================================================================
+
+    /**
+     * @brief Add a DIN MIDI serial port
+     *
+     * @param port UART to read; begun at MIDI_DIN_BAUD here
+     * @return Source index, or MIDI_INPUT_NO_SOURCE if full or polling
+     *
+     * On Teensy the UART's receive buffer is enlarged by
+     * MIDI_INPUT_SERIAL_RX_BYTES so a late poll never loses bytes.
+     * Add every source before begin().
+     */
+    uint8_t addSerial(HardwareSerial& port);
+
+    /**
+     * @brief Add a USB MIDI cable
+     *
+     * @param cable Virtual cable number (0 for single-cable USB types)
+     * @return Source index, or MIDI_INPUT_NO_SOURCE if full, polling or
+     *         the USB type has no MIDI interface
+     */
+    uint8_t addUsb(uint8_t cable = 0);
+
+    /**
+     * @brief Get the number of sources added
+     */
+    uint8_t getSourceCount() const;
+
+    /**
+     * @brief Get the kind of a source
+     *
+     * @param source Source index
+     * @return Source type (NONE if out of range)
+     */
+    MidiSourceType getSourceType(uint8_t source) const;
+
+    // =========================================================================
+    // POLLING
+    // =========================================================================
+
+    /**
+     * @brief Start draining the serial sources from a timer interrupt
+     *
+     * @param pollHz Poll rate, or 0 to poll from update() instead.
+     *               Default: MIDI_INPUT_DEFAULT_POLL_HZ
+     * @return true if the timer runs; false if update() polls (no timer
+     *         on this platform, none free, or another MidiInput has it)
+     *
+     * Teensy 4.x only; the timer runs at MIDI_INPUT_IRQ_PRIORITY.
+     */
+    bool begin(uint32_t pollHz = MIDI_INPUT_DEFAULT_POLL_HZ);
+
+    /**
+     * @brief Stop the polling timer; update() polls from then on
+     */
+    void end();
+
+    /**
+     * @brief Check if the serial sources are polled by the timer
+     */
+    bool isPolling() const;
+
+    /**
+     * @brief Move received serial bytes into the source rings
+     *
+     * Called by the timer interrupt, or by update() when there is none.
+     * Do not call it directly while the timer runs.
+     */
+    void poll();
+
+    // =========================================================================
+    // MERGE
+    // =========================================================================
+
+    /**
+     * @brief Dispatch pending messages, oldest first across all sources
+     *
+     * @param handler Receives each message
+     * @return Number of messages dispatched
+     *
+     * Reads USB, polls serial if no timer does, then dispatches at most
+     * MIDI_INPUT_MAX_MESSAGES_PER_UPDATE messages so a burst cannot stall
+     * loop(); the rest wait for the next call.
+     */
+    uint8_t update(MidiMessageHandler handler);
+
+    /**
+     * @brief Discard every pending message and reset the parsers
+     */
+    void flush();
+
+    // =========================================================================
+    // STATISTICS
+    // =========================================================================
+
+    /**
+     * @brief Get the number of messages dispatched from a source
+     *
+     * @param source Source index
+     * @return Messages since construction or resetStats()
+     */
+    uint32_t getMessageCount(uint8_t source) const;
+
+    /**
+     * @brief Get the number of messages a source lost to a full ring
+     *
+     * @param source Source index
+     * @return Overflowed messages since construction or resetStats()
+     */
+    uint32_t getOverflowCount(uint8_t source) const;
+
+    /**
+     * @brief Get the longest delay from arrival to dispatch
+     *
+     * @param source Source index
+     * @return Microseconds
+     */
+    uint32_t getMaxLatencyUs(uint8_t source) const;
+
+    /**
+     * @brief Get the mean delay from arrival to dispatch
+     *
+     * @param source Source index
+     * @return Microseconds (0 before the first message)
+     */
+    uint32_t getAverageLatencyUs(uint8_t source) const;
+
+    /**
+     * @brief Get the number of messages waiting in a source's ring
+     *
+     * @param source Source index
+     * @return Pending message count
+     */
+    uint8_t getPendingCount(uint8_t source) const;
+
+    /**
+     * @brief Clear the message, overflow and latency statistics
+     */
+    void resetStats();
+
+private:
+    /**
+     * @struct Source
+     * @brief One input and its ring
+     */
+    struct Source {
+        MidiSourceType type;          ///< Kind of input
+        HardwareSerial* port;         ///< UART (DIN)
+        uint8_t cable;                ///< USB cable number (USB)
+        MidiStreamParser parser;      ///< Byte parser (DIN)
+        MidiMessageRing ring;         ///< Messages waiting for update()
+        uint32_t messageCount;        ///< Messages dispatched
+        uint32_t overflowBase;        ///< ring.dropCount() at resetStats()
+        uint32_t maxLatencyUs;        ///< Longest arrival to dispatch delay
+        uint64_t totalLatencyUs;      ///< Sum of delays, for the mean
+    };
+
+    Source _sources[MIDI_INPUT_MAX_SOURCES];    ///< Sources in the order added
+    uint8_t _sourceCount;                       ///< Sources in use
+    bool _polling;                              ///< Timer drains the serial sources
+    uint32_t _pollHz;                           ///< Timer rate while polling
+
+    /**
+     * @brief Read pending USB messages into their cable's ring
+     */
+    void pollUsb();
+
+    /**
+     * @brief Claim the next source slot
+     *
+     * @param type Kind of input
+     * @return Source index, or MIDI_INPUT_NO_SOURCE
+     */
+    uint8_t addSource(MidiSourceType type);
+};
+
+#endif // MIDI_INPUT_H
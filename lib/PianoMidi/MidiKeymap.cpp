@@ -0,0 +1,61 @@
+/**
+ * @file MidiKeymap.cpp
+ * @brief Implementation of MidiKeymap class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "MidiKeymap.h"
+
+bool MidiKeymap::build(const MidiKeyRange ranges[], uint8_t count) {
+    clear();
+
+    bool complete = true;
+    for (uint8_t i = 0; i < count; i++) {
+        const MidiKeyRange& range = ranges[i];
+
+        // Entries the range should have produced
+        uint16_t notes = (range.lastNote >= range.firstNote && range.lastNote < MIDI_NOTE_COUNT)
+            ? range.lastNote - range.firstNote + 1 : 0;
+        uint16_t expected = notes * ((range.midiChannel == MIDI_OMNI) ? MIDI_CHANNEL_COUNT : 1);
+
+        if (notes == 0 || apply(range) != expected) {
+            complete = false;
+        }
+    }
+    return complete;
+}
+
+bool MidiKeymap::set(uint8_t midiChannel, uint8_t note, uint8_t solenoid) {
+    if (midiChannel > MIDI_CHANNEL_COUNT || note >= MIDI_NOTE_COUNT) {
+        return false;
+    }
+    if (solenoid >= MIDI_KEYMAP_MAX_SOLENOIDS && solenoid != MIDI_KEYMAP_UNMAPPED) {
+        return false;
+    }
+
+    uint8_t firstCh = (midiChannel == MIDI_OMNI) ? 0 : midiChannel - 1;
+    uint8_t lastCh = (midiChannel == MIDI_OMNI) ? MIDI_CHANNEL_COUNT - 1 : firstCh;
+    for (uint8_t ch = firstCh; ch <= lastCh; ch++) {
+        _map[ch][note] = solenoid;
+    }
+    return true;
+}
+
+bool MidiKeymap::findNote(uint8_t solenoid, uint8_t& midiChannel, uint8_t& note) const {
+    if (solenoid == MIDI_KEYMAP_UNMAPPED) {
+        return false;
+    }
+
+    for (uint8_t ch = 0; ch < MIDI_CHANNEL_COUNT; ch++) {
+        for (uint8_t n = 0; n < MIDI_NOTE_COUNT; n++) {
+            if (_map[ch][n] == solenoid) {
+                midiChannel = ch + 1;
+                note = n;
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file MidiKeymap.h
+ * @brief Constant-time (MIDI channel, note) to solenoid lookup
+ *
+ * The keymap is a full 16 x 128 table, so looking a note up is one array
+ * read whatever the wiring. It is built from a short list of note ranges,
+ * either at startup or at compile time as a constexpr object (the table
+ * then lives in flash).
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef MIDI_KEYMAP_H
+#define MIDI_KEYMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "PianoMidiConfig.h"
+
+/**
+ * @struct MidiKeyRange
+ * @brief A run of consecutive notes wired to evenly spaced solenoids
+ *
+ * Non-contiguous wiring, several boards or keyboard splits are described
+ * by listing several ranges; later ranges override earlier ones.
+ */
+struct MidiKeyRange {
+    uint8_t midiChannel;     ///< MIDI channel 1-16, or MIDI_OMNI for all channels
+    uint8_t firstNote;       ///< First MIDI note of the range
+    uint8_t lastNote;        ///< Last MIDI note of the range (inclusive)
+    uint8_t firstSolenoid;   ///< Global solenoid index driven by firstNote
+    int8_t stride;           ///< Solenoid step per note (1 = ascending, -1 = wired in reverse)
+};
+
+/**
+ * @class MidiKeymap
+ * @brief 16 x 128 lookup table from (MIDI channel, note) to solenoid
+ *
+ * 2KB of table; lookup() is a bounds check and one read. Entries that
+ * would fall outside 0 to MIDI_KEYMAP_MAX_SOLENOIDS - 1 are left unmapped.
+ *
+ * Example usage:
+ * @code
+ * // Compile time: bass on channel 1, treble on channel 2 wired in reverse
+ * constexpr MidiKeyRange RANGES[] = {
+ *     { 1, 21, 59, 0, 1 },      // A0-B3 -> solenoids 0-38
+ *     { 2, 60, 108, 87, -1 },   // C4-C8 -> solenoids 87-39
+ * };
+ * constexpr MidiKeymap KEYMAP(RANGES);
+ *
+ * uint8_t solenoid = KEYMAP.lookup(channel, note);
+ * if (solenoid != MIDI_KEYMAP_UNMAPPED) {
+ *     driver.on(solenoid, velocity);
+ * }
+ * @endcode
+ */
+class MidiKeymap {
+public:
+    /**
+     * @brief Construct an empty keymap (every note unmapped)
+     */
+    constexpr MidiKeymap() : _map{} {
+        clear();
+    }
+
+    /**
+     * @brief Construct a keymap from a list of ranges
+     *
+     * @tparam N Number of ranges
+     * @param ranges Ranges applied in order
+     *
+     * Usable in a constant expression, so the table can be generated at
+     * compile time.
+     */
+    template <size_t N>
+    constexpr explicit MidiKeymap(const MidiKeyRange (&ranges)[N]) : _map{} {
+        clear();
+        for (size_t i = 0; i < N; i++) {
+            apply(ranges[i]);
+        }
+    }
+
+    /**
+     * @brief Look up the solenoid for a note
+     *
+     * @param midiChannel MIDI channel (1-16)
+     * @param note MIDI note number (0-127)
+     * @return Global solenoid index, or MIDI_KEYMAP_UNMAPPED
+     */
+    constexpr uint8_t lookup(uint8_t midiChannel, uint8_t note) const {
+        return (midiChannel >= 1 && midiChannel <= MIDI_CHANNEL_COUNT && note < MIDI_NOTE_COUNT)
+            ? _map[midiChannel - 1][note]
+            : MIDI_KEYMAP_UNMAPPED;
+    }
+
+    /**
+     * @brief Unmap every note
+     */
+    constexpr void clear() {
+        for (uint8_t ch = 0; ch < MIDI_CHANNEL_COUNT; ch++) {
+            for (uint8_t note = 0; note < MIDI_NOTE_COUNT; note++) {
+                _map[ch][note] = MIDI_KEYMAP_UNMAPPED;
+            }
+        }
+    }
+
+    /**
+     * @brief Map a range of notes on top of the current table
+     *
+     * @param range Range to apply
+     * @return Number of table entries written; notes whose solenoid would be
+     *         out of range, and invalid channels, are skipped
+     */
+    constexpr uint16_t apply(const MidiKeyRange& range) {
+        uint16_t written = 0;
+        if (range.midiChannel > MIDI_CHANNEL_COUNT) {
+            return written;
+        }
+
+        uint8_t firstCh = (range.midiChannel == MIDI_OMNI) ? 0 : range.midiChannel - 1;
+        uint8_t lastCh = (range.midiChannel == MIDI_OMNI) ? MIDI_CHANNEL_COUNT - 1 : firstCh;
+
+        for (uint8_t note = range.firstNote; note <= range.lastNote && note < MIDI_NOTE_COUNT; note++) {
+            int16_t solenoid = range.firstSolenoid + (note - range.firstNote) * range.stride;
+            if (solenoid < 0 || solenoid >= MIDI_KEYMAP_MAX_SOLENOIDS) {
+                continue;
+            }
+            for (uint8_t ch = firstCh; ch <= lastCh; ch++) {
+                _map[ch][note] = static_cast<uint8_t>(solenoid);
+                written++;
+            }
+        }
+        return written;
+    }
+
+    /**
+     * @brief Rebuild the table from a list of ranges at run time
+     *
+     * @param ranges Ranges applied in order
+     * @param count Number of ranges
+     * @return true if every note of every range was mapped, false if any
+     *         were skipped (see apply())
+     */
+    bool build(const MidiKeyRange ranges[], uint8_t count);
+
+    /**
+     * @brief Map a single note
+     *
+     * @param midiChannel MIDI channel (1-16, or MIDI_OMNI)
+     * @param note MIDI note number (0-127)
+     * @param solenoid Global solenoid index, or MIDI_KEYMAP_UNMAPPED to unmap
+     * @return true if set, false if an argument is out of range
+     */
+    bool set(uint8_t midiChannel, uint8_t note, uint8_t solenoid);
+
+    /**
+     * @brief Find the first note that drives a solenoid
+     *
+     * @param solenoid Global solenoid index
+     * @param midiChannel Output: MIDI channel (1-16)
+     * @param note Output: MIDI note number
+     * @return true if found
+     *
+     * Scans the table (lowest channel, then lowest note first) - for
+     * diagnostics, not for the note path.
+     */
+    bool findNote(uint8_t solenoid, uint8_t& midiChannel, uint8_t& note) const;
+
+private:
+    uint8_t _map[MIDI_CHANNEL_COUNT][MIDI_NOTE_COUNT];   ///< Solenoid per (channel - 1, note)
+};
+
+#endif // MIDI_KEYMAP_H
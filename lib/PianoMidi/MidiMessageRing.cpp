@@ -0,0 +1,72 @@
+/**
+ * @file MidiMessageRing.cpp
+ * @brief Implementation of MidiMessageRing class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "MidiMessageRing.h"
+
+/** Ring index mask (capacity is a power of two) */
+static constexpr uint8_t MESSAGE_MASK = MIDI_INPUT_RING_CAPACITY - 1;
+
+static_assert((MIDI_INPUT_RING_CAPACITY & MESSAGE_MASK) == 0,
+              "MIDI_INPUT_RING_CAPACITY must be a power of two");
+
+MidiMessageRing::MidiMessageRing()
+    : _head(0)
+    , _tail(0)
+    , _dropped(0)
+{
+}
+
+bool MidiMessageRing::push(const MidiMessage& message) {
+    uint8_t head = _head;
+    if (static_cast<uint8_t>(head - _tail) >= MIDI_INPUT_RING_CAPACITY) {
+        _dropped = _dropped + 1;
+        return false;
+    }
+
+    _ring[head & MESSAGE_MASK] = message;
+
+    // Publish the message only after it is fully written
+    __asm__ volatile("" ::: "memory");
+    _head = head + 1;
+    return true;
+}
+
+bool MidiMessageRing::peek(MidiMessage& message) const {
+    uint8_t tail = _tail;
+    if (tail == _head) {
+        return false;
+    }
+
+    // Read the slot only after seeing it published
+    __asm__ volatile("" ::: "memory");
+    message = _ring[tail & MESSAGE_MASK];
+    return true;
+}
+
+bool MidiMessageRing::pop(MidiMessage& message) {
+    if (!peek(message)) {
+        return false;
+    }
+
+    // Release the slot only after it has been copied out
+    __asm__ volatile("" ::: "memory");
+    _tail = _tail + 1;
+    return true;
+}
+
+void MidiMessageRing::clear() {
+    _tail = _head;
+}
+
+uint8_t MidiMessageRing::pending() const {
+    return static_cast<uint8_t>(_head - _tail);
+}
+
+uint32_t MidiMessageRing::dropCount() const {
+    return _dropped;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file MidiMessageRing.h
+ * @brief Timestamped MIDI message ring between an input interrupt and loop()
+ *
+ * Each MidiInput source owns one ring. The polling interrupt parses the
+ * source's bytes into messages and pushes them here; MidiInput::update()
+ * pops them in loop(). With one ring per source a burst on one port fills
+ * only its own ring and cannot push out another port's messages.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef MIDI_MESSAGE_RING_H
+#define MIDI_MESSAGE_RING_H
+
+#include <stdint.h>
+
+#include "PianoMidiConfig.h"
+
+/**
+ * @struct MidiMessage
+ * @brief A complete channel message and when it arrived
+ */
+struct MidiMessage {
+    uint32_t timeUs;    ///< SolenoidTimebase::nowUs32() when the last byte was received
+    uint8_t source;     ///< MidiInput source index
+    uint8_t status;     ///< Status byte (running status already applied)
+    uint8_t data1;      ///< First data byte
+    uint8_t data2;      ///< Second data byte (0 for one-byte messages)
+};
+
+/**
+ * @class MidiMessageRing
+ * @brief Lock-free single-producer/single-consumer ring of MIDI messages
+ *
+ * The producer (polling interrupt or loop()) only writes _head and the
+ * consumer (MidiInput::update()) only writes _tail. A full ring rejects
+ * new messages and counts them, so the oldest messages are the ones kept.
+ */
+class MidiMessageRing {
+public:
+    /**
+     * @brief Construct an empty ring
+     */
+    MidiMessageRing();
+
+    /**
+     * @brief Add a message (producer side)
+     *
+     * @param message Message to add
+     * @return true if added, false if the ring was full
+     */
+    bool push(const MidiMessage& message);
+
+    /**
+     * @brief Look at the oldest message without removing it (consumer side)
+     *
+     * @param message Output: the oldest message
+     * @return true if a message was returned, false if the ring is empty
+     */
+    bool peek(MidiMessage& message) const;
+
+    /**
+     * @brief Take the oldest message off the ring (consumer side)
+     *
+     * @param message Output: the oldest message
+     * @return true if a message was returned, false if the ring is empty
+     */
+    bool pop(MidiMessage& message);
+
+    /**
+     * @brief Discard all pending messages (consumer side)
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of messages waiting
+     *
+     * @return Pending message count
+     */
+    uint8_t pending() const;
+
+    /**
+     * @brief Get the number of messages rejected because the ring was full
+     *
+     * @return Rejected message count since construction
+     */
+    uint32_t dropCount() const;
+
+private:
+    MidiMessage _ring[MIDI_INPUT_RING_CAPACITY];    ///< Message storage
+    volatile uint8_t _head;                         ///< Next slot to fill (producer)
+    volatile uint8_t _tail;                         ///< Next slot to read (consumer)
+    volatile uint32_t _dropped;                     ///< Messages lost to a full ring
+};
+
+#endif // MIDI_MESSAGE_RING_H
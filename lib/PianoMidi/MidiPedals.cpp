@@ -0,0 +1,310 @@
+/**
+ * @file MidiPedals.cpp
+ * @brief Implementation of MidiPedals class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "MidiPedals.h"
+
+#include "SolenoidTimebase.h"
+
+MidiPedals::MidiPedals(SolenoidDriverBase& driver)
+    : _driver(driver)
+    , _pedalHoldMs(MIDI_DEFAULT_PEDAL_HOLD_MS)
+{
+    reset();
+}
+
+// =============================================================================
+// NOTES
+// =============================================================================
+
+void MidiPedals::noteOn(uint8_t midiChannel, uint8_t solenoid, uint8_t velocity) {
+    // Velocity 0 is a note-off per the MIDI specification
+    if (velocity == 0) {
+        noteOff(midiChannel, solenoid);
+        return;
+    }
+
+    if (solenoid >= SOLENOID_MAX_CHANNELS) {
+        return;
+    }
+
+    setBit(_keyDown, solenoid);
+    setBit(_sounding, solenoid);
+    clearBit(_coilHeld, solenoid);
+    _keyChannel[solenoid] = midiChannel;
+
+    // A pedal-held coil is let go no earlier than the end of the kick
+    uint32_t kickMs = (_driver.getVelocityMap().lookup(solenoid, velocity).kickUs + 999) / 1000;
+    uint32_t holdMs = (_pedalHoldMs > kickMs) ? _pedalHoldMs : kickMs;
+    _holdUntilMs[solenoid] = SolenoidTimebase::nowMs() + holdMs;
+
+    _driver.on(solenoid, velocity);
+}
+
+void MidiPedals::noteOff(uint8_t midiChannel, uint8_t solenoid) {
+    (void)midiChannel;  // The pedals of the channel that struck the note apply
+
+    if (solenoid >= SOLENOID_MAX_CHANNELS || !testBit(_keyDown, solenoid)) {
+        return;
+    }
+    clearBit(_keyDown, solenoid);
+
+    if (!isDamperRaised(solenoid)) {
+        endNote(solenoid);
+        return;
+    }
+
+    // Held by a pedal: keeps sounding, the coil only waits for the hold time
+    if (static_cast<int32_t>(SolenoidTimebase::nowMs() - _holdUntilMs[solenoid]) >= 0) {
+        _driver.off(solenoid);
+    } else {
+        setBit(_coilHeld, solenoid);
+    }
+}
+
+bool MidiPedals::controlChange(uint8_t midiChannel, uint8_t control, uint8_t value) {
+    if (midiChannel < 1 || midiChannel > MIDI_CHANNEL_COUNT) {
+        return false;
+    }
+
+    uint16_t channelBit = static_cast<uint16_t>(1U << (midiChannel - 1));
+    bool down = value >= MIDI_PEDAL_DOWN_THRESHOLD;
+
+    switch (control) {
+        case MIDI_CC_SUSTAIN:
+            if (down) {
+                _sustainDown |= channelBit;
+            } else if ((_sustainDown & channelBit) != 0) {
+                _sustainDown &= ~channelBit;
+                releasePedal(midiChannel);
+            }
+            return true;
+
+        case MIDI_CC_SOSTENUTO:
+            if (down) {
+                if ((_sostenutoDown & channelBit) == 0) {
+                    // Catch the keys that are down right now, and only those
+                    _sostenutoDown |= channelBit;
+                    for (uint8_t i = 0; i < SOLENOID_MAX_CHANNELS; i++) {
+                        if (_keyChannel[i] == midiChannel && testBit(_keyDown, i)) {
+                            setBit(_caught, i);
+                        }
+                    }
+                }
+            } else if ((_sostenutoDown & channelBit) != 0) {
+                _sostenutoDown &= ~channelBit;
+                for (uint8_t i = 0; i < SOLENOID_MAX_CHANNELS; i++) {
+                    if (_keyChannel[i] == midiChannel) {
+                        clearBit(_caught, i);
+                    }
+                }
+                releasePedal(midiChannel);
+            }
+            return true;
+
+        case MIDI_CC_RESET_CONTROLLERS:
+            _sustainDown &= ~channelBit;
+            _sostenutoDown &= ~channelBit;
+            for (uint8_t i = 0; i < SOLENOID_MAX_CHANNELS; i++) {
+                if (_keyChannel[i] == midiChannel) {
+                    clearBit(_caught, i);
+                }
+            }
+            releasePedal(midiChannel);
+            return true;
+
+        case MIDI_CC_ALL_NOTES_OFF:
+            releaseKeys(midiChannel);
+            return true;
+
+        case MIDI_CC_ALL_SOUND_OFF:
+            silenceChannel(midiChannel);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void MidiPedals::update() {
+    bool open = false;
+    uint32_t nowMs = SolenoidTimebase::nowMs();
+
+    for (uint8_t word = 0; word < SOLENOID_MASK_WORDS; word++) {
+        uint32_t bits = _coilHeld[word];
+        while (bits != 0) {
+            uint8_t solenoid = (word << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            if (static_cast<int32_t>(nowMs - _holdUntilMs[solenoid]) < 0) {
+                continue;
+            }
+
+            // Coils that come due together share one write per board
+            if (!open) {
+                _driver.beginTransaction();
+                open = true;
+            }
+            clearBit(_coilHeld, solenoid);
+            _driver.off(solenoid);
+        }
+    }
+
+    if (open) {
+        _driver.commit();
+    }
+}
+
+void MidiPedals::reset() {
+    for (uint8_t word = 0; word < SOLENOID_MASK_WORDS; word++) {
+        _keyDown[word] = 0;
+        _sounding[word] = 0;
+        _caught[word] = 0;
+        _coilHeld[word] = 0;
+    }
+    for (uint8_t i = 0; i < SOLENOID_MAX_CHANNELS; i++) {
+        _keyChannel[i] = 0;
+        _holdUntilMs[i] = 0;
+    }
+    _sustainDown = 0;
+    _sostenutoDown = 0;
+}
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+
+void MidiPedals::setPedalHoldMs(uint32_t holdMs) {
+    _pedalHoldMs = holdMs;
+}
+
+uint32_t MidiPedals::getPedalHoldMs() const {
+    return _pedalHoldMs;
+}
+
+// =============================================================================
+// STATUS
+// =============================================================================
+
+bool MidiPedals::isSustainDown(uint8_t midiChannel) const {
+    if (midiChannel < 1 || midiChannel > MIDI_CHANNEL_COUNT) {
+        return false;
+    }
+    return (_sustainDown >> (midiChannel - 1)) & 0x01;
+}
+
+bool MidiPedals::isSostenutoDown(uint8_t midiChannel) const {
+    if (midiChannel < 1 || midiChannel > MIDI_CHANNEL_COUNT) {
+        return false;
+    }
+    return (_sostenutoDown >> (midiChannel - 1)) & 0x01;
+}
+
+bool MidiPedals::isSounding(uint8_t solenoid) const {
+    return solenoid < SOLENOID_MAX_CHANNELS && testBit(_sounding, solenoid);
+}
+
+uint8_t MidiPedals::getSoundingCount() const {
+    return countBits(_sounding);
+}
+
+uint8_t MidiPedals::getPedalHeldCount() const {
+    uint8_t count = 0;
+    for (uint8_t word = 0; word < SOLENOID_MASK_WORDS; word++) {
+        count += __builtin_popcount(_sounding[word] & ~_keyDown[word]);
+    }
+    return count;
+}
+
+// =============================================================================
+// PRIVATE
+// =============================================================================
+
+bool MidiPedals::isDamperRaised(uint8_t solenoid) const {
+    uint8_t midiChannel = _keyChannel[solenoid];
+    bool sustained = midiChannel >= 1 && midiChannel <= MIDI_CHANNEL_COUNT &&
+        ((_sustainDown >> (midiChannel - 1)) & 0x01);
+    return sustained || testBit(_caught, solenoid);
+}
+
+void MidiPedals::endNote(uint8_t solenoid) {
+    clearBit(_sounding, solenoid);
+    clearBit(_coilHeld, solenoid);
+    clearBit(_caught, solenoid);
+    _driver.off(solenoid);
+}
+
+void MidiPedals::releasePedal(uint8_t midiChannel) {
+    // One write per board for every coil still energized; notes whose coil
+    // was already let go only change state here
+    _driver.beginTransaction();
+    for (uint8_t word = 0; word < SOLENOID_MASK_WORDS; word++) {
+        uint32_t bits = _sounding[word] & ~_keyDown[word];
+        while (bits != 0) {
+            uint8_t solenoid = (word << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            if (_keyChannel[solenoid] == midiChannel && !isDamperRaised(solenoid)) {
+                endNote(solenoid);
+            }
+        }
+    }
+    _driver.commit();
+}
+
+void MidiPedals::releaseKeys(uint8_t midiChannel) {
+    _driver.beginTransaction();
+    for (uint8_t word = 0; word < SOLENOID_MASK_WORDS; word++) {
+        uint32_t bits = _keyDown[word];
+        while (bits != 0) {
+            uint8_t solenoid = (word << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            if (_keyChannel[solenoid] == midiChannel) {
+                noteOff(midiChannel, solenoid);
+            }
+        }
+    }
+    _driver.commit();
+}
+
+void MidiPedals::silenceChannel(uint8_t midiChannel) {
+    _driver.beginTransaction();
+    for (uint8_t word = 0; word < SOLENOID_MASK_WORDS; word++) {
+        uint32_t bits = _sounding[word];
+        while (bits != 0) {
+            uint8_t solenoid = (word << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            if (_keyChannel[solenoid] == midiChannel) {
+                clearBit(_keyDown, solenoid);
+                endNote(solenoid);
+            }
+        }
+    }
+    _driver.commit();
+}
+
+bool MidiPedals::testBit(const uint32_t mask[], uint8_t solenoid) {
+    return (mask[solenoid >> 5] >> (solenoid & 31)) & 0x01;
+}
+
+void MidiPedals::setBit(uint32_t mask[], uint8_t solenoid) {
+    mask[solenoid >> 5] |= (1UL << (solenoid & 31));
+}
+
+void MidiPedals::clearBit(uint32_t mask[], uint8_t solenoid) {
+    mask[solenoid >> 5] &= ~(1UL << (solenoid & 31));
+}
+
+uint8_t MidiPedals::countBits(const uint32_t mask[]) {
+    uint8_t count = 0;
+    for (uint8_t word = 0; word < SOLENOID_MASK_WORDS; word++) {
+        count += __builtin_popcount(mask[word]);
+    }
+    return count;
+}
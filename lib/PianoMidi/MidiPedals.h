@@ -0,0 +1,256 @@
+/**
+ * @file MidiPedals.h
+ * @brief Sustain and sostenuto pedal handling for the MIDI front end
+ *
+ * Tracks which notes are sounding separately from which coils are
+ * energized. A note the pedal holds keeps sounding logically, but its coil
+ * is let go once the strike and a short hold are over, so pedalled passages
+ * do not spend the coils' duty cycle and thermal budget on keys that only
+ * need to stay down in the MIDI data.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef MIDI_PEDALS_H
+#define MIDI_PEDALS_H
+
+#include <stdint.h>
+
+#include "PianoMidiConfig.h"
+#include "SolenoidDriver.h"
+
+/**
+ * @class MidiPedals
+ * @brief Note and pedal state between the MIDI handlers and SolenoidDriver
+ *
+ * Notes go through noteOn()/noteOff() instead of straight to the driver.
+ * While a pedal holds a released note it stays in the sounding mask; its
+ * coil is switched off at the pedal hold time after the strike (see
+ * setPedalHoldMs()), or right away if that has already passed. Lifting the
+ * pedal ends every note it held in one transaction, so coils that are still
+ * energized go out in a single write per board and notes whose coil is
+ * already off cost no bus traffic at all.
+ *
+ * Pedals are tracked per MIDI channel; a note follows the pedals of the
+ * channel that struck it.
+ *
+ * Example usage:
+ * @code
+ * MidiPedals pedals(driver);
+ *
+ * void handleNoteOn(byte channel, byte note, byte velocity) {
+ *     pedals.noteOn(channel, KEYMAP.lookup(channel, note), velocity);
+ * }
+ * void handleControlChange(byte channel, byte control, byte value) {
+ *     pedals.controlChange(channel, control, value);
+ * }
+ * void loop() {
+ *     driver.beginTransaction();
+ *     while (usbMIDI.read()) { }
+ *     pedals.update();
+ *     driver.commit();
+ *     driver.update();
+ * }
+ * @endcode
+ */
+class MidiPedals {
+public:
+    /**
+     * @brief Construct with every pedal up and no note sounding
+     *
+     * @param driver Driver the notes are played on
+     */
+    explicit MidiPedals(SolenoidDriverBase& driver);
+
+    // =========================================================================
+    // NOTES
+    // =========================================================================
+
+    /**
+     * @brief Key pressed
+     *
+     * @param midiChannel MIDI channel (1-16) whose pedals apply to the note
+     * @param solenoid Global solenoid index (MIDI_KEYMAP_UNMAPPED is ignored)
+     * @param velocity MIDI velocity (0 is a note-off)
+     *
+     * Strikes the solenoid with SolenoidDriver::on(solenoid, velocity).
+     */
+    void noteOn(uint8_t midiChannel, uint8_t solenoid, uint8_t velocity);
+
+    /**
+     * @brief Key released
+     *
+     * @param midiChannel MIDI channel (1-16)
+     * @param solenoid Global solenoid index (MIDI_KEYMAP_UNMAPPED is ignored)
+     *
+     * Without a pedal the coil is switched off. With the sustain pedal down
+     * (or the note caught by sostenuto) the note keeps sounding and its
+     * coil is released at the end of the pedal hold time.
+     */
+    void noteOff(uint8_t midiChannel, uint8_t solenoid);
+
+    /**
+     * @brief Apply a control change
+     *
+     * @param midiChannel MIDI channel (1-16)
+     * @param control Controller number
+     * @param value Controller value (0-127)
+     * @return true if the controller is one handled here: MIDI_CC_SUSTAIN,
+     *         MIDI_CC_SOSTENUTO, MIDI_CC_ALL_SOUND_OFF,
+     *         MIDI_CC_RESET_CONTROLLERS or MIDI_CC_ALL_NOTES_OFF
+     */
+    bool controlChange(uint8_t midiChannel, uint8_t control, uint8_t value);
+
+    /**
+     * @brief Release the coils of pedal-held notes whose hold time is over
+     *
+     * Call from loop(). Coils that come due together are released in one
+     * transaction.
+     */
+    void update();
+
+    /**
+     * @brief Forget every note and lift every pedal without touching the driver
+     *
+     * For use after SolenoidDriver::emergencyStop(), which has already
+     * switched every coil off.
+     */
+    void reset();
+
+    // =========================================================================
+    // CONFIGURATION
+    // =========================================================================
+
+    /**
+     * @brief Set how long a pedal-held note keeps its coil energized
+     *
+     * @param holdMs Time from the strike (ms). The kick always completes,
+     *               so 0 releases the coil as soon as the strike is over.
+     *               Default: MIDI_DEFAULT_PEDAL_HOLD_MS
+     *
+     * Applies to notes struck after the call.
+     */
+    void setPedalHoldMs(uint32_t holdMs);
+
+    /**
+     * @brief Get the pedal hold time
+     *
+     * @return Time from the strike (ms)
+     */
+    uint32_t getPedalHoldMs() const;
+
+    // =========================================================================
+    // STATUS
+    // =========================================================================
+
+    /**
+     * @brief Check if a channel's sustain pedal is down
+     *
+     * @param midiChannel MIDI channel (1-16)
+     * @return true if down
+     */
+    bool isSustainDown(uint8_t midiChannel) const;
+
+    /**
+     * @brief Check if a channel's sostenuto pedal is down
+     *
+     * @param midiChannel MIDI channel (1-16)
+     * @return true if down
+     */
+    bool isSostenutoDown(uint8_t midiChannel) const;
+
+    /**
+     * @brief Check if a note is sounding (key down or held by a pedal)
+     *
+     * @param solenoid Global solenoid index
+     * @return true if sounding, whether or not its coil is energized
+     */
+    bool isSounding(uint8_t solenoid) const;
+
+    /**
+     * @brief Get the number of sounding notes
+     *
+     * @return Notes with the key down or held by a pedal
+     */
+    uint8_t getSoundingCount() const;
+
+    /**
+     * @brief Get the number of notes held only by a pedal
+     *
+     * @return Sounding notes whose key is up
+     */
+    uint8_t getPedalHeldCount() const;
+
+private:
+    SolenoidDriverBase& _driver;                            ///< Driver the notes are played on
+
+    uint32_t _keyDown[SOLENOID_MASK_WORDS];                 ///< Bit set = key down
+    uint32_t _sounding[SOLENOID_MASK_WORDS];                ///< Bit set = key down or held by a pedal
+    uint32_t _caught[SOLENOID_MASK_WORDS];                  ///< Bit set = held by sostenuto
+    uint32_t _coilHeld[SOLENOID_MASK_WORDS];                ///< Bit set = key up, coil released by update()
+    uint8_t _keyChannel[SOLENOID_MAX_CHANNELS];             ///< MIDI channel (1-16) that struck the note
+    uint32_t _holdUntilMs[SOLENOID_MAX_CHANNELS];           ///< Pedal-held coil release time (timebase ms)
+    uint16_t _sustainDown;                                  ///< Bit per MIDI channel (bit 0 = channel 1)
+    uint16_t _sostenutoDown;                                ///< Bit per MIDI channel
+    uint32_t _pedalHoldMs;                                  ///< Coil hold time of pedal-held notes
+
+    /**
+     * @brief Check if a pedal keeps a released note sounding
+     *
+     * @param solenoid Global solenoid index
+     */
+    bool isDamperRaised(uint8_t solenoid) const;
+
+    /**
+     * @brief End a note: clear its sounding state and switch its coil off
+     *
+     * @param solenoid Global solenoid index
+     *
+     * SolenoidDriver::off() is a no-op for a coil that is already off.
+     */
+    void endNote(uint8_t solenoid);
+
+    /**
+     * @brief End the released notes of a channel that no pedal holds any more
+     *
+     * @param midiChannel MIDI channel (1-16)
+     */
+    void releasePedal(uint8_t midiChannel);
+
+    /**
+     * @brief Release every key of a channel, as if each got a note-off
+     *
+     * @param midiChannel MIDI channel (1-16)
+     */
+    void releaseKeys(uint8_t midiChannel);
+
+    /**
+     * @brief End every note of a channel, pedals or not
+     *
+     * @param midiChannel MIDI channel (1-16)
+     */
+    void silenceChannel(uint8_t midiChannel);
+
+    /**
+     * @brief Test a solenoid's bit in a mask
+     */
+    static bool testBit(const uint32_t mask[], uint8_t solenoid);
+
+    /**
+     * @brief Set a solenoid's bit in a mask
+     */
+    static void setBit(uint32_t mask[], uint8_t solenoid);
+
+    /**
+     * @brief Clear a solenoid's bit in a mask
+     */
+    static void clearBit(uint32_t mask[], uint8_t solenoid);
+
+    /**
+     * @brief Count the set bits of a mask
+     */
+    static uint8_t countBits(const uint32_t mask[]);
+};
+
+#endif // MIDI_PEDALS_H
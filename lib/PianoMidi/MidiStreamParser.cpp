@@ -0,0 +1,69 @@
+/**
+ * @file MidiStreamParser.cpp
+ * @brief Implementation of MidiStreamParser class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "MidiStreamParser.h"
+
+MidiStreamParser::MidiStreamParser()
+    : _status(0)
+    , _data1(0)
+    , _length(0)
+    , _count(0)
+    , _sysex(false)
+{
+}
+
+bool MidiStreamParser::feed(uint8_t value, MidiMessage& message) {
+    if (value >= 0xF8) {
+        // System Real-Time - may interleave with anything
+        return false;
+    }
+
+    if (value >= 0xF0) {
+        // SysEx start/end and System Common end running status
+        _sysex = (value == 0xF0);
+        _status = 0;
+        _count = 0;
+        return false;
+    }
+
+    if (value & 0x80) {
+        uint8_t type = value & 0xF0;
+        _status = value;
+        _length = (type == 0xC0 || type == 0xD0) ? 1 : 2;
+        _count = 0;
+        _sysex = false;
+        return false;
+    }
+
+    if (_sysex || _status == 0) {
+        return false;
+    }
+
+    if (_count == 0 && _length == 2) {
+        _data1 = value;
+        _count = 1;
+        return false;
+    }
+
+    message.status = _status;
+    if (_length == 1) {
+        message.data1 = value;
+        message.data2 = 0;
+    } else {
+        message.data1 = _data1;
+        message.data2 = value;
+    }
+    _count = 0;
+    return true;
+}
+
+void MidiStreamParser::reset() {
+    _status = 0;
+    _count = 0;
+    _sysex = false;
+}
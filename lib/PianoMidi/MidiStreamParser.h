@@ -0,0 +1,63 @@
+/**
+ * @file MidiStreamParser.h
+ * @brief Byte-at-a-time parser for a MIDI 1.0 serial stream
+ *
+ * Turns the raw bytes of a DIN (UART) port into complete channel messages.
+ * Cheap enough to run from the polling interrupt: one call per byte, no
+ * loops, a few bytes of state.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef MIDI_STREAM_PARSER_H
+#define MIDI_STREAM_PARSER_H
+
+#include <stdint.h>
+
+#include "MidiMessageRing.h"
+
+/**
+ * @class MidiStreamParser
+ * @brief Running-status MIDI byte parser
+ *
+ * - Running status is followed: data bytes after a complete message reuse
+ *   the last channel status, as keyboards send long note runs.
+ * - System Real-Time bytes (0xF8-0xFF, e.g. MIDI clock and Active Sensing)
+ *   may appear anywhere, even inside a message; they are ignored and do
+ *   not disturb the message in progress.
+ * - SysEx (0xF0 ... 0xF7) and System Common messages are skipped and
+ *   cancel running status, as the MIDI specification requires.
+ * - Stray data bytes with no status are dropped.
+ */
+class MidiStreamParser {
+public:
+    /**
+     * @brief Construct a parser waiting for a status byte
+     */
+    MidiStreamParser();
+
+    /**
+     * @brief Feed one received byte
+     *
+     * @param value Byte from the port
+     * @param message Output: status and data bytes of a completed message
+     *                (timeUs and source are left for the caller)
+     * @return true if the byte completed a channel message
+     */
+    bool feed(uint8_t value, MidiMessage& message);
+
+    /**
+     * @brief Forget running status and any partial message
+     */
+    void reset();
+
+private:
+    uint8_t _status;      ///< Running status (0 = none)
+    uint8_t _data1;       ///< First data byte of the message in progress
+    uint8_t _length;      ///< Data bytes of the current status (1 or 2)
+    uint8_t _count;       ///< Data bytes received so far
+    bool _sysex;          ///< Inside a SysEx message
+};
+
+#endif // MIDI_STREAM_PARSER_H
@@ -0,0 +1,94 @@
+/**
+ * @file MidiTempoMap.cpp
+ * @brief Implementation of MidiTempoMap class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "MidiTempoMap.h"
+
+MidiTempoMap::MidiTempoMap()
+    : _count(0)
+    , _cursor(0)
+    , _division(480)
+    , _smpte(false)
+{
+    reset(480);
+}
+
+void MidiTempoMap::reset(uint16_t division) {
+    _division = (division == 0) ? 480 : division;
+    _smpte = (_division & 0x8000) != 0;
+
+    _segments[0].tick = 0;
+    _segments[0].startUs = 0;
+    _segments[0].usPerTickQ16 = tickLengthQ16(MIDI_SMF_DEFAULT_TEMPO_US);
+    _count = 1;
+    _cursor = 0;
+}
+
+bool MidiTempoMap::addTempo(uint32_t tick, uint32_t usPerQuarter) {
+    // SMPTE ticks have a fixed length
+    if (_smpte || usPerQuarter == 0) {
+        return true;
+    }
+
+    MidiTempoSegment& last = _segments[_count - 1];
+    if (tick <= last.tick) {
+        // Same tick (or out of order): the later event wins
+        last.usPerTickQ16 = tickLengthQ16(usPerQuarter);
+        return true;
+    }
+
+    if (_count > MIDI_SMF_MAX_TEMPO_CHANGES) {
+        return false;
+    }
+
+    MidiTempoSegment& next = _segments[_count];
+    next.tick = tick;
+    next.startUs = last.startUs + scale(tick - last.tick, last.usPerTickQ16);
+    next.usPerTickQ16 = tickLengthQ16(usPerQuarter);
+    _count++;
+    return true;
+}
+
+uint64_t MidiTempoMap::tickToUs(uint32_t tick) {
+    // Events arrive in tick order, so the cursor rarely moves more than one
+    while (_cursor + 1 < _count && _segments[_cursor + 1].tick <= tick) {
+        _cursor++;
+    }
+    while (_cursor > 0 && _segments[_cursor].tick > tick) {
+        _cursor--;
+    }
+
+    const MidiTempoSegment& seg = _segments[_cursor];
+    return seg.startUs + scale(tick - seg.tick, seg.usPerTickQ16);
+}
+
+uint8_t MidiTempoMap::getSegmentCount() const {
+    return _count;
+}
+
+uint64_t MidiTempoMap::scale(uint32_t ticks, uint64_t usPerTickQ16) {
+    // Rounded to the nearest microsecond
+    return ((static_cast<uint64_t>(ticks) * usPerTickQ16) + 0x8000) >> 16;
+}
+
+uint64_t MidiTempoMap::tickLengthQ16(uint32_t usPerQuarter) const {
+    if (!_smpte) {
+        return (static_cast<uint64_t>(usPerQuarter) << 16) / _division;
+    }
+
+    // SMPTE: negative frame rate in the high byte, ticks per frame in the low
+    uint8_t fps = static_cast<uint8_t>(-static_cast<int8_t>(_division >> 8));
+    uint8_t ticksPerFrame = _division & 0xFF;
+    if (fps == 0 || ticksPerFrame == 0) {
+        return (static_cast<uint64_t>(MIDI_SMF_DEFAULT_TEMPO_US) << 16) / 480;
+    }
+    if (fps == 29) {
+        // 29.97 drop-frame
+        return (1000000ULL * 1001 << 16) / (30000ULL * ticksPerFrame);
+    }
+    return (1000000ULL << 16) / (static_cast<uint32_t>(fps) * ticksPerFrame);
+}
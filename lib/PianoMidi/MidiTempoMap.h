@@ -0,0 +1,112 @@
+/**
+ * @file MidiTempoMap.h
+ * @brief Precomputed tick-to-microsecond conversion for Standard MIDI Files
+ *
+ * The tempo map is built once when a file is opened. Each tempo change
+ * starts a segment holding its absolute start time and a fixed-point
+ * microseconds-per-tick rate, so converting an event's tick to a time is
+ * one 64-bit multiply and shift - no division on the playback path.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef MIDI_TEMPO_MAP_H
+#define MIDI_TEMPO_MAP_H
+
+#include <stdint.h>
+
+#include "PianoMidiConfig.h"
+
+/**
+ * @struct MidiTempoSegment
+ * @brief A span of ticks played at one tempo
+ */
+struct MidiTempoSegment {
+    uint32_t tick;             ///< First tick of the segment
+    uint64_t startUs;          ///< Time of that tick from the start of the file (us)
+    uint64_t usPerTickQ16;     ///< Microseconds per tick, 16.16 fixed point
+};
+
+/**
+ * @class MidiTempoMap
+ * @brief Tick to microsecond conversion through precomputed tempo segments
+ *
+ * tickToUs() keeps a cursor into the segments, so converting events in
+ * playback order is O(1); seeking backwards walks the cursor back.
+ *
+ * Example usage:
+ * @code
+ * MidiTempoMap map;
+ * map.reset(480);                  // 480 ticks per quarter note
+ * map.addTempo(1920, 250000);      // 240 BPM from bar 2
+ * uint64_t us = map.tickToUs(2400);  // 2s + 250ms
+ * @endcode
+ */
+class MidiTempoMap {
+public:
+    /**
+     * @brief Construct a map at 120 BPM, 480 ticks per quarter note
+     */
+    MidiTempoMap();
+
+    /**
+     * @brief Clear every tempo change
+     *
+     * @param division SMF header division: ticks per quarter note, or with
+     *                 the top bit set an SMPTE frame rate and ticks per frame
+     */
+    void reset(uint16_t division);
+
+    /**
+     * @brief Add a Set Tempo event
+     *
+     * @param tick Absolute tick of the event (not before the previous one)
+     * @param usPerQuarter Tempo in microseconds per quarter note
+     * @return false if the map is full (the change is ignored)
+     *
+     * Ignored with SMPTE timing, where ticks have a fixed length.
+     */
+    bool addTempo(uint32_t tick, uint32_t usPerQuarter);
+
+    /**
+     * @brief Convert an absolute tick to microseconds from the start
+     *
+     * @param tick Absolute tick
+     * @return Time in microseconds
+     */
+    uint64_t tickToUs(uint32_t tick);
+
+    /**
+     * @brief Get the number of tempo segments
+     *
+     * @return 1 plus the number of tempo changes kept
+     */
+    uint8_t getSegmentCount() const;
+
+private:
+    MidiTempoSegment _segments[MIDI_SMF_MAX_TEMPO_CHANGES + 1];   ///< Segments in tick order
+    uint8_t _count;                                               ///< Segments in use (at least 1)
+    uint8_t _cursor;                                              ///< Segment of the last conversion
+    uint16_t _division;                                           ///< SMF header division
+    bool _smpte;                                                  ///< Division is SMPTE based
+
+    /**
+     * @brief Fixed-point tick length for a tempo
+     *
+     * @param usPerQuarter Tempo in microseconds per quarter note
+     * @return Microseconds per tick, 16.16 fixed point
+     */
+    uint64_t tickLengthQ16(uint32_t usPerQuarter) const;
+
+    /**
+     * @brief Length of a span of ticks at one tempo
+     *
+     * @param ticks Number of ticks
+     * @param usPerTickQ16 Tick length, 16.16 fixed point
+     * @return Microseconds, rounded
+     */
+    static uint64_t scale(uint32_t ticks, uint64_t usPerTickQ16);
+};
+
+#endif // MIDI_TEMPO_MAP_H
@@ -0,0 +1,157 @@
+/**
+ * @file PianoMidiConfig.h
+ * @brief Configuration constants for the PianoMidi library
+ *
+ * The PianoMidi library turns MIDI input into SolenoidDriver calls. This
+ * file holds the constants shared by its components.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef PIANO_MIDI_CONFIG_H
+#define PIANO_MIDI_CONFIG_H
+
+#include <stdint.h>
+
+#include "SolenoidConfig.h"
+
+// =============================================================================
+// MIDI CONSTANTS
+// =============================================================================
+
+/** Number of MIDI channels (numbered 1-16 in the API, as delivered by usbMIDI) */
+constexpr uint8_t MIDI_CHANNEL_COUNT = 16;
+
+/** Number of MIDI note numbers (0-127) */
+constexpr uint8_t MIDI_NOTE_COUNT = 128;
+
+/** Channel value meaning "every MIDI channel" in keymap ranges */
+constexpr uint8_t MIDI_OMNI = 0;
+
+// =============================================================================
+// KEYMAP
+// =============================================================================
+
+/** Keymap entry for a note that drives no solenoid */
+constexpr uint8_t MIDI_KEYMAP_UNMAPPED = 0xFF;
+
+/** Solenoids a keymap can address (the full SolenoidDriver channel range) */
+constexpr uint8_t MIDI_KEYMAP_MAX_SOLENOIDS = SOLENOID_MAX_CHANNELS;
+
+// =============================================================================
+// PEDALS
+// =============================================================================
+
+/** Control change: damper (sustain) pedal */
+constexpr uint8_t MIDI_CC_SUSTAIN = 64;
+
+/** Control change: sostenuto pedal */
+constexpr uint8_t MIDI_CC_SOSTENUTO = 66;
+
+/** Channel mode message: all sound off (ends notes regardless of pedals) */
+constexpr uint8_t MIDI_CC_ALL_SOUND_OFF = 120;
+
+/** Channel mode message: reset all controllers (lifts the pedals) */
+constexpr uint8_t MIDI_CC_RESET_CONTROLLERS = 121;
+
+/** Channel mode message: all notes off (pedals still sustain) */
+constexpr uint8_t MIDI_CC_ALL_NOTES_OFF = 123;
+
+/** Pedal controller value at or above which the pedal is down */
+constexpr uint8_t MIDI_PEDAL_DOWN_THRESHOLD = 64;
+
+/** Default longest a pedal-held note keeps its coil energized (ms) */
+constexpr uint32_t MIDI_DEFAULT_PEDAL_HOLD_MS = 250;
+
+// =============================================================================
+// MIDI INPUT
+// =============================================================================
+
+/** Most input sources (serial ports and USB cables) a MidiInput merges */
+constexpr uint8_t MIDI_INPUT_MAX_SOURCES = 4;
+
+/** Messages each source can buffer between merges (power of two) */
+constexpr uint8_t MIDI_INPUT_RING_CAPACITY = 64;
+
+/** Source index returned when a source cannot be added */
+constexpr uint8_t MIDI_INPUT_NO_SOURCE = 0xFF;
+
+/** DIN MIDI baud rate */
+constexpr uint32_t MIDI_DIN_BAUD = 31250;
+
+/** Extra UART receive buffer per serial source (bytes, Teensy only) */
+constexpr uint16_t MIDI_INPUT_SERIAL_RX_BYTES = 256;
+
+/**
+ * Default rate of the interrupt that moves serial bytes into the source
+ * rings (Hz). At 31250 baud a byte takes 320us, so 4kHz timestamps every
+ * byte to within a quarter of that.
+ */
+constexpr uint32_t MIDI_INPUT_DEFAULT_POLL_HZ = 4000;
+
+/** NVIC priority of the polling interrupt - below the driver tick (176) */
+constexpr uint8_t MIDI_INPUT_IRQ_PRIORITY = 192;
+
+/** Most merged messages dispatched per MidiInput::update() */
+constexpr uint8_t MIDI_INPUT_MAX_MESSAGES_PER_UPDATE = 32;
+
+// =============================================================================
+// STANDARD MIDI FILE PLAYER
+// =============================================================================
+
+/** Most tracks a Standard MIDI File may have to be played */
+constexpr uint8_t MIDI_SMF_MAX_TRACKS = 16;
+
+/** Size of each half of a track's double buffer (bytes) */
+constexpr uint16_t MIDI_SMF_CHUNK_BYTES = 256;
+
+/** Most tempo changes kept in the precomputed tempo map */
+constexpr uint8_t MIDI_SMF_MAX_TEMPO_CHANGES = 128;
+
+/** Tempo until the first Set Tempo event (us per quarter note) - 120 BPM */
+constexpr uint32_t MIDI_SMF_DEFAULT_TEMPO_US = 500000;
+
+/** Default time ahead of playback at which notes are handed to the driver (us) */
+constexpr uint32_t MIDI_SMF_DEFAULT_LOOKAHEAD_US = 50000;
+
+/** Scheduler slots the player leaves free for kicks, hold edges and live input */
+constexpr uint8_t MIDI_SMF_SCHEDULER_RESERVE = 32;
+
+/** Most file events handed to the driver per MidiFilePlayer::update() */
+constexpr uint8_t MIDI_SMF_MAX_EVENTS_PER_UPDATE = 16;
+
+/** Control changes read ahead and waiting for their time (must be a power of two) */
+constexpr uint8_t MIDI_SMF_CONTROL_QUEUE_CAPACITY = 16;
+
+/**
+ * @enum MidiFileError
+ * @brief Error codes reported by MidiFilePlayer
+ */
+enum class MidiFileError : uint8_t {
+    /** No error */
+    OK = 0,
+
+    /** File could not be opened */
+    OPEN_FAILED = 1,
+
+    /** File is not a Standard MIDI File (missing MThd/MTrk) */
+    NOT_SMF = 2,
+
+    /** SMF format 2 (independent sequences) is not supported */
+    UNSUPPORTED_FORMAT = 3,
+
+    /** File has more than MIDI_SMF_MAX_TRACKS tracks */
+    TOO_MANY_TRACKS = 4,
+
+    /** Read from the card failed or the file ended early */
+    READ_FAILED = 5,
+
+    /** Malformed track data (e.g. data byte without running status) */
+    BAD_EVENT = 6,
+
+    /** More than MIDI_SMF_MAX_TEMPO_CHANGES tempo changes; later ones ignored */
+    TEMPO_MAP_FULL = 7
+};
+
+#endif // PIANO_MIDI_CONFIG_H
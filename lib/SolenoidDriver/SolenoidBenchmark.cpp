@@ -0,0 +1,321 @@
+/**
+ * @file SolenoidBenchmark.cpp
+ * @brief Implementation of SolenoidBenchmark class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidBenchmark.h"
+
+#include "SolenoidTimebase.h"
+
+/** Benchmark receiving the driver's transmit callback during run() */
+static SolenoidBenchmark* s_running = nullptr;
+
+/** I2C bits of a register write besides its data: START, address, register, STOP */
+static constexpr uint32_t FRAME_OVERHEAD_BITS = 1 + 9 + 9 + 1;
+
+// Workload names
+static const char STR_CHORD[] = "chord";
+static const char STR_TRILL[] = "trill";
+static const char STR_GLISSANDO[] = "glissando";
+
+SolenoidBenchmark::SolenoidBenchmark(SolenoidDriverBase& driver)
+    : _driver(driver)
+    , _strikeCount(0)
+    , _writeCount(0)
+    , _elapsedUs(0)
+    , _step(0)
+    , _lastChannel(0xFF)
+    , _chordHeld(false)
+    , _releaseUs(0)
+{
+    for (uint8_t i = 0; i < SOLENOID_MASK_WORDS; i++) {
+        _awaiting[i] = 0;
+    }
+}
+
+bool SolenoidBenchmark::run(const SolenoidBenchConfig& config, SolenoidBenchNoteHandler handler) {
+    if (!_driver.isInitialized() || handler == nullptr || s_running != nullptr) {
+        return false;
+    }
+    if (config.rateHz == 0 || config.rateHz > 1000000 || config.velocity == 0 || config.channelCount == 0 ||
+        config.firstChannel + config.channelCount > _driver.getChannelCount()) {
+        return false;
+    }
+    if (config.workload == SolenoidBenchWorkload::TRILL && config.channelCount < 2) {
+        return false;
+    }
+
+#if defined(__IMXRT1062__)
+    // Normally already running when the timebase uses it
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+
+    _config = config;
+    _noteToWire.reset();
+    _noteCost.reset();
+    _updateCost.reset();
+    for (uint8_t i = 0; i < SOLENOID_MASK_WORDS; i++) {
+        _awaiting[i] = 0;
+    }
+    _strikeCount = 0;
+    _writeCount = 0;
+    _step = 0;
+    _lastChannel = 0xFF;
+    _chordHeld = false;
+
+    s_running = this;
+    _driver.setTransmitCallback(transmitCallback);
+
+    uint32_t periodUs = 1000000 / config.rateHz;
+    uint32_t startUs = SolenoidTimebase::nowUs32();
+    uint32_t endUs = startUs + (config.durationMs * 1000);
+    uint32_t nextUs = startUs;
+    uint32_t nowUs = startUs;
+
+    while (static_cast<int32_t>(nowUs - endUs) < 0) {
+        if (static_cast<int32_t>(nowUs - nextUs) >= 0) {
+            // One event per transaction, as loop() commits its MIDI batch
+            _driver.beginTransaction();
+            playEvent(handler);
+            _driver.commit();
+            if (_config.workload == SolenoidBenchWorkload::CHORD) {
+                _chordHeld = true;
+                _releaseUs = nextUs + (periodUs / 2);
+            }
+            nextUs += periodUs;
+        }
+
+        if (_chordHeld && static_cast<int32_t>(nowUs - _releaseUs) >= 0) {
+            releaseAll(handler);
+        }
+
+        uint32_t before = cycles();
+        _driver.update();
+        _updateCost.record(cycles() - before);
+
+        nowUs = SolenoidTimebase::nowUs32();
+    }
+
+    // Let the last strikes and releases reach the wire
+    releaseAll(handler);
+    uint32_t drainStartMs = SolenoidTimebase::nowMs();
+    while (SolenoidTimebase::nowMs() - drainStartMs < SOLENOID_BENCH_DRAIN_MS) {
+        _driver.update();
+    }
+
+    _elapsedUs = SolenoidTimebase::nowUs32() - startUs;
+    _driver.setTransmitCallback(nullptr);
+    s_running = nullptr;
+    return true;
+}
+
+void SolenoidBenchmark::printReport(Print& out) const {
+    out.print(F("Workload: "));
+    switch (_config.workload) {
+        case SolenoidBenchWorkload::CHORD:     out.print(STR_CHORD); break;
+        case SolenoidBenchWorkload::TRILL:     out.print(STR_TRILL); break;
+        case SolenoidBenchWorkload::GLISSANDO: out.print(STR_GLISSANDO); break;
+    }
+    out.print(F(" at "));
+    out.print(_config.rateHz);
+    out.print(F(" Hz, "));
+    out.print(_config.channelCount);
+    out.print(F(" channels, "));
+    out.print(_config.durationMs);
+    out.println(F(" ms"));
+
+    out.print(F("  Strikes: "));
+    out.print(_strikeCount);
+    out.print(F(" (missed "));
+    out.print(getMissedCount());
+    out.println(F(")"));
+
+    out.println(F("                    p50      p99      max     mean"));
+    printHistogram(out, "  Note to wire", _noteToWire, "us");
+    printHistogram(out, "  Note handler", _noteCost, "cyc");
+    printHistogram(out, "  update()    ", _updateCost, "cyc");
+
+    out.print(F("  Bus: "));
+    out.print(_writeCount);
+    out.print(F(" writes ("));
+    out.print(getWritesPerSecond());
+    out.print(F("/s), "));
+    uint16_t permille = getBusUtilizationPermille();
+    out.print(permille / 10);
+    out.print(F("."));
+    out.print(permille % 10);
+    out.print(F("% busy at "));
+    out.print(_driver.getI2CClockHz() / 1000);
+    out.println(F(" kHz"));
+
+    out.print(F("  ("));
+    out.print(cyclesPerUs());
+    out.println(F(" cyc/us)"));
+}
+
+// =============================================================================
+// RESULTS
+// =============================================================================
+
+const SolenoidHistogram& SolenoidBenchmark::getNoteToWire() const {
+    return _noteToWire;
+}
+
+const SolenoidHistogram& SolenoidBenchmark::getNoteCost() const {
+    return _noteCost;
+}
+
+const SolenoidHistogram& SolenoidBenchmark::getUpdateCost() const {
+    return _updateCost;
+}
+
+uint32_t SolenoidBenchmark::getStrikeCount() const {
+    return _strikeCount;
+}
+
+uint32_t SolenoidBenchmark::getMissedCount() const {
+    return _strikeCount - _noteToWire.getCount();
+}
+
+uint32_t SolenoidBenchmark::getWriteCount() const {
+    return _writeCount;
+}
+
+uint32_t SolenoidBenchmark::getWritesPerSecond() const {
+    if (_elapsedUs == 0) {
+        return 0;
+    }
+    return static_cast<uint32_t>((static_cast<uint64_t>(_writeCount) * 1000000) / _elapsedUs);
+}
+
+uint16_t SolenoidBenchmark::getBusUtilizationPermille() const {
+    uint32_t clockHz = _driver.getI2CClockHz();
+    if (_elapsedUs == 0 || clockHz == 0) {
+        return 0;
+    }
+
+    uint32_t dataBytes = (_driver.getChannelsPerBoard() > 8) ? 2 : 1;
+    uint64_t busyBits = static_cast<uint64_t>(_writeCount) * (FRAME_OVERHEAD_BITS + (9 * dataBytes));
+    uint64_t busyUs = (busyBits * 1000000) / clockHz;
+    uint64_t permille = (busyUs * 1000) / _elapsedUs;
+    return (permille > 1000) ? 1000 : static_cast<uint16_t>(permille);
+}
+
+uint32_t SolenoidBenchmark::cycles() {
+    return SolenoidTimebase::cycles();
+}
+
+uint32_t SolenoidBenchmark::cyclesPerUs() {
+    return SolenoidTimebase::cyclesPerUs();
+}
+
+// =============================================================================
+// PRIVATE
+// =============================================================================
+
+void SolenoidBenchmark::playEvent(SolenoidBenchNoteHandler handler) {
+    uint8_t first = _config.firstChannel;
+    uint8_t count = _config.channelCount;
+
+    switch (_config.workload) {
+        case SolenoidBenchWorkload::CHORD:
+            for (uint8_t i = 0; i < count; i++) {
+                strike(handler, first + i);
+            }
+            break;
+
+        case SolenoidBenchWorkload::TRILL:
+        case SolenoidBenchWorkload::GLISSANDO: {
+            uint8_t index;
+            if (_config.workload == SolenoidBenchWorkload::TRILL) {
+                index = _step & 0x01;
+            } else if (count == 1) {
+                index = 0;
+            } else {
+                // Up, then back down without repeating the end notes
+                uint32_t cycle = 2 * (count - 1);
+                uint32_t pos = _step % cycle;
+                index = static_cast<uint8_t>((pos < count) ? pos : cycle - pos);
+            }
+
+            if (_lastChannel != 0xFF) {
+                handler(_lastChannel, 0);
+            }
+            _lastChannel = first + index;
+            strike(handler, _lastChannel);
+            _step++;
+            break;
+        }
+    }
+}
+
+void SolenoidBenchmark::strike(SolenoidBenchNoteHandler handler, uint8_t channel) {
+    _strikeUs[channel] = SolenoidTimebase::nowUs32();
+    _awaiting[channel >> 5] |= (1UL << (channel & 31));
+    _strikeCount++;
+
+    uint32_t before = cycles();
+    handler(channel, _config.velocity);
+    _noteCost.record(cycles() - before);
+}
+
+void SolenoidBenchmark::releaseAll(SolenoidBenchNoteHandler handler) {
+    _driver.beginTransaction();
+    for (uint8_t i = 0; i < _config.channelCount; i++) {
+        handler(_config.firstChannel + i, 0);
+    }
+    _driver.commit();
+
+    _chordHeld = false;
+    _lastChannel = 0xFF;
+}
+
+void SolenoidBenchmark::onWrite(uint8_t board, uint16_t states, uint32_t wireUs, bool ok) {
+    if (!ok) {
+        return;
+    }
+    _writeCount++;
+
+    uint8_t perBoard = _driver.getChannelsPerBoard();
+    uint8_t base = board * perBoard;
+    for (uint8_t bit = 0; bit < perBoard; bit++) {
+        uint8_t ch = base + bit;
+        uint32_t mask = 1UL << (ch & 31);
+        if (((states >> bit) & 0x01) == 0 || (_awaiting[ch >> 5] & mask) == 0) {
+            continue;
+        }
+
+        // First write carrying the channel's bit is the strike
+        _awaiting[ch >> 5] &= ~mask;
+        int32_t latencyUs = static_cast<int32_t>(wireUs - _strikeUs[ch]);
+        _noteToWire.record((latencyUs > 0) ? static_cast<uint32_t>(latencyUs) : 0);
+    }
+}
+
+void SolenoidBenchmark::transmitCallback(uint8_t board, uint16_t states, uint32_t wireUs, bool ok) {
+    if (s_running != nullptr) {
+        s_running->onWrite(board, states, wireUs, ok);
+    }
+}
+
+void SolenoidBenchmark::printHistogram(Print& out, const char* name, const SolenoidHistogram& h, const char* unit) {
+    out.print(name);
+    uint32_t values[4] = { h.getPercentile(50), h.getPercentile(99), h.getMax(), h.getMean() };
+    for (uint8_t i = 0; i < 4; i++) {
+        // Right-align in 9 columns
+        uint32_t width = 1;
+        for (uint32_t v = values[i]; v >= 10; v /= 10) {
+            width++;
+        }
+        for (uint32_t pad = width; pad < 9; pad++) {
+            out.print(' ');
+        }
+        out.print(values[i]);
+    }
+    out.print(' ');
+    out.println(unit);
+}
@@ -0,0 +1,274 @@
+/**
+ * @file SolenoidBenchmark.h
+ * @brief Synthetic note workloads with latency and throughput histograms
+ *
+ * Plays chords, trills or glissandi through the application's own note
+ * handler at a fixed rate and measures each stage: the cost of the handler
+ * and of SolenoidDriver::update() in CPU cycles (ARM_DWT_CYCCNT on Teensy
+ * 4.x), and the time from the handler call to the STOP condition of the
+ * board write that carried the strike. The results are a baseline for
+ * changes to the driver's hot paths.
+ *
+ * Built into the firmware by the teensy41_bench environment
+ * (-D SOLENOID_BENCHMARK); the library itself has no build flag.
+ *
+ * @warning The workloads fire real strikes. Run with the coils unplugged,
+ *          or with a low velocity and a rate the safety limits allow.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_BENCHMARK_H
+#define SOLENOID_BENCHMARK_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "SolenoidConfig.h"
+#include "SolenoidDriver.h"
+#include "SolenoidHistogram.h"
+
+/**
+ * @enum SolenoidBenchWorkload
+ * @brief Note pattern played by a benchmark run
+ */
+enum class SolenoidBenchWorkload : uint8_t {
+    CHORD = 0,        ///< Every channel struck together, released half a period later
+    TRILL = 1,        ///< Two channels alternating
+    GLISSANDO = 2     ///< Channels struck in turn, up then down
+};
+
+/**
+ * @brief Note handler driven by the benchmark
+ *
+ * @param channel Solenoid channel
+ * @param velocity Strike velocity, or 0 to release
+ *
+ * Should take the same path as live MIDI (keymap, pedals, driver) so the
+ * measurement covers it.
+ */
+typedef void (*SolenoidBenchNoteHandler)(uint8_t channel, uint8_t velocity);
+
+/**
+ * @struct SolenoidBenchConfig
+ * @brief Parameters of one benchmark run
+ */
+struct SolenoidBenchConfig {
+    /**
+     * Note pattern
+     * Default: CHORD
+     */
+    SolenoidBenchWorkload workload = SolenoidBenchWorkload::CHORD;
+
+    /**
+     * Workload events per second (chords, trill notes or glissando steps)
+     * Default: SOLENOID_DEFAULT_BENCH_RATE_HZ
+     */
+    uint32_t rateHz = SOLENOID_DEFAULT_BENCH_RATE_HZ;
+
+    /**
+     * Length of the run (milliseconds)
+     * Default: SOLENOID_DEFAULT_BENCH_DURATION_MS
+     */
+    uint32_t durationMs = SOLENOID_DEFAULT_BENCH_DURATION_MS;
+
+    /**
+     * First channel played
+     * Default: 0
+     */
+    uint8_t firstChannel = 0;
+
+    /**
+     * Channels played: chord size or glissando span (a trill uses two)
+     * Default: 8
+     */
+    uint8_t channelCount = 8;
+
+    /**
+     * Strike velocity (1-127)
+     * Default: SOLENOID_DEFAULT_BENCH_VELOCITY
+     */
+    uint8_t velocity = SOLENOID_DEFAULT_BENCH_VELOCITY;
+};
+
+/**
+ * @class SolenoidBenchmark
+ * @brief Runs a workload against a driver and collects histograms
+ *
+ * run() blocks for the length of the run, calling the note handler on
+ * schedule and driver.update() in between, with each event's calls in one
+ * transaction as loop() does. While it runs it owns the driver's transmit
+ * callback, and clears it when done.
+ *
+ * Example usage:
+ * @code
+ * SolenoidBenchmark bench(driver);
+ *
+ * void benchNote(uint8_t channel, uint8_t velocity) {
+ *     if (velocity > 0) driver.on(channel, velocity); else driver.off(channel);
+ * }
+ *
+ * SolenoidBenchConfig config;
+ * config.workload = SolenoidBenchWorkload::TRILL;
+ * config.rateHz = 40;
+ * if (bench.run(config, benchNote)) {
+ *     bench.printReport(Serial);
+ * }
+ * @endcode
+ */
+class SolenoidBenchmark {
+public:
+    /**
+     * @brief Construct a benchmark for a driver
+     *
+     * @param driver Initialized driver to measure
+     */
+    explicit SolenoidBenchmark(SolenoidDriverBase& driver);
+
+    /**
+     * @brief Play a workload and collect the results
+     *
+     * @param config Run parameters
+     * @param handler Note handler to drive
+     * @return false if the driver is not initialized, the handler is
+     *         missing or the parameters are out of range
+     *
+     * Releases every channel played before returning.
+     */
+    bool run(const SolenoidBenchConfig& config, SolenoidBenchNoteHandler handler);
+
+    /**
+     * @brief Print the results of the last run
+     *
+     * @param out Stream to print to (e.g. Serial)
+     */
+    void printReport(Print& out) const;
+
+    // =========================================================================
+    // RESULTS
+    // =========================================================================
+
+    /**
+     * @brief Time from the note handler call to the strike's STOP condition
+     *
+     * @return Histogram in microseconds
+     */
+    const SolenoidHistogram& getNoteToWire() const;
+
+    /**
+     * @brief Cost of the note handler for strikes
+     *
+     * @return Histogram in CPU cycles
+     */
+    const SolenoidHistogram& getNoteCost() const;
+
+    /**
+     * @brief Cost of SolenoidDriver::update()
+     *
+     * @return Histogram in CPU cycles
+     */
+    const SolenoidHistogram& getUpdateCost() const;
+
+    /**
+     * @brief Get the number of strikes requested
+     */
+    uint32_t getStrikeCount() const;
+
+    /**
+     * @brief Get the number of strikes that never reached the wire
+     *
+     * @return Strikes refused by the safety limits, dropped, or still
+     *         pending when the run ended
+     */
+    uint32_t getMissedCount() const;
+
+    /**
+     * @brief Get the number of board writes completed during the run
+     */
+    uint32_t getWriteCount() const;
+
+    /**
+     * @brief Get the sustained board write rate
+     *
+     * @return Writes per second
+     */
+    uint32_t getWritesPerSecond() const;
+
+    /**
+     * @brief Get the share of the run the bus spent clocking writes
+     *
+     * @return Utilization in tenths of a percent, estimated from the write
+     *         count, the frame length and the bus clock
+     */
+    uint16_t getBusUtilizationPermille() const;
+
+    /**
+     * @brief Read the CPU cycle counter
+     *
+     * @return ARM_DWT_CYCCNT on Teensy 4.x, micros() elsewhere
+     */
+    static uint32_t cycles();
+
+    /**
+     * @brief Get the cycle counter rate
+     *
+     * @return Counts per microsecond (1 when cycles() falls back to micros())
+     */
+    static uint32_t cyclesPerUs();
+
+private:
+    SolenoidDriverBase& _driver;                     ///< Driver under test
+    SolenoidBenchConfig _config;                     ///< Parameters of the last run
+    SolenoidHistogram _noteToWire;                   ///< Handler call to STOP (us)
+    SolenoidHistogram _noteCost;                     ///< Strike handler cost (cycles)
+    SolenoidHistogram _updateCost;                   ///< update() cost (cycles)
+    uint32_t _strikeUs[SOLENOID_MAX_CHANNELS];       ///< Handler call time of each awaited strike
+    uint32_t _awaiting[SOLENOID_MASK_WORDS];         ///< Strikes not yet seen on the wire
+    uint32_t _strikeCount;                           ///< Strikes requested
+    uint32_t _writeCount;                            ///< Board writes completed
+    uint32_t _elapsedUs;                             ///< Length of the measured run
+    uint32_t _step;                                  ///< Position in the trill or glissando
+    uint8_t _lastChannel;                            ///< Channel of the previous step (0xFF = none)
+    bool _chordHeld;                                 ///< Chord struck, not yet released
+    uint32_t _releaseUs;                             ///< When the held chord is released
+
+    /**
+     * @brief Play one workload event
+     *
+     * @param handler Note handler
+     */
+    void playEvent(SolenoidBenchNoteHandler handler);
+
+    /**
+     * @brief Strike a channel through the handler and time it
+     */
+    void strike(SolenoidBenchNoteHandler handler, uint8_t channel);
+
+    /**
+     * @brief Release every channel of the workload
+     */
+    void releaseAll(SolenoidBenchNoteHandler handler);
+
+    /**
+     * @brief Match a completed board write against the awaited strikes
+     *
+     * @param board Board written
+     * @param states Channel bitmask written
+     * @param wireUs Time the STOP condition completed
+     * @param ok Write acknowledged
+     */
+    void onWrite(uint8_t board, uint16_t states, uint32_t wireUs, bool ok);
+
+    /**
+     * @brief Transmit callback trampoline to the running benchmark
+     */
+    static void transmitCallback(uint8_t board, uint16_t states, uint32_t wireUs, bool ok);
+
+    /**
+     * @brief Print one histogram line
+     */
+    static void printHistogram(Print& out, const char* name, const SolenoidHistogram& h, const char* unit);
+};
+
+#endif // SOLENOID_BENCHMARK_H
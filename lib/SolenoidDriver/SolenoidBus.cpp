@@ -0,0 +1,125 @@
+/**
+ * @file SolenoidBus.cpp
+ * @brief Implementation of SolenoidWireBus class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidBus.h"
+
+/** Half an SCL period while recovering the bus by hand (5us = 100 kHz) */
+static constexpr uint32_t RECOVERY_HALF_PERIOD_US = 5;
+
+SolenoidWireBus::SolenoidWireBus()
+    : _wire(nullptr)
+{
+}
+
+void SolenoidWireBus::attach(TwoWire& wire) {
+    _wire = &wire;
+    _wire->setTimeout(100);  // 100ms I2C timeout to prevent bus lockup
+}
+
+bool SolenoidWireBus::probe(uint8_t address) {
+    if (_wire == nullptr) {
+        return false;
+    }
+
+    _wire->beginTransmission(address);
+    return _wire->endTransmission() == 0;
+}
+
+uint8_t SolenoidWireBus::writeRegisters(uint8_t address, uint8_t reg, const uint8_t* data, uint8_t length) {
+    if (_wire == nullptr) {
+        return 4;   // "other error", as endTransmission() reports it
+    }
+
+    _wire->beginTransmission(address);
+    _wire->write(reg);
+    for (uint8_t i = 0; i < length; i++) {
+        _wire->write(data[i]);
+    }
+    return _wire->endTransmission();
+}
+
+bool SolenoidWireBus::readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length) {
+    if (_wire == nullptr) {
+        return false;
+    }
+
+    // Set the register pointer, then read with a repeated START
+    _wire->beginTransmission(address);
+    _wire->write(reg);
+    if (_wire->endTransmission(false) != 0) {
+        return false;
+    }
+    if (_wire->requestFrom(address, length) != length) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < length; i++) {
+        data[i] = static_cast<uint8_t>(_wire->read());
+    }
+    return true;
+}
+
+void SolenoidWireBus::setClock(uint32_t hz) {
+    if (_wire != nullptr) {
+        _wire->setClock(hz);
+    }
+}
+
+TwoWire* SolenoidWireBus::getWire() {
+    return _wire;
+}
+
+bool SolenoidWireBus::recoverBus() {
+#if defined(__IMXRT1062__)
+    // SDA, SCL pins of Wire, Wire1, Wire2 on Teensy 4.1
+    uint8_t sda;
+    uint8_t scl;
+    if (_wire == &Wire) {
+        sda = 18;
+        scl = 19;
+    } else if (_wire == &Wire1) {
+        sda = 17;
+        scl = 16;
+    } else if (_wire == &Wire2) {
+        sda = 25;
+        scl = 24;
+    } else {
+        return false;
+    }
+
+    // Take the pins from the LPI2C port and drive SCL ourselves
+    _wire->end();
+    pinMode(sda, INPUT_PULLUP);
+    pinMode(scl, OUTPUT_OPENDRAIN);
+    digitalWrite(scl, HIGH);
+    delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+
+    // Clock out whatever the slave is stuck sending
+    for (uint8_t i = 0; i < SOLENOID_BUS_RECOVERY_CLOCKS && digitalRead(sda) == LOW; i++) {
+        digitalWrite(scl, LOW);
+        delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+        digitalWrite(scl, HIGH);
+        delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+    }
+
+    // STOP: SDA rises while SCL is high
+    pinMode(sda, OUTPUT_OPENDRAIN);
+    digitalWrite(sda, LOW);
+    delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+    digitalWrite(sda, HIGH);
+    delayMicroseconds(RECOVERY_HALF_PERIOD_US);
+    pinMode(sda, INPUT_PULLUP);
+    bool released = digitalRead(sda) == HIGH;
+
+    // Hand the pins back to the port (the caller restores the clock)
+    _wire->begin();
+    return released;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,130 @@
+/**
+ * @file SolenoidBus.h
+ * @brief Register-level I2C access used by SolenoidDriver
+ *
+ * The driver talks to its MCP23017 boards only through this interface, so
+ * the bus can be replaced: SolenoidWireBus is the Arduino TwoWire bus used
+ * on hardware, and the native simulation build supplies a mock bus that
+ * models the boards and the transfer time of every transaction.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_BUS_H
+#define SOLENOID_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "SolenoidConfig.h"
+
+/**
+ * @class SolenoidBus
+ * @brief Abstract I2C bus of register-addressed devices
+ *
+ * All calls are blocking and made from one context (the driver serializes
+ * them, and waits for its asynchronous queue to go idle first).
+ */
+class SolenoidBus {
+public:
+    virtual ~SolenoidBus() {}
+
+    /**
+     * @brief Check if a device acknowledges its address
+     *
+     * @param address 7-bit I2C address
+     * @return true if ACKed
+     */
+    virtual bool probe(uint8_t address) = 0;
+
+    /**
+     * @brief Write consecutive registers in one transaction
+     *
+     * @param address 7-bit I2C address
+     * @param reg First register
+     * @param data Bytes to write
+     * @param length Number of bytes (1-2)
+     * @return 0 on ACK, otherwise a TwoWire::endTransmission() error code
+     */
+    virtual uint8_t writeRegisters(uint8_t address, uint8_t reg, const uint8_t* data, uint8_t length) = 0;
+
+    /**
+     * @brief Read consecutive registers (register write, repeated START, read)
+     *
+     * @param address 7-bit I2C address
+     * @param reg First register
+     * @param data Output: the bytes read
+     * @param length Number of bytes (1-2)
+     * @return true if every byte was read
+     */
+    virtual bool readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length) = 0;
+
+    /**
+     * @brief Set the SCL frequency
+     *
+     * @param hz Clock in Hz
+     */
+    virtual void setClock(uint32_t hz) = 0;
+
+    /**
+     * @brief Free a bus held by a slave and restart it
+     *
+     * @return true if SDA is released (the clock must be set again)
+     *
+     * A slave that lost sync mid-byte (e.g. after a power spike) can keep
+     * SDA low forever. Clocking SCL until it lets go and sending a STOP
+     * returns it to idle. The default does nothing and returns false.
+     */
+    virtual bool recoverBus() { return false; }
+
+    /**
+     * @brief Get the underlying TwoWire, for the interrupt-driven transmit path
+     *
+     * @return The TwoWire instance, or nullptr if the bus has none (frames
+     *         are then sent through writeRegisters())
+     */
+    virtual TwoWire* getWire() { return nullptr; }
+};
+
+/**
+ * @class SolenoidWireBus
+ * @brief SolenoidBus over an Arduino TwoWire instance
+ *
+ * Created internally by SolenoidDriver::begin(TwoWire&, ...).
+ */
+class SolenoidWireBus : public SolenoidBus {
+public:
+    /**
+     * @brief Construct an unattached bus
+     */
+    SolenoidWireBus();
+
+    /**
+     * @brief Attach to a started TwoWire instance
+     *
+     * @param wire Bus to use (Wire.begin() already called)
+     *
+     * Sets a 100ms transfer timeout so a held bus cannot lock up loop().
+     */
+    void attach(TwoWire& wire);
+
+    bool probe(uint8_t address) override;
+    uint8_t writeRegisters(uint8_t address, uint8_t reg, const uint8_t* data, uint8_t length) override;
+    bool readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length) override;
+    void setClock(uint32_t hz) override;
+    TwoWire* getWire() override;
+
+    /**
+     * @brief Clock SCL by hand until SDA is released, then restart the port
+     *
+     * Supported for Wire, Wire1 and Wire2 on Teensy 4.x; returns false
+     * elsewhere.
+     */
+    bool recoverBus() override;
+
+private:
+    TwoWire* _wire;    ///< Attached bus
+};
+
+#endif // SOLENOID_BUS_H
@@ -2,43 +2,86 @@
  * @file SolenoidChannel.cpp
  * @brief Implementation of SolenoidChannel class
  *
+ * All timing is kept in microseconds from SolenoidTimebase. The
+ * millisecond accessors convert on the way out.
+ *
  * @author Mechanical MIDI Piano Project
  * @version 1.0.0
  */
 
 #include "SolenoidChannel.h"
 
-SolenoidChannel::SolenoidChannel(uint8_t boardIndex, uint8_t channelIndex, uint8_t globalIndex)
+#include <math.h>
+
+SolenoidChannel::SolenoidChannel(uint8_t boardIndex, uint8_t channelIndex, uint8_t globalIndex,
+                                 SolenoidChannelBank* bank)
     : _boardIndex(boardIndex)
     , _channelIndex(channelIndex)
     , _globalIndex(globalIndex)
-    , _isOn(false)
-    , _lastOnTime(0)
-    , _lastOffTime(0)
-    , _totalOnTime(0)
+    , _bank(bank)
+    , _totalOnUs(0)
     , _activationCount(0)
-    , _windowStartTime(0)
-    , _windowOnTime(0)
+    , _expiredOnUs(0)
+    , _windowSumUs(0)
+    , _windowMs(0)
+    , _bucketWidthUs(0)
+    , _bucketStartUs(0)
+    , _trackStartUs(0)
+    , _creditedUs(0)
+    , _bucketIndex(0)
+    , _heat(0.0f)
+    , _heatUs(0)
+    , _heatTauUs(0.0f)
+    , _coolTauUs(0.0f)
 {
+    for (uint8_t i = 0; i < SOLENOID_DUTY_BUCKETS; i++) {
+        _bucketOnUs[i] = 0;
+    }
+
+    // Start this channel's slot in the bank in the off state
+    if (_bank != nullptr) {
+        _bank->onMask[_globalIndex >> 5] &= ~(1UL << (_globalIndex & 31));
+        _bank->lastOnUs[_globalIndex] = 0;
+        _bank->lastOffUs[_globalIndex] = 0;
+        _bank->holdMask[_globalIndex >> 5] &= ~(1UL << (_globalIndex & 31));
+        _bank->kickUs[_globalIndex] = 0;
+        _bank->holdDuty[_globalIndex] = 255;
+    }
 }
 
 bool SolenoidChannel::isOn() const {
-    return _isOn;
+    return _bank->isOn(_globalIndex);
 }
 
-uint32_t SolenoidChannel::onDuration() const {
-    if (!_isOn) {
+uint64_t SolenoidChannel::onDurationUs() const {
+    if (!isOn()) {
         return 0;
     }
-    return millis() - _lastOnTime;
+    return SolenoidTimebase::nowUs() - _bank->lastOnUs[_globalIndex];
 }
 
-uint32_t SolenoidChannel::timeSinceOff() const {
+uint32_t SolenoidChannel::onDuration() const {
+    return SolenoidTimebase::usToMs(onDurationUs());
+}
+
+uint64_t SolenoidChannel::lastOnTimeUs() const {
+    return _bank->lastOnUs[_globalIndex];
+}
+
+uint32_t SolenoidChannel::lastOnTime() const {
+    return SolenoidTimebase::usToMs(_bank->lastOnUs[_globalIndex]);
+}
+
+uint64_t SolenoidChannel::timeSinceOffUs() const {
     // If never turned off, return max value to indicate no cooldown needed
-    if (_lastOffTime == 0) {
-        return UINT32_MAX;
+    if (_bank->lastOffUs[_globalIndex] == 0) {
+        return UINT64_MAX;
     }
-    return millis() - _lastOffTime;
+    return SolenoidTimebase::nowUs() - _bank->lastOffUs[_globalIndex];
+}
+
+uint32_t SolenoidChannel::timeSinceOff() const {
+    return SolenoidTimebase::usToMs(timeSinceOffUs());
 }
 
 uint8_t SolenoidChannel::boardIndex() const {
@@ -53,12 +96,16 @@ uint8_t SolenoidChannel::globalIndex() const {
     return _globalIndex;
 }
 
-uint32_t SolenoidChannel::totalOnTime() const {
+uint64_t SolenoidChannel::totalOnTimeUs() const {
     // If currently on, include the current on-duration in the total
-    if (_isOn) {
-        return _totalOnTime + onDuration();
+    if (isOn()) {
+        return _totalOnUs + energizedTime(onDurationUs());
     }
-    return _totalOnTime;
+    return _totalOnUs;
+}
+
+uint32_t SolenoidChannel::totalOnTime() const {
+    return SolenoidTimebase::usToMs(totalOnTimeUs());
 }
 
 uint32_t SolenoidChannel::activationCount() const {
@@ -66,133 +113,258 @@ uint32_t SolenoidChannel::activationCount() const {
 }
 
 void SolenoidChannel::resetStats() {
-    _totalOnTime = 0;
+    _totalOnUs = 0;
     _activationCount = 0;
-    _windowStartTime = 0;
-    _windowOnTime = 0;
+    resetWindow(0, 0);
 }
 
-void SolenoidChannel::updateState(bool isOn) {
-    uint32_t now = millis();
+void SolenoidChannel::updateState(bool state) {
+    uint64_t now = SolenoidTimebase::nowUs();
 
-    if (isOn && !_isOn) {
-        // Turning on
-        _lastOnTime = now;
+    if (state && !isOn()) {
+        // Turning on - slide the window to the edge first, then credit it
+        // from the edge onwards as time passes
+        advanceWindow(now);
+        advanceHeat(now);
+        _creditedUs = now;
+
+        _bank->lastOnUs[_globalIndex] = now;
         _activationCount++;
-        _isOn = true;
+        _bank->onMask[_globalIndex >> 5] |= (1UL << (_globalIndex & 31));
+    } else if (!state && isOn()) {
+        // Turning off - credit the rest of the activation while the drive
+        // settings that shaped it are still in place
+        advanceWindow(now);
+        advanceHeat(now);
+        _totalOnUs += energizedTime(now - _bank->lastOnUs[_globalIndex]);
+        _bank->lastOffUs[_globalIndex] = now;
+        _bank->lastOnUs[_globalIndex] = 0;
+        _bank->onMask[_globalIndex >> 5] &= ~(1UL << (_globalIndex & 31));
+
+        // The next activation is full power unless setDrive() says otherwise
+        _bank->holdMask[_globalIndex >> 5] &= ~(1UL << (_globalIndex & 31));
+        _bank->kickUs[_globalIndex] = 0;
+        _bank->holdDuty[_globalIndex] = 255;
+    }
+    // No change if state is already the same
+}
 
-        // Initialize window if this is the first activation
-        if (_windowStartTime == 0) {
-            _windowStartTime = now;
+void SolenoidChannel::setEdgeTime(bool state, uint64_t timeUs) {
+    if (state && isOn()) {
+        // On-edge landed later than recorded
+        if (timeUs > _bank->lastOnUs[_globalIndex]) {
+            _bank->lastOnUs[_globalIndex] = timeUs;
+            if (_creditedUs < timeUs) {
+                _creditedUs = timeUs;
+            }
+        }
+    } else if (!state && !isOn() && _bank->lastOffUs[_globalIndex] != 0) {
+        // Off-edge landed later - the coil was on for longer than recorded
+        if (timeUs > _bank->lastOffUs[_globalIndex]) {
+            uint64_t delta = timeUs - _bank->lastOffUs[_globalIndex];
+            _totalOnUs += delta;
+            addWindowOnTime(delta);
+            _bank->lastOffUs[_globalIndex] = timeUs;
         }
-    } else if (!isOn && _isOn) {
-        // Turning off - accumulate the on-time
-        uint32_t thisDuration = now - _lastOnTime;
-        _totalOnTime += thisDuration;
-        _windowOnTime += thisDuration;
-        _lastOffTime = now;
-        _lastOnTime = 0;
-        _isOn = false;
     }
-    // No change if state is already the same
 }
 
-void SolenoidChannel::updateWindow(uint32_t windowDurationMs, uint32_t now) {
-    // Initialize window on first call
-    if (_windowStartTime == 0) {
-        _windowStartTime = now;
-        _windowOnTime = 0;
-        return;
+void SolenoidChannel::setDrive(uint16_t kickUs, uint8_t holdDuty) {
+    // A mid-note change applies from now on
+    advanceHeat(SolenoidTimebase::nowUs());
+    _bank->kickUs[_globalIndex] = kickUs;
+    _bank->holdDuty[_globalIndex] = holdDuty;
+}
+
+uint64_t SolenoidChannel::energizedTime(uint64_t sinceOnUs) const {
+    uint8_t duty = _bank->holdDuty[_globalIndex];
+    if (duty == 255) {
+        return sinceOnUs;
+    }
+
+    uint32_t kickUs = _bank->kickUs[_globalIndex];
+    if (sinceOnUs <= kickUs) {
+        return sinceOnUs;
     }
 
-    uint32_t windowAge = now - _windowStartTime;
+    // Full power during the kick, then the hold duty for the rest
+    uint64_t held = (sinceOnUs - kickUs) * duty;
+    return kickUs + (held + 127) / 255;
+}
 
-    // If window has expired, reset it
-    if (windowAge >= windowDurationMs) {
-        // If currently on, we need to track how much of the current activation
-        // falls within the new window. Reset window to start now.
-        _windowStartTime = now;
-        _windowOnTime = 0;
+void SolenoidChannel::setThermalModel(uint32_t heatTauMs, uint32_t coolTauMs) {
+    uint64_t now = SolenoidTimebase::nowUs();
+    advanceHeat(now);
 
-        // If currently on, the ongoing activation will be counted when it ends
-        // or when getDutyCyclePercent includes the current on-duration
+    _heatTauUs = static_cast<float>(heatTauMs) * 1000.0f;
+    _coolTauUs = static_cast<float>(coolTauMs) * 1000.0f;
+    if (_heatTauUs == 0.0f) {
+        _heat = 0.0f;
     }
 }
 
-float SolenoidChannel::getDutyCyclePercent(uint32_t windowDurationMs) {
-    if (windowDurationMs == 0) {
-        return 0.0f;
+float SolenoidChannel::thermalLoad() const {
+    return heatAt(SolenoidTimebase::nowUs());
+}
+
+float SolenoidChannel::heatAt(uint64_t now) const {
+    if (_heatTauUs == 0.0f || now <= _heatUs) {
+        return _heat;
     }
 
-    uint32_t now = millis();
+    float heat = _heat;
+    uint64_t from = _heatUs;
 
-    // Update window state (may reset if expired)
-    updateWindow(windowDurationMs, now);
+    if (isOn()) {
+        uint64_t lastOn = _bank->lastOnUs[_globalIndex];
+        float holdPower = _bank->holdDuty[_globalIndex] / 255.0f;
 
-    // Calculate window elapsed time
-    uint32_t windowElapsed = now - _windowStartTime;
-    if (windowElapsed == 0) {
-        return 0.0f;
+        // Kick at full power, up to where it ends or now
+        uint64_t kickEnd = lastOn + _bank->kickUs[_globalIndex];
+        if (holdPower < 1.0f && from < kickEnd) {
+            uint64_t until = (now < kickEnd) ? now : kickEnd;
+            heat = 1.0f + (heat - 1.0f) * expf(-static_cast<float>(until - from) / _heatTauUs);
+            from = until;
+        }
+
+        // Hold for the rest
+        if (from < now) {
+            heat = holdPower + (heat - holdPower) * expf(-static_cast<float>(now - from) / _heatTauUs);
+        }
+    } else if (_coolTauUs > 0.0f) {
+        heat *= expf(-static_cast<float>(now - from) / _coolTauUs);
+    } else {
+        heat = 0.0f;
     }
 
-    // Calculate on-time within window
-    uint32_t onTimeInWindow = _windowOnTime;
+    return heat;
+}
 
-    // If currently on, add the ongoing duration
-    if (_isOn && _lastOnTime >= _windowStartTime) {
-        // Normal case: channel turned on after window started
-        onTimeInWindow += (now - _lastOnTime);
-    } else if (_isOn && _lastOnTime < _windowStartTime) {
-        // Edge case: channel was already on when window was reset, only count from window start
-        // Channel was on before window started; only count time since window start
-        onTimeInWindow += (now - _windowStartTime);
+void SolenoidChannel::advanceHeat(uint64_t now) {
+    _heat = heatAt(now);
+    if (now > _heatUs) {
+        _heatUs = now;
     }
+}
 
-    // Cap window elapsed to the configured duration for percentage calculation
-    if (windowElapsed > windowDurationMs) {
-        windowElapsed = windowDurationMs;
+void SolenoidChannel::resetWindow(uint32_t windowDurationMs, uint64_t now) {
+    for (uint8_t i = 0; i < SOLENOID_DUTY_BUCKETS; i++) {
+        _bucketOnUs[i] = 0;
     }
+    _expiredOnUs = 0;
+    _windowSumUs = 0;
+    _bucketIndex = 0;
+    _windowMs = windowDurationMs;
+    _bucketWidthUs = static_cast<uint32_t>(static_cast<uint64_t>(windowDurationMs) * 1000 / SOLENOID_DUTY_BUCKETS);
+    if (_bucketWidthUs == 0 && windowDurationMs > 0) {
+        _bucketWidthUs = 1;
+    }
+    _bucketStartUs = now;
+    _trackStartUs = now;
 
-    return static_cast<float>(onTimeInWindow) / static_cast<float>(windowElapsed);
+    // An activation already in progress is counted from here on
+    _creditedUs = now;
 }
 
-bool SolenoidChannel::wouldExceedDutyCycle(uint32_t windowDurationMs, float maxDutyCycle, uint32_t estimatedOnTimeMs) const {
-    if (windowDurationMs == 0 || maxDutyCycle >= 1.0f) {
-        return false;  // No limit
+void SolenoidChannel::advanceWindow(uint64_t now) {
+    if (_windowMs == 0 || now <= _bucketStartUs) {
+        return;
     }
 
-    uint32_t now = millis();
+    uint64_t steps = (now - _bucketStartUs) / _bucketWidthUs;
 
-    // Calculate current on-time in window
-    uint32_t windowElapsed = (_windowStartTime > 0) ? (now - _windowStartTime) : 0;
+    // Everything in the ring is older than the window - clear it at once
+    // and skip ahead to the last bucket that can still be partly inside
+    if (steps > SOLENOID_DUTY_BUCKETS) {
+        uint64_t skip = steps - SOLENOID_DUTY_BUCKETS;
+        _bucketStartUs += skip * _bucketWidthUs;
+        for (uint8_t i = 0; i < SOLENOID_DUTY_BUCKETS; i++) {
+            _bucketOnUs[i] = 0;
+        }
+        _expiredOnUs = 0;
+        _windowSumUs = 0;
+        if (_creditedUs < _bucketStartUs) {
+            _creditedUs = _bucketStartUs;
+        }
+        steps = SOLENOID_DUTY_BUCKETS;
+    }
 
-    // If window hasn't started yet, first activation is always safe
-    if (windowElapsed == 0) {
-        return false;
+    // Close each bucket that has ended, crediting the activation into it
+    for (uint64_t i = 0; i < steps; i++) {
+        uint64_t bucketEnd = _bucketStartUs + _bucketWidthUs;
+        creditOnTime(bucketEnd);
+
+        _bucketIndex = (_bucketIndex + 1) & (SOLENOID_DUTY_BUCKETS - 1);
+        _expiredOnUs = _bucketOnUs[_bucketIndex];
+        _windowSumUs -= _expiredOnUs;
+        _bucketOnUs[_bucketIndex] = 0;
+        _bucketStartUs = bucketEnd;
     }
 
-    uint32_t onTimeInWindow = _windowOnTime;
+    creditOnTime(now);
+}
 
-    // If currently on (shouldn't normally be when calling this, but handle it)
-    if (_isOn && _lastOnTime >= _windowStartTime) {
-        onTimeInWindow += (now - _lastOnTime);
-    } else if (_isOn && _lastOnTime > 0 && _windowStartTime > 0 && _lastOnTime < _windowStartTime) {
-        onTimeInWindow += (now - _windowStartTime);
+void SolenoidChannel::creditOnTime(uint64_t until) {
+    if (!isOn() || until <= _creditedUs) {
+        return;
     }
 
-    // Project forward: if we activate for estimatedOnTimeMs
-    uint32_t projectedOnTime = onTimeInWindow + estimatedOnTimeMs;
-    uint32_t projectedWindowElapsed = windowElapsed + estimatedOnTimeMs;
+    uint64_t lastOn = _bank->lastOnUs[_globalIndex];
+    addWindowOnTime(energizedTime(until - lastOn) - energizedTime(_creditedUs - lastOn));
+    _creditedUs = until;
+}
 
-    // Cap to window duration
-    if (projectedWindowElapsed > windowDurationMs) {
-        projectedWindowElapsed = windowDurationMs;
+void SolenoidChannel::addWindowOnTime(uint64_t onUs) {
+    if (_windowMs == 0) {
+        return;
     }
+    uint64_t bucket = _bucketOnUs[_bucketIndex] + onUs;
+    _bucketOnUs[_bucketIndex] = (bucket > UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(bucket);
+    _windowSumUs += _bucketOnUs[_bucketIndex] - (bucket - onUs);
+}
 
-    if (projectedWindowElapsed == 0) {
-        return false;
+SolenoidDutyStatus SolenoidChannel::evaluateDutyCycle(uint32_t windowDurationMs, uint32_t estimatedOnTimeMs) {
+    SolenoidDutyStatus status = { 0.0f, 0.0f };
+    if (windowDurationMs == 0) {
+        return status;
     }
 
-    float projectedDutyCycle = static_cast<float>(projectedOnTime) / static_cast<float>(projectedWindowElapsed);
-    return projectedDutyCycle > maxDutyCycle;
+    uint64_t now = SolenoidTimebase::nowUs();
+    if (windowDurationMs != _windowMs) {
+        resetWindow(windowDurationMs, now);
+    }
+    advanceWindow(now);
+
+    // The window is the current bucket, the full buckets before it, and
+    // the part of the bucket that just slid out which is still in range
+    uint64_t intoBucket = now - _bucketStartUs;
+    uint64_t onInWindow = _windowSumUs
+        + (static_cast<uint64_t>(_expiredOnUs) * (_bucketWidthUs - intoBucket)) / _bucketWidthUs;
+
+    // Always over the whole window: time before tracking began was time
+    // off, so a fresh channel (or a strike retried a few ms after it was
+    // first refused power) is not judged on a sliver of history
+    uint64_t windowUs = static_cast<uint64_t>(windowDurationMs) * 1000;
+    uint64_t tracked = now - _trackStartUs;
+    if (onInWindow > tracked) {
+        onInWindow = tracked;
+    }
+    status.current = static_cast<float>(onInWindow) / static_cast<float>(windowUs);
+
+    // Project forward: if we activate for estimatedOnTimeMs
+    uint64_t estimatedOnUs = static_cast<uint64_t>(estimatedOnTimeMs) * 1000;
+    status.projected = static_cast<float>(onInWindow + estimatedOnUs) / static_cast<float>(windowUs);
+
+    return status;
+}
+
+float SolenoidChannel::getDutyCyclePercent(uint32_t windowDurationMs) {
+    return evaluateDutyCycle(windowDurationMs, 0).current;
+}
+
+bool SolenoidChannel::wouldExceedDutyCycle(uint32_t windowDurationMs, float maxDutyCycle, uint32_t estimatedOnTimeMs) {
+    if (windowDurationMs == 0 || maxDutyCycle >= 1.0f) {
+        return false;  // No limit
+    }
+    return evaluateDutyCycle(windowDurationMs, estimatedOnTimeMs).projected > maxDutyCycle;
 }
@@ -16,26 +16,134 @@
 #include <stdint.h>
 #include <Arduino.h>
 
+#include "SolenoidConfig.h"
+#include "SolenoidTimebase.h"
+
+/**
+ * @struct SolenoidChannelBank
+ * @brief Hot per-channel state for all channels, stored as arrays
+ *
+ * The state touched on every note and every update() - on/off and the
+ * last edge timestamps - is kept in a structure-of-arrays layout owned by
+ * SolenoidDriver. "Which channels are on" is a single bitmask (128 bits at
+ * most), so board diffs and timeout scans are word-wide bit operations,
+ * and the timestamps a scan reads are contiguous in memory.
+ *
+ * The bank only points at the arrays: the driver sizes them for its
+ * topology (see SolenoidDriverStorage). SolenoidChannel objects read and
+ * write their slot of the bank.
+ */
+struct SolenoidChannelBank {
+    uint32_t* onMask;           ///< Bit set = channel on
+    uint64_t* lastOnUs;         ///< Timebase us when last turned on (0 if off)
+    uint64_t* lastOffUs;        ///< Timebase us when last turned off (0 if never)
+    uint32_t* holdMask;         ///< Bit set = coil being modulated by a hold
+    uint16_t* kickUs;           ///< Kick length of the current note (us)
+    uint8_t* holdDuty;          ///< Hold duty of the current note (255 = full)
+    uint8_t channelCount;       ///< Slots in each array
+
+    /**
+     * @brief Check if a channel is on
+     *
+     * @param channel Global channel index
+     * @return true if the channel's bit is set
+     */
+    bool isOn(uint8_t channel) const {
+        return (onMask[channel >> 5] >> (channel & 31)) & 0x01;
+    }
+
+    /**
+     * @brief Get up to 16 consecutive on-bits starting at a board boundary
+     *
+     * @param firstChannel First global channel (multiple of 8)
+     * @param count Number of channels (8 or 16)
+     * @return Bitmask with bit 0 = firstChannel
+     */
+    uint16_t bits(uint8_t firstChannel, uint8_t count) const {
+        return maskBits(onMask, firstChannel, count);
+    }
+
+    /**
+     * @brief Get up to 16 consecutive bits of a channel mask
+     *
+     * @param mask onMask or holdMask
+     * @param firstChannel First global channel (multiple of 8)
+     * @param count Number of channels (8 or 16)
+     * @return Bitmask with bit 0 = firstChannel
+     */
+    static uint16_t maskBits(const uint32_t* mask, uint8_t firstChannel, uint8_t count) {
+        uint32_t word = mask[firstChannel >> 5] >> (firstChannel & 31);
+        return static_cast<uint16_t>(word & ((1UL << count) - 1));
+    }
+
+    /**
+     * @brief Clear all state
+     */
+    void clear() {
+        for (uint8_t i = 0; i < solenoidMaskWords(channelCount); i++) {
+            onMask[i] = 0;
+            holdMask[i] = 0;
+        }
+        for (uint8_t i = 0; i < channelCount; i++) {
+            lastOnUs[i] = 0;
+            lastOffUs[i] = 0;
+            kickUs[i] = 0;
+            holdDuty[i] = 255;
+        }
+    }
+};
+
+/**
+ * @struct SolenoidDutyStatus
+ * @brief Duty cycle of a channel from one window evaluation
+ *
+ * Both values are fractions of the window (0.0 to 1.0 and beyond).
+ */
+struct SolenoidDutyStatus {
+    float current;      ///< Duty cycle over the window ending now
+    float projected;    ///< Duty cycle if the channel is now on for the estimated time
+};
+
 /**
  * @class SolenoidChannel
  * @brief Tracks the state and timing of a single solenoid channel
  *
  * Maintains timing information for safety enforcement and diagnostics.
- * Each channel tracks:
+ * The on/off state and edge timestamps live in a shared SolenoidChannelBank
+ * (see above); the channel object holds the per-channel statistics and
+ * duty cycle window. Each channel tracks:
  * - Current on/off state
  * - Time when last turned on (for timeout detection)
  * - Time when last turned off (for cooldown enforcement)
- * - Rolling window duty cycle calculation
+ * - Sliding window duty cycle calculation
+ * - First-order coil thermal model
  * - Activation count (for statistics)
  *
+ * Timing:
+ * All timestamps are microseconds from SolenoidTimebase (64-bit, no
+ * wraparound). The millisecond accessors are a facade over the *Us() ones.
+ *
  * Duty Cycle Tracking:
- * The duty cycle is calculated over a configurable rolling window (default 10 seconds).
- * When the window expires, it resets and begins tracking again. This provides
- * protection against sustained high-duty-cycle operation that could overheat solenoids.
+ * The duty cycle is calculated over a configurable sliding window (default
+ * 10 seconds) split into SOLENOID_DUTY_BUCKETS time buckets. Energized
+ * time is credited to the bucket it falls in; as time moves on the oldest
+ * bucket slides out, with the bucket that just left the window counted
+ * pro rata. Evaluation cost and memory are constant, and the result is
+ * within one bucket of an exact sliding window - there is no boundary at
+ * which the budget resets.
+ *
+ * Thermal Model:
+ * The coil temperature rise is estimated as a thermal load h, normalized
+ * so 1.0 is the steady state of continuous full power. Between edges the
+ * energized fraction p is constant (1.0 in the kick, holdDuty/255 in the
+ * hold, 0.0 when off), so the model is folded forward exactly at each
+ * edge: h' = p + (h - p) * exp(-dt / tau), with separate heating and
+ * cooling time constants. Queries extrapolate to now without changing
+ * state.
  *
  * Example usage (internal to SolenoidDriver):
  * @code
- * SolenoidChannel channel(0, 3, 3);  // Board 0, channel 3, global index 3
+ * SolenoidChannel channel(0, 3, 3, &bank);  // Board 0, channel 3, global index 3
  * channel.updateState(true);          // Turn on
  * if (channel.onDuration() > maxTime) {
  *     // Timeout - need to turn off
@@ -51,13 +159,16 @@ public:
      * @brief Construct a new SolenoidChannel object
      *
      * @param boardIndex Index of the driver board (0-7)
-     * @param channelIndex Index of the channel on the board (0-7)
+     * @param channelIndex Index of the channel on the board (0-15)
      * @param globalIndex Global channel index across all boards (0-127)
+     * @param bank Shared hot-state storage (must outlive the channel)
      *
      * All timing values are initialized to 0, and the channel starts in the
-     * off state.
+     * off state. A default-constructed channel has no bank and must be
+     * reassigned before use.
      */
-    SolenoidChannel(uint8_t boardIndex = 0, uint8_t channelIndex = 0, uint8_t globalIndex = 0);
+    SolenoidChannel(uint8_t boardIndex = 0, uint8_t channelIndex = 0, uint8_t globalIndex = 0,
+                    SolenoidChannelBank* bank = nullptr);
 
     /**
      * @brief Check if the channel is currently on
@@ -77,6 +188,31 @@ public:
      */
     uint32_t onDuration() const;
 
+    /**
+     * @brief Get duration the channel has been on, in microseconds
+     *
+     * @return Microseconds since the channel was turned on, or 0 if off
+     */
+    uint64_t onDurationUs() const;
+
+    /**
+     * @brief Get the time the channel was last turned on
+     *
+     * @return SolenoidTimebase::nowMs() time of the last on-edge, or 0 if
+     *         the channel is off
+     */
+    uint32_t lastOnTime() const;
+
+    /**
+     * @brief Get the time the channel was last turned on, in microseconds
+     *
+     * @return SolenoidTimebase::nowUs() time of the last on-edge, or 0 if off
+     *
+     * Lets the driver compute timeout deadlines without reading the clock
+     * once per channel.
+     */
+    uint64_t lastOnTimeUs() const;
+
     /**
      * @brief Get time since channel was turned off
      *
@@ -88,6 +224,13 @@ public:
      */
     uint32_t timeSinceOff() const;
 
+    /**
+     * @brief Get time since channel was turned off, in microseconds
+     *
+     * @return Microseconds since last off, or UINT64_MAX if never turned off
+     */
+    uint64_t timeSinceOffUs() const;
+
     /**
      * @brief Get the board index
      *
@@ -98,7 +241,7 @@ public:
     /**
      * @brief Get the channel index on the board
      *
-     * @return Channel index (0-7)
+     * @return Channel index (0-15)
      */
     uint8_t channelIndex() const;
 
@@ -115,42 +258,79 @@ public:
      * @return Total milliseconds the channel has been on since last reset
      *
      * This accumulates the total time the channel has spent in the on state.
+     * During a reduced-duty hold only the energized fraction is counted.
      * Use resetStats() to clear this value.
      *
      * @note For duty cycle enforcement, use getDutyCyclePercent() instead,
-     *       which uses the rolling window calculation.
+     *       which uses the sliding window calculation.
      */
     uint32_t totalOnTime() const;
 
     /**
-     * @brief Get the current duty cycle percentage within the rolling window
+     * @brief Get total on-time for statistics, in microseconds
      *
-     * @param windowDurationMs The duration of the rolling window in milliseconds
-     * @return Duty cycle as a value between 0.0 and 1.0
+     * @return Total microseconds on since last reset (see totalOnTime())
+     */
+    uint64_t totalOnTimeUs() const;
+
+    /**
+     * @brief Evaluate the sliding window once for both duty cycle checks
      *
-     * Calculates the percentage of time the channel has been on within the
-     * specified rolling window. If the window has expired (more time has passed
-     * than windowDurationMs since the window started), the window is reset
-     * and tracking begins fresh.
+     * @param windowDurationMs The duration of the sliding window in milliseconds
+     * @param estimatedOnTimeMs Estimated duration of the next activation
+     * @return Current and projected duty cycle
      *
-     * If the channel is currently on, the calculation includes the ongoing
-     * on-duration up to the current moment.
+     * Slides the window up to now (crediting the ongoing activation, if
+     * any) and derives both values from the same window sum, always as a
+     * fraction of the whole window (time before tracking began counts as
+     * off). Changing windowDurationMs restarts tracking.
+     */
+    SolenoidDutyStatus evaluateDutyCycle(uint32_t windowDurationMs, uint32_t estimatedOnTimeMs);
+
+    /**
+     * @brief Get the current duty cycle percentage within the sliding window
+     *
+     * @param windowDurationMs The duration of the sliding window in milliseconds
+     * @return Duty cycle as a value between 0.0 and 1.0
+     *
+     * Calculates the fraction of the last windowDurationMs the channel has
+     * been energized, including an ongoing activation up to the current
+     * moment. See evaluateDutyCycle().
      */
     float getDutyCyclePercent(uint32_t windowDurationMs);
 
     /**
      * @brief Check if activating would exceed the duty cycle limit
      *
-     * @param windowDurationMs The duration of the rolling window in milliseconds
+     * @param windowDurationMs The duration of the sliding window in milliseconds
      * @param maxDutyCycle Maximum allowed duty cycle (0.0 to 1.0)
      * @param estimatedOnTimeMs Estimated duration the channel will be on
      * @return true if activation would exceed duty cycle, false if safe
      *
      * This method estimates whether turning on the channel would cause
      * the duty cycle to exceed the limit, assuming the channel stays on
-     * for the estimated duration.
+     * for the estimated duration. See evaluateDutyCycle().
      */
-    bool wouldExceedDutyCycle(uint32_t windowDurationMs, float maxDutyCycle, uint32_t estimatedOnTimeMs) const;
+    bool wouldExceedDutyCycle(uint32_t windowDurationMs, float maxDutyCycle, uint32_t estimatedOnTimeMs);
+
+    /**
+     * @brief Set the time constants of the thermal model
+     *
+     * @param heatTauMs Time constant while energized (ms), 0 disables the model
+     * @param coolTauMs Time constant while off (ms)
+     *
+     * The current estimate is brought up to date under the old constants
+     * first.
+     */
+    void setThermalModel(uint32_t heatTauMs, uint32_t coolTauMs);
+
+    /**
+     * @brief Get the estimated thermal load of the coil
+     *
+     * @return 0.0 (ambient) to 1.0 (steady state at continuous full power),
+     *         or 0.0 if the thermal model is disabled
+     */
+    float thermalLoad() const;
 
     /**
      * @brief Get the total number of activations
@@ -170,7 +350,7 @@ public:
     /**
      * @brief Update the channel state (called internally by SolenoidDriver)
      *
-     * @param isOn New state (true = on, false = off)
+     * @param state New state (true = on, false = off)
      *
      * This method updates the internal state and timing information:
      * - When turning on: Records the on-time and increments activation count
@@ -179,33 +359,116 @@ public:
      * This should only be called by SolenoidDriver after successfully
      * writing the state to hardware.
      */
-    void updateState(bool isOn);
+    void updateState(bool state);
+
+    /**
+     * @brief Move the timestamp of the latest edge to when it hit the hardware
+     *
+     * @param state State the hardware was set to
+     * @param timeUs SolenoidTimebase::nowUs() time at which the write completed
+     *
+     * Used with asynchronous transmission, where updateState() runs when the
+     * change is queued but the coil only switches when the frame finishes.
+     * Only moves timestamps forward, and ignores edges that no longer match
+     * the current state (the channel changed again before the frame landed).
+     * A later off-edge also extends the accumulated on-time.
+     */
+    void setEdgeTime(bool state, uint64_t timeUs);
+
+    /**
+     * @brief Set how the coil is driven for the next activation
+     *
+     * @param kickUs Full-power time at the start of the note (us)
+     * @param holdDuty Duty after the kick (255 = full power throughout)
+     *
+     * Call before updateState(true). Duty cycle accounting then counts only
+     * the energized part of the hold. Reset to full power on the next
+     * off-edge.
+     */
+    void setDrive(uint16_t kickUs, uint8_t holdDuty);
 
 private:
     uint8_t _boardIndex;           ///< Board index (0-15)
-    uint8_t _channelIndex;         ///< Channel on board (0-7)
+    uint8_t _channelIndex;         ///< Channel on board (0-15)
     uint8_t _globalIndex;          ///< Global channel index
-    bool _isOn;                    ///< Current state
-    uint32_t _lastOnTime;          ///< millis() when last turned on
-    uint32_t _lastOffTime;         ///< millis() when last turned off
-    uint32_t _totalOnTime;         ///< Accumulated on-time for statistics
+    SolenoidChannelBank* _bank;    ///< On/off state and edge timestamps
+    uint64_t _totalOnUs;           ///< Accumulated on-time for statistics (us)
     uint32_t _activationCount;     ///< Number of activations
 
-    // Rolling window duty cycle tracking
-    uint32_t _windowStartTime;     ///< millis() when duty cycle window started
-    uint32_t _windowOnTime;        ///< Accumulated on-time within current window
+    // Sliding window duty cycle tracking
+    uint32_t _bucketOnUs[SOLENOID_DUTY_BUCKETS]; ///< Energized time per bucket (us)
+    uint32_t _expiredOnUs;         ///< Energized time of the bucket that last left the window
+    uint64_t _windowSumUs;         ///< Sum of _bucketOnUs
+    uint32_t _windowMs;            ///< Window the buckets were sized for (0 = not tracking)
+    uint32_t _bucketWidthUs;       ///< Length of one bucket (us)
+    uint64_t _bucketStartUs;       ///< Timebase us when the current bucket started
+    uint64_t _trackStartUs;        ///< Timebase us when tracking started
+    uint64_t _creditedUs;          ///< Ongoing activation has been credited up to here
+    uint8_t _bucketIndex;          ///< Current bucket
+
+    // Thermal model
+    float _heat;                   ///< Thermal load at _heatUs
+    uint64_t _heatUs;              ///< Timebase us the thermal load was last folded at
+    float _heatTauUs;              ///< Heating time constant (us, 0 = disabled)
+    float _coolTauUs;              ///< Cooling time constant (us)
 
     /**
-     * @brief Update the rolling window, resetting if expired
+     * @brief Extrapolate the thermal load to a point in time
      *
-     * @param windowDurationMs Duration of the rolling window
-     * @param now Current time from millis()
+     * @param now Current time from SolenoidTimebase::nowUs()
+     * @return Thermal load at now, assuming no edge since _heatUs
+     */
+    float heatAt(uint64_t now) const;
+
+    /**
+     * @brief Fold the thermal load forward to a point in time
+     *
+     * @param now Current time from SolenoidTimebase::nowUs()
+     *
+     * Called at every edge, before the state or drive settings change.
+     */
+    void advanceHeat(uint64_t now);
+
+    /**
+     * @brief Size the buckets for a window and restart tracking
+     *
+     * @param windowDurationMs Window duration (ms), 0 stops tracking
+     * @param now Current time from SolenoidTimebase::nowUs()
+     */
+    void resetWindow(uint32_t windowDurationMs, uint64_t now);
+
+    /**
+     * @brief Slide the window up to a point in time
+     *
+     * @param now Current time from SolenoidTimebase::nowUs()
+     *
+     * Credits the ongoing activation bucket by bucket and retires buckets
+     * that have left the window. Gaps longer than the window clear the
+     * buckets in one step, so the cost is bounded by SOLENOID_DUTY_BUCKETS.
+     */
+    void advanceWindow(uint64_t now);
+
+    /**
+     * @brief Credit the ongoing activation to the current bucket
+     *
+     * @param until Credit energized time up to this timebase time
+     */
+    void creditOnTime(uint64_t until);
+
+    /**
+     * @brief Add energized time to the current bucket
+     *
+     * @param onUs Microseconds to add
+     */
+    void addWindowOnTime(uint64_t onUs);
+
+    /**
+     * @brief Convert time since the on-edge into energized time
      *
-     * If more time has passed than windowDurationMs since _windowStartTime,
-     * the window is reset. Any partial on-time from a currently-on channel
-     * is preserved when the window resets.
+     * @param sinceOnUs Microseconds since the channel turned on
+     * @return Microseconds of that span the coil was effectively at full power
      */
-    void updateWindow(uint32_t windowDurationMs, uint32_t now);
+    uint64_t energizedTime(uint64_t sinceOnUs) const;
 };
 
 #endif // SOLENOID_CHANNEL_H
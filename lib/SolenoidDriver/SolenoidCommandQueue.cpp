@@ -0,0 +1,63 @@
+/**
+ * @file SolenoidCommandQueue.cpp
+ * @brief Implementation of SolenoidCommandQueue class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidCommandQueue.h"
+
+/** Ring index mask (capacity is a power of two) */
+static constexpr uint8_t COMMAND_MASK = SOLENOID_COMMAND_QUEUE_CAPACITY - 1;
+
+static_assert((SOLENOID_COMMAND_QUEUE_CAPACITY & COMMAND_MASK) == 0,
+              "SOLENOID_COMMAND_QUEUE_CAPACITY must be a power of two");
+
+SolenoidCommandQueue::SolenoidCommandQueue()
+    : _head(0)
+    , _tail(0)
+    , _dropped(0)
+{
+}
+
+bool SolenoidCommandQueue::push(const SolenoidCommand& command) {
+    uint8_t head = _head;
+    if (static_cast<uint8_t>(head - _tail) >= SOLENOID_COMMAND_QUEUE_CAPACITY) {
+        _dropped = _dropped + 1;
+        return false;
+    }
+
+    _ring[head & COMMAND_MASK] = command;
+
+    // Publish the command only after it is fully written
+    __asm__ volatile("" ::: "memory");
+    _head = head + 1;
+    return true;
+}
+
+bool SolenoidCommandQueue::pop(SolenoidCommand& command) {
+    uint8_t tail = _tail;
+    if (tail == _head) {
+        return false;
+    }
+
+    command = _ring[tail & COMMAND_MASK];
+
+    // Release the slot only after it has been copied out
+    __asm__ volatile("" ::: "memory");
+    _tail = tail + 1;
+    return true;
+}
+
+void SolenoidCommandQueue::clear() {
+    _tail = _head;
+}
+
+uint8_t SolenoidCommandQueue::pending() const {
+    return static_cast<uint8_t>(_head - _tail);
+}
+
+uint32_t SolenoidCommandQueue::dropCount() const {
+    return _dropped;
+}
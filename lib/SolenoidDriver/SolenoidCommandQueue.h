@@ -0,0 +1,104 @@
+/**
+ * @file SolenoidCommandQueue.h
+ * @brief Command ring from the application to the driver's tick interrupt
+ *
+ * When SolenoidDriver runs its timing core from a hardware timer
+ * (SolenoidConfig::tickHz), calls such as on() and off() made from loop()
+ * or the MIDI callbacks do not touch driver state directly. They are
+ * recorded here and applied by the next tick, so the interrupt and the
+ * application never need a lock.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_COMMAND_QUEUE_H
+#define SOLENOID_COMMAND_QUEUE_H
+
+#include <stdint.h>
+
+#include "SolenoidConfig.h"
+
+/**
+ * @enum SolenoidCommandType
+ * @brief Driver call recorded by a SolenoidCommand
+ */
+enum class SolenoidCommandType : uint8_t {
+    ON = 0,             ///< on(channel)
+    STRIKE = 1,         ///< on(channel, velocity)
+    OFF = 2,            ///< off(channel)
+    PULSE = 3,          ///< pulse(channel, arg = durationMs)
+    NOTE_ON = 4,        ///< scheduleNoteOn(channel, velocity, arg = strikeUs)
+    NOTE_OFF = 5,       ///< scheduleNoteOff(channel, arg = releaseUs)
+    CANCEL_NOTES = 6    ///< cancelScheduledNotes()
+};
+
+/**
+ * @struct SolenoidCommand
+ * @brief A single deferred driver call
+ */
+struct SolenoidCommand {
+    uint32_t arg;               ///< Duration or target time, depending on type
+    SolenoidCommandType type;   ///< Call to perform
+    uint8_t channel;            ///< Global channel index
+    uint8_t velocity;           ///< Velocity for STRIKE and NOTE_ON
+};
+
+/**
+ * @class SolenoidCommandQueue
+ * @brief Lock-free single-producer/single-consumer ring of driver calls
+ *
+ * The producer (application context) only writes _head and the consumer
+ * (the tick interrupt) only writes _tail. Commands are applied in the
+ * order they were pushed. A full ring rejects new commands and counts them.
+ */
+class SolenoidCommandQueue {
+public:
+    /**
+     * @brief Construct an empty queue
+     */
+    SolenoidCommandQueue();
+
+    /**
+     * @brief Record a command (producer side)
+     *
+     * @param command Command to record
+     * @return true if recorded, false if the ring was full
+     */
+    bool push(const SolenoidCommand& command);
+
+    /**
+     * @brief Take the oldest command off the ring (consumer side)
+     *
+     * @param command Output: the oldest command
+     * @return true if a command was returned, false if the ring is empty
+     */
+    bool pop(SolenoidCommand& command);
+
+    /**
+     * @brief Discard all pending commands (consumer side)
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of commands waiting to be applied
+     *
+     * @return Pending command count
+     */
+    uint8_t pending() const;
+
+    /**
+     * @brief Get the number of commands rejected because the ring was full
+     *
+     * @return Rejected command count since construction
+     */
+    uint32_t dropCount() const;
+
+private:
+    SolenoidCommand _ring[SOLENOID_COMMAND_QUEUE_CAPACITY];    ///< Command storage
+    volatile uint8_t _head;                                    ///< Next slot to fill (producer)
+    volatile uint8_t _tail;                                    ///< Next slot to apply (consumer)
+    volatile uint32_t _dropped;                                ///< Commands lost to a full ring
+};
+
+#endif // SOLENOID_COMMAND_QUEUE_H
@@ -18,14 +18,102 @@
 // LIBRARY LIMITS
 // =============================================================================
 
+/** Maximum number of I2C buses used by SolenoidMultiBus (Wire, Wire1, Wire2) */
+constexpr uint8_t SOLENOID_MAX_BUSES = 3;
+
 /** Maximum number of driver boards supported per I2C bus */
 constexpr uint8_t SOLENOID_MAX_BOARDS_PER_BUS = 8;
 
-/** Maximum number of channels per board */
+/** Default number of channels per board (Port A only) */
 constexpr uint8_t SOLENOID_CHANNELS_PER_BOARD = 8;
 
+/** Maximum number of channels per board (Port A and Port B) */
+constexpr uint8_t SOLENOID_MAX_CHANNELS_PER_BOARD = 16;
+
 /** Maximum total channels (for static allocation) */
-constexpr uint8_t SOLENOID_MAX_CHANNELS = 128;  // Supports multiple boards with 8 channels each
+constexpr uint8_t SOLENOID_MAX_CHANNELS = 128;  // 8 boards with 16 channels each
+
+/**
+ * @brief Number of 32-bit words in a bitmask covering a number of channels
+ */
+constexpr uint8_t solenoidMaskWords(uint16_t channels) {
+    return static_cast<uint8_t>((channels + 31) / 32);
+}
+
+/** Number of 32-bit words in a bitmask covering every channel */
+constexpr uint8_t SOLENOID_MASK_WORDS = solenoidMaskWords(SOLENOID_MAX_CHANNELS);
+
+/** Maximum number of pending scheduled events (pulse/hold edges and sequenced notes) */
+constexpr uint8_t SOLENOID_SCHEDULER_CAPACITY = 128;
+
+/** Frames in the asynchronous I2C transmit ring (must be a power of two) */
+constexpr uint8_t SOLENOID_TX_QUEUE_CAPACITY = 16;
+
+/** Time after which an asynchronous I2C frame is considered stalled (us) */
+constexpr uint32_t SOLENOID_TX_TIMEOUT_US = 5000;
+
+/**
+ * Longest pulse() (ms) - the scheduler orders edges by signed 32-bit
+ * microsecond differences, so later off-edges would wrap (about 35 minutes)
+ */
+constexpr uint32_t SOLENOID_MAX_PULSE_MS = 0x7FFFFFFF / 1000;
+
+/** TwoWire::endTransmission() code: address or data not acknowledged */
+constexpr uint8_t SOLENOID_I2C_NACK = 2;
+
+/** TwoWire::endTransmission() code: other error (arbitration lost, bus error, aborted) */
+constexpr uint8_t SOLENOID_I2C_OTHER_ERROR = 4;
+
+/** TwoWire::endTransmission() code: transfer timed out */
+constexpr uint8_t SOLENOID_I2C_TIMEOUT = 5;
+
+/** Failed transfers in a row, on any board, after which the bus is assumed stuck */
+constexpr uint8_t SOLENOID_BUS_RECOVERY_FAILURES = 8;
+
+/** Shortest time between two automatic bus recoveries (ms) */
+constexpr uint32_t SOLENOID_BUS_RECOVERY_INTERVAL_MS = 1000;
+
+/** SCL pulses clocked to make a slave release SDA (one byte plus its ACK) */
+constexpr uint8_t SOLENOID_BUS_RECOVERY_CLOCKS = 9;
+
+/** SolenoidConfig::resetPin value for no board reset line */
+constexpr uint8_t SOLENOID_NO_PIN = 0xFF;
+
+/** Low time of a board RESET pulse (us) - twice the MCP23017's 1us minimum */
+constexpr uint32_t SOLENOID_RESET_PULSE_US = 2;
+
+/** Records held by the deferred error ring (must be a power of two) */
+constexpr uint8_t SOLENOID_ERROR_QUEUE_CAPACITY = 32;
+
+/** Calls held by the application-to-tick command ring (must be a power of two) */
+constexpr uint8_t SOLENOID_COMMAND_QUEUE_CAPACITY = 64;
+
+/** NVIC priority of the tick timer - below LPI2C so transmits can preempt it */
+constexpr uint8_t SOLENOID_TICK_IRQ_PRIORITY = 176;
+
+/** Breakpoints in each channel's velocity curve (velocities 1, 19, ... 127) */
+constexpr uint8_t SOLENOID_VELOCITY_POINTS = 8;
+
+/** Buckets in each channel's sliding duty cycle window (must be a power of two) */
+constexpr uint8_t SOLENOID_DUTY_BUCKETS = 16;
+
+/** Sub-buckets per power of two in a SolenoidHistogram (2^bits; 3 = 12.5% resolution) */
+constexpr uint8_t SOLENOID_HISTOGRAM_SUB_BITS = 3;
+
+/** Buckets in a SolenoidHistogram - covers the whole uint32_t range */
+constexpr uint16_t SOLENOID_HISTOGRAM_BUCKETS = (33 - SOLENOID_HISTOGRAM_SUB_BITS) << SOLENOID_HISTOGRAM_SUB_BITS;
+
+/** Rejection counters kept by SolenoidMetrics: codes 0-9 plus one for UNKNOWN */
+constexpr uint8_t SOLENOID_METRICS_ERROR_CODES = 11;
+
+/** SysEx manufacturer ID of metrics frames (0x7D = non-commercial) */
+constexpr uint8_t SOLENOID_METRICS_SYSEX_ID = 0x7D;
+
+/** Byte after the manufacturer ID identifying a metrics frame ('M') */
+constexpr uint8_t SOLENOID_METRICS_SYSEX_TAG = 0x4D;
+
+/** Metrics frame layout version - bumped whenever the payload changes */
+constexpr uint8_t SOLENOID_METRICS_VERSION = 1;
 
 // =============================================================================
 // DEFAULT CONFIGURATION VALUES
@@ -43,8 +131,80 @@ constexpr float SOLENOID_DEFAULT_MAX_DUTY_CYCLE = 0.5f;
 /** Default duty cycle window duration (ms) - 10 second rolling window */
 constexpr uint32_t SOLENOID_DEFAULT_DUTY_CYCLE_WINDOW_MS = 10000;
 
-/** Default I2C clock speed (Hz) */
-constexpr uint32_t SOLENOID_DEFAULT_I2C_CLOCK_HZ = 400000;
+/** Default coil heating time constant (ms) - 0 disables the thermal model */
+constexpr uint32_t SOLENOID_DEFAULT_THERMAL_HEAT_TAU_MS = 30000;
+
+/** Default coil cooling time constant (ms) */
+constexpr uint32_t SOLENOID_DEFAULT_THERMAL_COOL_TAU_MS = 60000;
+
+/** Default thermal load at which hold duty starts to be reduced (0.0 - 1.0) */
+constexpr float SOLENOID_DEFAULT_THERMAL_SOFT_LIMIT = 0.3f;
+
+/** Default thermal load at which activations are rejected (0.0 - 1.0) */
+constexpr float SOLENOID_DEFAULT_THERMAL_HARD_LIMIT = 0.5f;
+
+/** Default kick length at velocity 1 (us) */
+constexpr uint16_t SOLENOID_DEFAULT_KICK_MIN_US = 2000;
+
+/** Default kick length at velocity 127 (us) */
+constexpr uint16_t SOLENOID_DEFAULT_KICK_MAX_US = 12000;
+
+/** Default hold duty after the kick (0-255; 128 = 50%) */
+constexpr uint8_t SOLENOID_DEFAULT_HOLD_DUTY = 128;
+
+/** Default software PWM period for the hold phase (us) - 200Hz */
+constexpr uint32_t SOLENOID_DEFAULT_HOLD_PWM_PERIOD_US = 5000;
+
+/** Default current drawn by one energized coil (mA), for the power budget */
+constexpr uint16_t SOLENOID_DEFAULT_COIL_CURRENT_MA = 1000;
+
+/** Default shortest delay before an over-budget strike is retried (us) */
+constexpr uint32_t SOLENOID_DEFAULT_POWER_STAGGER_US = 300;
+
+/** Default longest an over-budget strike waits before it is dropped (us, 0 = until it plays) */
+constexpr uint32_t SOLENOID_DEFAULT_POWER_STAGGER_MAX_US = 0;
+
+/** Default shortest release before a retriggered key is struck again (us) */
+constexpr uint32_t SOLENOID_DEFAULT_RETRIGGER_GAP_US = 2000;
+
+/** Default window within which due scheduled events share one commit (us) */
+constexpr uint32_t SOLENOID_DEFAULT_EVENT_GROUP_US = 250;
+
+/** Default I2C clock speed (Hz) - Fast-mode Plus, with automatic fallback */
+constexpr uint32_t SOLENOID_DEFAULT_I2C_CLOCK_HZ = 1000000;
+
+/** Standard I2C clock speeds tried by the speed fallback, fastest first (Hz) */
+constexpr uint32_t SOLENOID_I2C_SPEEDS[] = { 1000000, 400000, 100000 };
+
+/** Number of entries in SOLENOID_I2C_SPEEDS */
+constexpr uint8_t SOLENOID_I2C_SPEED_COUNT = sizeof(SOLENOID_I2C_SPEEDS) / sizeof(SOLENOID_I2C_SPEEDS[0]);
+
+/** Default number of I2C errors within the error window that triggers a slowdown */
+constexpr uint8_t SOLENOID_DEFAULT_I2C_ERROR_THRESHOLD = 8;
+
+/** Default I2C error counting window (ms) */
+constexpr uint32_t SOLENOID_DEFAULT_I2C_ERROR_WINDOW_MS = 1000;
+
+/** Default retries of a failed board write before the board is taken offline */
+constexpr uint8_t SOLENOID_DEFAULT_I2C_RETRY_LIMIT = 3;
+
+/** Default delay before the first retry of a failed board write (us); doubles per retry */
+constexpr uint32_t SOLENOID_DEFAULT_I2C_RETRY_BACKOFF_US = 250;
+
+/** Default interval between reconnection attempts of an offline board (ms) */
+constexpr uint32_t SOLENOID_DEFAULT_BOARD_RECOVERY_MS = 100;
+
+/** Default benchmark workload events per second */
+constexpr uint32_t SOLENOID_DEFAULT_BENCH_RATE_HZ = 20;
+
+/** Default benchmark run length (ms) */
+constexpr uint32_t SOLENOID_DEFAULT_BENCH_DURATION_MS = 2000;
+
+/** Default strike velocity of benchmark notes */
+constexpr uint8_t SOLENOID_DEFAULT_BENCH_VELOCITY = 64;
+
+/** Time left after a benchmark run for the last writes to complete (ms) */
+constexpr uint32_t SOLENOID_BENCH_DRAIN_MS = 100;
 
 // =============================================================================
 // MCP23017 CONSTANTS
@@ -56,6 +216,61 @@ constexpr uint8_t MCP23017_BASE_ADDRESS = 0x20;
 /** MCP23017 maximum address */
 constexpr uint8_t MCP23017_MAX_ADDRESS = 0x27;
 
+/** MCP23017 IODIRA direction register (1 = input); IODIRB follows sequentially */
+constexpr uint8_t MCP23017_REG_IODIRA = 0x00;
+
+/** MCP23017 DEFVALA register - harmless scratch register for bus checks */
+constexpr uint8_t MCP23017_REG_DEFVALA = 0x06;
+
+/** MCP23017 GPIOA register (IOCON.BANK = 0); GPIOB follows sequentially */
+constexpr uint8_t MCP23017_REG_GPIOA = 0x12;
+
+/** MCP23017 OLATA output latch register; OLATB follows sequentially */
+constexpr uint8_t MCP23017_REG_OLATA = 0x14;
+
+// =============================================================================
+// TIMEBASE
+// =============================================================================
+
+/**
+ * @enum SolenoidTimebaseSource
+ * @brief Hardware counter behind SolenoidTimebase
+ */
+enum class SolenoidTimebaseSource : uint8_t {
+    /** micros() (1us resolution, any platform) */
+    MICROS = 0,
+
+    /**
+     * ARM DWT cycle counter (CPU clock resolution, Teensy 4.x only).
+     * Falls back to MICROS on other platforms.
+     */
+    CYCLE_COUNTER = 1
+};
+
+// =============================================================================
+// RETRIGGER POLICY
+// =============================================================================
+
+/**
+ * @enum SolenoidRetriggerPolicy
+ * @brief What the driver does with a strike it cannot play right now
+ */
+enum class SolenoidRetriggerPolicy : uint8_t {
+    /**
+     * A note-on for a key that is already down is ignored, and a strike
+     * inside the cooldown is rejected with SAFETY_COOLDOWN
+     */
+    IGNORE = 0,
+
+    /**
+     * A note-on for a key that is already down releases it and strikes it
+     * again; a strike inside the cooldown is played as soon as the cooldown
+     * allows. When the scheduler is full, the weakest pending strike is shed
+     * to make room for a stronger one.
+     */
+    DEFER = 1
+};
+
 // =============================================================================
 // ERROR CODES
 // =============================================================================
@@ -93,13 +308,92 @@ enum class SolenoidError : uint8_t {
     /** Safety: Duty cycle limit exceeded */
     DUTY_CYCLE_EXCEEDED = 7,
 
-    /** Reserved for future non-blocking operations */
+    /** Scheduler queue full - non-blocking operation could not be queued */
     BUSY = 8,
 
+    /** Power budget: strike waited past powerStaggerMaxUs (or staggering is off), dropped */
+    POWER_BUDGET_EXCEEDED = 9,
+
     /** Generic/unknown error */
     UNKNOWN = 255
 };
 
+// =============================================================================
+// BOARD HEALTH
+// =============================================================================
+
+/**
+ * @enum SolenoidBoardHealth
+ * @brief Link state of one board, as seen by the driver
+ *
+ * Writes to a board that is not ONLINE are not sent; they only update the
+ * cached state, which is written in full once the board answers again.
+ * The other boards on the bus are not affected.
+ */
+enum class SolenoidBoardHealth : uint8_t {
+    /** Board acknowledged its last write */
+    ONLINE = 0,
+
+    /** A write failed; retrying with growing delays (i2cRetryBackoffUs) */
+    RETRYING = 1,
+
+    /** i2cRetryLimit retries failed; reconnection tried every boardRecoveryMs */
+    OFFLINE = 2
+};
+
+// =============================================================================
+// SETTINGS STORE
+// =============================================================================
+
+/** First bytes of a stored settings blob ("SCFG" in memory order) */
+constexpr uint32_t SOLENOID_STORE_MAGIC = 0x47464353;
+
+/** Settings blob layout version - bumped whenever the payload changes */
+constexpr uint16_t SOLENOID_STORE_VERSION = 1;
+
+/** Default EEPROM offset of the settings blob */
+constexpr uint16_t SOLENOID_STORE_DEFAULT_ADDRESS = 0;
+
+/** Bytes reserved in the blob for the application's own settings */
+constexpr uint8_t SOLENOID_STORE_USER_BYTES = 128;
+
+/**
+ * @enum SolenoidStoreStatus
+ * @brief Result of loading or saving a SolenoidConfigStore
+ */
+enum class SolenoidStoreStatus : uint8_t {
+    /** Blob read (or written) and verified */
+    OK = 0,
+
+    /** No blob at the address (never saved or erased) */
+    EMPTY = 1,
+
+    /** Blob written by a firmware with a different layout */
+    VERSION_MISMATCH = 2,
+
+    /** Blob fails its length or CRC check */
+    CORRUPT = 3,
+
+    /** No EEPROM on this platform */
+    UNSUPPORTED = 4
+};
+
+// =============================================================================
+// EVENT LOG
+// =============================================================================
+
+/** Records held by the event log ring (must be a power of two; 16 bytes each) */
+constexpr uint16_t SOLENOID_LOG_CAPACITY = 1024;
+
+/** Records written out per chunk - 32 x 16 bytes fill one 512-byte SD sector */
+constexpr uint16_t SOLENOID_LOG_CHUNK_RECORDS = 32;
+
+/** Value of the first record's value0 ("SLOG" in memory order) */
+constexpr uint32_t SOLENOID_LOG_MAGIC = 0x474F4C53;
+
+/** Event log record layout version - bumped whenever a record changes */
+constexpr uint8_t SOLENOID_LOG_VERSION = 1;
+
 // =============================================================================
 // CONFIGURATION STRUCTURE
 // =============================================================================
@@ -155,18 +449,282 @@ struct SolenoidConfig {
      * The time period over which duty cycle is calculated.
      * A longer window provides smoother averaging but slower response.
      * A shorter window reacts faster but may be more restrictive.
+     * The window slides in steps of dutyCycleWindowMs / SOLENOID_DUTY_BUCKETS.
      * Default: 10000ms (10 seconds)
      */
     uint32_t dutyCycleWindowMs = SOLENOID_DEFAULT_DUTY_CYCLE_WINDOW_MS;
 
+    /**
+     * Coil heating time constant of the thermal model (milliseconds)
+     *
+     * Each channel keeps a first-order estimate of its coil temperature as
+     * a thermal load: 0.0 is ambient, 1.0 the temperature reached after
+     * running continuously at full power. While energized the load moves
+     * towards the energized fraction (1.0 during a kick, holdDuty/255
+     * during a hold) with this time constant.
+     * 0 disables the thermal model.
+     * Default: 30000ms
+     */
+    uint32_t thermalHeatTauMs = SOLENOID_DEFAULT_THERMAL_HEAT_TAU_MS;
+
+    /**
+     * Coil cooling time constant of the thermal model (milliseconds)
+     *
+     * While off the load decays towards 0.0 with this time constant.
+     * Default: 60000ms
+     */
+    uint32_t thermalCoolTauMs = SOLENOID_DEFAULT_THERMAL_COOL_TAU_MS;
+
+    /**
+     * Thermal load at which velocity strikes start to be softened (0.0 to 1.0)
+     *
+     * Between thermalSoftLimit and thermalHardLimit the hold duty of
+     * SolenoidDriver::on(channel, velocity) is scaled down linearly, down
+     * to a kick with no hold at the hard limit. With holdPwmPeriodUs = 0
+     * only the fully scaled case (no hold) takes effect.
+     * Default: 0.3
+     */
+    float thermalSoftLimit = SOLENOID_DEFAULT_THERMAL_SOFT_LIMIT;
+
+    /**
+     * Thermal load at which activations are rejected (0.0 to 1.0)
+     *
+     * At or above this load on() fails with DUTY_CYCLE_EXCEEDED until the
+     * coil has cooled. Set to 1.0 or more to only throttle.
+     * Default: 0.5
+     */
+    float thermalHardLimit = SOLENOID_DEFAULT_THERMAL_HARD_LIMIT;
+
+    /**
+     * Software PWM period used for the hold phase of velocity strikes (us)
+     *
+     * After the kick of SolenoidDriver::on(channel, velocity), a hold duty
+     * below 255 is produced by switching the coil on and off once per
+     * period. Each switch is one board write, so shorter periods cost more
+     * I2C bandwidth. Only the energized part of the hold counts towards
+     * maxDutyCycle.
+     * Default: 5000us (200Hz)
+     */
+    uint32_t holdPwmPeriodUs = SOLENOID_DEFAULT_HOLD_PWM_PERIOD_US;
+
+    /**
+     * Scheduled event grouping window (microseconds)
+     *
+     * update() fires every scheduled event due within this time from now,
+     * so notes of a chord that land a few microseconds apart go out in the
+     * same write per board instead of waiting for the next update().
+     * Events may fire up to this much early.
+     * Default: 250us
+     */
+    uint32_t eventGroupUs = SOLENOID_DEFAULT_EVENT_GROUP_US;
+
+    /**
+     * Maximum number of coils energized at the same moment
+     *
+     * Counts coils that are physically powered: a kick, a full-power note,
+     * or the high phase of a hold. 0 disables the limit.
+     * Default: 0 (unlimited)
+     */
+    uint8_t maxActiveCoils = 0;
+
+    /**
+     * Maximum total coil current (milliamps)
+     *
+     * Sum of SolenoidDriver::setCoilCurrent() ratings of the coils that are
+     * physically powered. 0 disables the limit.
+     * Default: 0 (unlimited)
+     */
+    uint32_t powerBudgetMa = 0;
+
+    /**
+     * Delay between attempts of an over-budget strike (microseconds)
+     *
+     * A strike that would exceed maxActiveCoils or powerBudgetMa is not
+     * rejected but retried through the scheduler when the first coil still
+     * in its kick drops to its hold, and no sooner than this (this is the
+     * polling interval while no kick is running). To make room for it,
+     * coils in the high phase of a hold are switched off early, and hold
+     * phases yield while the budget is full - kicks take priority over
+     * holds. Set to 0 to reject over-budget strikes with
+     * POWER_BUDGET_EXCEEDED instead.
+     * Default: 300us
+     */
+    uint32_t powerStaggerUs = SOLENOID_DEFAULT_POWER_STAGGER_US;
+
+    /**
+     * Latency deadline of an over-budget strike (microseconds, 0 = none)
+     *
+     * With 0 a strike keeps waiting until a kick frees power, so a chord
+     * of any width plays in full, in rounds of maxActiveCoils kicks;
+     * only a full scheduler sheds strikes (the weakest first). Otherwise a
+     * strike still waiting this long after it was first deferred is
+     * dropped and POWER_BUDGET_EXCEEDED is reported - strikes expire in
+     * the order they arrived, so the oldest goes first.
+     * Default: 0 (no deadline)
+     */
+    uint32_t powerStaggerMaxUs = SOLENOID_DEFAULT_POWER_STAGGER_MAX_US;
+
+    /**
+     * Handling of repeated notes and strikes inside the cooldown
+     *
+     * See SolenoidRetriggerPolicy. The cooldown itself (minOffTimeMs) only
+     * applies while safetyEnabled is set.
+     * Default: IGNORE
+     */
+    SolenoidRetriggerPolicy retrigger = SolenoidRetriggerPolicy::IGNORE;
+
+    /**
+     * Shortest release before a retriggered key is struck again (microseconds)
+     *
+     * Gives the hammer time to fall back when minOffTimeMs is shorter or
+     * disabled. Only used with SolenoidRetriggerPolicy::DEFER.
+     * Default: 2000us
+     */
+    uint32_t retriggerGapUs = SOLENOID_DEFAULT_RETRIGGER_GAP_US;
+
+    /**
+     * Hardware timer tick rate for the timing core (Hz)
+     *
+     * 0: the core runs from update(), so timing resolution depends on how
+     *    often loop() calls it.
+     * Non-zero (Teensy 4.x): begin() starts an IntervalTimer at this rate
+     *    and the core - scheduled events, timeouts, transmit completions -
+     *    runs from its interrupt. on(), off(), pulse() and the sequencing
+     *    calls made from loop() are queued and applied by the next tick;
+     *    their errors are reported through popError(). Use with
+     *    asyncTransmit so the interrupt never waits on the bus.
+     * Ignored on other platforms. Latched by begin().
+     * Default: 0 (disabled)
+     */
+    uint32_t tickHz = 0;
+
+    /**
+     * Counter behind the library's microsecond timebase
+     *
+     * MICROS works everywhere. CYCLE_COUNTER reads the DWT cycle counter
+     * on Teensy 4.x for sub-microsecond edge timestamps and a cheaper read
+     * from interrupt context. Latched by begin().
+     * Default: MICROS
+     */
+    SolenoidTimebaseSource timebase = SolenoidTimebaseSource::MICROS;
+
     /**
      * I2C clock frequency (Hz)
      *
-     * Standard: 100000 (100kHz), Fast: 400000 (400kHz)
-     * Default: 400000 (400kHz)
+     * Standard: 100000 (100kHz), Fast: 400000 (400kHz),
+     * Fast-mode Plus: 1000000 (1MHz)
+     * With i2cSpeedFallback enabled this is the fastest speed tried.
+     * Default: 1000000 (1MHz)
      */
     uint32_t i2cClockHz = SOLENOID_DEFAULT_I2C_CLOCK_HZ;
 
+    /**
+     * Automatically fall back to a slower I2C clock
+     *
+     * When true, begin() checks every board with a write/read-back test at
+     * i2cClockHz and steps down through the standard speeds until all boards
+     * pass. At runtime, i2cErrorThreshold communication errors within
+     * i2cErrorWindowMs drop the clock one more step.
+     * The speed in use is reported by SolenoidDriver::getI2CClockHz().
+     * Default: true
+     */
+    bool i2cSpeedFallback = true;
+
+    /**
+     * I2C errors within i2cErrorWindowMs that trigger a runtime slowdown
+     *
+     * Default: 8
+     */
+    uint8_t i2cErrorThreshold = SOLENOID_DEFAULT_I2C_ERROR_THRESHOLD;
+
+    /**
+     * Window over which I2C errors are counted (milliseconds)
+     *
+     * Default: 1000ms
+     */
+    uint32_t i2cErrorWindowMs = SOLENOID_DEFAULT_I2C_ERROR_WINDOW_MS;
+
+    /**
+     * Retries of a failed board write before the board is taken offline
+     *
+     * A board whose write is not acknowledged stops receiving writes and is
+     * retried from update() (or the tick) after i2cRetryBackoffUs, twice
+     * that, and so on. Each retry reconfigures the board's outputs and
+     * writes its cached state, so a board that reset itself comes back
+     * with the right coils on. Retries are queued behind the writes of
+     * healthy boards, which keep playing.
+     * Default: 3
+     */
+    uint8_t i2cRetryLimit = SOLENOID_DEFAULT_I2C_RETRY_LIMIT;
+
+    /**
+     * Delay before the first retry of a failed board write (microseconds)
+     *
+     * Doubles with every further retry.
+     * Default: 250us
+     */
+    uint32_t i2cRetryBackoffUs = SOLENOID_DEFAULT_I2C_RETRY_BACKOFF_US;
+
+    /**
+     * Interval between reconnection attempts of an offline board (milliseconds)
+     *
+     * An offline board is reconfigured and restored from the cached state
+     * as soon as it answers. 0 leaves it offline until the next begin().
+     * Default: 100ms
+     */
+    uint32_t boardRecoveryMs = SOLENOID_DEFAULT_BOARD_RECOVERY_MS;
+
+    /**
+     * Pin driving the boards' shared RESET line (active low)
+     *
+     * When set, emergencyStop() and allOff() release every coil with one
+     * RESET pulse instead of a write per board: each MCP23017 returns to
+     * its power-on state, all pins inputs, within microseconds however busy
+     * the bus is. The outputs are then reconfigured board by board. The
+     * driver boards must hold their MOSFET gates low while the expander
+     * pins float (gate pull-downs). Latched by begin().
+     * Default: SOLENOID_NO_PIN (boards are zeroed over I2C, energized
+     * boards first)
+     */
+    uint8_t resetPin = SOLENOID_NO_PIN;
+
+    /**
+     * Channels used on each board (8 or 16)
+     *
+     * 8: Port A only (GPA0-7), written with one single-port write.
+     * 16: Port A and Port B (GPA0-7 = channels 0-7, GPB0-7 = channels 8-15),
+     *     written together in one sequential two-byte write.
+     * Latched by begin() - changing it afterwards has no effect until the
+     * next begin().
+     * Default: 8
+     */
+    uint8_t channelsPerBoard = SOLENOID_CHANNELS_PER_BOARD;
+
+    /**
+     * Send board writes through the asynchronous transmit queue
+     *
+     * When true, board frames are queued and clocked out by the LPI2C
+     * interrupt (Teensy 4.x) so the CPU is not blocked while the bus is
+     * busy. Channel timestamps are corrected to the time each frame actually
+     * completed on the wire. On other platforms frames are sent from
+     * update() with the blocking Wire API.
+     * Latched by begin().
+     * Default: false
+     */
+    bool asyncTransmit = false;
+
+    /**
+     * Interval between automatic output latch checks (milliseconds)
+     *
+     * The driver never reads a board before writing it - it trusts its
+     * cached copy of the output latches. When non-zero, update() reads the
+     * OLAT registers of every board at this interval and rewrites any board
+     * whose latches have drifted (e.g. after a brown-out reset).
+     * Set to 0 to disable; resyncFromHardware() can still be called.
+     * Default: 0 (disabled)
+     */
+    uint32_t resyncIntervalMs = 0;
+
     /**
      * Enable safety features
      *
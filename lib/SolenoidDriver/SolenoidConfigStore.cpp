@@ -0,0 +1,264 @@
+/**
+ * @file SolenoidConfigStore.cpp
+ * @brief Implementation of SolenoidConfigStore class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidConfigStore.h"
+
+#include <string.h>
+
+#include "SolenoidDriver.h"
+
+#if defined(__IMXRT1062__)
+#include <EEPROM.h>
+
+static_assert(SOLENOID_STORE_MAX_BYTES <= E2END + 1, "Settings blob is larger than the EEPROM");
+#endif
+
+// Header field offsets
+static constexpr uint16_t OFFSET_MAGIC = 0;
+static constexpr uint16_t OFFSET_VERSION = 4;
+static constexpr uint16_t OFFSET_CONFIG_SIZE = 6;
+static constexpr uint16_t OFFSET_CHANNELS = 8;
+static constexpr uint16_t OFFSET_USER_SIZE = 9;
+static constexpr uint16_t OFFSET_LENGTH = 10;
+static constexpr uint16_t OFFSET_CRC = 12;
+
+// Status strings
+static const char STR_OK[] = "OK";
+static const char STR_EMPTY[] = "No stored settings";
+static const char STR_VERSION[] = "Stored settings are from another firmware version";
+static const char STR_CORRUPT[] = "Stored settings are corrupt";
+static const char STR_UNSUPPORTED[] = "No EEPROM on this platform";
+static const char STR_UNKNOWN[] = "Unknown status";
+
+/** Copy a value into the image */
+template <typename T>
+static uint8_t* put(uint8_t* out, const T& value) {
+    memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+}
+
+/** Copy a value out of the image */
+template <typename T>
+static const uint8_t* get(const uint8_t* in, T& value) {
+    memcpy(&value, in, sizeof(T));
+    return in + sizeof(T);
+}
+
+SolenoidConfigStore::SolenoidConfigStore(uint16_t address)
+    : _address(address)
+    , _userSize(0)
+    , _valid(false)
+{
+    memset(_image, 0, sizeof(_image));
+}
+
+// =============================================================================
+// CONTENT
+// =============================================================================
+
+void SolenoidConfigStore::capture(const SolenoidDriverBase& driver) {
+    uint8_t channels = driver.getChannelCount();
+    const SolenoidVelocityMap& velocity = driver.getVelocityMap();
+    SolenoidConfig config = driver.getConfig();
+
+    uint8_t* p = _image + SOLENOID_STORE_HEADER_BYTES;
+    p = put(p, config);
+    for (uint8_t ch = 0; ch < channels; ch++) {
+        memcpy(p, velocity.getCurve(ch), 2 * SOLENOID_VELOCITY_POINTS);
+        p += 2 * SOLENOID_VELOCITY_POINTS;
+        p = put(p, velocity.getHoldDuty(ch));
+        p = put(p, velocity.getLatency(ch));
+        p = put(p, driver.getCoilCurrent(ch));
+    }
+    memcpy(p, _user, _userSize);
+
+    uint16_t length = payloadLength(channels, _userSize);
+    uint8_t* h = _image;
+    h = put(h, SOLENOID_STORE_MAGIC);
+    h = put(h, SOLENOID_STORE_VERSION);
+    h = put(h, static_cast<uint16_t>(sizeof(SolenoidConfig)));
+    h = put(h, channels);
+    h = put(h, _userSize);
+    h = put(h, length);
+    put(h, crc32(_image + SOLENOID_STORE_HEADER_BYTES, length));
+    _valid = true;
+}
+
+void SolenoidConfigStore::setUserData(const void* data, uint8_t size) {
+    _userSize = (size > SOLENOID_STORE_USER_BYTES) ? SOLENOID_STORE_USER_BYTES : size;
+    memcpy(_user, data, _userSize);
+}
+
+bool SolenoidConfigStore::apply(SolenoidDriverBase& driver) const {
+    if (!_valid) {
+        return false;
+    }
+
+    uint8_t channels = _image[OFFSET_CHANNELS];
+    const uint8_t* p = _image + SOLENOID_STORE_HEADER_BYTES;
+
+    // The board layout belongs to the firmware, not to the tuning
+    SolenoidConfig config;
+    p = get(p, config);
+    config.channelsPerBoard = driver.getConfig().channelsPerBoard;
+    driver.setConfig(config);
+
+    // Channels beyond the driver's storage are skipped by the setters
+    SolenoidVelocityMap& velocity = driver.getVelocityMap();
+    for (uint8_t ch = 0; ch < channels; ch++) {
+        uint16_t kickUs[SOLENOID_VELOCITY_POINTS];
+        uint8_t holdDuty;
+        uint16_t latencyUs;
+        uint16_t currentMa;
+        memcpy(kickUs, p, sizeof(kickUs));
+        p += sizeof(kickUs);
+        p = get(p, holdDuty);
+        p = get(p, latencyUs);
+        p = get(p, currentMa);
+
+        velocity.setCurve(ch, kickUs);
+        velocity.setHoldDuty(ch, holdDuty);
+        velocity.setLatency(ch, latencyUs);
+        driver.setCoilCurrent(ch, currentMa);
+    }
+    return true;
+}
+
+uint8_t SolenoidConfigStore::getUserData(void* data, uint8_t size) const {
+    if (!_valid) {
+        return 0;
+    }
+
+    uint8_t stored = _image[OFFSET_USER_SIZE];
+    uint8_t count = (size < stored) ? size : stored;
+    uint16_t offset = SOLENOID_STORE_HEADER_BYTES + payloadLength(_image[OFFSET_CHANNELS], 0);
+    memcpy(data, _image + offset, count);
+    return count;
+}
+
+bool SolenoidConfigStore::isValid() const {
+    return _valid;
+}
+
+uint16_t SolenoidConfigStore::getLength() const {
+    if (!_valid) {
+        return 0;
+    }
+    uint16_t length;
+    get(_image + OFFSET_LENGTH, length);
+    return SOLENOID_STORE_HEADER_BYTES + length;
+}
+
+// =============================================================================
+// EEPROM
+// =============================================================================
+
+SolenoidStoreStatus SolenoidConfigStore::load() {
+    _valid = false;
+
+#if defined(__IMXRT1062__)
+    // One block read of the largest blob - cheaper than a read per field
+    uint16_t available = (E2END + 1) - _address;
+    uint16_t size = (available < SOLENOID_STORE_MAX_BYTES) ? available : SOLENOID_STORE_MAX_BYTES;
+    eeprom_read_block(_image, reinterpret_cast<const void*>(static_cast<uintptr_t>(_address)), size);
+
+    SolenoidStoreStatus status = verify();
+    _valid = (status == SolenoidStoreStatus::OK);
+    return status;
+#else
+    return SolenoidStoreStatus::UNSUPPORTED;
+#endif
+}
+
+SolenoidStoreStatus SolenoidConfigStore::save() {
+#if defined(__IMXRT1062__)
+    if (!_valid) {
+        return SolenoidStoreStatus::EMPTY;
+    }
+    uint16_t length = getLength();
+    if (static_cast<uint32_t>(_address) + length > E2END + 1) {
+        return SolenoidStoreStatus::CORRUPT;
+    }
+
+    // The EEPROM emulation skips bytes that already hold the value
+    eeprom_write_block(_image, reinterpret_cast<void*>(static_cast<uintptr_t>(_address)), length);
+    return SolenoidStoreStatus::OK;
+#else
+    return SolenoidStoreStatus::UNSUPPORTED;
+#endif
+}
+
+SolenoidStoreStatus SolenoidConfigStore::erase() {
+#if defined(__IMXRT1062__)
+    uint8_t blank[sizeof(SOLENOID_STORE_MAGIC)];
+    memset(blank, 0xFF, sizeof(blank));
+    eeprom_write_block(blank, reinterpret_cast<void*>(static_cast<uintptr_t>(_address)), sizeof(blank));
+    return SolenoidStoreStatus::OK;
+#else
+    return SolenoidStoreStatus::UNSUPPORTED;
+#endif
+}
+
+const char* SolenoidConfigStore::getStatusString(SolenoidStoreStatus status) {
+    switch (status) {
+        case SolenoidStoreStatus::OK:               return STR_OK;
+        case SolenoidStoreStatus::EMPTY:            return STR_EMPTY;
+        case SolenoidStoreStatus::VERSION_MISMATCH: return STR_VERSION;
+        case SolenoidStoreStatus::CORRUPT:          return STR_CORRUPT;
+        case SolenoidStoreStatus::UNSUPPORTED:      return STR_UNSUPPORTED;
+        default:                                    return STR_UNKNOWN;
+    }
+}
+
+uint32_t SolenoidConfigStore::crc32(const uint8_t* data, uint16_t length) {
+    // Bitwise, reflected polynomial 0xEDB88320 - no table, runs once per boot
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint16_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// =============================================================================
+// PRIVATE
+// =============================================================================
+
+SolenoidStoreStatus SolenoidConfigStore::verify() const {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t configSize;
+    uint16_t length;
+    uint32_t crc;
+    get(_image + OFFSET_MAGIC, magic);
+    get(_image + OFFSET_VERSION, version);
+    get(_image + OFFSET_CONFIG_SIZE, configSize);
+    get(_image + OFFSET_LENGTH, length);
+    get(_image + OFFSET_CRC, crc);
+    uint8_t channels = _image[OFFSET_CHANNELS];
+    uint8_t userSize = _image[OFFSET_USER_SIZE];
+
+    if (magic != SOLENOID_STORE_MAGIC) {
+        return SolenoidStoreStatus::EMPTY;
+    }
+    if (version != SOLENOID_STORE_VERSION || configSize != sizeof(SolenoidConfig)) {
+        return SolenoidStoreStatus::VERSION_MISMATCH;
+    }
+    if (channels > SOLENOID_MAX_CHANNELS || userSize > SOLENOID_STORE_USER_BYTES ||
+        length != payloadLength(channels, userSize) ||
+        crc != crc32(_image + SOLENOID_STORE_HEADER_BYTES, length)) {
+        return SolenoidStoreStatus::CORRUPT;
+    }
+    return SolenoidStoreStatus::OK;
+}
+
+uint16_t SolenoidConfigStore::payloadLength(uint8_t channels, uint8_t userSize) {
+    return sizeof(SolenoidConfig) + (SOLENOID_STORE_CHANNEL_BYTES * channels) + userSize;
+}
@@ -0,0 +1,206 @@
+/**
+ * @file SolenoidConfigStore.h
+ * @brief Versioned, CRC-checked settings blob kept in EEPROM
+ *
+ * Holds everything a rig is tuned with - the SolenoidConfig (thermal
+ * model, timing and safety limits), each channel's velocity curve, hold
+ * duty, strike latency and coil current, plus up to
+ * SOLENOID_STORE_USER_BYTES of the application's own settings (e.g. its
+ * keymap). The blob is read with one bulk EEPROM read at startup and only
+ * applied if its magic, layout version, length and CRC-32 all check out,
+ * so a blank, stale or half-written EEPROM falls back to the defaults.
+ *
+ * Blob layout (native byte order; Teensy 4.x is little-endian):
+ *
+ * | Field                                          | Size              |
+ * |------------------------------------------------|-------------------|
+ * | Magic (SOLENOID_STORE_MAGIC)                   | 4                 |
+ * | Layout version (SOLENOID_STORE_VERSION)        | 2                 |
+ * | sizeof(SolenoidConfig)                         | 2                 |
+ * | Channel count C, user data size U              | 1 + 1             |
+ * | Payload length                                 | 2                 |
+ * | CRC-32 of the payload                          | 4                 |
+ * | SolenoidConfig                                 | sizeof            |
+ * | Per channel: 8 kicks, hold, latency, current   | 21 x C            |
+ * | User data                                      | U                 |
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_CONFIG_STORE_H
+#define SOLENOID_CONFIG_STORE_H
+
+#include <stdint.h>
+#include <Arduino.h>
+
+#include "SolenoidConfig.h"
+
+class SolenoidDriverBase;
+
+/** Bytes of the blob header (magic to CRC) */
+constexpr uint16_t SOLENOID_STORE_HEADER_BYTES = 16;
+
+/** Bytes stored per channel: kick curve, hold duty, latency, coil current */
+constexpr uint16_t SOLENOID_STORE_CHANNEL_BYTES = (2 * SOLENOID_VELOCITY_POINTS) + 1 + 2 + 2;
+
+/** Bytes of the largest blob: every channel and all user data */
+constexpr uint16_t SOLENOID_STORE_MAX_BYTES =
+    SOLENOID_STORE_HEADER_BYTES + sizeof(SolenoidConfig)
+    + (SOLENOID_STORE_CHANNEL_BYTES * SOLENOID_MAX_CHANNELS) + SOLENOID_STORE_USER_BYTES;
+
+/**
+ * @class SolenoidConfigStore
+ * @brief RAM image of the settings blob, loaded from and saved to EEPROM
+ *
+ * capture() packs a driver's settings into the image and save() writes
+ * it; load() reads the image back and apply() hands it to a driver. The
+ * image is about 3KB, so keep one instance (e.g. a global).
+ *
+ * apply() may be called before SolenoidDriver::begin() - the settings
+ * begin() latches then take effect.
+ *
+ * Example usage:
+ * @code
+ * SolenoidConfigStore store;
+ *
+ * void setup() {
+ *     driver.setConfig(defaults);
+ *     if (store.load() == SolenoidStoreStatus::OK) {
+ *         store.apply(driver);   // Tuned settings replace the defaults
+ *     }
+ *     driver.begin(Wire);
+ * }
+ *
+ * void saveTuning() {
+ *     store.capture(driver);
+ *     store.save();
+ * }
+ * @endcode
+ */
+class SolenoidConfigStore {
+public:
+    /**
+     * @brief Construct an empty store
+     *
+     * @param address EEPROM offset of the blob
+     */
+    explicit SolenoidConfigStore(uint16_t address = SOLENOID_STORE_DEFAULT_ADDRESS);
+
+    // =========================================================================
+    // CONTENT
+    // =========================================================================
+
+    /**
+     * @brief Pack a driver's settings into the image
+     *
+     * @param driver Driver to copy from (after begin(), so its channel
+     *               count is known)
+     *
+     * Keeps the user data set with setUserData().
+     */
+    void capture(const SolenoidDriverBase& driver);
+
+    /**
+     * @brief Set the application's part of the image
+     *
+     * @param data Bytes to store
+     * @param size Byte count (clamped to SOLENOID_STORE_USER_BYTES)
+     */
+    void setUserData(const void* data, uint8_t size);
+
+    /**
+     * @brief Hand the image to a driver
+     *
+     * @param driver Driver to configure
+     * @return false if the image holds no valid blob
+     *
+     * Sets the configuration, then the velocity tables and coil currents
+     * of every stored channel the driver has room for.
+     */
+    bool apply(SolenoidDriverBase& driver) const;
+
+    /**
+     * @brief Copy out the application's part of the image
+     *
+     * @param data Buffer to fill
+     * @param size Buffer size
+     * @return Bytes copied (0 if the image is not valid)
+     */
+    uint8_t getUserData(void* data, uint8_t size) const;
+
+    /**
+     * @brief Check if the image holds a verified blob
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Get the blob length in bytes (header included)
+     *
+     * @return Length, or 0 if the image is not valid
+     */
+    uint16_t getLength() const;
+
+    // =========================================================================
+    // EEPROM
+    // =========================================================================
+
+    /**
+     * @brief Read the blob with one bulk EEPROM read and verify it
+     *
+     * @return OK if the image now holds the stored settings
+     */
+    SolenoidStoreStatus load();
+
+    /**
+     * @brief Write the image to EEPROM
+     *
+     * @return OK once written, UNSUPPORTED without EEPROM
+     *
+     * Only bytes that changed are programmed. Writing flash holds off
+     * interrupts for up to a few milliseconds, tick included - turn the
+     * coils off first.
+     */
+    SolenoidStoreStatus save();
+
+    /**
+     * @brief Invalidate the stored blob so the next load() finds none
+     *
+     * @return OK once erased, UNSUPPORTED without EEPROM
+     *
+     * Only the magic is overwritten. The image in RAM is kept.
+     */
+    SolenoidStoreStatus erase();
+
+    /**
+     * @brief Get a human-readable description of a status
+     */
+    static const char* getStatusString(SolenoidStoreStatus status);
+
+    /**
+     * @brief Compute the CRC-32 (IEEE 802.3, as zlib) of a block
+     *
+     * @param data Bytes to check
+     * @param length Byte count
+     */
+    static uint32_t crc32(const uint8_t* data, uint16_t length);
+
+private:
+    uint8_t _image[SOLENOID_STORE_MAX_BYTES];    ///< Header and payload
+    uint16_t _address;                           ///< EEPROM offset of the blob
+    uint8_t _userSize;                           ///< User data bytes in the image
+    uint8_t _user[SOLENOID_STORE_USER_BYTES];    ///< User data waiting for capture()
+    bool _valid;                                 ///< _image holds a verified blob
+
+    /**
+     * @brief Check the header and CRC of _image
+     */
+    SolenoidStoreStatus verify() const;
+
+    /**
+     * @brief Get the payload length a header describes
+     */
+    static uint16_t payloadLength(uint8_t channels, uint8_t userSize);
+};
+
+#endif // SOLENOID_CONFIG_STORE_H
@@ -24,29 +24,131 @@ static const char STR_TIMEOUT[] PROGMEM = "Safety timeout";
 static const char STR_COOLDOWN[] PROGMEM = "Safety cooldown";
 static const char STR_DUTY[] PROGMEM = "Duty cycle exceeded";
 static const char STR_BUSY[] PROGMEM = "Busy";
+static const char STR_POWER[] PROGMEM = "Power budget exceeded";
 static const char STR_UNKNOWN[] PROGMEM = "Unknown error";
 
+// =============================================================================
+// HARDWARE TICK
+// =============================================================================
+
+#if defined(__IMXRT1062__)
+
+/** One timer serves every driver (e.g. the three buses of SolenoidMultiBus) */
+static IntervalTimer s_tickTimer;
+
+/** Drivers running from the tick, in registration order */
+static SolenoidDriverBase* volatile s_tickDrivers[SOLENOID_MAX_BUSES] = { nullptr, nullptr, nullptr };
+
+/** Rate the shared timer was started at (0 = stopped) */
+static uint32_t s_tickHz = 0;
+
+static void solenoidTickIsr() {
+    for (uint8_t i = 0; i < SOLENOID_MAX_BUSES; i++) {
+        SolenoidDriverBase* driver = s_tickDrivers[i];
+        if (driver != nullptr) {
+            driver->tick();
+        }
+    }
+}
+
+#endif
+
 // =============================================================================
 // CONSTRUCTOR / DESTRUCTOR
 // =============================================================================
 
 SolenoidDriver::SolenoidDriver()
-    : _wire(nullptr)
+    : SolenoidDriverStorage<SOLENOID_MAX_BOARDS_PER_BUS, SOLENOID_MAX_CHANNELS>()
+    , SolenoidDriverBase(ref())
+{
+}
+
+SolenoidDriverBase::SolenoidDriverBase(const SolenoidDriverStorageRef& storage)
+    : _bus(nullptr)
+    , _channels(storage.channels)
+    , _boardAddresses(storage.boardAddresses)
+    , _boardStates(storage.boardStates)
+    , _boardCapacity(storage.boardCapacity)
+    , _channelCapacity(storage.channelCapacity)
+    , _maskWords(solenoidMaskWords(storage.channelCapacity))
+    , _dirtyBoards(0)
+    , _transactionDepth(0)
     , _boardCount(0)
     , _channelCount(0)
+    , _channelsPerBoard(SOLENOID_CHANNELS_PER_BOARD)
+    , _boardShift(3)
     , _initialized(false)
     , _config()
     , _lastError(SolenoidError::OK)
     , _errorCallback(nullptr)
+    , _wireStates(storage.wireStates)
+    , _asyncTransmit(false)
+    , _lastResyncMs(0)
+    , _driftCount(0)
+    , _boardLinks(storage.boardLinks)
+    , _busFailureRun(0)
+    , _busRecoveryPending(false)
+    , _lastBusRecoveryMs(0)
+    , _busRecoveryCount(0)
+    , _resetPin(SOLENOID_NO_PIN)
+    , _i2cClockHz(SOLENOID_DEFAULT_I2C_CLOCK_HZ)
+    , _busErrorWindowStart(0)
+    , _busErrorCount(0)
+    , _nextTimeoutUs(0)
+    , _timeoutArmed(false)
+    , _transmitCallback(nullptr)
+    , _eventLog(nullptr)
+    , _lateEventCount(0)
+    , _coilCurrentMa(storage.coilCurrentMa)
+    , _staggerSinceUs(storage.staggerSinceUs)
+    , _pulseMs(storage.pulseMs)
+    , _staggeredCount(0)
+    , _holdYieldCount(0)
+    , _deferredMask(storage.deferredMask)
+    , _releaseMask(storage.releaseMask)
+    , _staggerMask(storage.staggerMask)
+    , _deferredNoteCount(0)
+    , _droppedNoteCount(0)
+    , _tickActive(false)
+    , _coreDepth(0)
 {
+    _bank.onMask = storage.onMask;
+    _bank.holdMask = storage.holdMask;
+    _bank.lastOnUs = storage.lastOnUs;
+    _bank.lastOffUs = storage.lastOffUs;
+    _bank.kickUs = storage.kickUs;
+    _bank.holdDuty = storage.holdDuty;
+    _bank.channelCount = _channelCapacity;
+    _velocityMap.attach(storage.velocityKickUs, storage.velocityHoldDuty, storage.velocityLatencyUs,
+                        _channelCapacity);
+
+    // Bind every channel slot to the state bank so no channel is left dangling
+    _bank.clear();
+    for (uint8_t i = 0; i < _channelCapacity; i++) {
+        _channels[i] = SolenoidChannel(0, 0, i, &_bank);
+        _channels[i].setThermalModel(_config.thermalHeatTauMs, _config.thermalCoolTauMs);
+        _coilCurrentMa[i] = SOLENOID_DEFAULT_COIL_CURRENT_MA;
+        _staggerSinceUs[i] = 0;
+        _pulseMs[i] = 0;
+    }
+    for (uint8_t word = 0; word < _maskWords; word++) {
+        _deferredMask[word] = 0;
+        _releaseMask[word] = 0;
+        _staggerMask[word] = 0;
+    }
+
     // Initialize board states to all off
-    for (uint8_t i = 0; i < SOLENOID_MAX_BOARDS_PER_BUS; i++) {
+    for (uint8_t i = 0; i < _boardCapacity; i++) {
         _boardAddresses[i] = 0;
         _boardStates[i] = 0;
+        _wireStates[i] = 0;
     }
+    resetBoardLinks();
 }
 
-SolenoidDriver::~SolenoidDriver() {
+SolenoidDriverBase::~SolenoidDriverBase() {
+    stopTick();
+
     // Ensure all solenoids are off when driver is destroyed
     if (_initialized) {
         emergencyStop();
@@ -57,15 +159,36 @@ SolenoidDriver::~SolenoidDriver() {
 // INITIALIZATION
 // =============================================================================
 
-bool SolenoidDriver::begin(TwoWire& wire, uint8_t address) {
+bool SolenoidDriverBase::begin(TwoWire& wire, uint8_t address) {
     // Single board initialization - delegate to multi-board version
     uint8_t addresses[] = { address };
     return begin(wire, addresses, 1);
 }
 
-bool SolenoidDriver::begin(TwoWire& wire, const uint8_t addresses[], uint8_t count) {
+bool SolenoidDriverBase::begin(TwoWire& wire, const uint8_t addresses[], uint8_t count) {
+    // Retarget the built-in bus only once nothing is in flight on it
+    stopTick();
+    _txQueue.waitIdle();
+    _wireBus.attach(wire);
+    return begin(static_cast<SolenoidBus&>(_wireBus), addresses, count);
+}
+
+bool SolenoidDriverBase::begin(SolenoidBus& bus, uint8_t address) {
+    uint8_t addresses[] = { address };
+    return begin(bus, addresses, 1);
+}
+
+bool SolenoidDriverBase::begin(SolenoidBus& bus, const uint8_t addresses[], uint8_t count) {
+    // Reconfiguring - the tick must not run while state is rebuilt
+    stopTick();
+    CoreGuard guard(*this);
+    _commandQueue.clear();
+    SolenoidTimebase::begin(_config.timebase);
+    _metrics.reset();
+    _metrics.setBoardCount(0);
+
     // Validate parameters
-    if (count == 0 || count > SOLENOID_MAX_BOARDS_PER_BUS) {
+    if (count == 0 || count > _boardCapacity) {
         reportError(SolenoidError::INVALID_BOARD);
         return false;
     }
@@ -78,17 +201,59 @@ bool SolenoidDriver::begin(TwoWire& wire, const uint8_t addresses[], uint8_t cou
         }
     }
 
-    // Store wire reference
-    _wire = &wire;
+    // Validate board layout (8 = Port A only, 16 = Port A + Port B)
+    if (_config.channelsPerBoard != SOLENOID_CHANNELS_PER_BOARD &&
+        _config.channelsPerBoard != SOLENOID_MAX_CHANNELS_PER_BOARD) {
+        debugPrint("channelsPerBoard must be 8 or 16");
+        reportError(SolenoidError::INVALID_CHANNEL);
+        return false;
+    }
+
+    // The layout must fit the arrays the driver was built with
+    if (static_cast<uint16_t>(count) * _config.channelsPerBoard > _channelCapacity) {
+        debugPrint("Too many channels for this driver's storage");
+        reportError(SolenoidError::INVALID_CHANNEL);
+        return false;
+    }
+
+    // Finish anything still queued on the previous bus before reconfiguring
+    _txQueue.waitIdle();
+    _asyncTransmit = false;
+
+    // Store bus reference
+    _bus = &bus;
 
-    // Set I2C clock speed and timeout
-    _wire->setClock(_config.i2cClockHz);
-    _wire->setTimeout(100);  // 100ms I2C timeout to prevent bus lockup
+    // Hold the boards out of reset before talking to them
+    _resetPin = _config.resetPin;
+    if (_resetPin != SOLENOID_NO_PIN) {
+        pinMode(_resetPin, OUTPUT);
+        digitalWrite(_resetPin, HIGH);
+    }
+
+    // Set I2C clock speed
+    if (_config.i2cSpeedFallback) {
+        negotiateClock(addresses, count);
+    } else {
+        applyClock(_config.i2cClockHz);
+    }
+    _busErrorCount = 0;
 
     // Reset state
     _boardCount = 0;
     _channelCount = 0;
     _initialized = false;
+    _dirtyBoards = 0;
+    _transactionDepth = 0;
+    clearScheduledEvents();
+    _channelsPerBoard = _config.channelsPerBoard;
+    _boardShift = (_channelsPerBoard == SOLENOID_MAX_CHANNELS_PER_BOARD) ? 4 : 3;
+    _bank.clear();
+    _timeoutArmed = false;
+    resetBoardLinks();
+    _busFailureRun = 0;
+    _busRecoveryPending = false;
+    _lastBusRecoveryMs = millis() - SOLENOID_BUS_RECOVERY_INTERVAL_MS;
+    _busRecoveryCount = 0;
 
     // Initialize each board
     for (uint8_t i = 0; i < count; i++) {
@@ -100,52 +265,86 @@ bool SolenoidDriver::begin(TwoWire& wire, const uint8_t addresses[], uint8_t cou
         }
 
         // Initialize MCP23017
-        if (!_mcp[i].begin_I2C(addr, _wire)) {
+        if (!_bus->probe(addr)) {
             debugPrint("Failed to initialize MCP23017");
             reportError(SolenoidError::I2C_COMMUNICATION);
             return false;
         }
 
-        // Configure Port A as outputs (solenoid channels)
-        for (uint8_t pin = 0; pin < 8; pin++) {
-            _mcp[i].pinMode(pin, OUTPUT);
+        // Configure solenoid channels as outputs (Port A, plus Port B in 16-channel mode)
+        const uint8_t outputs[2] = { 0x00, 0x00 };
+        uint8_t ports = (_channelsPerBoard > 8) ? 2 : 1;
+        if (_bus->writeRegisters(addr, MCP23017_REG_IODIRA, outputs, ports) != 0) {
+            debugPrint("Failed to configure MCP23017 outputs");
+            reportError(SolenoidError::I2C_COMMUNICATION);
+            return false;
         }
 
-        // Turn all channels off initially
-        _mcp[i].writeGPIOA(0x00);
-
-        // Store board info
+        // Store board info, then turn all channels off initially
         _boardAddresses[i] = addr;
-        _boardStates[i] = 0x00;
+        if (!writePortsBlocking(i, 0x0000)) {
+            debugPrint("Failed to clear MCP23017 outputs");
+            reportError(SolenoidError::I2C_COMMUNICATION);
+            return false;
+        }
+        _boardStates[i] = 0x0000;
+        _wireStates[i] = 0x0000;
         _boardCount++;
 
         // Initialize channel objects for this board
-        for (uint8_t ch = 0; ch < SOLENOID_CHANNELS_PER_BOARD; ch++) {
-            uint8_t globalIdx = (i * SOLENOID_CHANNELS_PER_BOARD) + ch;
-            if (globalIdx >= SOLENOID_MAX_CHANNELS) {
+        for (uint8_t ch = 0; ch < _channelsPerBoard; ch++) {
+            uint16_t globalIdx = (i << _boardShift) + ch;
+            if (globalIdx >= _channelCapacity) {
                 reportError(SolenoidError::INVALID_CHANNEL);
                 return false;
             }
-            _channels[globalIdx] = SolenoidChannel(i, ch, globalIdx);
+            _channels[globalIdx] = SolenoidChannel(i, ch, static_cast<uint8_t>(globalIdx), &_bank);
+            _channels[globalIdx].setThermalModel(_config.thermalHeatTauMs, _config.thermalCoolTauMs);
         }
 
-        _channelCount = _boardCount * SOLENOID_CHANNELS_PER_BOARD;
+        _channelCount = _boardCount * _channelsPerBoard;
+    }
+    _metrics.setBoardCount(_boardCount);
+
+    // Hand board writes to the interrupt-driven queue if requested
+    if (_config.asyncTransmit) {
+        _asyncTransmit = true;
+        if (!_txQueue.begin(*_bus)) {
+            debugPrint("Async transmit: no LPI2C support, frames sent from update()");
+        }
     }
 
+    _lastResyncMs = millis();
+    _driftCount = 0;
     _initialized = true;
     _lastError = SolenoidError::OK;
 
+    // Move the timing core to the timer interrupt if requested
+    startTick();
+
     debugPrint("SolenoidDriver initialized successfully");
 
     return true;
 }
 
-void SolenoidDriver::setConfig(const SolenoidConfig& config) {
+void SolenoidDriverBase::setConfig(const SolenoidConfig& config) {
+    CoreGuard guard(*this);
+    bool clockChanged = (config.i2cClockHz != _config.i2cClockHz);
     _config = config;
 
-    // Apply I2C clock speed if already initialized
-    if (_wire != nullptr) {
-        _wire->setClock(_config.i2cClockHz);
+    // maxOnTimeMs may have changed - rescan deadlines on the next update()
+    if (_timeoutArmed) {
+        _nextTimeoutUs = SolenoidTimebase::nowUs();
+    }
+
+    for (uint8_t i = 0; i < _channelCapacity; i++) {
+        _channels[i].setThermalModel(_config.thermalHeatTauMs, _config.thermalCoolTauMs);
+    }
+
+    // Apply a new I2C clock speed if already initialized. An unchanged
+    // setting keeps whatever speed the fallback negotiated.
+    if (_bus != nullptr && clockChanged) {
+        applyClock(_config.i2cClockHz);
     }
 
     // Validate configuration
@@ -162,7 +361,7 @@ void SolenoidDriver::setConfig(const SolenoidConfig& config) {
     }
 }
 
-SolenoidConfig SolenoidDriver::getConfig() const {
+SolenoidConfig SolenoidDriverBase::getConfig() const {
     return _config;
 }
 
@@ -170,7 +369,11 @@ SolenoidConfig SolenoidDriver::getConfig() const {
 // SINGLE CHANNEL CONTROL
 // =============================================================================
 
-SolenoidError SolenoidDriver::on(uint8_t channel) {
+SolenoidError SolenoidDriverBase::on(uint8_t channel) {
+    if (deferToTick()) {
+        return enqueueCommand(SolenoidCommandType::ON, channel, 0, 0);
+    }
+
     if (!validateChannel(channel)) {
         return _lastError;
     }
@@ -181,40 +384,98 @@ SolenoidError SolenoidDriver::on(uint8_t channel) {
         return _lastError;
     }
 
-    // Safety check
-    if (_config.safetyEnabled && !isSafeToActivate(channel)) {
-        // Error already set by isSafeToActivate
+    return activate(channel, 0);
+}
+
+SolenoidError SolenoidDriverBase::on(uint8_t channel, uint8_t velocity) {
+    // Velocity 0 is a note-off per the MIDI specification
+    if (velocity == 0) {
+        return off(channel);
+    }
+
+    if (deferToTick()) {
+        return enqueueCommand(SolenoidCommandType::STRIKE, channel, velocity, 0);
+    }
+
+    if (!validateChannel(channel)) {
         return _lastError;
     }
 
-    // Convert to board/local channel
-    uint8_t board, localChannel;
-    globalToLocal(channel, board, localChannel);
+    // Key already down: restrike it, or ignore the repeat (no-op)
+    if (_channels[channel].isOn()) {
+        if (retriggerEnabled()) {
+            return retrigger(channel, velocity);
+        }
+        _lastError = SolenoidError::OK;
+        return _lastError;
+    }
 
-    // Write to hardware
-    if (!writeChannel(board, localChannel, true)) {
-        reportError(SolenoidError::I2C_COMMUNICATION, channel);
+    SolenoidStrike strike = _velocityMap.lookup(channel, velocity);
+    if (_config.safetyEnabled) {
+        strike.holdDuty = thermalHoldDuty(channel, strike.holdDuty);
+    }
+    if (strike.holdDuty != 0 && _config.holdPwmPeriodUs == 0) {
+        strike.holdDuty = 255;  // PWM disabled - hold at full power
+    }
+    bool needsHold = strike.holdDuty != 255;
+
+    // Make sure the end of the kick can be queued before energizing the coil
+    if (needsHold && !makeRoom(velocity)) {
+        debugPrintChannel("Scheduler full, strike rejected on channel ", channel);
+        _droppedNoteCount++;
+        reportError(SolenoidError::BUSY, channel);
         return _lastError;
     }
 
-    // Update state tracking
-    _channels[channel].updateState(true);
+    _channels[channel].setDrive(strike.kickUs, strike.holdDuty);
+
+    SolenoidError err = activate(channel, velocity);
+    if (err != SolenoidError::OK || !_bank.isOn(channel)) {
+        // Not activated (or deferred by the power budget or cooldown) -
+        // the next activation starts at full power again
+        _channels[channel].setDrive(0, 255);
+        return err;
+    }
+
+    // Queue the end of the kick - fired by update()
+    if (needsHold) {
+        uint32_t dueUs = SolenoidTimebase::nowUs32() + strike.kickUs;
+        SolenoidEvent event = { dueUs, channel, SolenoidAction::HOLD_OFF, 0 };
+        _scheduler.push(event);
+    }
 
     _lastError = SolenoidError::OK;
     return _lastError;
 }
 
-SolenoidError SolenoidDriver::off(uint8_t channel) {
+SolenoidError SolenoidDriverBase::off(uint8_t channel) {
+    if (deferToTick()) {
+        return enqueueCommand(SolenoidCommandType::OFF, channel, 0, 0);
+    }
+
     if (!validateChannel(channel)) {
         return _lastError;
     }
 
+    // A strike still waiting is either kept and played short, or dropped
+    if ((_deferredMask[channel >> 5] >> (channel & 31)) & 0x01) {
+        if (retriggerEnabled()) {
+            _releaseMask[channel >> 5] |= (1UL << (channel & 31));
+        } else {
+            clearDeferredStrike(channel, true);
+        }
+    }
+
     // Check if already off (no-op)
     if (!_channels[channel].isOn()) {
         _lastError = SolenoidError::OK;
         return _lastError;
     }
 
+    // An explicit off supersedes any pending pulse or hold edge (sequenced
+    // notes further ahead are kept)
+    _scheduler.cancel(channel, SOLENOID_NOTE_EDGE_ACTIONS);
+
     // Convert to board/local channel
     uint8_t board, localChannel;
     globalToLocal(channel, board, localChannel);
@@ -226,17 +487,17 @@ SolenoidError SolenoidDriver::off(uint8_t channel) {
     }
 
     // Update state tracking
-    _channels[channel].updateState(false);
+    setChannelState(channel, false);
 
     _lastError = SolenoidError::OK;
     return _lastError;
 }
 
-SolenoidError SolenoidDriver::set(uint8_t channel, bool state) {
+SolenoidError SolenoidDriverBase::set(uint8_t channel, bool state) {
     return state ? on(channel) : off(channel);
 }
 
-SolenoidError SolenoidDriver::toggle(uint8_t channel) {
+SolenoidError SolenoidDriverBase::toggle(uint8_t channel) {
     // Validate channel first
     if (channel >= _channelCount) {
         reportError(SolenoidError::INVALID_CHANNEL, channel);
@@ -246,57 +507,195 @@ SolenoidError SolenoidDriver::toggle(uint8_t channel) {
     return set(channel, !_channels[channel].isOn());
 }
 
-SolenoidError SolenoidDriver::pulse(uint8_t channel, uint32_t durationMs) {
+SolenoidError SolenoidDriverBase::pulse(uint8_t channel, uint32_t durationMs) {
+    if (deferToTick()) {
+        return enqueueCommand(SolenoidCommandType::PULSE, channel, 0, durationMs);
+    }
+
     // Clamp duration to max on-time
     if (_config.maxOnTimeMs > 0 && durationMs > _config.maxOnTimeMs) {
         durationMs = _config.maxOnTimeMs;
         debugPrint("Pulse duration clamped to maxOnTimeMs");
     }
 
+    // Without maxOnTimeMs the off-edge must still fit the scheduler's horizon
+    if (durationMs > SOLENOID_MAX_PULSE_MS) {
+        durationMs = SOLENOID_MAX_PULSE_MS;
+        debugPrint("Pulse duration clamped to SOLENOID_MAX_PULSE_MS");
+    }
+
+    if (!validateChannel(channel)) {
+        return _lastError;
+    }
+
+    // Replace any pending off-edge for this channel
+    _scheduler.cancel(channel, SOLENOID_NOTE_EDGE_ACTIONS);
+
+    // Make sure the off-edge can be queued before energizing the coil
+    if (_scheduler.isFull()) {
+        debugPrintChannel("Scheduler full, pulse rejected on channel ", channel);
+        reportError(SolenoidError::BUSY, channel);
+        return _lastError;
+    }
+
     // Turn on
     SolenoidError err = on(channel);
     if (err != SolenoidError::OK) {
         return err;
     }
 
-    // Wait (blocking)
-    delay(durationMs);
+    // Strike deferred: the off-edge is queued when it fires
+    if (!_bank.isOn(channel)) {
+        if ((_deferredMask[channel >> 5] >> (channel & 31)) & 0x01) {
+            _pulseMs[channel] = durationMs;
+        }
+        return SolenoidError::OK;
+    }
+
+    // Queue the off-edge - fired by update()
+    uint32_t dueUs = SolenoidTimebase::nowUs32() + (durationMs * 1000);
+    SolenoidEvent event = { dueUs, channel, SolenoidAction::OFF, 0 };
+    _scheduler.push(event);
+
+    return SolenoidError::OK;
+}
+
+// =============================================================================
+// SEQUENCED PLAYBACK
+// =============================================================================
+
+SolenoidError SolenoidDriverBase::scheduleNoteOn(uint8_t channel, uint8_t velocity, uint32_t strikeUs) {
+    // Velocity 0 is a note-off per the MIDI specification
+    if (velocity == 0) {
+        return scheduleNoteOff(channel, strikeUs);
+    }
+    return scheduleNote(channel, SolenoidAction::NOTE_ON, velocity, strikeUs);
+}
+
+SolenoidError SolenoidDriverBase::scheduleNoteOff(uint8_t channel, uint32_t releaseUs) {
+    return scheduleNote(channel, SolenoidAction::NOTE_OFF, 0, releaseUs);
+}
+
+void SolenoidDriverBase::cancelScheduledNotes() {
+    if (deferToTick()) {
+        enqueueCommand(SolenoidCommandType::CANCEL_NOTES, 0, 0, 0);
+        return;
+    }
+    _scheduler.cancel(SOLENOID_ANY_CHANNEL, SOLENOID_SEQUENCED_ACTIONS);
+}
+
+uint32_t SolenoidDriverBase::getLateEventCount() const {
+    return _lateEventCount;
+}
+
+// =============================================================================
+// POWER BUDGET
+// =============================================================================
+
+SolenoidError SolenoidDriverBase::setCoilCurrent(uint8_t channel, uint16_t currentMa) {
+    if (channel >= _channelCapacity) {
+        return SolenoidError::INVALID_CHANNEL;
+    }
+    _coilCurrentMa[channel] = currentMa;
+    return SolenoidError::OK;
+}
+
+uint16_t SolenoidDriverBase::getCoilCurrent(uint8_t channel) const {
+    if (channel >= _channelCapacity) {
+        return 0;
+    }
+    return _coilCurrentMa[channel];
+}
+
+uint8_t SolenoidDriverBase::getActiveCoilCount() const {
+    uint8_t count;
+    uint32_t currentMa;
+    measureLoad(count, currentMa);
+    return count;
+}
+
+uint32_t SolenoidDriverBase::getActiveCurrentMa() const {
+    uint8_t count;
+    uint32_t currentMa;
+    measureLoad(count, currentMa);
+    return currentMa;
+}
+
+uint32_t SolenoidDriverBase::getStaggeredStrikeCount() const {
+    return _staggeredCount;
+}
+
+uint32_t SolenoidDriverBase::getHoldYieldCount() const {
+    return _holdYieldCount;
+}
+
+// =============================================================================
+// RETRIGGER
+// =============================================================================
+
+uint32_t SolenoidDriverBase::getDeferredNoteCount() const {
+    return _deferredNoteCount;
+}
 
-    // Turn off
-    return off(channel);
+uint32_t SolenoidDriverBase::getDroppedNoteCount() const {
+    return _droppedNoteCount;
 }
 
 // =============================================================================
 // MULTI-CHANNEL CONTROL
 // =============================================================================
 
-SolenoidError SolenoidDriver::allOn() {
+SolenoidError SolenoidDriverBase::allOn() {
+    CoreGuard guard(*this);
+
     if (!validateInitialized()) {
         return _lastError;
     }
 
+    // Stage all channels so each board gets a single write
+    beginTransaction();
+
     uint8_t failedCount = 0;
     // Preserve the first error encountered so it can be returned after
     // processing all remaining channels (subsequent on() calls may overwrite _lastError)
     SolenoidError firstError = SolenoidError::OK;
 
-    // Turn on each channel individually (respects safety checks)
-    for (uint8_t ch = 0; ch < _channelCount; ch++) {
-        SolenoidError err = on(ch);
-        if (err != SolenoidError::OK) {
-            failedCount++;
-            // Store the first error encountered
-            if (firstError == SolenoidError::OK) {
-                firstError = err;
-            }
-            // I2C errors are critical - stop immediately
-            if (err == SolenoidError::I2C_COMMUNICATION) {
-                debugPrint("allOn: I2C error, aborting");
-                return err;
+    // Turn on each channel that is still off (respects safety checks)
+    for (uint8_t word = 0; word < _maskWords; word++) {
+        uint8_t first = word << 5;
+        if (_channelCount <= first) {
+            break;
+        }
+        uint8_t inWord = _channelCount - first;
+        uint32_t valid = (inWord >= 32) ? 0xFFFFFFFFUL : ((1UL << inWord) - 1);
+        uint32_t bits = ~_bank.onMask[word] & valid;
+
+        while (bits != 0) {
+            uint8_t ch = first + __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            SolenoidError err = on(ch);
+            if (err != SolenoidError::OK) {
+                failedCount++;
+                // Store the first error encountered
+                if (firstError == SolenoidError::OK) {
+                    firstError = err;
+                }
+                // I2C errors are critical - stop immediately
+                if (err == SolenoidError::I2C_COMMUNICATION) {
+                    debugPrint("allOn: I2C error, aborting");
+                    commit();
+                    return err;
+                }
             }
         }
     }
 
+    if (commit() != SolenoidError::OK) {
+        debugPrint("allOn: I2C error on commit");
+        return _lastError;
+    }
+
     // Report if any channels failed
     if (failedCount > 0) {
         if (_config.debugEnabled) {
@@ -312,27 +711,40 @@ SolenoidError SolenoidDriver::allOn() {
     return _lastError;
 }
 
-SolenoidError SolenoidDriver::allOff() {
+SolenoidError SolenoidDriverBase::allOff() {
+    CoreGuard guard(*this);
+
+    // Calls queued before this one would only fight the shutoff
+    _commandQueue.clear();
+
     if (!validateInitialized()) {
         return _lastError;
     }
 
-    // Turn off each board
-    for (uint8_t board = 0; board < _boardCount; board++) {
-        if (!writeBoard(board, 0x00)) {
-            reportError(SolenoidError::I2C_COMMUNICATION);
-            return _lastError;
-        }
+    // Nothing should turn back on or off after this
+    clearScheduledEvents();
 
-        // Update channel states
+    // A board that fails must not keep the others on - every board is
+    // cleared before any failure is reported
+    bool ok = haltBoards();
+    _dirtyBoards = 0;
+
+    // Update channel states (a failed board is cleared when it recovers)
+    for (uint8_t board = 0; board < _boardCount; board++) {
         updateBoardChannelStates(board, 0x00);
     }
 
+    if (!ok) {
+        reportError(SolenoidError::I2C_COMMUNICATION);
+        return _lastError;
+    }
     _lastError = SolenoidError::OK;
     return _lastError;
 }
 
-SolenoidError SolenoidDriver::setAll(const uint8_t states[], uint8_t stateCount) {
+SolenoidError SolenoidDriverBase::setAll(const uint16_t states[], uint8_t stateCount) {
+    CoreGuard guard(*this);
+
     if (!validateInitialized()) {
         return _lastError;
     }
@@ -346,21 +758,31 @@ SolenoidError SolenoidDriver::setAll(const uint8_t states[], uint8_t stateCount)
 
     // Track if any board had blocked channels
     bool anyBlocked = false;
+    // Remember the safety error so commit() does not mask it
+    SolenoidError blockedError = SolenoidError::OK;
 
     // Apply each board's states
+    beginTransaction();
     for (uint8_t board = 0; board < _boardCount; board++) {
         SolenoidError err = setBoardChannels(board, states[board]);
         if (err == SolenoidError::I2C_COMMUNICATION) {
             // I2C errors are critical - stop immediately
+            commit();
             return err;
         } else if (err != SolenoidError::OK) {
             // Safety-related errors (cooldown, duty cycle) - track but continue
             anyBlocked = true;
+            blockedError = err;
         }
     }
 
-    // If any channels were blocked, _lastError already contains the error
+    if (commit() != SolenoidError::OK) {
+        return _lastError;
+    }
+
+    // If any channels were blocked, report the safety error
     if (anyBlocked) {
+        _lastError = blockedError;
         return _lastError;
     }
 
@@ -368,7 +790,9 @@ SolenoidError SolenoidDriver::setAll(const uint8_t states[], uint8_t stateCount)
     return _lastError;
 }
 
-SolenoidError SolenoidDriver::setBoardChannels(uint8_t board, uint8_t states) {
+SolenoidError SolenoidDriverBase::setBoardChannels(uint8_t board, uint16_t states) {
+    CoreGuard guard(*this);
+
     if (!validateInitialized()) {
         return _lastError;
     }
@@ -378,30 +802,69 @@ SolenoidError SolenoidDriver::setBoardChannels(uint8_t board, uint8_t states) {
         return _lastError;
     }
 
-    // Get current state
-    uint8_t currentStates = _boardStates[board];
-    uint8_t blockedChannels = 0;  // Track which channels were blocked by safety
+    // Ignore bits beyond this board's channel count
+    if (_channelsPerBoard < 16) {
+        states &= static_cast<uint16_t>((1U << _channelsPerBoard) - 1);
+    }
+
+    // Get current logical state (staged changes included)
+    uint16_t currentStates = _bank.bits(board << _boardShift, _channelsPerBoard);
+    uint16_t blockedChannels = 0;  // Track which channels were blocked by safety
+    SolenoidError blockedError = SolenoidError::OK;
 
     // Check safety for each channel that is being turned on
     if (_config.safetyEnabled) {
-        for (uint8_t ch = 0; ch < SOLENOID_CHANNELS_PER_BOARD; ch++) {
+        for (uint8_t ch = 0; ch < _channelsPerBoard; ch++) {
             bool wasOn = (currentStates >> ch) & 0x01;
             bool willBeOn = (states >> ch) & 0x01;
 
             if (willBeOn && !wasOn) {
-                uint8_t globalCh = (board * SOLENOID_CHANNELS_PER_BOARD) + ch;
+                uint8_t globalCh = (board << _boardShift) + ch;
                 if (!isSafeToActivate(globalCh)) {
                     // Clear this bit to prevent activation and track it
-                    states &= ~(1 << ch);
-                    blockedChannels |= (1 << ch);
+                    states &= ~(1U << ch);
+                    blockedChannels |= (1U << ch);
+                    blockedError = _lastError;
+                }
+            }
+        }
+    }
+
+    // Stage the write, so hold preemption below shares it
+    beginTransaction();
+
+    // Power budget: coils this write turns off free their share first, then
+    // each new activation claims its own; the rest are staggered
+    uint16_t holding = SolenoidChannelBank::maskBits(_bank.holdMask, board << _boardShift, _channelsPerBoard)
+        & states;
+    uint16_t turningOn = states & ~currentStates;
+    if (turningOn != 0 && powerBudgetEnabled()) {
+        _boardStates[board] &= states;
+        while (turningOn != 0) {
+            uint8_t ch = __builtin_ctz(turningOn);
+            turningOn &= turningOn - 1;
+
+            uint8_t globalCh = (board << _boardShift) + ch;
+            if (claimPower(globalCh, true)) {
+                _boardStates[board] |= (1U << ch);
+                _staggerMask[globalCh >> 5] &= ~(1UL << (globalCh & 31));
+            } else {
+                states &= ~(1U << ch);
+                SolenoidError err = staggerActivation(globalCh, 0);
+                if (err != SolenoidError::OK) {
+                    blockedChannels |= (1U << ch);
+                    blockedError = err;
                 }
             }
         }
     }
 
+    // Coils in a hold keep their current PWM phase
+    uint16_t physical = (states & ~holding) | (_boardStates[board] & holding);
+
     // Write to hardware
-    if (!writeBoard(board, states)) {
-        reportError(SolenoidError::I2C_COMMUNICATION);
+    writeBoard(board, physical);
+    if (commit() != SolenoidError::OK) {
         return _lastError;
     }
 
@@ -414,14 +877,16 @@ SolenoidError SolenoidDriver::setBoardChannels(uint8_t board, uint8_t states) {
     if (blockedChannels != 0) {
         // Report the first blocked channel (the specific error was already
         // reported by isSafeToActivate, but we want to indicate partial failure)
-        for (uint8_t ch = 0; ch < SOLENOID_CHANNELS_PER_BOARD; ch++) {
+        for (uint8_t ch = 0; ch < _channelsPerBoard; ch++) {
             if ((blockedChannels >> ch) & 0x01) {
-                uint8_t globalCh = (board * SOLENOID_CHANNELS_PER_BOARD) + ch;
+                uint8_t globalCh = (board << _boardShift) + ch;
                 debugPrintChannel("Channel blocked by safety: ", globalCh);
                 break;
             }
         }
         // Return the last error set by isSafeToActivate (SAFETY_COOLDOWN or DUTY_CYCLE_EXCEEDED)
+        // or by the power budget (BUSY or POWER_BUDGET_EXCEEDED)
+        _lastError = blockedError;
         return _lastError;
     }
 
@@ -429,25 +894,73 @@ SolenoidError SolenoidDriver::setBoardChannels(uint8_t board, uint8_t states) {
     return _lastError;
 }
 
+// =============================================================================
+// TRANSACTIONS (COALESCED BOARD WRITES)
+// =============================================================================
+
+void SolenoidDriverBase::beginTransaction() {
+    // Tick mode: queued calls are already applied together, once per tick
+    if (deferToTick()) {
+        return;
+    }
+
+    if (_transactionDepth < UINT8_MAX) {
+        _transactionDepth++;
+    }
+}
+
+SolenoidError SolenoidDriverBase::commit() {
+    if (deferToTick()) {
+        return SolenoidError::OK;
+    }
+
+    if (_transactionDepth > 0) {
+        _transactionDepth--;
+    }
+
+    // Nested transaction - the outermost commit() does the write
+    if (_transactionDepth > 0) {
+        return SolenoidError::OK;
+    }
+
+    if (!flushDirtyBoards()) {
+        reportError(SolenoidError::I2C_COMMUNICATION);
+        return _lastError;
+    }
+
+    return SolenoidError::OK;
+}
+
+bool SolenoidDriverBase::inTransaction() const {
+    return _transactionDepth > 0;
+}
+
 // =============================================================================
 // STATE QUERIES
 // =============================================================================
 
-bool SolenoidDriver::isOn(uint8_t channel) const {
+bool SolenoidDriverBase::isOn(uint8_t channel) const {
     if (channel >= _channelCount) {
         return false;
     }
-    return _channels[channel].isOn();
+    return _bank.isOn(channel);
+}
+
+float SolenoidDriverBase::getThermalLoad(uint8_t channel) const {
+    if (channel >= _channelCount) {
+        return 0.0f;
+    }
+    return _channels[channel].thermalLoad();
 }
 
-const SolenoidChannel* SolenoidDriver::getChannelState(uint8_t channel) const {
+const SolenoidChannel* SolenoidDriverBase::getChannelState(uint8_t channel) const {
     if (channel >= _channelCount) {
         return nullptr;
     }
     return &_channels[channel];
 }
 
-uint8_t SolenoidDriver::getBoardState(uint8_t board) const {
+uint16_t SolenoidDriverBase::getBoardState(uint8_t board) const {
     if (board >= _boardCount) {
         return 0;
     }
@@ -458,123 +971,302 @@ uint8_t SolenoidDriver::getBoardState(uint8_t board) const {
 // SAFETY AND MAINTENANCE
 // =============================================================================
 
-void SolenoidDriver::update() {
+void SolenoidDriverBase::update() {
     if (!_initialized) {
         return;
     }
+    uint32_t startCycles = SolenoidTimebase::cycles();
 
-    uint32_t now = millis();
+    // In tick mode the timer interrupt runs the core; only maintenance is left
+    if (!_tickActive) {
+        // Retire frames that finished on the wire since the last call
+        serviceTransmit();
 
-    // Check each channel for timeout
-    for (uint8_t ch = 0; ch < _channelCount; ch++) {
-        if (_channels[ch].isOn()) {
-            // Check if on-time exceeded
-            if (_config.maxOnTimeMs > 0) {
-                uint32_t onDuration = _channels[ch].onDuration();
-                if (onDuration >= _config.maxOnTimeMs) {
-                    // Auto-shutoff
-                    debugPrintChannel("Safety timeout on channel ", ch);
-
-                    uint8_t board, localChannel;
-                    globalToLocal(ch, board, localChannel);
-                    writeChannel(board, localChannel, false);
-                    _channels[ch].updateState(false);
-
-                    reportError(SolenoidError::SAFETY_TIMEOUT, ch);
-                }
-            }
-        }
+        // Coalesce scheduled edges and timeouts into one write per board
+        beginTransaction();
+
+        // Everything due within the grouping window shares this commit
+        uint8_t scheduled = _scheduler.size();
+        uint64_t nowUs = SolenoidTimebase::nowUs();
+        processScheduledEvents(static_cast<uint32_t>(nowUs) + _config.eventGroupUs);
+        processTimeouts(nowUs);
+
+        commit();
+        serviceBoardLinks();
+        _metrics.recordDepths(scheduled, _txQueue.pending(), 0, _errorQueue.pending());
     }
-}
 
-void SolenoidDriver::emergencyStop() {
-    // Bypass all checks - write directly to hardware
-    for (uint8_t board = 0; board < _boardCount; board++) {
-        _mcp[board].writeGPIOA(0x00);
-        _boardStates[board] = 0x00;
+    // A bus no board answers on may be held by a slave - free it
+    if (_busRecoveryPending && (millis() - _lastBusRecoveryMs) >= SOLENOID_BUS_RECOVERY_INTERVAL_MS) {
+        recoverBus();
     }
 
-    // Update all channel states
-    for (uint8_t ch = 0; ch < _channelCount; ch++) {
-        _channels[ch].updateState(false);
+    // Periodic check that the boards still hold what we think they hold
+    if (_config.resyncIntervalMs > 0 && (millis() - _lastResyncMs) >= _config.resyncIntervalMs) {
+        resyncFromHardware();
     }
 
-    debugPrint("Emergency stop - all channels off");
+    _metrics.recordUpdate(SolenoidTimebase::cycles() - startCycles);
 }
 
-void SolenoidDriver::resetAllStats() {
-    for (uint8_t ch = 0; ch < _channelCount; ch++) {
-        _channels[ch].resetStats();
+void SolenoidDriverBase::tick() {
+    // loop() owns the core (or a tick is already running) - try next tick
+    if (!_initialized || _coreDepth != 0) {
+        return;
     }
+    CoreGuard guard(*this);
+    uint32_t startCycles = SolenoidTimebase::cycles();
 
-    debugPrint("All channel stats reset");
-}
+    serviceTransmit();
 
-// =============================================================================
-// ERROR HANDLING
-// =============================================================================
+    // Queued calls, due events and timeouts share one write per board
+    beginTransaction();
 
-bool SolenoidDriver::isInitialized() const {
-    return _initialized;
-}
+    uint8_t commands = _commandQueue.pending();
+    drainCommands();
+    uint8_t scheduled = _scheduler.size();
+    uint64_t nowUs = SolenoidTimebase::nowUs();
+    processScheduledEvents(static_cast<uint32_t>(nowUs) + _config.eventGroupUs);
+    processTimeouts(nowUs);
 
-SolenoidError SolenoidDriver::getLastError() const {
-    return _lastError;
+    commit();
+    serviceBoardLinks();
+    _metrics.recordDepths(scheduled, _txQueue.pending(), commands, _errorQueue.pending());
+    _metrics.recordTick(SolenoidTimebase::cycles() - startCycles);
 }
 
-const char* SolenoidDriver::getErrorString(SolenoidError error) {
-    switch (error) {
-        case SolenoidError::OK:
-            return STR_OK;
-        case SolenoidError::NOT_INITIALIZED:
-            return STR_NOT_INIT;
-        case SolenoidError::INVALID_CHANNEL:
-            return STR_INV_CHAN;
-        case SolenoidError::INVALID_BOARD:
-            return STR_INV_BOARD;
-        case SolenoidError::I2C_COMMUNICATION:
-            return STR_I2C_ERR;
-        case SolenoidError::SAFETY_TIMEOUT:
-            return STR_TIMEOUT;
-        case SolenoidError::SAFETY_COOLDOWN:
-            return STR_COOLDOWN;
-        case SolenoidError::DUTY_CYCLE_EXCEEDED:
-            return STR_DUTY;
-        case SolenoidError::BUSY:
-            return STR_BUSY;
-        default:
-            return STR_UNKNOWN;
-    }
+bool SolenoidDriverBase::isTickActive() const {
+    return _tickActive;
 }
 
-void SolenoidDriver::setErrorCallback(SolenoidErrorCallback callback) {
-    _errorCallback = callback;
+uint32_t SolenoidDriverBase::getDroppedCommandCount() const {
+    return _commandQueue.dropCount();
 }
 
-// =============================================================================
-// DIAGNOSTICS
-// =============================================================================
+void SolenoidDriverBase::emergencyStop() {
+    CoreGuard guard(*this);
+    _commandQueue.clear();
 
-uint8_t SolenoidDriver::getBoardCount() const {
-    return _boardCount;
+    // Bypass all checks - straight to hardware, offline boards included
+    haltBoards();
+
+    // Nothing left to stage - any pending transaction is discarded
+    _dirtyBoards = 0;
+    clearScheduledEvents();
+
+    // Update all channel states
+    for (uint8_t ch = 0; ch < _channelCount; ch++) {
+        setChannelState(ch, false);
+    }
+
+    debugPrint("Emergency stop - all channels off");
+}
+
+SolenoidError SolenoidDriverBase::resyncFromHardware() {
+    CoreGuard guard(*this);
+
+    if (!validateInitialized()) {
+        return _lastError;
+    }
+
+    _lastResyncMs = millis();
+
+    // Reads are blocking - let queued frames land first
+    _txQueue.waitIdle();
+    serviceTransmit();
+
+    bool allInSync = true;
+
+    for (uint8_t board = 0; board < _boardCount; board++) {
+        // A failed board is restored in full by its retry instead
+        if (_boardLinks[board].health != SolenoidBoardHealth::ONLINE) {
+            allInSync = false;
+            continue;
+        }
+
+        // Staged changes haven't been written yet - compare against the wire
+        uint16_t latches;
+        if (!readLatches(board, latches)) {
+            allInSync = false;
+            if (noteLinkResult(board, SOLENOID_I2C_NACK, true)) {
+                reportError(SolenoidError::I2C_COMMUNICATION);
+            }
+            continue;
+        }
+
+        if (latches != _wireStates[board]) {
+            _driftCount++;
+            if (_config.debugEnabled) {
+                Serial.print(F("[SolenoidDriver] Latch drift on board "));
+                Serial.print(board);
+                Serial.print(F(": 0x"));
+                Serial.println(latches, HEX);
+            }
+
+            // Restore the intended state, including any staged changes. A
+            // repaired board is only counted; the bus failed if the write did.
+            uint8_t status = writeRegistersBlocking(board, MCP23017_REG_GPIOA, _boardStates[board]);
+            if (status == 0) {
+                _wireStates[board] = _boardStates[board];
+                _dirtyBoards &= ~(1 << board);
+            } else {
+                allInSync = false;
+            }
+            if (noteLinkResult(board, status, true)) {
+                reportError(SolenoidError::I2C_COMMUNICATION);
+            }
+        }
+    }
+
+    return allInSync ? SolenoidError::OK : SolenoidError::I2C_COMMUNICATION;
+}
+
+uint32_t SolenoidDriverBase::getDriftCount() const {
+    return _driftCount;
+}
+
+bool SolenoidDriverBase::recoverBus() {
+    CoreGuard guard(*this);
+
+    if (_bus == nullptr) {
+        return false;
+    }
+
+    // Nothing queued can get through - fail it so its boards are retried.
+    // These failures are the bus's, not the boards', so none is reported.
+    _txQueue.abort();
+    SolenoidFrame frame;
+    while (_txQueue.popCompleted(frame)) {
+        _metrics.recordWrite(frame.board, frame.length, frame.status == 0);
+        completeFrame(frame.board, frame.reg, frame.data, frame.wireUs, frame.status);
+    }
+
+    bool released = _bus->recoverBus();
+
+    // The port was restarted - restore the clock and the interrupt path
+    applyClock(_i2cClockHz);
+    if (_asyncTransmit) {
+        _txQueue.begin(*_bus);
+    }
+
+    _busFailureRun = 0;
+    _busRecoveryPending = false;
+    _lastBusRecoveryMs = millis();
+    _busRecoveryCount++;
+    debugPrint(released ? "I2C bus recovered" : "I2C bus recovery failed");
+
+    return released;
+}
+
+void SolenoidDriverBase::resetAllStats() {
+    CoreGuard guard(*this);
+
+    for (uint8_t ch = 0; ch < _channelCount; ch++) {
+        _channels[ch].resetStats();
+    }
+
+    debugPrint("All channel stats reset");
+}
+
+// =============================================================================
+// ERROR HANDLING
+// =============================================================================
+
+bool SolenoidDriverBase::isInitialized() const {
+    return _initialized;
+}
+
+SolenoidError SolenoidDriverBase::getLastError() const {
+    return _lastError;
+}
+
+const char* SolenoidDriverBase::getErrorString(SolenoidError error) {
+    switch (error) {
+        case SolenoidError::OK:
+            return STR_OK;
+        case SolenoidError::NOT_INITIALIZED:
+            return STR_NOT_INIT;
+        case SolenoidError::INVALID_CHANNEL:
+            return STR_INV_CHAN;
+        case SolenoidError::INVALID_BOARD:
+            return STR_INV_BOARD;
+        case SolenoidError::I2C_COMMUNICATION:
+            return STR_I2C_ERR;
+        case SolenoidError::SAFETY_TIMEOUT:
+            return STR_TIMEOUT;
+        case SolenoidError::SAFETY_COOLDOWN:
+            return STR_COOLDOWN;
+        case SolenoidError::DUTY_CYCLE_EXCEEDED:
+            return STR_DUTY;
+        case SolenoidError::BUSY:
+            return STR_BUSY;
+        case SolenoidError::POWER_BUDGET_EXCEEDED:
+            return STR_POWER;
+        default:
+            return STR_UNKNOWN;
+    }
+}
+
+void SolenoidDriverBase::setErrorCallback(SolenoidErrorCallback callback) {
+    _errorCallback = callback;
+}
+
+void SolenoidDriverBase::setTransmitCallback(SolenoidTransmitCallback callback) {
+    _transmitCallback = callback;
+}
+
+void SolenoidDriverBase::setEventLog(SolenoidEventLog* log) {
+    _eventLog = log;
+}
+
+bool SolenoidDriverBase::popError(SolenoidErrorRecord& record) {
+    return _errorQueue.pop(record);
 }
 
-uint8_t SolenoidDriver::getChannelCount() const {
+uint8_t SolenoidDriverBase::getPendingErrorCount() const {
+    return _errorQueue.pending();
+}
+
+uint32_t SolenoidDriverBase::getDroppedErrorCount() const {
+    return _errorQueue.dropCount();
+}
+
+SolenoidVelocityMap& SolenoidDriverBase::getVelocityMap() {
+    return _velocityMap;
+}
+
+const SolenoidVelocityMap& SolenoidDriverBase::getVelocityMap() const {
+    return _velocityMap;
+}
+
+// =============================================================================
+// DIAGNOSTICS
+// =============================================================================
+
+uint8_t SolenoidDriverBase::getBoardCount() const {
+    return _boardCount;
+}
+
+uint8_t SolenoidDriverBase::getChannelsPerBoard() const {
+    return _channelsPerBoard;
+}
+
+uint8_t SolenoidDriverBase::getChannelCount() const {
     return _channelCount;
 }
 
-uint8_t SolenoidDriver::scanI2C() {
-    if (_wire == nullptr) {
+uint8_t SolenoidDriverBase::scanI2C() {
+    if (_bus == nullptr) {
         return 0;
     }
 
+    // The bus must not be used while frames are in flight
+    _txQueue.waitIdle();
+
     uint8_t count = 0;
 
     for (uint8_t addr = MCP23017_BASE_ADDRESS; addr <= MCP23017_MAX_ADDRESS; addr++) {
-        _wire->beginTransmission(addr);
-        uint8_t error = _wire->endTransmission();
-
-        if (error == 0) {
+        if (_bus->probe(addr)) {
             count++;
             if (_config.debugEnabled) {
                 Serial.print(F("Found device at 0x"));
@@ -586,18 +1278,62 @@ uint8_t SolenoidDriver::scanI2C() {
     return count;
 }
 
-uint8_t SolenoidDriver::getBoardAddress(uint8_t board) const {
+uint8_t SolenoidDriverBase::getBoardAddress(uint8_t board) const {
     if (board >= _boardCount) {
         return 0;
     }
     return _boardAddresses[board];
 }
 
+uint32_t SolenoidDriverBase::getI2CClockHz() const {
+    return _i2cClockHz;
+}
+
+SolenoidBoardHealth SolenoidDriverBase::getBoardHealth(uint8_t board) const {
+    if (board >= _boardCount) {
+        return SolenoidBoardHealth::OFFLINE;
+    }
+    return _boardLinks[board].health;
+}
+
+uint32_t SolenoidDriverBase::getBoardRecoveryCount(uint8_t board) const {
+    if (board >= _boardCount) {
+        return 0;
+    }
+    return _boardLinks[board].recoveries;
+}
+
+uint32_t SolenoidDriverBase::getBusRecoveryCount() const {
+    return _busRecoveryCount;
+}
+
+uint8_t SolenoidDriverBase::getScheduledEventCount() const {
+    return _scheduler.size();
+}
+
+uint8_t SolenoidDriverBase::getPendingFrameCount() const {
+    return _txQueue.pending();
+}
+
+bool SolenoidDriverBase::isTransmitIdle() const {
+    return _txQueue.isIdle();
+}
+
+void SolenoidDriverBase::getMetrics(SolenoidMetrics& out) {
+    CoreGuard guard(*this);
+    out = _metrics;
+}
+
+void SolenoidDriverBase::resetMetrics() {
+    CoreGuard guard(*this);
+    _metrics.reset();
+}
+
 // =============================================================================
 // PRIVATE METHODS
 // =============================================================================
 
-bool SolenoidDriver::validateInitialized() {
+bool SolenoidDriverBase::validateInitialized() {
     if (!_initialized) {
         reportError(SolenoidError::NOT_INITIALIZED);
         return false;
@@ -605,7 +1341,7 @@ bool SolenoidDriver::validateInitialized() {
     return true;
 }
 
-bool SolenoidDriver::validateChannel(uint8_t channel) {
+bool SolenoidDriverBase::validateChannel(uint8_t channel) {
     if (!_initialized) {
         reportError(SolenoidError::NOT_INITIALIZED, channel);
         return false;
@@ -617,25 +1353,29 @@ bool SolenoidDriver::validateChannel(uint8_t channel) {
     return true;
 }
 
-bool SolenoidDriver::writeChannel(uint8_t board, uint8_t channel, bool state) {
-    if (board >= _boardCount || channel >= SOLENOID_CHANNELS_PER_BOARD) {
+bool SolenoidDriverBase::writeChannel(uint8_t board, uint8_t channel, bool state) {
+    if (board >= _boardCount || channel >= _channelsPerBoard) {
         return false;
     }
 
     // Update local state cache
     if (state) {
-        _boardStates[board] |= (1 << channel);
+        _boardStates[board] |= (1U << channel);
     } else {
-        _boardStates[board] &= ~(1 << channel);
+        _boardStates[board] &= ~(1U << channel);
     }
 
-    // Write single pin (the library handles I2C internally)
-    _mcp[board].digitalWrite(channel, state ? HIGH : LOW);
+    // Inside a transaction, defer the write to commit()
+    if (_transactionDepth > 0) {
+        _dirtyBoards |= (1 << board);
+        return true;
+    }
 
-    return true;
+    // Send the whole port from the cache - one write, no read-back
+    return writePorts(board, _boardStates[board]);
 }
 
-bool SolenoidDriver::writeBoard(uint8_t board, uint8_t states) {
+bool SolenoidDriverBase::writeBoard(uint8_t board, uint16_t states) {
     if (board >= _boardCount) {
         return false;
     }
@@ -643,96 +1383,1218 @@ bool SolenoidDriver::writeBoard(uint8_t board, uint8_t states) {
     // Update local state cache
     _boardStates[board] = states;
 
-    // Write full port (more efficient than individual pins)
-    _mcp[board].writeGPIOA(states);
+    // Inside a transaction, defer the write to commit()
+    if (_transactionDepth > 0) {
+        _dirtyBoards |= (1 << board);
+        return true;
+    }
+
+    // Write full port(s) (more efficient than individual pins)
+    return writePorts(board, states);
+}
+
+bool SolenoidDriverBase::flushDirtyBoards() {
+    bool ok = true;
 
+    for (uint8_t board = 0; board < _boardCount; board++) {
+        if ((_dirtyBoards >> board) & 0x01) {
+            ok = writePorts(board, _boardStates[board]) && ok;
+        }
+    }
+
+    _dirtyBoards = 0;
+    return ok;
+}
+
+bool SolenoidDriverBase::writePorts(uint8_t board, uint16_t states) {
+    // A failed board is rewritten from the cache when it answers again, so
+    // its writes never hold up the boards that are still playing
+    if (_boardLinks[board].health != SolenoidBoardHealth::ONLINE) {
+        return true;
+    }
+
+    return sendFrame(board, MCP23017_REG_GPIOA, states);
+}
+
+bool SolenoidDriverBase::sendFrame(uint8_t board, uint8_t reg, uint16_t data) {
+    if (!_asyncTransmit) {
+        uint32_t startUs = SolenoidTimebase::nowUs32();
+        uint8_t status = writeRegistersBlocking(board, reg, data);
+        uint32_t wireUs = SolenoidTimebase::nowUs32();
+        _metrics.recordLatency(wireUs - startUs);
+        return !completeFrame(board, reg, data, wireUs, status);
+    }
+
+    SolenoidFrame frame;
+    frame.address = _boardAddresses[board];
+    frame.reg = reg;
+    frame.length = (_channelsPerBoard == SOLENOID_MAX_CHANNELS_PER_BOARD) ? 2 : 1;
+    frame.board = board;
+    frame.data = data;
+    frame.status = 0;
+    frame.queuedUs = SolenoidTimebase::nowUs32();
+    frame.wireUs = 0;
+
+    // Ring full: retire finished frames, waiting briefly for space if needed
+    uint32_t start = micros();
+    while (!_txQueue.push(frame)) {
+        serviceTransmit();
+        if ((micros() - start) > SOLENOID_TX_TIMEOUT_US) {
+            return false;
+        }
+    }
     return true;
 }
 
-bool SolenoidDriver::isSafeToActivate(uint8_t channel) {
-    if (channel >= _channelCount) {
+bool SolenoidDriverBase::writePortsBlocking(uint8_t board, uint16_t states) {
+    return writeRegistersBlocking(board, MCP23017_REG_GPIOA, states) == 0;
+}
+
+uint8_t SolenoidDriverBase::writeRegistersBlocking(uint8_t board, uint8_t reg, uint16_t data) {
+    // Port A then Port B in one sequential write (IOCON.SEQOP enabled by default)
+    uint8_t bytes[2] = { static_cast<uint8_t>(data), static_cast<uint8_t>(data >> 8) };
+    uint8_t length = (_channelsPerBoard == SOLENOID_MAX_CHANNELS_PER_BOARD) ? 2 : 1;
+    uint8_t status = _bus->writeRegisters(_boardAddresses[board], reg, bytes, length);
+    _metrics.recordWrite(board, length, status == 0);
+    return status;
+}
+
+bool SolenoidDriverBase::haltBoards() {
+    if (_bus == nullptr) {
         return false;
     }
 
-    SolenoidChannel& ch = _channels[channel];
+    // Frames that already finished carry real results; the ones still
+    // queued would only delay the shutoff, so they are dropped. A board
+    // with a dropped frame may be latched to anything.
+    serviceTransmit();
+    uint8_t unknown = 0;
+    _txQueue.abort();
+    SolenoidFrame frame;
+    while (_txQueue.popCompleted(frame)) {
+        _metrics.recordWrite(frame.board, frame.length, false);
+        unknown |= (1 << frame.board);
+        // A dropped retry is sent again by serviceBoardLinks()
+        _boardLinks[frame.board].retryInFlight = false;
+    }
 
-    // Check cooldown time
-    if (_config.minOffTimeMs > 0) {
-        uint32_t timeSinceOff = ch.timeSinceOff();
-        if (timeSinceOff < _config.minOffTimeMs) {
-            debugPrintChannel("Cooldown not elapsed for channel ", channel);
-            reportError(SolenoidError::SAFETY_COOLDOWN, channel);
-            return false;
+    bool ok = true;
+
+    if (_resetPin != SOLENOID_NO_PIN) {
+        // Every board at once: all pins inputs, output latches 0
+        digitalWrite(_resetPin, LOW);
+        delayMicroseconds(SOLENOID_RESET_PULSE_US);
+        digitalWrite(_resetPin, HIGH);
+
+        // Coils are already off - make the pins outputs again (driving 0)
+        for (uint8_t board = 0; board < _boardCount; board++) {
+            _boardStates[board] = 0x0000;
+            _wireStates[board] = 0x0000;
+            uint8_t status = writeRegistersBlocking(board, MCP23017_REG_IODIRA, 0x0000);
+            noteLinkResult(board, status, false);
+            ok = ok && (status == 0);
         }
+        return ok;
     }
 
-    // Check duty cycle using rolling window
-    if (_config.maxDutyCycle < 1.0f && _config.dutyCycleWindowMs > 0) {
-        // Use minOffTimeMs as a conservative estimate for the on-duration
-        // in the duty cycle projection (or 100ms default if cooldown is disabled)
-        uint32_t estimatedOnTime = _config.minOffTimeMs > 0 ? _config.minOffTimeMs : 100;
+    for (uint8_t board = 0; board < _boardCount; board++) {
+        if (_wireStates[board] != 0) {
+            unknown |= (1 << board);
+        }
+    }
 
-        // Check current duty cycle in the window
-        float currentDutyCycle = ch.getDutyCyclePercent(_config.dutyCycleWindowMs);
-        if (currentDutyCycle >= _config.maxDutyCycle) {
-            debugPrintChannel("Duty cycle exceeded for channel ", channel);
-            reportError(SolenoidError::DUTY_CYCLE_EXCEEDED, channel);
+    // Boards that may have coils on first, then the rest to be sure
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        for (uint8_t board = 0; board < _boardCount; board++) {
+            bool energized = (unknown >> board) & 0x01;
+            if (energized != (pass == 0)) {
+                continue;
+            }
+            uint8_t status = writeRegistersBlocking(board, MCP23017_REG_GPIOA, 0x0000);
+            _boardStates[board] = 0x0000;
+            if (status == 0) {
+                _wireStates[board] = 0x0000;
+            }
+            // A board that missed it is cleared by its retry
+            noteLinkResult(board, status, true);
+            ok = ok && (status == 0);
+        }
+    }
+    return ok;
+}
+
+uint32_t SolenoidDriverBase::negotiateClock(const uint8_t addresses[], uint8_t count) {
+    // Try the configured speed first, then each slower standard speed
+    uint32_t candidate = _config.i2cClockHz;
+    uint8_t next = 0;
+
+    while (true) {
+        applyClock(candidate);
+
+        bool allPassed = true;
+        for (uint8_t i = 0; i < count && allPassed; i++) {
+            allPassed = verifyBoard(addresses[i]);
+        }
+
+        if (allPassed) {
+            if (_config.debugEnabled) {
+                Serial.print(F("[SolenoidDriver] I2C clock: "));
+                Serial.print(candidate / 1000);
+                Serial.println(F(" kHz"));
+            }
+            return candidate;
+        }
+
+        // Find the next standard speed below the one that failed
+        while (next < SOLENOID_I2C_SPEED_COUNT && SOLENOID_I2C_SPEEDS[next] >= candidate) {
+            next++;
+        }
+        if (next >= SOLENOID_I2C_SPEED_COUNT) {
+            // Nothing slower to try - boards are likely missing, let
+            // initialization report the failure
+            debugPrint("I2C verify failed at all speeds");
+            return candidate;
+        }
+
+        debugPrint("I2C verify failed, trying slower clock");
+        candidate = SOLENOID_I2C_SPEEDS[next];
+    }
+}
+
+bool SolenoidDriverBase::verifyBoard(uint8_t address) {
+    static const uint8_t PATTERNS[] = { 0xA5, 0x5A };
+
+    bool ok = true;
+    for (uint8_t i = 0; i < sizeof(PATTERNS) && ok; i++) {
+        if (_bus->writeRegisters(address, MCP23017_REG_DEFVALA, &PATTERNS[i], 1) != 0) {
             return false;
         }
 
-        // Also check if activating would exceed the limit
-        if (ch.wouldExceedDutyCycle(_config.dutyCycleWindowMs, _config.maxDutyCycle, estimatedOnTime)) {
-            debugPrintChannel("Activation would exceed duty cycle for channel ", channel);
-            reportError(SolenoidError::DUTY_CYCLE_EXCEEDED, channel);
+        uint8_t readBack = 0;
+        if (!_bus->readRegisters(address, MCP23017_REG_DEFVALA, &readBack, 1)) {
             return false;
         }
+        ok = (readBack == PATTERNS[i]);
     }
 
-    return true;
+    // Restore the power-on default
+    const uint8_t zero = 0x00;
+    _bus->writeRegisters(address, MCP23017_REG_DEFVALA, &zero, 1);
+
+    return ok;
 }
 
-void SolenoidDriver::reportError(SolenoidError error, uint8_t channel) {
-    _lastError = error;
+void SolenoidDriverBase::noteBusError() {
+    if (!_config.i2cSpeedFallback || _bus == nullptr || _config.i2cErrorThreshold == 0) {
+        return;
+    }
 
-    if (_errorCallback != nullptr) {
-        _errorCallback(error, channel);
+    uint32_t now = millis();
+    if (_busErrorCount == 0 || (now - _busErrorWindowStart) > _config.i2cErrorWindowMs) {
+        _busErrorWindowStart = now;
+        _busErrorCount = 0;
     }
 
-    if (_config.debugEnabled) {
-        Serial.print(F("[SolenoidDriver] Error: "));
-        Serial.print(getErrorString(error));
-        if (channel != 255) {
-            Serial.print(F(" on channel "));
-            Serial.print(channel);
+    if (++_busErrorCount < _config.i2cErrorThreshold) {
+        return;
+    }
+    _busErrorCount = 0;
+
+    // Step down to the next slower standard speed, if there is one
+    for (uint8_t i = 0; i < SOLENOID_I2C_SPEED_COUNT; i++) {
+        if (SOLENOID_I2C_SPEEDS[i] < _i2cClockHz) {
+            applyClock(SOLENOID_I2C_SPEEDS[i]);
+            if (_config.debugEnabled) {
+                Serial.print(F("[SolenoidDriver] Too many I2C errors, clock now "));
+                Serial.print(_i2cClockHz / 1000);
+                Serial.println(F(" kHz"));
+            }
+            return;
         }
-        Serial.println();
     }
 }
 
-void SolenoidDriver::globalToLocal(uint8_t globalChannel, uint8_t& board, uint8_t& localChannel) const {
-    board = globalChannel / SOLENOID_CHANNELS_PER_BOARD;
-    localChannel = globalChannel % SOLENOID_CHANNELS_PER_BOARD;
+void SolenoidDriverBase::applyClock(uint32_t hz) {
+    // Never change the clock under a frame that is on the wire
+    _txQueue.waitIdle();
+    _bus->setClock(hz);
+    _i2cClockHz = hz;
 }
 
-void SolenoidDriver::debugPrint(const char* msg) const {
-    if (_config.debugEnabled) {
-        Serial.print(F("[SolenoidDriver] "));
-        Serial.println(msg);
+bool SolenoidDriverBase::readLatches(uint8_t board, uint16_t& states) {
+    uint8_t length = (_channelsPerBoard == SOLENOID_MAX_CHANNELS_PER_BOARD) ? 2 : 1;
+
+    uint8_t bytes[2] = { 0, 0 };
+    bool ok = _bus->readRegisters(_boardAddresses[board], MCP23017_REG_OLATA, bytes, length);
+    _metrics.recordRead(board, length, ok);
+    if (!ok) {
+        return false;
     }
+
+    states = static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+    return true;
 }
 
-void SolenoidDriver::debugPrintChannel(const char* msg, uint8_t channel) const {
-    if (_config.debugEnabled) {
-        Serial.print(F("[SolenoidDriver] "));
-        Serial.print(msg);
-        Serial.println(channel);
+void SolenoidDriverBase::serviceTransmit() {
+    if (!_asyncTransmit) {
+        return;
+    }
+
+    _txQueue.poll();
+
+    SolenoidFrame frame;
+    while (_txQueue.popCompleted(frame)) {
+        _metrics.recordWrite(frame.board, frame.length, frame.status == 0);
+        _metrics.recordLatency(frame.wireUs - frame.queuedUs);
+        if (completeFrame(frame.board, frame.reg, frame.data, frame.wireUs, frame.status)) {
+            reportError(SolenoidError::I2C_COMMUNICATION);
+        }
+    }
+}
+
+bool SolenoidDriverBase::completeFrame(uint8_t board, uint8_t reg, uint16_t data, uint32_t wireUs, uint8_t status) {
+    if (_eventLog != nullptr) {
+        _eventLog->record(SolenoidLogType::COMMIT, board, reg, status, data, wireUs);
     }
+    if (reg == MCP23017_REG_GPIOA) {
+        handleWireComplete(board, data, wireUs, status == 0);
+    }
+    return noteLinkResult(board, status, reg == MCP23017_REG_GPIOA);
 }
 
-void SolenoidDriver::updateBoardChannelStates(uint8_t board, uint8_t states) {
-    for (uint8_t ch = 0; ch < SOLENOID_CHANNELS_PER_BOARD; ch++) {
-        uint8_t globalCh = (board * SOLENOID_CHANNELS_PER_BOARD) + ch;
-        bool newState = (states >> ch) & 0x01;
-        _channels[globalCh].updateState(newState);
+bool SolenoidDriverBase::noteLinkResult(uint8_t board, uint8_t status, bool gpio) {
+    SolenoidBoardLink& link = _boardLinks[board];
+    uint32_t nowUs = SolenoidTimebase::nowUs32();
+
+    if (status == 0) {
+        _busFailureRun = 0;
+        _busRecoveryPending = false;
+
+        // Only the GPIO write of a retry brings a board back: its outputs
+        // have just been reconfigured and its cached state written
+        if (!gpio || link.health == SolenoidBoardHealth::ONLINE || !link.retryInFlight) {
+            return false;
+        }
+        link.health = SolenoidBoardHealth::ONLINE;
+        link.attempts = 0;
+        link.retryInFlight = false;
+        link.recoveries++;
+
+        // Writes made while it was down only reached the cache
+        if (_wireStates[board] != _boardStates[board]) {
+            _dirtyBoards |= (1 << board);
+        }
+        if (_config.debugEnabled) {
+            Serial.print(F("[SolenoidDriver] Board "));
+            Serial.print(board);
+            Serial.println(F(" back online"));
+        }
+        return false;
+    }
+
+    // Every board failing in a row, or a transfer that never ended, points
+    // at the bus rather than at one board
+    if (_busFailureRun < UINT8_MAX) {
+        _busFailureRun++;
+    }
+    if (status == SOLENOID_I2C_TIMEOUT || _busFailureRun >= SOLENOID_BUS_RECOVERY_FAILURES) {
+        _busRecoveryPending = true;
+    }
+
+    if (link.health == SolenoidBoardHealth::ONLINE) {
+        // First failure - stop writing the board and retry it shortly
+        link.health = SolenoidBoardHealth::RETRYING;
+        link.attempts = 0;
+    } else if (!link.retryInFlight) {
+        // Queued before the board failed - already accounted for
+        return false;
+    } else if (link.health == SolenoidBoardHealth::OFFLINE) {
+        // Still not answering - try again at the next reconnection interval
+        link.retryInFlight = false;
+        link.retryAtUs = nowUs + (_config.boardRecoveryMs * 1000);
+        return false;
+    } else {
+        link.retryInFlight = false;
+        link.attempts++;
+    }
+
+    if (link.attempts >= _config.i2cRetryLimit) {
+        link.health = SolenoidBoardHealth::OFFLINE;
+        link.retryAtUs = nowUs + (_config.boardRecoveryMs * 1000);
+        if (_config.debugEnabled) {
+            Serial.print(F("[SolenoidDriver] Board "));
+            Serial.print(board);
+            Serial.println(F(" offline"));
+        }
+    } else {
+        uint8_t shift = (link.attempts < 16) ? link.attempts : 16;
+        link.retryAtUs = nowUs + (_config.i2cRetryBackoffUs << shift);
+    }
+    return true;
+}
+
+void SolenoidDriverBase::serviceBoardLinks() {
+    uint32_t nowUs = SolenoidTimebase::nowUs32();
+
+    for (uint8_t board = 0; board < _boardCount; board++) {
+        SolenoidBoardLink& link = _boardLinks[board];
+        if (link.health == SolenoidBoardHealth::ONLINE || link.retryInFlight ||
+            static_cast<int32_t>(nowUs - link.retryAtUs) < 0) {
+            continue;
+        }
+        if (link.health == SolenoidBoardHealth::OFFLINE && _config.boardRecoveryMs == 0) {
+            continue;
+        }
+
+        // Configuration and state go out back to back - wait for room for both
+        if (_asyncTransmit && _txQueue.space() < 2) {
+            return;
+        }
+
+        // Re-run begin()'s setup (a board that reset has every pin an
+        // input), then restore the cached state. A synchronous setup write
+        // that failed has already ended the attempt.
+        link.retryInFlight = true;
+        bool ok = sendFrame(board, MCP23017_REG_IODIRA, 0x0000);
+        if (ok && link.retryInFlight) {
+            ok = sendFrame(board, MCP23017_REG_GPIOA, _boardStates[board]);
+        }
+        if (!ok) {
+            reportError(SolenoidError::I2C_COMMUNICATION);
+        }
+    }
+}
+
+void SolenoidDriverBase::resetBoardLinks() {
+    for (uint8_t i = 0; i < _boardCapacity; i++) {
+        _boardLinks[i].health = SolenoidBoardHealth::ONLINE;
+        _boardLinks[i].attempts = 0;
+        _boardLinks[i].retryInFlight = false;
+        _boardLinks[i].retryAtUs = 0;
+        _boardLinks[i].recoveries = 0;
+    }
+}
+
+void SolenoidDriverBase::handleWireComplete(uint8_t board, uint16_t states, uint32_t wireUs, bool ok) {
+    if (_transmitCallback != nullptr) {
+        _transmitCallback(board, states, wireUs, ok);
+    }
+
+    // Failures are reported by the caller once noteLinkResult() has judged them
+    if (!ok) {
+        return;
+    }
+
+    uint16_t changed = states ^ _wireStates[board];
+    _wireStates[board] = states;
+
+    // Hold PWM edges are not note edges - leave the channel timestamps alone
+    changed &= ~SolenoidChannelBank::maskBits(_bank.holdMask, board << _boardShift, _channelsPerBoard);
+
+    if (!_asyncTransmit || changed == 0) {
+        return;
+    }
+
+    // Extend the 32-bit wire time to the 64-bit timebase used by the channels
+    uint64_t nowUs = SolenoidTimebase::nowUs();
+    uint64_t wireTimeUs = nowUs - static_cast<uint32_t>(static_cast<uint32_t>(nowUs) - wireUs);
+
+    for (uint8_t ch = 0; ch < _channelsPerBoard; ch++) {
+        if ((changed >> ch) & 0x01) {
+            uint8_t globalCh = (board << _boardShift) + ch;
+            _channels[globalCh].setEdgeTime((states >> ch) & 0x01, wireTimeUs);
+        }
+    }
+}
+
+void SolenoidDriverBase::setChannelState(uint8_t channel, bool isOn) {
+    SolenoidChannel& ch = _channels[channel];
+    if (ch.isOn() == isOn) {
+        return;
+    }
+
+    // Also sets or clears the channel's bit in _bank.onMask
+    ch.updateState(isOn);
+
+    if (isOn) {
+        // A new on-edge can only bring the earliest deadline closer
+        uint64_t deadline = ch.lastOnTimeUs() + static_cast<uint64_t>(_config.maxOnTimeMs) * 1000;
+        if (!_timeoutArmed || deadline < _nextTimeoutUs) {
+            _nextTimeoutUs = deadline;
+            _timeoutArmed = true;
+        }
+    }
+    // Off-edges leave the cached deadline alone - at worst it fires early and rescans
+}
+
+void SolenoidDriverBase::processTimeouts(uint64_t nowUs) {
+    if (!_timeoutArmed || _config.maxOnTimeMs == 0) {
+        return;
+    }
+
+    // O(1) fast path: nothing can have expired yet
+    if (nowUs < _nextTimeoutUs) {
+        return;
+    }
+
+    bool anyOn = false;
+    uint64_t nextDeadline = 0;
+    uint64_t maxOnUs = static_cast<uint64_t>(_config.maxOnTimeMs) * 1000;
+
+    // Visit only channels that are on
+    for (uint8_t word = 0; word < _maskWords; word++) {
+        uint32_t bits = _bank.onMask[word];
+        while (bits != 0) {
+            uint8_t ch = (word << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            uint64_t deadline = _bank.lastOnUs[ch] + maxOnUs;
+            if (nowUs >= deadline) {
+                // Auto-shutoff
+                debugPrintChannel("Safety timeout on channel ", ch);
+
+                uint8_t board, localChannel;
+                globalToLocal(ch, board, localChannel);
+                _scheduler.cancel(ch, SOLENOID_NOTE_EDGE_ACTIONS);
+                writeChannel(board, localChannel, false);
+                setChannelState(ch, false);
+
+                reportError(SolenoidError::SAFETY_TIMEOUT, ch);
+            } else if (!anyOn || deadline < nextDeadline) {
+                nextDeadline = deadline;
+                anyOn = true;
+            }
+        }
+    }
+
+    _timeoutArmed = anyOn;
+    _nextTimeoutUs = nextDeadline;
+}
+
+void SolenoidDriverBase::processScheduledEvents(uint32_t nowUs) {
+    SolenoidEvent event;
+
+    while (_scheduler.popDue(nowUs, event)) {
+        // Hold edges run at the PWM rate and are implied by the strike
+        if (_eventLog != nullptr && event.action != SolenoidAction::HOLD_OFF &&
+            event.action != SolenoidAction::HOLD_ON) {
+            _eventLog->record(SolenoidLogType::FIRED, event.channel, static_cast<uint8_t>(event.action),
+                              event.velocity, event.dueUs, nowUs - event.dueUs);
+        }
+
+        switch (event.action) {
+            case SolenoidAction::OFF:
+                off(event.channel);
+                break;
+            case SolenoidAction::HOLD_OFF:
+            case SolenoidAction::HOLD_ON:
+                processHoldEvent(event, nowUs);
+                break;
+            case SolenoidAction::NOTE_ON:
+                on(event.channel, event.velocity);
+                break;
+            case SolenoidAction::NOTE_OFF:
+                // Released during its kick (e.g. a zero-length note): the
+                // hammer is thrown first so the note still sounds
+                if (!_bank.isOn(event.channel) || !endAfterKick(event.channel)) {
+                    off(event.channel);
+                }
+                break;
+            case SolenoidAction::DEFERRED_ON:
+                fireDeferredStrike(event);
+                break;
+        }
+    }
+}
+
+SolenoidError SolenoidDriverBase::scheduleNote(uint8_t channel, SolenoidAction action, uint8_t velocity,
+                                           uint32_t targetUs) {
+    if (deferToTick()) {
+        SolenoidCommandType type = (action == SolenoidAction::NOTE_ON)
+            ? SolenoidCommandType::NOTE_ON : SolenoidCommandType::NOTE_OFF;
+        return enqueueCommand(type, channel, velocity, targetUs);
+    }
+
+    if (!validateChannel(channel)) {
+        return _lastError;
+    }
+
+    // Releases outrank every strike, so a note is never left hanging
+    uint8_t priority = (action == SolenoidAction::NOTE_ON) ? velocity : 255;
+    if (!makeRoom(priority)) {
+        debugPrintChannel("Scheduler full, note rejected on channel ", channel);
+        if (action == SolenoidAction::NOTE_ON) {
+            _droppedNoteCount++;
+        }
+        reportError(SolenoidError::BUSY, channel);
+        return _lastError;
+    }
+
+    // Fire early so the key sounds at the target time
+    uint32_t dueUs = targetUs - _velocityMap.getLatency(channel);
+    if (static_cast<int32_t>(SolenoidTimebase::nowUs32() - dueUs) > 0) {
+        _lateEventCount++;
+    }
+
+    SolenoidEvent event = { dueUs, channel, action, velocity };
+    _scheduler.push(event);
+    if (_eventLog != nullptr) {
+        _eventLog->record(SolenoidLogType::SCHEDULED, channel, static_cast<uint8_t>(action), velocity, dueUs, 0);
+    }
+
+    _lastError = SolenoidError::OK;
+    return _lastError;
+}
+
+bool SolenoidDriverBase::deferToTick() const {
+    return _tickActive && _coreDepth == 0;
+}
+
+SolenoidError SolenoidDriverBase::enqueueCommand(SolenoidCommandType type, uint8_t channel, uint8_t velocity,
+                                             uint32_t arg) {
+    // Validate here so the caller still gets immediate feedback
+    if (!_initialized) {
+        return SolenoidError::NOT_INITIALIZED;
+    }
+    if (type != SolenoidCommandType::CANCEL_NOTES && channel >= _channelCount) {
+        return SolenoidError::INVALID_CHANNEL;
+    }
+
+    SolenoidCommand command = { arg, type, channel, velocity };
+    if (!_commandQueue.push(command)) {
+        return SolenoidError::BUSY;
+    }
+    return SolenoidError::OK;
+}
+
+void SolenoidDriverBase::drainCommands() {
+    SolenoidCommand command;
+
+    // Bounded by the ring capacity; results are reported via popError()
+    while (_commandQueue.pop(command)) {
+        switch (command.type) {
+            case SolenoidCommandType::ON:
+                on(command.channel);
+                break;
+            case SolenoidCommandType::STRIKE:
+                on(command.channel, command.velocity);
+                break;
+            case SolenoidCommandType::OFF:
+                off(command.channel);
+                break;
+            case SolenoidCommandType::PULSE:
+                pulse(command.channel, command.arg);
+                break;
+            case SolenoidCommandType::NOTE_ON:
+                scheduleNoteOn(command.channel, command.velocity, command.arg);
+                break;
+            case SolenoidCommandType::NOTE_OFF:
+                scheduleNoteOff(command.channel, command.arg);
+                break;
+            case SolenoidCommandType::CANCEL_NOTES:
+                cancelScheduledNotes();
+                break;
+        }
+    }
+}
+
+void SolenoidDriverBase::startTick() {
+#if defined(__IMXRT1062__)
+    if (_config.tickHz == 0) {
+        return;
+    }
+
+    uint8_t slot = SOLENOID_MAX_BUSES;
+    for (uint8_t i = 0; i < SOLENOID_MAX_BUSES; i++) {
+        if (s_tickDrivers[i] == nullptr) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == SOLENOID_MAX_BUSES) {
+        debugPrint("Tick: no free driver slot, core stays in update()");
+        return;
+    }
+
+    // The timer is shared; the first driver to start it sets the rate
+    if (s_tickHz == 0) {
+        if (!s_tickTimer.begin(solenoidTickIsr, 1000000.0f / _config.tickHz)) {
+            debugPrint("Tick: no IntervalTimer available, core stays in update()");
+            return;
+        }
+        s_tickTimer.priority(SOLENOID_TICK_IRQ_PRIORITY);
+        s_tickHz = _config.tickHz;
+    }
+
+    _tickActive = true;
+    s_tickDrivers[slot] = this;
+#endif
+}
+
+void SolenoidDriverBase::stopTick() {
+#if defined(__IMXRT1062__)
+    if (!_tickActive) {
+        return;
+    }
+
+    // Unregister first, so the interrupt cannot pick this driver up again
+    bool anyLeft = false;
+    for (uint8_t i = 0; i < SOLENOID_MAX_BUSES; i++) {
+        if (s_tickDrivers[i] == this) {
+            s_tickDrivers[i] = nullptr;
+        } else if (s_tickDrivers[i] != nullptr) {
+            anyLeft = true;
+        }
+    }
+    if (!anyLeft) {
+        s_tickTimer.end();
+        s_tickHz = 0;
+    }
+#endif
+    _tickActive = false;
+}
+
+void SolenoidDriverBase::processHoldEvent(const SolenoidEvent& event, uint32_t nowUs) {
+    uint8_t channel = event.channel;
+
+    // The note ended before this edge came due
+    if (channel >= _channelCount || !_bank.isOn(channel)) {
+        return;
+    }
+
+    // From here on the physical output no longer mirrors the logical state
+    _bank.holdMask[channel >> 5] |= (1UL << (channel & 31));
+
+    uint8_t board, localChannel;
+    globalToLocal(channel, board, localChannel);
+
+    bool energize = (event.action == SolenoidAction::HOLD_ON);
+
+    // Holds yield to kicks: skip this high phase while the budget is full
+    if (energize && !claimPower(channel, false)) {
+        energize = false;
+        _holdYieldCount++;
+    }
+
+    if (!writeChannel(board, localChannel, energize)) {
+        reportError(SolenoidError::I2C_COMMUNICATION, channel);
+        return;
+    }
+
+    // Duty 0: released after the kick, nothing more until note-off
+    uint8_t duty = _bank.holdDuty[channel];
+    if (duty == 0) {
+        return;
+    }
+
+    uint32_t periodUs = _config.holdPwmPeriodUs;
+    uint32_t highUs = periodUs * duty / 255;
+    uint32_t nextUs = event.dueUs + (energize ? highUs : periodUs - highUs);
+
+    // After a stall, restart the cycle instead of replaying missed edges
+    if (static_cast<int32_t>(nowUs - nextUs) > 0) {
+        nextUs = nowUs;
+    }
+
+    SolenoidEvent next = {
+        nextUs, channel, energize ? SolenoidAction::HOLD_OFF : SolenoidAction::HOLD_ON, 0
+    };
+    if (!_scheduler.push(next)) {
+        // No room for the next edge - hold at full power so the note still
+        // sounds; maxOnTimeMs still ends it, and the budget counts full power
+        writeChannel(board, localChannel, true);
+        _channels[channel].setDrive(0, 255);
+        reportError(SolenoidError::BUSY, channel);
+    }
+}
+
+SolenoidError SolenoidDriverBase::activate(uint8_t channel, uint8_t velocity) {
+    // Inside the cooldown: strike as soon as it has elapsed instead of rejecting
+    if (retriggerEnabled() && _config.safetyEnabled && _config.minOffTimeMs > 0 &&
+        _channels[channel].timeSinceOffUs() < static_cast<uint64_t>(_config.minOffTimeMs) * 1000) {
+        _deferredNoteCount++;
+        return deferStrike(channel, velocity, cooldownDelayUs(channel));
+    }
+
+    // Safety check
+    if (_config.safetyEnabled && !isSafeToActivate(channel)) {
+        // Error already set by isSafeToActivate
+        return _lastError;
+    }
+
+    // Over budget: try again shortly instead of rejecting
+    if (!claimPower(channel, true)) {
+        return staggerActivation(channel, velocity);
+    }
+    _staggerMask[channel >> 5] &= ~(1UL << (channel & 31));
+
+    // Convert to board/local channel
+    uint8_t board, localChannel;
+    globalToLocal(channel, board, localChannel);
+
+    // Write to hardware
+    if (!writeChannel(board, localChannel, true)) {
+        reportError(SolenoidError::I2C_COMMUNICATION, channel);
+        return _lastError;
+    }
+
+    // Update state tracking
+    setChannelState(channel, true);
+
+    _lastError = SolenoidError::OK;
+    return _lastError;
+}
+
+bool SolenoidDriverBase::powerBudgetEnabled() const {
+    return _config.maxActiveCoils > 0 || _config.powerBudgetMa > 0;
+}
+
+bool SolenoidDriverBase::withinPowerBudget(uint8_t count, uint32_t currentMa) const {
+    if (_config.maxActiveCoils > 0 && count > _config.maxActiveCoils) {
+        return false;
+    }
+    if (_config.powerBudgetMa > 0 && currentMa > _config.powerBudgetMa) {
+        return false;
+    }
+    return true;
+}
+
+void SolenoidDriverBase::measureLoad(uint8_t& count, uint32_t& currentMa) const {
+    count = 0;
+    currentMa = 0;
+
+    // The staged board states are what the coils will be driven with
+    for (uint8_t board = 0; board < _boardCount; board++) {
+        uint16_t bits = _boardStates[board];
+        count += __builtin_popcount(bits);
+        while (bits != 0) {
+            currentMa += _coilCurrentMa[(board << _boardShift) + __builtin_ctz(bits)];
+            bits &= bits - 1;
+        }
+    }
+}
+
+bool SolenoidDriverBase::claimPower(uint8_t channel, bool preemptHolds) {
+    if (!powerBudgetEnabled()) {
+        return true;
+    }
+
+    uint8_t count;
+    uint32_t currentMa;
+    measureLoad(count, currentMa);
+    count++;
+    currentMa += _coilCurrentMa[channel];
+
+    if (withinPowerBudget(count, currentMa)) {
+        return true;
+    }
+    if (!preemptHolds) {
+        return false;
+    }
+
+    // Only cut holds short if that actually makes room
+    uint8_t holdCount = 0;
+    uint32_t holdMa = 0;
+    for (uint8_t board = 0; board < _boardCount; board++) {
+        uint16_t bits = _boardStates[board]
+            & SolenoidChannelBank::maskBits(_bank.holdMask, board << _boardShift, _channelsPerBoard);
+        holdCount += __builtin_popcount(bits);
+        while (bits != 0) {
+            holdMa += _coilCurrentMa[(board << _boardShift) + __builtin_ctz(bits)];
+            bits &= bits - 1;
+        }
+    }
+    if (!withinPowerBudget(count - holdCount, currentMa - holdMa)) {
+        return false;
+    }
+
+    // Kicks first: end the high phase of holds early until the strike fits.
+    // Their next HOLD_ON edge asks for power again.
+    for (uint8_t board = 0; board < _boardCount; board++) {
+        uint16_t bits = _boardStates[board]
+            & SolenoidChannelBank::maskBits(_bank.holdMask, board << _boardShift, _channelsPerBoard);
+        while (bits != 0) {
+            uint8_t local = __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            uint8_t held = (board << _boardShift) + local;
+            if (!writeChannel(board, local, false)) {
+                reportError(SolenoidError::I2C_COMMUNICATION, held);
+            }
+            _holdYieldCount++;
+            count--;
+            currentMa -= _coilCurrentMa[held];
+
+            if (withinPowerBudget(count, currentMa)) {
+                return true;
+            }
+        }
+    }
+    return true;
+}
+
+SolenoidError SolenoidDriverBase::staggerActivation(uint8_t channel, uint8_t velocity) {
+    uint32_t bit = 1UL << (channel & 31);
+    bool waiting = (_staggerMask[channel >> 5] & bit) != 0;
+    uint32_t nowUs = SolenoidTimebase::nowUs32();
+    uint32_t sinceUs = waiting ? _staggerSinceUs[channel] : nowUs;
+    uint32_t waitedUs = nowUs - sinceUs;
+
+    // Past its deadline (or staggering disabled): this strike has waited
+    // longest, so it is the one given up
+    if (_config.powerStaggerUs == 0 ||
+        (_config.powerStaggerMaxUs > 0 && waitedUs >= _config.powerStaggerMaxUs)) {
+        clearDeferredStrike(channel, true);
+        _droppedNoteCount++;
+        debugPrintChannel("Power budget exceeded, strike dropped on channel ", channel);
+        reportError(SolenoidError::POWER_BUDGET_EXCEEDED, channel);
+        return _lastError;
+    }
+
+    // Retry when the next kick frees its share rather than polling. Events
+    // due within eventGroupUs fire in the same pass, so the retry must land
+    // beyond it or it would spin without the clock moving.
+    uint32_t minDelayUs = _config.powerStaggerUs;
+    if (minDelayUs <= _config.eventGroupUs) {
+        minDelayUs = _config.eventGroupUs + 1;
+    }
+    uint32_t delayUs = kickEndDelayUs();
+    if (_config.powerStaggerMaxUs > 0 && delayUs > _config.powerStaggerMaxUs - waitedUs) {
+        delayUs = _config.powerStaggerMaxUs - waitedUs;
+    }
+    if (delayUs < minDelayUs) {
+        delayUs = minDelayUs;
+    }
+
+    SolenoidError err = deferStrike(channel, velocity, delayUs);
+    if (err != SolenoidError::OK) {
+        return err;
+    }
+
+    // deferStrike() starts a fresh strike - keep when this one began waiting
+    _staggerMask[channel >> 5] |= bit;
+    _staggerSinceUs[channel] = sinceUs;
+    if (!waiting) {
+        _staggeredCount++;
+    }
+
+    return err;
+}
+
+uint32_t SolenoidDriverBase::kickEndDelayUs() const {
+    uint64_t nowUs = SolenoidTimebase::nowUs();
+    uint64_t earliestUs = UINT64_MAX;
+
+    // A coil is in its kick while on, not yet modulated, and due a hold
+    for (uint8_t word = 0; word < _maskWords; word++) {
+        uint32_t bits = _bank.onMask[word] & ~_bank.holdMask[word];
+        while (bits != 0) {
+            uint8_t channel = (word << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+
+            if (channel >= _channelCount || _bank.holdDuty[channel] == 255 || _bank.kickUs[channel] == 0) {
+                continue;
+            }
+            uint64_t endUs = _bank.lastOnUs[channel] + _bank.kickUs[channel];
+            if (endUs < earliestUs) {
+                earliestUs = endUs;
+            }
+        }
+    }
+
+    if (earliestUs == UINT64_MAX || earliestUs <= nowUs) {
+        return 0;
+    }
+    return static_cast<uint32_t>(earliestUs - nowUs);
+}
+
+void SolenoidDriverBase::clearScheduledEvents() {
+    _scheduler.clear();
+    for (uint8_t i = 0; i < _channelCapacity; i++) {
+        _staggerSinceUs[i] = 0;
+        _pulseMs[i] = 0;
+    }
+    for (uint8_t word = 0; word < _maskWords; word++) {
+        _deferredMask[word] = 0;
+        _releaseMask[word] = 0;
+        _staggerMask[word] = 0;
+    }
+}
+
+bool SolenoidDriverBase::retriggerEnabled() const {
+    return _config.retrigger == SolenoidRetriggerPolicy::DEFER;
+}
+
+SolenoidError SolenoidDriverBase::retrigger(uint8_t channel, uint8_t velocity) {
+    SolenoidError err = off(channel);
+    if (err != SolenoidError::OK) {
+        return err;
+    }
+
+    _deferredNoteCount++;
+    return deferStrike(channel, velocity, cooldownDelayUs(channel));
+}
+
+uint32_t SolenoidDriverBase::cooldownDelayUs(uint8_t channel) const {
+    // The hammer needs to fall back before the key can sound again
+    uint64_t releaseUs = _config.retriggerGapUs;
+    if (_config.safetyEnabled && static_cast<uint64_t>(_config.minOffTimeMs) * 1000 > releaseUs) {
+        releaseUs = static_cast<uint64_t>(_config.minOffTimeMs) * 1000;
+    }
+
+    uint64_t sinceOffUs = _channels[channel].timeSinceOffUs();
+    uint64_t waitUs = (sinceOffUs < releaseUs) ? releaseUs - sinceOffUs : 0;
+    return static_cast<uint32_t>(waitUs) + _config.eventGroupUs;
+}
+
+SolenoidError SolenoidDriverBase::deferStrike(uint8_t channel, uint8_t velocity, uint32_t delayUs) {
+    // Only the latest strike for a channel is kept
+    clearDeferredStrike(channel, true);
+
+    if (!makeRoom(velocity == 0 ? 128 : velocity)) {
+        _droppedNoteCount++;
+        debugPrintChannel("Scheduler full, strike rejected on channel ", channel);
+        reportError(SolenoidError::BUSY, channel);
+        return _lastError;
+    }
+
+    SolenoidEvent event = {
+        SolenoidTimebase::nowUs32() + delayUs, channel, SolenoidAction::DEFERRED_ON, velocity
+    };
+    _scheduler.push(event);
+    _deferredMask[channel >> 5] |= (1UL << (channel & 31));
+    if (_eventLog != nullptr) {
+        _eventLog->record(SolenoidLogType::DEFERRED, channel, static_cast<uint8_t>(event.action), velocity,
+                          event.dueUs, 0);
+    }
+
+    _lastError = SolenoidError::OK;
+    return _lastError;
+}
+
+bool SolenoidDriverBase::makeRoom(uint8_t priority) {
+    if (!_scheduler.isFull()) {
+        return true;
+    }
+    if (!retriggerEnabled()) {
+        return false;
+    }
+
+    SolenoidEvent shed;
+    if (!_scheduler.shedWeakestStrike(priority, shed)) {
+        return false;
+    }
+
+    if (shed.action == SolenoidAction::DEFERRED_ON) {
+        clearDeferredStrike(shed.channel, false);
+    }
+    _droppedNoteCount++;
+    if (_eventLog != nullptr) {
+        _eventLog->record(SolenoidLogType::SHED, shed.channel, static_cast<uint8_t>(shed.action), shed.velocity,
+                          shed.dueUs, 0);
+    }
+    debugPrintChannel("Scheduler full, strike shed on channel ", shed.channel);
+    return true;
+}
+
+void SolenoidDriverBase::clearDeferredStrike(uint8_t channel, bool cancelEvent) {
+    uint32_t bit = 1UL << (channel & 31);
+    if (cancelEvent && (_deferredMask[channel >> 5] & bit) != 0) {
+        _scheduler.cancel(channel, solenoidActionBit(SolenoidAction::DEFERRED_ON));
+    }
+    _deferredMask[channel >> 5] &= ~bit;
+    _releaseMask[channel >> 5] &= ~bit;
+    _staggerMask[channel >> 5] &= ~bit;
+    _pulseMs[channel] = 0;
+}
+
+void SolenoidDriverBase::fireDeferredStrike(const SolenoidEvent& event) {
+    uint8_t channel = event.channel;
+    uint32_t bit = 1UL << (channel & 31);
+    bool released = (_releaseMask[channel >> 5] & bit) != 0;
+
+    // The event is gone - drop its bits, but keep the stagger bit so a
+    // strike that is still over budget keeps its place in line
+    _deferredMask[channel >> 5] &= ~bit;
+    _releaseMask[channel >> 5] &= ~bit;
+    uint32_t pulseMs = _pulseMs[channel];
+    _pulseMs[channel] = 0;
+
+    if (event.velocity == 0) {
+        on(channel);
+    } else {
+        on(channel, event.velocity);
+    }
+
+    if (!released) {
+        if (pulseMs == 0) {
+            return;
+        }
+        if ((_deferredMask[channel >> 5] & bit) != 0) {
+            // Deferred again - the pulse starts when it fires
+            _pulseMs[channel] = pulseMs;
+        } else if (_bank.isOn(channel)) {
+            // The pulse lasts its full length from the real strike
+            SolenoidEvent end = { SolenoidTimebase::nowUs32() + pulseMs * 1000, channel, SolenoidAction::OFF, 0 };
+            if (!_scheduler.push(end)) {
+                off(channel);
+            }
+        }
+        return;
+    }
+
+    if ((_deferredMask[channel >> 5] & bit) != 0) {
+        // Deferred again - it still owes its release
+        _releaseMask[channel >> 5] |= bit;
+        return;
+    }
+
+    // The note-off has already arrived: end the note once the kick has
+    // thrown the hammer
+    if (_bank.isOn(channel) && !endAfterKick(channel)) {
+        off(channel);
+    }
+}
+
+bool SolenoidDriverBase::endAfterKick(uint8_t channel) {
+    uint32_t kickUs = _bank.kickUs[channel];
+    if (kickUs == 0) {
+        kickUs = _velocityMap.lookup(channel, 127).kickUs;
+    }
+
+    uint64_t nowUs = SolenoidTimebase::nowUs();
+    uint64_t endUs = _bank.lastOnUs[channel] + kickUs;
+    if (endUs <= nowUs) {
+        return false;
+    }
+
+    _scheduler.cancel(channel, SOLENOID_NOTE_EDGE_ACTIONS);
+    SolenoidEvent end = {
+        SolenoidTimebase::nowUs32() + static_cast<uint32_t>(endUs - nowUs), channel, SolenoidAction::OFF, 0
+    };
+    return _scheduler.push(end);
+}
+
+bool SolenoidDriverBase::isSafeToActivate(uint8_t channel) {
+    if (channel >= _channelCount) {
+        return false;
+    }
+
+    SolenoidChannel& ch = _channels[channel];
+
+    // Check cooldown time
+    if (_config.minOffTimeMs > 0) {
+        // Compared in microseconds, so short cooldowns are not rounded
+        uint64_t timeSinceOffUs = ch.timeSinceOffUs();
+        if (timeSinceOffUs < static_cast<uint64_t>(_config.minOffTimeMs) * 1000) {
+            debugPrintChannel("Cooldown not elapsed for channel ", channel);
+            reportError(SolenoidError::SAFETY_COOLDOWN, channel);
+            return false;
+        }
+    }
+
+    // Check duty cycle using rolling window
+    if (_config.maxDutyCycle < 1.0f && _config.dutyCycleWindowMs > 0) {
+        // Use minOffTimeMs as a conservative estimate for the on-duration
+        // in the duty cycle projection (or 100ms default if cooldown is disabled)
+        uint32_t estimatedOnTime = _config.minOffTimeMs > 0 ? _config.minOffTimeMs : 100;
+
+        // One window evaluation serves both checks
+        SolenoidDutyStatus duty = ch.evaluateDutyCycle(_config.dutyCycleWindowMs, estimatedOnTime);
+
+        // Check current duty cycle in the window
+        if (duty.current >= _config.maxDutyCycle) {
+            debugPrintChannel("Duty cycle exceeded for channel ", channel);
+            reportError(SolenoidError::DUTY_CYCLE_EXCEEDED, channel);
+            return false;
+        }
+
+        // Also check if activating would exceed the limit
+        if (duty.projected > _config.maxDutyCycle) {
+            debugPrintChannel("Activation would exceed duty cycle for channel ", channel);
+            reportError(SolenoidError::DUTY_CYCLE_EXCEEDED, channel);
+            return false;
+        }
+    }
+
+    // Last resort once throttling the hold has not kept the coil cool enough
+    if (_config.thermalHeatTauMs > 0 && ch.thermalLoad() >= _config.thermalHardLimit) {
+        debugPrintChannel("Coil too hot for channel ", channel);
+        reportError(SolenoidError::DUTY_CYCLE_EXCEEDED, channel);
+        return false;
+    }
+
+    return true;
+}
+
+uint8_t SolenoidDriverBase::thermalHoldDuty(uint8_t channel, uint8_t holdDuty) const {
+    if (_config.thermalHeatTauMs == 0 || holdDuty == 0) {
+        return holdDuty;
+    }
+
+    float load = _channels[channel].thermalLoad();
+    if (load <= _config.thermalSoftLimit) {
+        return holdDuty;
+    }
+
+    float span = _config.thermalHardLimit - _config.thermalSoftLimit;
+    if (span <= 0.0f || load >= _config.thermalHardLimit) {
+        return 0;  // Kick only
+    }
+
+    // Linear from the full duty at the soft limit to none at the hard limit
+    float scale = (_config.thermalHardLimit - load) / span;
+    return static_cast<uint8_t>(holdDuty * scale);
+}
+
+void SolenoidDriverBase::reportError(SolenoidError error, uint8_t channel) {
+    uint32_t nowUs = SolenoidTimebase::nowUs32();
+    _lastError = error;
+    _metrics.recordError(error);
+    if (_eventLog != nullptr) {
+        _eventLog->record(SolenoidLogType::REJECTED, channel, static_cast<uint8_t>(error), 0, nowUs, 0);
+    }
+
+    if (error == SolenoidError::I2C_COMMUNICATION) {
+        noteBusError();
+    }
+
+    // Deferred - the application prints these from loop() via popError()
+    _errorQueue.push(error, channel, nowUs);
+
+    if (_errorCallback != nullptr) {
+        _errorCallback(error, channel);
+    }
+}
+
+void SolenoidDriverBase::globalToLocal(uint8_t globalChannel, uint8_t& board, uint8_t& localChannel) const {
+    board = globalChannel >> _boardShift;
+    localChannel = globalChannel & (_channelsPerBoard - 1);
+}
+
+void SolenoidDriverBase::debugPrint(const char* msg) const {
+    if (_config.debugEnabled) {
+        Serial.print(F("[SolenoidDriver] "));
+        Serial.println(msg);
+    }
+}
+
+void SolenoidDriverBase::debugPrintChannel(const char* msg, uint8_t channel) const {
+    if (_config.debugEnabled) {
+        Serial.print(F("[SolenoidDriver] "));
+        Serial.print(msg);
+        Serial.println(channel);
+    }
+}
+
+void SolenoidDriverBase::updateBoardChannelStates(uint8_t board, uint16_t states) {
+    uint8_t first = board << _boardShift;
+
+    // Visit only the channels whose state actually changes
+    uint32_t changed = _bank.bits(first, _channelsPerBoard) ^ states;
+    while (changed != 0) {
+        uint8_t ch = __builtin_ctz(changed);
+        changed &= changed - 1;
+        setChannelState(first + ch, (states >> ch) & 0x01);
     }
 }
@@ -3,16 +3,21 @@
  * @brief Main SolenoidDriver library header
  *
  * High-level interface for controlling solenoids through Adafruit I2C
- * Solenoid Driver boards (MCP23017-based).
+ * Solenoid Driver boards (MCP23017-based). The boards are driven at the
+ * register level through a SolenoidBus, so the driver needs no MCP23017
+ * library and runs unchanged against the host simulation's mock bus.
  *
  * Features:
- * - Support for up to 8 boards per I2C bus (64 channels)
+ * - Support for up to 8 boards per I2C bus (64 channels, or 128 using both ports)
  * - Automatic safety shutoff for over-temperature protection
  * - Minimum cooldown enforcement between activations
  * - Duty cycle monitoring and limiting
  * - Non-blocking operation suitable for real-time applications
- * - Support for multiple I2C buses (Wire, Wire1, Wire2)
+ * - Non-blocking timed pulses via an internal event scheduler
+ * - Optional interrupt-driven I2C transmission (Teensy 4.x LPI2C)
+ * - Support for multiple I2C buses (Wire, Wire1, Wire2) via SolenoidMultiBus
  * - Error callback system for monitoring
+ * - Runtime metrics (bus traffic, latency, rejections, pass cost)
  *
  * @author Mechanical MIDI Piano Project
  * @version 1.0.0
@@ -23,10 +28,18 @@
 
 #include <Arduino.h>
 #include <Wire.h>
-#include <Adafruit_MCP23X17.h>
 
 #include "SolenoidConfig.h"
+#include "SolenoidBus.h"
 #include "SolenoidChannel.h"
+#include "SolenoidScheduler.h"
+#include "SolenoidTxQueue.h"
+#include "SolenoidErrorQueue.h"
+#include "SolenoidCommandQueue.h"
+#include "SolenoidVelocity.h"
+#include "SolenoidTimebase.h"
+#include "SolenoidMetrics.h"
+#include "SolenoidEventLog.h"
 
 /**
  * @brief Error callback function type
@@ -48,14 +61,129 @@
 typedef void (*SolenoidErrorCallback)(SolenoidError error, uint8_t channel);
 
 /**
- * @class SolenoidDriver
+ * @brief Transmit completion callback function type
+ *
+ * @param board Board index the frame was sent to
+ * @param states Channel bitmask that was written
+ * @param wireUs micros() time at which the write completed on the bus
+ * @param ok true if the board acknowledged the write
+ *
+ * Called from update() (main context), never from an interrupt.
+ */
+typedef void (*SolenoidTransmitCallback)(uint8_t board, uint16_t states, uint32_t wireUs, bool ok);
+
+/**
+ * @struct SolenoidBoardLink
+ * @brief Fault tracking of one board's I2C link
+ */
+struct SolenoidBoardLink {
+    SolenoidBoardHealth health;   ///< Link state
+    uint8_t attempts;             ///< Retries made since the first failure
+    bool retryInFlight;           ///< A retry has been sent and not yet completed
+    uint32_t retryAtUs;           ///< SolenoidTimebase::nowUs32() of the next retry
+    uint32_t recoveries;          ///< Times the board came back after failing
+};
+
+/**
+ * @struct SolenoidDriverStorageRef
+ * @brief Pointers to the per-channel and per-board arrays of a driver
+ *
+ * Filled in by SolenoidDriverStorage::ref() and handed to the
+ * SolenoidDriverBase constructor.
+ */
+struct SolenoidDriverStorageRef {
+    SolenoidChannel* channels;                            ///< Channel statistics objects
+    uint16_t* coilCurrentMa;                              ///< Coil current ratings (mA)
+    uint32_t* staggerSinceUs;                             ///< When a strike waiting for power was first deferred
+    uint32_t* pulseMs;                                    ///< Length of a pulse() whose strike is waiting
+    uint32_t* deferredMask;                               ///< DEFERRED_ON pending per channel
+    uint32_t* staggerMask;                                ///< Deferred strike is waiting for power
+    uint32_t* releaseMask;                                ///< Note ended before its deferred strike
+    uint32_t* onMask;                                     ///< Channel bank: on bits
+    uint32_t* holdMask;                                   ///< Channel bank: hold bits
+    uint64_t* lastOnUs;                                   ///< Channel bank: last on edge
+    uint64_t* lastOffUs;                                  ///< Channel bank: last off edge
+    uint16_t* kickUs;                                     ///< Channel bank: current kick length
+    uint8_t* holdDuty;                                    ///< Channel bank: current hold duty
+    uint16_t (*velocityKickUs)[SOLENOID_VELOCITY_POINTS]; ///< Velocity map kick curves
+    uint8_t* velocityHoldDuty;                            ///< Velocity map hold duties
+    uint16_t* velocityLatencyUs;                          ///< Velocity map strike latencies
+    uint8_t* boardAddresses;                              ///< Board I2C addresses
+    uint16_t* boardStates;                                ///< Staged GPIO states
+    uint16_t* wireStates;                                 ///< GPIO states confirmed on the wire
+    SolenoidBoardLink* boardLinks;                        ///< Link state of each board
+    uint8_t boardCapacity;                                ///< Entries in the per-board arrays
+    uint8_t channelCapacity;                              ///< Entries in the per-channel arrays
+};
+
+/**
+ * @struct SolenoidDriverStorage
+ * @brief Per-channel and per-board state of a driver, sized at compile time
+ *
+ * @tparam Boards Boards the driver can manage (1 to SOLENOID_MAX_BOARDS_PER_BUS)
+ * @tparam Channels Channels the driver can manage (1 to SOLENOID_MAX_CHANNELS)
+ *
+ * Everything in SolenoidDriverBase that grows with the topology lives
+ * here, so a driver only pays for the channels it has: roughly 200 bytes
+ * per channel, 17 bytes per board.
+ */
+template <uint8_t Boards, uint8_t Channels>
+struct SolenoidDriverStorage {
+    static_assert(Boards >= 1 && Boards <= SOLENOID_MAX_BOARDS_PER_BUS, "Boards must be 1 to 8");
+    static_assert(Channels >= 1 && Channels <= SOLENOID_MAX_CHANNELS, "Channels must be 1 to 128");
+
+    SolenoidChannel channels[Channels];
+    uint16_t coilCurrentMa[Channels];
+    uint32_t staggerSinceUs[Channels];
+    uint32_t pulseMs[Channels];
+    uint32_t deferredMask[solenoidMaskWords(Channels)];
+    uint32_t staggerMask[solenoidMaskWords(Channels)];
+    uint32_t releaseMask[solenoidMaskWords(Channels)];
+    uint32_t onMask[solenoidMaskWords(Channels)];
+    uint32_t holdMask[solenoidMaskWords(Channels)];
+    uint64_t lastOnUs[Channels];
+    uint64_t lastOffUs[Channels];
+    uint16_t kickUs[Channels];
+    uint8_t holdDuty[Channels];
+    uint16_t velocityKickUs[Channels][SOLENOID_VELOCITY_POINTS];
+    uint8_t velocityHoldDuty[Channels];
+    uint16_t velocityLatencyUs[Channels];
+    uint8_t boardAddresses[Boards];
+    uint16_t boardStates[Boards];
+    uint16_t wireStates[Boards];
+    SolenoidBoardLink boardLinks[Boards];
+
+    /**
+     * @brief Get pointers to every array
+     */
+    SolenoidDriverStorageRef ref() {
+        SolenoidDriverStorageRef r = {
+            channels, coilCurrentMa, staggerSinceUs, pulseMs, deferredMask, staggerMask, releaseMask,
+            onMask, holdMask, lastOnUs, lastOffUs, kickUs, holdDuty,
+            velocityKickUs, velocityHoldDuty, velocityLatencyUs,
+            boardAddresses, boardStates, wireStates, boardLinks, Boards, Channels
+        };
+        return r;
+    }
+};
+
+/**
+ * @class SolenoidDriverBase
  * @brief Main class for controlling solenoid driver boards
  *
  * Provides a high-level, safety-aware interface for controlling multiple
  * solenoid driver boards over I2C.
  *
- * The driver uses Port A (pins 0-7) of the MCP23017 for solenoid control.
- * Port B is available for future expansion (e.g., feedback sensors).
+ * The base holds the whole implementation; its per-channel and per-board
+ * arrays are supplied by the derived class. Instantiate SolenoidDriver
+ * (any topology up to the library limits, chosen at begin()) or
+ * SolenoidDriverT (one topology fixed at compile time, less RAM), and take
+ * a SolenoidDriverBase& in code that works with either.
+ *
+ * By default the driver uses Port A (pins 0-7) of the MCP23017 for solenoid
+ * control, leaving Port B free (e.g., feedback sensors). Setting
+ * SolenoidConfig::channelsPerBoard to 16 uses both ports, giving 16 channels
+ * per board written in a single two-byte burst.
  *
  * Safety Features:
  * - Maximum on-time: Channels auto-shutoff after configurable duration
@@ -65,7 +193,9 @@ typedef void (*SolenoidErrorCallback)(SolenoidError error, uint8_t channel);
  *
  * Thread Safety:
  * This class is NOT thread-safe. All calls should be made from the same
- * thread/context (typically the main Arduino loop).
+ * thread/context (typically the main Arduino loop). With
+ * SolenoidConfig::tickHz set, the driver's own timer interrupt is the one
+ * exception: it shares state with loop() only through lock-free rings.
  *
  * Example usage:
  * @code
@@ -93,27 +223,23 @@ typedef void (*SolenoidErrorCallback)(SolenoidError error, uint8_t channel);
  * @note Supports up to 8 MCP23017 boards per I2C bus.
  * Use begin() with an array of addresses for multi-board setups.
  */
-class SolenoidDriver {
+class SolenoidDriverBase {
 public:
     // =========================================================================
     // CONSTRUCTOR / DESTRUCTOR
     // =========================================================================
 
     /**
-     * @brief Construct a new SolenoidDriver object
-     *
-     * Does not initialize hardware - call begin() to initialize.
-     * Default configuration is applied (see SolenoidConfig).
-     */
-    SolenoidDriver();
-
-    /**
-     * @brief Destroy the SolenoidDriver object
+     * @brief Destroy the driver
      *
      * Automatically calls emergencyStop() to ensure all solenoids are off.
      * This prevents solenoids from being left on if the driver is destroyed.
      */
-    ~SolenoidDriver();
+    ~SolenoidDriverBase();
+
+    // The arrays belong to the derived object - a copy would share them
+    SolenoidDriverBase(const SolenoidDriverBase&) = delete;
+    SolenoidDriverBase& operator=(const SolenoidDriverBase&) = delete;
 
     // =========================================================================
     // INITIALIZATION
@@ -128,9 +254,10 @@ public:
      * @return false if initialization failed (check getLastError())
      *
      * This method:
-     * 1. Configures the I2C clock speed from config
+     * 1. Configures the I2C clock speed from config (negotiating down to a
+     *    speed every board handles if i2cSpeedFallback is enabled)
      * 2. Initializes the MCP23017 at the specified address
-     * 3. Configures Port A as outputs
+     * 3. Configures Port A (and Port B in 16-channel mode) as outputs
      * 4. Sets all outputs to LOW (off)
      * 5. Initializes channel state tracking
      *
@@ -168,6 +295,32 @@ public:
      */
     bool begin(TwoWire& wire, const uint8_t addresses[], uint8_t count);
 
+    /**
+     * @brief Initialize with a single driver board on a custom bus
+     *
+     * @param bus Bus to drive the board through (kept by reference)
+     * @param address I2C address of the MCP23017 (0x20-0x27)
+     * @return true if initialization successful
+     *
+     * Same as begin(TwoWire&, uint8_t) over any SolenoidBus, such as the
+     * simulation's SolenoidSimBus.
+     */
+    bool begin(SolenoidBus& bus, uint8_t address = MCP23017_BASE_ADDRESS);
+
+    /**
+     * @brief Initialize with multiple driver boards on a custom bus
+     *
+     * @param bus Bus to drive the boards through (kept by reference)
+     * @param addresses Array of I2C addresses
+     * @param count Number of boards (1-8)
+     * @return true if all boards initialized successfully
+     *
+     * Frames go through the interrupt-driven queue only if the bus exposes
+     * a TwoWire (getWire()); otherwise asynchronous frames are written
+     * through the bus from update().
+     */
+    bool begin(SolenoidBus& bus, const uint8_t addresses[], uint8_t count);
+
     /**
      * @brief Set configuration options
      *
@@ -198,12 +351,57 @@ public:
      *
      * Subject to safety checks when safetyEnabled is true:
      * - SAFETY_COOLDOWN: Returned if minOffTimeMs has not elapsed
+     *   (with SolenoidRetriggerPolicy::DEFER the activation is instead
+     *   queued for the end of the cooldown and OK is returned)
      * - DUTY_CYCLE_EXCEEDED: Returned if duty cycle limit exceeded
      *
+     * If energizing the coil would exceed SolenoidConfig::maxActiveCoils or
+     * powerBudgetMa, holds are cut short to make room; failing that, the
+     * activation is retried when the next kick ends (at least
+     * powerStaggerUs later) and OK is returned. It waits until it plays,
+     * or fails with POWER_BUDGET_EXCEEDED (via popError() once staggered)
+     * if powerStaggerMaxUs is set and has passed.
+     *
      * If the channel is already on, this is a no-op and returns OK.
      */
     SolenoidError on(uint8_t channel);
 
+    /**
+     * @brief Strike a channel with a MIDI velocity (non-blocking)
+     *
+     * @param channel Global channel index
+     * @param velocity MIDI velocity (1-127; 0 turns the channel off)
+     * @return SolenoidError::OK on success, error code on failure
+     *
+     * Looks the velocity up in the channel's curve (see getVelocityMap()),
+     * energizes the coil at full power for the resulting kick length, then
+     * holds it at the channel's hold duty until off() - using software PWM
+     * with period SolenoidConfig::holdPwmPeriodUs, driven from update().
+     * A hold duty of 0 releases the coil after the kick; 255 keeps full power.
+     * Only the energized time counts towards maxDutyCycle, so soft notes and
+     * long holds use less of the budget.
+     *
+     * With safety enabled, a coil whose thermal load is above
+     * SolenoidConfig::thermalSoftLimit gets a reduced hold duty (see
+     * getThermalLoad()), so repeated notes get softer before they are
+     * rejected.
+     *
+     * Same safety checks as on(). Returns BUSY if the scheduler has no room
+     * for the end of the kick.
+     *
+     * If the channel is already on, SolenoidRetriggerPolicy::IGNORE makes
+     * this a no-op; DEFER releases the key and strikes it again after
+     * SolenoidConfig::retriggerGapUs (or the cooldown, if longer).
+     *
+     * Example:
+     * @code
+     * void handleNoteOn(byte channel, byte note, byte velocity) {
+     *     driver.on(note - 60, velocity);
+     * }
+     * @endcode
+     */
+    SolenoidError on(uint8_t channel, uint8_t velocity);
+
     /**
      * @brief Turn off a single channel
      *
@@ -216,6 +414,9 @@ public:
      * - I2C error occurs (I2C_COMMUNICATION)
      *
      * If the channel is already off, this is a no-op and returns OK.
+     * A strike still waiting in the scheduler (power budget or cooldown) is
+     * dropped, or with SolenoidRetriggerPolicy::DEFER played and released
+     * right after its kick.
      */
     SolenoidError off(uint8_t channel);
 
@@ -242,19 +443,168 @@ public:
     SolenoidError toggle(uint8_t channel);
 
     /**
-     * @brief Pulse a channel for a specified duration (blocking)
+     * @brief Pulse a channel for a specified duration (non-blocking)
      *
      * @param channel Global channel index
      * @param durationMs Pulse duration in milliseconds
      * @return SolenoidError::OK on success, error code on failure
      *
-     * WARNING: This is a blocking function. For non-blocking operation,
-     * use on() and off() with your own timing.
+     * Turns the channel on immediately and schedules the off-edge. The
+     * off-edge is fired by update(), so update() must be called regularly.
+     * Pulses on different channels can overlap freely.
+     *
+     * Pulsing a channel that already has a pending off-edge replaces it.
+     * Calling off() before the pulse ends cancels the pending off-edge.
+     *
+     * If on() defers the strike (power budget staggering or the retrigger
+     * cooldown), the pulse starts when the strike fires and lasts the full
+     * duration from then.
      *
-     * Duration is clamped to maxOnTimeMs if exceeded.
+     * - BUSY: Returned if the scheduler queue is full (channel not turned on)
+     *
+     * Duration is clamped to maxOnTimeMs if exceeded, and always to
+     * SOLENOID_MAX_PULSE_MS.
      */
     SolenoidError pulse(uint8_t channel, uint32_t durationMs);
 
+    // =========================================================================
+    // SEQUENCED PLAYBACK
+    // =========================================================================
+
+    /**
+     * @brief Queue a note to sound at a future time
+     *
+     * @param channel Global channel index
+     * @param velocity MIDI velocity (1-127; 0 queues a note-off instead)
+     * @param strikeUs micros() time at which the note should sound
+     * @return SolenoidError::OK if queued, error code on failure
+     *
+     * For file or sequencer playback, where notes are known ahead of time.
+     * The strike is fired by update() at strikeUs minus the channel's strike
+     * latency (SolenoidVelocityMap::setLatency()), then behaves like
+     * on(channel, velocity). Queue notes at least the largest latency plus
+     * one loop() pass ahead; a note whose firing time has already passed is
+     * still played as soon as possible and counted by getLateEventCount().
+     *
+     * Notes due within SolenoidConfig::eventGroupUs of each other are sent
+     * in the same write per board.
+     *
+     * - BUSY: Returned if the scheduler queue is full
+     *
+     * Example:
+     * @code
+     * uint32_t t0 = micros() + 50000;           // 50ms playback buffer
+     * driver.scheduleNoteOn(0, 100, t0);
+     * driver.scheduleNoteOff(0, t0 + 250000);   // Quarter note at 240 BPM
+     * @endcode
+     */
+    SolenoidError scheduleNoteOn(uint8_t channel, uint8_t velocity, uint32_t strikeUs);
+
+    /**
+     * @brief Queue a note release at a future time
+     *
+     * @param channel Global channel index
+     * @param releaseUs micros() time at which the note should end
+     * @return SolenoidError::OK if queued, error code on failure
+     *
+     * The release is shifted by the same strike latency as scheduleNoteOn(),
+     * so a note keeps its written length. Events on the same channel that
+     * fall on the same time are played in the order they were queued, so
+     * queue a note's strike before its release. A release that comes due
+     * while its note is still in the kick (a zero-length note) ends the
+     * note when the kick is over.
+     *
+     * - BUSY: Returned if the scheduler queue is full
+     */
+    SolenoidError scheduleNoteOff(uint8_t channel, uint32_t releaseUs);
+
+    /**
+     * @brief Drop all queued sequenced notes
+     *
+     * Notes that are already sounding keep playing until off(); only
+     * future scheduleNoteOn()/scheduleNoteOff() events are removed.
+     */
+    void cancelScheduledNotes();
+
+    /**
+     * @brief Get the number of sequenced events queued too late
+     *
+     * @return Events whose firing time had already passed when queued
+     */
+    uint32_t getLateEventCount() const;
+
+    // =========================================================================
+    // POWER BUDGET
+    // =========================================================================
+
+    /**
+     * @brief Set the current a channel's coil draws when energized
+     *
+     * @param channel Global channel index (0-127, may be set before begin())
+     * @param currentMa Coil current in milliamps
+     * @return OK, or INVALID_CHANNEL
+     *
+     * Used by SolenoidConfig::powerBudgetMa. Channels default to
+     * SOLENOID_DEFAULT_COIL_CURRENT_MA.
+     */
+    SolenoidError setCoilCurrent(uint8_t channel, uint16_t currentMa);
+
+    /**
+     * @brief Get a channel's coil current rating
+     *
+     * @param channel Global channel index
+     * @return Coil current in milliamps, or 0 if invalid
+     */
+    uint16_t getCoilCurrent(uint8_t channel) const;
+
+    /**
+     * @brief Get the number of coils energized right now
+     *
+     * @return Coils being driven (kicks, full-power notes, hold high phases)
+     */
+    uint8_t getActiveCoilCount() const;
+
+    /**
+     * @brief Get the total current of the coils energized right now
+     *
+     * @return Sum of the coil current ratings (mA)
+     */
+    uint32_t getActiveCurrentMa() const;
+
+    /**
+     * @brief Get the number of strikes delayed by the power budget
+     *
+     * @return Strikes delayed since begin (each counted once, however often it was retried)
+     */
+    uint32_t getStaggeredStrikeCount() const;
+
+    /**
+     * @brief Get the number of hold phases given up for the power budget
+     *
+     * @return Hold high phases cut short or skipped to make room for kicks
+     */
+    uint32_t getHoldYieldCount() const;
+
+    // =========================================================================
+    // RETRIGGER
+    // =========================================================================
+
+    /**
+     * @brief Get the number of strikes postponed by the retrigger policy
+     *
+     * @return Repeated notes and cooldown strikes played late instead of
+     *         being dropped (SolenoidRetriggerPolicy::DEFER)
+     */
+    uint32_t getDeferredNoteCount() const;
+
+    /**
+     * @brief Get the number of strikes that were never played
+     *
+     * @return Strikes shed from a full scheduler, or dropped because they
+     *         could not be queued or staggered any longer
+     */
+    uint32_t getDroppedNoteCount() const;
+
     // =========================================================================
     // MULTI-CHANNEL CONTROL
     // =========================================================================
@@ -277,27 +627,30 @@ public:
      * @return SolenoidError::OK on success
      *
      * Turns off all channels without safety checks (always allowed).
-     * For guaranteed immediate shutoff, use emergencyStop() instead.
+     * Takes the same fast path as emergencyStop() - queued frames are
+     * dropped and the boards cleared at once - but keeps the channel
+     * statistics and reports boards that did not acknowledge.
      */
     SolenoidError allOff();
 
     /**
      * @brief Set all channel states at once
      *
-     * @param states Array of bytes, one per board. Each bit = one channel.
+     * @param states Array of bitmasks, one per board. Each bit = one channel.
      * @param stateCount Number of elements in the states array
      * @return SolenoidError::OK on success, INVALID_BOARD if stateCount < boardCount
      *
      * The stateCount parameter prevents array out-of-bounds access.
-     * Each byte represents 8 channels (bit 0 = channel 0, etc.)
+     * Each element represents one board's channels (bit 0 = channel 0, etc.).
+     * In 8-channel mode only the low 8 bits are used.
      *
-     * Example for 2 boards (16 channels):
+     * Example for 2 boards in 8-channel mode (16 channels):
      * @code
-     * uint8_t states[] = {0b00001111, 0b11110000};  // Channels 0-3 and 12-15 on
+     * uint16_t states[] = {0b00001111, 0b11110000};  // Channels 0-3 and 12-15 on
      * driver.setAll(states, 2);
      * @endcode
      */
-    SolenoidError setAll(const uint8_t states[], uint8_t stateCount);
+    SolenoidError setAll(const uint16_t states[], uint8_t stateCount);
 
     /**
      * @brief Set all channels on a single board
@@ -310,14 +663,59 @@ public:
      *         safety checks remain in their previous state.
      *
      * More efficient than setting channels individually - uses a single
-     * I2C transaction.
+     * I2C transaction. Bits above the board's channel count are ignored.
      *
      * Example:
      * @code
      * driver.setBoardChannels(0, 0b01010101);  // Channels 0, 2, 4, 6 on
      * @endcode
      */
-    SolenoidError setBoardChannels(uint8_t board, uint8_t states);
+    SolenoidError setBoardChannels(uint8_t board, uint16_t states);
+
+    // =========================================================================
+    // TRANSACTIONS (COALESCED BOARD WRITES)
+    // =========================================================================
+
+    /**
+     * @brief Start staging channel changes for a single coalesced write
+     *
+     * While a transaction is open, on(), off(), setBoardChannels() and the
+     * other control methods only update the cached port state and mark the
+     * board dirty. Nothing is sent over I2C until commit() is called, at which
+     * point each dirty board receives exactly one GPIO write.
+     *
+     * Safety checks and channel state tracking still happen immediately, so
+     * return values are the same as in direct mode.
+     *
+     * Transactions nest: only the outermost commit() writes to hardware.
+     *
+     * Example:
+     * @code
+     * driver.beginTransaction();
+     * while (usbMIDI.read()) { }   // handlers call driver.on()/off()
+     * driver.commit();             // one write per board that changed
+     * @endcode
+     */
+    void beginTransaction();
+
+    /**
+     * @brief Close a transaction and write all dirty boards to hardware
+     *
+     * @return SolenoidError::OK on success, I2C_COMMUNICATION if a board
+     *         write failed
+     *
+     * Has no effect on hardware if nested inside another transaction.
+     * Calling commit() with no open transaction flushes any dirty boards
+     * and returns OK.
+     */
+    SolenoidError commit();
+
+    /**
+     * @brief Check if a transaction is currently open
+     *
+     * @return true if writes are being staged
+     */
+    bool inTransaction() const;
 
     // =========================================================================
     // STATE QUERIES
@@ -342,13 +740,25 @@ public:
      */
     const SolenoidChannel* getChannelState(uint8_t channel) const;
 
+    /**
+     * @brief Get the estimated coil thermal load of a channel
+     *
+     * @param channel Global channel index
+     * @return 0.0 (cold) to 1.0 (continuous full power), or 0.0 if invalid
+     *         or the thermal model is disabled
+     *
+     * Above SolenoidConfig::thermalSoftLimit velocity strikes are softened;
+     * at thermalHardLimit activations are rejected.
+     */
+    float getThermalLoad(uint8_t channel) const;
+
     /**
      * @brief Get the state of all channels on a board as a bitmask
      *
      * @param board Board index
      * @return Bitmask of channel states (bit 0 = channel 0), or 0 if invalid
      */
-    uint8_t getBoardState(uint8_t board) const;
+    uint16_t getBoardState(uint8_t board) const;
 
     // =========================================================================
     // SAFETY AND MAINTENANCE
@@ -357,8 +767,13 @@ public:
     /**
      * @brief Update function - MUST be called regularly
      *
-     * Performs safety checks and auto-shutoff for channels exceeding maxOnTime.
+     * Fires due scheduled events (such as pulse off-edges), then performs
+     * safety checks and auto-shutoff for channels exceeding maxOnTime.
+     * The earliest timeout deadline is cached, so when nothing is due the
+     * safety check costs one comparison regardless of channel count; only
+     * channels that are actually on are visited when it expires.
      * Should be called from loop() at least every 10ms for reliable safety.
+     * Pulse timing accuracy depends directly on how often this is called.
      *
      * This function is non-blocking and returns quickly.
      *
@@ -366,14 +781,48 @@ public:
      * - The channel is turned off
      * - SAFETY_TIMEOUT error is reported via callback (if set)
      * - Debug message is printed (if debugEnabled)
+     *
+     * With the hardware tick active (see isTickActive()) all of the above
+     * runs from the timer interrupt instead, and update() only performs the
+     * periodic output latch check. It is still safe to call every loop().
      */
     void update();
 
+    /**
+     * @brief Run one pass of the timing core
+     *
+     * Applies queued commands, fires due scheduled events, checks timeouts
+     * and commits the result as one write per board. Called from the
+     * hardware tick interrupt when SolenoidConfig::tickHz is set; there is
+     * no need to call it otherwise. Skips the pass if loop() is inside a
+     * driver call that owns the core (e.g. allOff()).
+     */
+    void tick();
+
+    /**
+     * @brief Check if the timing core runs from the hardware tick
+     *
+     * @return true if begin() started the tick timer
+     */
+    bool isTickActive() const;
+
+    /**
+     * @brief Get the number of calls rejected because the command ring was full
+     *
+     * @return Rejected command count (tick mode only)
+     */
+    uint32_t getDroppedCommandCount() const;
+
     /**
      * @brief Immediately turn off all channels
      *
      * Emergency stop - bypasses all safety checks and state tracking.
-     * Writes 0x00 directly to all GPIO registers.
+     * Frames still queued for the bus are dropped, scheduled events are
+     * discarded, and every board is cleared: with SolenoidConfig::resetPin
+     * set, by one RESET pulse; otherwise by a blocking write of 0 to each
+     * board, boards with coils on first. No other traffic is queued ahead
+     * of the shutoff, so with N boards the last coil is released after N
+     * single-register writes (about 30us each at 1MHz).
      *
      * Use when immediate shutoff is critical. This is also called
      * automatically when the driver is destroyed.
@@ -391,6 +840,48 @@ public:
      */
     void resetAllStats();
 
+    /**
+     * @brief Check the boards' output latches against the cached state
+     *
+     * @return SolenoidError::OK if every board matched or was restored,
+     *         I2C_COMMUNICATION if a board is not online or could not be
+     *         read or rewritten
+     *
+     * Reads OLATA (and OLATB in 16-channel mode) from each board. A board
+     * whose latches differ from what the driver last wrote is rewritten from
+     * the cache and counted in getDriftCount(); a successful rewrite is not
+     * reported as an error, so periodic resyncs only raise I2C_COMMUNICATION
+     * when the bus actually fails.
+     *
+     * This performs blocking reads and waits for queued frames first, so
+     * call it from a quiet point (it also runs from update() when
+     * SolenoidConfig::resyncIntervalMs is set).
+     */
+    SolenoidError resyncFromHardware();
+
+    /**
+     * @brief Get number of boards found out of sync by resyncFromHardware()
+     *
+     * @return Drift count since begin()
+     */
+    uint32_t getDriftCount() const;
+
+    /**
+     * @brief Free a stuck I2C bus and rewrite every board
+     *
+     * @return true if the bus reported SDA released
+     *
+     * Fails every queued frame, clocks SCL until a slave holding SDA lets
+     * go (SolenoidBus::recoverBus()), restores the clock and restarts the
+     * transmit queue. The boards whose writes were dropped are rewritten
+     * from the cached state by the normal retry path.
+     *
+     * update() calls this by itself when SOLENOID_BUS_RECOVERY_FAILURES
+     * transfers in a row fail or a frame times out, at most once per
+     * SOLENOID_BUS_RECOVERY_INTERVAL_MS. Blocking: call from loop().
+     */
+    bool recoverBus();
+
     // =========================================================================
     // ERROR HANDLING
     // =========================================================================
@@ -426,10 +917,81 @@ public:
      *
      * Callback receives error code and channel number (255 for global errors).
      * The callback is called synchronously - keep it short to avoid
-     * blocking I2C operations.
+     * blocking I2C operations. Do not print from it; use popError() from
+     * loop() instead.
      */
     void setErrorCallback(SolenoidErrorCallback callback);
 
+    /**
+     * @brief Take the oldest deferred error record
+     *
+     * @param record Output: error code, channel and micros() timestamp
+     * @return true if a record was returned, false if none are pending
+     *
+     * Every reported error is recorded in a fixed-size ring instead of being
+     * printed, so error handling never blocks note handling. Drain the ring
+     * from a low-priority point in loop().
+     *
+     * Example:
+     * @code
+     * SolenoidErrorRecord rec;
+     * while (driver.popError(rec)) {
+     *     Serial.println(SolenoidDriver::getErrorString(rec.code));
+     * }
+     * @endcode
+     */
+    bool popError(SolenoidErrorRecord& record);
+
+    /**
+     * @brief Get the number of error records waiting to be drained
+     *
+     * @return Pending record count
+     */
+    uint8_t getPendingErrorCount() const;
+
+    /**
+     * @brief Get the number of error records lost because the ring was full
+     *
+     * @return Dropped record count since the driver was constructed
+     */
+    uint32_t getDroppedErrorCount() const;
+
+    /**
+     * @brief Get the velocity curves used by on(channel, velocity)
+     *
+     * @return Reference to the per-channel velocity map (editable)
+     */
+    SolenoidVelocityMap& getVelocityMap();
+
+    /**
+     * @brief Get the velocity curves used by on(channel, velocity)
+     *
+     * @return Const reference to the per-channel velocity map
+     */
+    const SolenoidVelocityMap& getVelocityMap() const;
+
+    /**
+     * @brief Set callback for board write completions
+     *
+     * @param callback Function to call when a board write finishes, or
+     *        nullptr to disable
+     *
+     * With asyncTransmit enabled this reports the real time each frame hit
+     * the wire. Callbacks are delivered from update().
+     */
+    void setTransmitCallback(SolenoidTransmitCallback callback);
+
+    /**
+     * @brief Record the driver's decisions into an event log
+     *
+     * @param log Log to append to, or nullptr to stop logging
+     *
+     * Logs scheduled, deferred, shed and fired note edges, rejections and
+     * finished board writes. Each costs a few dozen cycles while the log
+     * is recording and one compare otherwise.
+     */
+    void setEventLog(SolenoidEventLog* log);
+
     // =========================================================================
     // DIAGNOSTICS
     // =========================================================================
@@ -441,10 +1003,17 @@ public:
      */
     uint8_t getBoardCount() const;
 
+    /**
+     * @brief Get number of channels on each board
+     *
+     * @return 8 (Port A only) or 16 (Port A and Port B)
+     */
+    uint8_t getChannelsPerBoard() const;
+
     /**
      * @brief Get total number of available channels
      *
-     * @return Channel count (boards * 8)
+     * @return Channel count (boards * channels per board)
      */
     uint8_t getChannelCount() const;
 
@@ -466,33 +1035,198 @@ public:
      */
     uint8_t getBoardAddress(uint8_t board) const;
 
-private:
-    // =========================================================================
-    // PRIVATE MEMBERS
-    // =========================================================================
-
-    TwoWire* _wire;                                          ///< I2C bus reference
-    Adafruit_MCP23X17 _mcp[SOLENOID_MAX_BOARDS_PER_BUS];    ///< MCP23017 instances
-    SolenoidChannel _channels[SOLENOID_MAX_CHANNELS];       ///< Channel state objects
-    uint8_t _boardAddresses[SOLENOID_MAX_BOARDS_PER_BUS];   ///< Board I2C addresses
-    uint8_t _boardStates[SOLENOID_MAX_BOARDS_PER_BUS];      ///< Current GPIO states
-    uint8_t _boardCount;                                     ///< Number of boards
-    uint8_t _channelCount;                                   ///< Total channels
-    bool _initialized;                                       ///< Initialization status
-    SolenoidConfig _config;                                  ///< Configuration
-    SolenoidError _lastError;                                ///< Last error code
-    SolenoidErrorCallback _errorCallback;                    ///< Error callback
-
-    // =========================================================================
-    // PRIVATE METHODS
-    // =========================================================================
-
     /**
-     * @brief Validate that the driver is initialized
+     * @brief Get the I2C clock speed currently in use
      *
-     * @return true if initialized, false otherwise (reports NOT_INITIALIZED error)
+     * @return Clock speed in Hz
+     *
+     * May be lower than SolenoidConfig::i2cClockHz if the speed fallback
+     * stepped down at begin() or after repeated errors.
      */
-    bool validateInitialized();
+    uint32_t getI2CClockHz() const;
+
+    /**
+     * @brief Get the link state of a board
+     *
+     * @param board Board index (0 to boardCount-1)
+     * @return ONLINE, RETRYING or OFFLINE (OFFLINE for an invalid index)
+     */
+    SolenoidBoardHealth getBoardHealth(uint8_t board) const;
+
+    /**
+     * @brief Get how often a board came back after failing
+     *
+     * @param board Board index (0 to boardCount-1)
+     * @return Recoveries since begin() (0 for an invalid index)
+     */
+    uint32_t getBoardRecoveryCount(uint8_t board) const;
+
+    /**
+     * @brief Get how often the bus was recovered
+     *
+     * @return Automatic and explicit recoverBus() calls since begin()
+     */
+    uint32_t getBusRecoveryCount() const;
+
+    /**
+     * @brief Get number of pending scheduled events
+     *
+     * @return Event count (0 to SOLENOID_SCHEDULER_CAPACITY)
+     */
+    uint8_t getScheduledEventCount() const;
+
+    /**
+     * @brief Get number of board frames waiting to go out on the bus
+     *
+     * @return Pending frame count (always 0 unless asyncTransmit is enabled)
+     */
+    uint8_t getPendingFrameCount() const;
+
+    /**
+     * @brief Check if all queued board writes have finished
+     *
+     * @return true if the I2C bus is idle
+     */
+    bool isTransmitIdle() const;
+
+    /**
+     * @brief Copy the runtime counters
+     *
+     * @param out Receives a consistent snapshot (the tick is held off while
+     *            it is copied)
+     *
+     * Counters run from begin(); cost samples are in
+     * SolenoidTimebase::cycles() counts.
+     */
+    void getMetrics(SolenoidMetrics& out);
+
+    /**
+     * @brief Clear the runtime counters
+     */
+    void resetMetrics();
+
+protected:
+    /**
+     * @brief Construct a driver over caller-owned arrays
+     *
+     * @param storage Arrays sized for the topology (see SolenoidDriverStorage)
+     *
+     * Does not initialize hardware - call begin() to initialize.
+     * Default configuration is applied (see SolenoidConfig). The arrays
+     * must be constructed before this runs and outlive the driver, so
+     * derived classes inherit their storage ahead of SolenoidDriverBase.
+     */
+    explicit SolenoidDriverBase(const SolenoidDriverStorageRef& storage);
+
+    /**
+     * @brief Read a channel's on bit without validation
+     *
+     * @param channel Global channel index below the storage capacity
+     */
+    bool channelBit(uint8_t channel) const {
+        return _bank.isOn(channel);
+    }
+
+    /**
+     * @brief Read a board's staged GPIO state without validation
+     *
+     * @param board Board index below the storage capacity
+     */
+    uint16_t boardBits(uint8_t board) const {
+        return _boardStates[board];
+    }
+
+private:
+    // =========================================================================
+    // CORE OWNERSHIP
+    // =========================================================================
+
+    /**
+     * @class CoreGuard
+     * @brief Claims the driver core for the calling context while in scope
+     *
+     * While any guard is alive, tick() returns without touching driver
+     * state, so loop()-side calls such as allOff() can run directly without
+     * racing the tick interrupt. tick() itself holds a guard while it runs.
+     */
+    class CoreGuard {
+    public:
+        explicit CoreGuard(SolenoidDriverBase& driver) : _driver(driver) { _driver._coreDepth = _driver._coreDepth + 1; }
+        ~CoreGuard() { _driver._coreDepth = _driver._coreDepth - 1; }
+    private:
+        SolenoidDriverBase& _driver;
+    };
+
+    // =========================================================================
+    // PRIVATE MEMBERS
+    // =========================================================================
+
+    SolenoidBus* _bus;                                       ///< Bus the boards are on
+    SolenoidWireBus _wireBus;                                ///< Built-in bus for begin(TwoWire&)
+    SolenoidChannelBank _bank;                               ///< Hot on/off state and edge times (SoA)
+    SolenoidChannel* _channels;                              ///< Channel statistics objects
+    uint8_t* _boardAddresses;                                ///< Board I2C addresses
+    uint16_t* _boardStates;                                  ///< Current GPIO states (bit 8-15 = Port B)
+    uint8_t _boardCapacity;                                  ///< Boards the storage holds
+    uint8_t _channelCapacity;                                ///< Channels the storage holds
+    uint8_t _maskWords;                                      ///< Words in each channel bitmask
+    uint8_t _dirtyBoards;                                    ///< Boards with staged changes (bitmask)
+    uint8_t _transactionDepth;                               ///< Open transaction nesting level
+    uint8_t _boardCount;                                     ///< Number of boards
+    uint8_t _channelCount;                                   ///< Total channels
+    uint8_t _channelsPerBoard;                               ///< Channels per board (8 or 16)
+    uint8_t _boardShift;                                     ///< log2(_channelsPerBoard)
+    bool _initialized;                                       ///< Initialization status
+    SolenoidConfig _config;                                  ///< Configuration
+    SolenoidError _lastError;                                ///< Last error code
+    SolenoidErrorCallback _errorCallback;                    ///< Error callback
+    SolenoidErrorQueue _errorQueue;                          ///< Deferred error records
+    SolenoidVelocityMap _velocityMap;                        ///< Velocity-to-strike curves
+    SolenoidScheduler _scheduler;                            ///< Pending timed events
+    SolenoidTxQueue _txQueue;                                ///< Asynchronous frame ring
+    uint16_t* _wireStates;                                   ///< States confirmed written to hardware
+    bool _asyncTransmit;                                     ///< Board writes go through _txQueue
+    uint32_t _lastResyncMs;                                  ///< millis() of the last latch check
+    uint32_t _driftCount;                                    ///< Boards found out of sync
+    SolenoidBoardLink* _boardLinks;                          ///< Link state of each board
+    uint8_t _busFailureRun;                                  ///< Failed transfers since the last success
+    bool _busRecoveryPending;                                ///< update() should recover the bus
+    uint32_t _lastBusRecoveryMs;                             ///< millis() of the last bus recovery
+    uint32_t _busRecoveryCount;                              ///< Bus recoveries since begin()
+    uint8_t _resetPin;                                       ///< Board RESET line (SOLENOID_NO_PIN if none)
+    uint32_t _i2cClockHz;                                    ///< Clock speed in use
+    uint32_t _busErrorWindowStart;                           ///< millis() when error counting began
+    uint8_t _busErrorCount;                                  ///< I2C errors in the current window
+    uint64_t _nextTimeoutUs;                                 ///< Earliest possible maxOnTime deadline (timebase us)
+    bool _timeoutArmed;                                      ///< _nextTimeoutUs is valid
+    SolenoidTransmitCallback _transmitCallback;              ///< Write completion callback
+    SolenoidEventLog* _eventLog;                             ///< Decision log, or nullptr
+    uint32_t _lateEventCount;                                ///< Sequenced events queued too late
+    uint16_t* _coilCurrentMa;                                ///< Coil current ratings (mA)
+    uint32_t* _staggerSinceUs;                               ///< nowUs32() a strike waiting for power was first deferred
+    uint32_t* _pulseMs;                                      ///< Length of a pulse() whose strike is waiting (0 = none)
+    uint32_t _staggeredCount;                                ///< Strikes delayed by the power budget
+    uint32_t _holdYieldCount;                                ///< Hold phases given up for the power budget
+    uint32_t* _deferredMask;                                 ///< Bit set = DEFERRED_ON pending for channel
+    uint32_t* _releaseMask;                                  ///< Bit set = note ended before its deferred strike
+    uint32_t* _staggerMask;                                  ///< Bit set = deferred strike is waiting for power
+    uint32_t _deferredNoteCount;                             ///< Strikes postponed by the retrigger policy
+    uint32_t _droppedNoteCount;                              ///< Strikes shed or dropped
+    SolenoidCommandQueue _commandQueue;                      ///< Calls waiting for the next tick
+    SolenoidMetrics _metrics;                                ///< Runtime counters
+    volatile bool _tickActive;                               ///< Core runs from the tick interrupt
+    volatile uint8_t _coreDepth;                             ///< Live CoreGuards (0 = core free)
+
+    // =========================================================================
+    // PRIVATE METHODS
+    // =========================================================================
+
+    /**
+     * @brief Validate that the driver is initialized
+     *
+     * @return true if initialized, false otherwise (reports NOT_INITIALIZED error)
+     */
+    bool validateInitialized();
 
     /**
      * @brief Validate that a channel index is valid and the driver is initialized
@@ -506,9 +1240,14 @@ private:
      * @brief Write state to a single channel on the hardware
      *
      * @param board Board index
-     * @param channel Local channel index (0-7)
+     * @param channel Local channel index (0-15)
      * @param state Desired state
      * @return true if write succeeded
+     *
+     * The new port value is computed from the cached state and sent with one
+     * write-only transaction (no read-modify-write over I2C).
+     * Inside a transaction only the cached state is updated and the board is
+     * marked dirty.
      */
     bool writeChannel(uint8_t board, uint8_t channel, bool state);
 
@@ -518,8 +1257,286 @@ private:
      * @param board Board index
      * @param states Bitmask of channel states
      * @return true if write succeeded
+     *
+     * Inside a transaction only the cached state is updated and the board is
+     * marked dirty.
+     */
+    bool writeBoard(uint8_t board, uint16_t states);
+
+    /**
+     * @brief Write the cached state of every dirty board to hardware
+     *
+     * @return true if all writes succeeded
+     *
+     * Issues one port write per dirty board and clears the dirty mask.
+     */
+    bool flushDirtyBoards();
+
+    /**
+     * @brief Write a board's output latch(es) in one I2C transaction
+     *
+     * @param board Board index
+     * @param states Bitmask of channel states
+     * @return true if written (or queued, in async mode); false if the board
+     *         did not acknowledge the write
+     *
+     * Sends a GPIO frame with sendFrame(). Does not touch the cached state.
+     * A board that is not ONLINE is skipped (returns true): its cached
+     * state is written when it recovers.
+     */
+    bool writePorts(uint8_t board, uint16_t states);
+
+    /**
+     * @brief Write one or two registers of a board in one I2C transaction
+     *
+     * @param board Board index
+     * @param reg First register (GPIOA for port writes)
+     * @param data Register values (second register in the high byte)
+     * @return false if the write failed with a fault to report (sync) or
+     *         could not be queued (async)
+     *
+     * Queues a frame when asyncTransmit is enabled, otherwise writes
+     * immediately and completes it on the spot. Either way the result goes
+     * through completeFrame(); asynchronous failures are reported from
+     * serviceTransmit().
      */
-    bool writeBoard(uint8_t board, uint8_t states);
+    bool sendFrame(uint8_t board, uint8_t reg, uint16_t data);
+
+    /**
+     * @brief Write a board's output latch(es) with a blocking bus write
+     *
+     * @param board Board index
+     * @param states Bitmask of channel states
+     *
+     * @return true if the board acknowledged the write
+     *
+     * Writes GPIOA in 8-channel mode and GPIOA/GPIOB in 16-channel mode.
+     * The transmit queue must be idle.
+     */
+    bool writePortsBlocking(uint8_t board, uint16_t states);
+
+    /**
+     * @brief Write one or two registers of a board with a blocking bus write
+     *
+     * @param board Board index
+     * @param reg First register
+     * @param data Register values (second register in the high byte)
+     * @return 0 on ACK, otherwise a TwoWire::endTransmission() error code
+     *
+     * Counts the write in the metrics. The transmit queue must be idle.
+     */
+    uint8_t writeRegistersBlocking(uint8_t board, uint8_t reg, uint16_t data);
+
+    /**
+     * @brief Release every coil as fast as the hardware allows
+     *
+     * @return true if every board acknowledged
+     *
+     * Drops the frames still queued, then pulses the RESET line and
+     * reconfigures each board, or without one writes 0 to the boards that
+     * may have coils on before the others. A board that misses the write
+     * is cleared by its retry. Board states end at 0; channel states are
+     * left to the caller.
+     */
+    bool haltBoards();
+
+    /**
+     * @brief Pick the fastest clock at which every board passes verifyBoard()
+     *
+     * @param addresses Board addresses
+     * @param count Number of boards
+     * @return Selected clock speed in Hz (already applied to the bus)
+     */
+    uint32_t negotiateClock(const uint8_t addresses[], uint8_t count);
+
+    /**
+     * @brief Write/read-back check of one board at the current clock
+     *
+     * @param address Board I2C address
+     * @return true if two test patterns read back correctly
+     *
+     * Uses DEFVALA, which has no effect while interrupt-on-change is
+     * disabled, and restores it to 0 afterwards.
+     */
+    bool verifyBoard(uint8_t address);
+
+    /**
+     * @brief Count an I2C error and slow the bus down if they pile up
+     */
+    void noteBusError();
+
+    /**
+     * @brief Apply a clock speed to the bus
+     *
+     * @param hz Clock speed in Hz
+     */
+    void applyClock(uint32_t hz);
+
+    /**
+     * @brief Read a board's output latch register(s)
+     *
+     * @param board Board index
+     * @param states Output: latch contents (OLATB in the high byte)
+     * @return true if the read succeeded
+     */
+    bool readLatches(uint8_t board, uint16_t& states);
+
+    /**
+     * @brief Retire finished asynchronous frames
+     *
+     * Polls the transmit queue and passes each completed frame to
+     * handleWireComplete().
+     */
+    void serviceTransmit();
+
+    /**
+     * @brief Record that a board write reached the hardware
+     *
+     * @param board Board index
+     * @param states Channel bitmask that was written
+     * @param wireUs micros() time at which the write completed
+     * @param ok true if the write was acknowledged
+     *
+     * Corrects channel edge timestamps to the wire time and invokes the
+     * transmit callback. Failures are left to completeFrame()'s caller.
+     */
+    void handleWireComplete(uint8_t board, uint16_t states, uint32_t wireUs, bool ok);
+
+    /**
+     * @brief Dispatch the result of a finished frame
+     *
+     * @param board Board index
+     * @param reg First register written
+     * @param data Values written
+     * @param wireUs SolenoidTimebase::nowUs32() when the write completed
+     * @param status 0 on ACK, otherwise a TwoWire::endTransmission() error code
+     * @return true if the frame failed and the failure should be reported
+     *
+     * GPIO frames go to handleWireComplete(); every frame then updates the
+     * board's link state through noteLinkResult().
+     */
+    bool completeFrame(uint8_t board, uint8_t reg, uint16_t data, uint32_t wireUs, uint8_t status);
+
+    /**
+     * @brief Update a board's link state after a transfer
+     *
+     * @param board Board index
+     * @param status 0 on ACK, otherwise a TwoWire::endTransmission() error code
+     * @param gpio true for a GPIO frame, false for a configuration frame
+     * @return true if the transfer failed and the failure should be reported
+     *
+     * A first failure starts the retries, a failed retry backs off further
+     * or takes the board offline, and a GPIO write that is acknowledged
+     * brings the board back (rewriting it if its cached state has moved on
+     * meanwhile). Failures of frames queued before the board failed are
+     * not counted again, and neither are failed reconnection attempts of
+     * an offline board. Also tracks the failure run that triggers a bus
+     * recovery.
+     */
+    bool noteLinkResult(uint8_t board, uint8_t status, bool gpio);
+
+    /**
+     * @brief Send the retries and reconnection attempts that are due
+     *
+     * Runs after the commit of update() and tick(), so retries queue
+     * behind the writes of the healthy boards. Only sends when the
+     * transmit ring has room; never waits for it.
+     */
+    void serviceBoardLinks();
+
+    /**
+     * @brief Mark every board ONLINE with no retry pending
+     */
+    void resetBoardLinks();
+
+    /**
+     * @brief Record a channel state change
+     *
+     * @param channel Global channel index
+     * @param isOn New state
+     *
+     * Updates the SolenoidChannel, the on-mask and the timeout deadline
+     * cache. All state changes go through here.
+     */
+    void setChannelState(uint8_t channel, bool isOn);
+
+    /**
+     * @brief Turn off channels whose maxOnTime deadline has passed
+     *
+     * @param nowUs Current time from SolenoidTimebase::nowUs()
+     *
+     * Returns immediately if the cached earliest deadline is in the future.
+     * Otherwise visits only the channels in the on-mask and recomputes the
+     * cached deadline.
+     */
+    void processTimeouts(uint64_t nowUs);
+
+    /**
+     * @brief Fire all scheduled events that are due
+     *
+     * @param nowUs Current time from micros()
+     */
+    void processScheduledEvents(uint32_t nowUs);
+
+    /**
+     * @brief Check if a call must be queued for the tick instead of run now
+     *
+     * @return true if the tick is active and the caller does not own the core
+     */
+    bool deferToTick() const;
+
+    /**
+     * @brief Queue a call for the next tick
+     *
+     * @param type Call to perform
+     * @param channel Global channel index (validated here)
+     * @param velocity Velocity for STRIKE and NOTE_ON
+     * @param arg Duration or target time
+     * @return OK if queued, NOT_INITIALIZED, INVALID_CHANNEL, or BUSY if the
+     *         command ring is full
+     *
+     * Runs in application context, so it only reads driver state and never
+     * reports errors itself.
+     */
+    SolenoidError enqueueCommand(SolenoidCommandType type, uint8_t channel, uint8_t velocity, uint32_t arg);
+
+    /**
+     * @brief Apply all queued calls (tick context)
+     */
+    void drainCommands();
+
+    /**
+     * @brief Start the hardware tick if SolenoidConfig::tickHz is set
+     */
+    void startTick();
+
+    /**
+     * @brief Stop the hardware tick and return the core to update()
+     */
+    void stopTick();
+
+    /**
+     * @brief Queue a sequenced note event, shifted by the strike latency
+     *
+     * @param channel Global channel index
+     * @param action NOTE_ON or NOTE_OFF
+     * @param velocity NOTE_ON velocity
+     * @param targetUs micros() time at which the event should be heard
+     * @return SolenoidError::OK if queued, error code on failure
+     */
+    SolenoidError scheduleNote(uint8_t channel, SolenoidAction action, uint8_t velocity, uint32_t targetUs);
+
+    /**
+     * @brief Apply one hold-phase PWM edge and schedule the next
+     *
+     * @param event HOLD_ON or HOLD_OFF event that came due
+     * @param nowUs Current time from micros()
+     *
+     * Ignored if the note has already ended. The coil is switched without
+     * touching the channel's logical state, so timeouts and cooldowns still
+     * see one continuous activation.
+     */
+    void processHoldEvent(const SolenoidEvent& event, uint32_t nowUs);
 
     /**
      * @brief Check if a channel activation is safe
@@ -527,18 +1544,176 @@ private:
      * @param channel Global channel index
      * @return true if safe to activate
      *
-     * Checks cooldown time and duty cycle limits.
+     * Checks cooldown time, duty cycle and thermal limits.
      * Sets _lastError if not safe.
      */
     bool isSafeToActivate(uint8_t channel);
 
+    /**
+     * @brief Energize a channel that is off (shared by both on() overloads)
+     *
+     * @param channel Global channel index (validated, currently off)
+     * @param velocity Strike velocity to retry with if staggered (0 = full power)
+     * @return OK if energized or staggered, error code otherwise
+     *
+     * Runs the safety checks, claims power and writes the channel. A
+     * staggered activation returns OK with the channel still off.
+     */
+    SolenoidError activate(uint8_t channel, uint8_t velocity);
+
+    /**
+     * @brief Check if a power limit is configured
+     *
+     * @return true if maxActiveCoils or powerBudgetMa is non-zero
+     */
+    bool powerBudgetEnabled() const;
+
+    /**
+     * @brief Check a load against the configured power limits
+     *
+     * @param count Coils energized
+     * @param currentMa Their total current (mA)
+     * @return true if within both limits
+     */
+    bool withinPowerBudget(uint8_t count, uint32_t currentMa) const;
+
+    /**
+     * @brief Measure the staged coil load
+     *
+     * @param count Output: coils energized
+     * @param currentMa Output: their total current (mA)
+     *
+     * O(energized coils) - reads the cached board states.
+     */
+    void measureLoad(uint8_t& count, uint32_t& currentMa) const;
+
+    /**
+     * @brief Check whether one more coil fits the power budget
+     *
+     * @param channel Channel about to be energized
+     * @param preemptHolds true to cut hold high phases short to make room
+     * @return true if the channel may be energized now
+     *
+     * Holds are only cut if that is enough to fit the channel.
+     */
+    bool claimPower(uint8_t channel, bool preemptHolds);
+
+    /**
+     * @brief Retry an over-budget activation later through the scheduler
+     *
+     * @param channel Global channel index
+     * @param velocity Strike velocity (0 = full power on())
+     * @return OK if queued, POWER_BUDGET_EXCEEDED past powerStaggerMaxUs
+     *         (or with powerStaggerUs 0), or BUSY if the scheduler is full
+     */
+    SolenoidError staggerActivation(uint8_t channel, uint8_t velocity);
+
+    /**
+     * @brief Get the time until the first running kick drops to its hold
+     *
+     * @return Microseconds from now, or 0 if no coil is in a kick
+     */
+    uint32_t kickEndDelayUs() const;
+
+    /**
+     * @brief Drop every scheduled event, including deferred strikes
+     */
+    void clearScheduledEvents();
+
+    /**
+     * @brief Check if SolenoidRetriggerPolicy::DEFER is selected
+     */
+    bool retriggerEnabled() const;
+
+    /**
+     * @brief Release a held channel and strike it again once that is allowed
+     *
+     * @param channel Global channel index (currently on)
+     * @param velocity Strike velocity (1-127)
+     * @return OK if the strike was queued, or the off()/deferStrike() error
+     */
+    SolenoidError retrigger(uint8_t channel, uint8_t velocity);
+
+    /**
+     * @brief Delay until a strike on a channel clears its cooldown
+     *
+     * @param channel Global channel index
+     * @return Remaining minOffTimeMs (when safetyEnabled), at least
+     *         retriggerGapUs, plus eventGroupUs so an early-grouped event
+     *         cannot fire inside the cooldown (microseconds)
+     */
+    uint32_t cooldownDelayUs(uint8_t channel) const;
+
+    /**
+     * @brief Queue a DEFERRED_ON strike for a channel
+     *
+     * @param channel Global channel index
+     * @param velocity Strike velocity (0 = full power on())
+     * @param delayUs Delay from now (microseconds)
+     * @return OK if queued, or BUSY if no room could be made
+     *
+     * Collapses repeats: a pending deferred strike for the channel is
+     * replaced, so a channel never has more than one.
+     */
+    SolenoidError deferStrike(uint8_t channel, uint8_t velocity, uint32_t delayUs);
+
+    /**
+     * @brief Make room in a full scheduler for one more event
+     *
+     * @param priority Rank of the new event (strike velocity, 128 for a
+     *                 full-power strike, 255 for a release)
+     * @return true if the scheduler has room
+     *
+     * With SolenoidRetriggerPolicy::DEFER, the weakest pending strike ranked
+     * at or below priority is shed and counted as dropped.
+     */
+    bool makeRoom(uint8_t priority);
+
+    /**
+     * @brief Forget a channel's pending deferred strike
+     *
+     * @param channel Global channel index
+     * @param cancelEvent true to also remove the DEFERRED_ON from the scheduler
+     */
+    void clearDeferredStrike(uint8_t channel, bool cancelEvent);
+
+    /**
+     * @brief Play a DEFERRED_ON strike that came due
+     *
+     * @param event The DEFERRED_ON event
+     *
+     * A note that was released while its strike waited is ended right after
+     * the kick, so it still sounds.
+     */
+    void fireDeferredStrike(const SolenoidEvent& event);
+
+    /**
+     * @brief End a note that is still in its kick once the kick is over
+     *
+     * @param channel Global channel index (must be on)
+     * @return true if the end was queued, false if the kick is already over
+     *         or the scheduler is full (the caller turns the channel off)
+     */
+    bool endAfterKick(uint8_t channel);
+
+    /**
+     * @brief Scale a strike's hold duty by the coil's thermal load
+     *
+     * @param channel Global channel index
+     * @param holdDuty Hold duty from the velocity map
+     * @return holdDuty below thermalSoftLimit, scaled linearly down to 0
+     *         (kick only) at thermalHardLimit
+     */
+    uint8_t thermalHoldDuty(uint8_t channel, uint8_t holdDuty) const;
+
     /**
      * @brief Report an error
      *
      * @param error Error code
      * @param channel Channel involved (255 for global)
      *
-     * Sets _lastError and calls error callback if set.
+     * Sets _lastError, records the error for popError() and calls the
+     * error callback if set. Never prints.
      */
     void reportError(SolenoidError error, uint8_t channel = 255);
 
@@ -547,7 +1722,10 @@ private:
      *
      * @param globalChannel Global channel index
      * @param board Output: board index
-     * @param localChannel Output: local channel index (0-7)
+     * @param localChannel Output: local channel index (0-15)
+     *
+     * Channels per board is always a power of two, so this is a shift and
+     * a mask.
      */
     void globalToLocal(uint8_t globalChannel, uint8_t& board, uint8_t& localChannel) const;
 
@@ -572,7 +1750,29 @@ private:
      * @param board Board index
      * @param states Bitmask of channel states
      */
-    void updateBoardChannelStates(uint8_t board, uint8_t states);
+    void updateBoardChannelStates(uint8_t board, uint16_t states);
+};
+
+/**
+ * @class SolenoidDriver
+ * @brief Driver for any topology up to the library limits
+ *
+ * Holds storage for SOLENOID_MAX_BOARDS_PER_BUS boards and
+ * SOLENOID_MAX_CHANNELS channels, so the board count and
+ * SolenoidConfig::channelsPerBoard can be chosen at begin(). For a
+ * topology known at compile time, SolenoidDriverT uses a fraction of the
+ * RAM.
+ */
+class SolenoidDriver : private SolenoidDriverStorage<SOLENOID_MAX_BOARDS_PER_BUS, SOLENOID_MAX_CHANNELS>,
+                       public SolenoidDriverBase {
+public:
+    /**
+     * @brief Construct a new SolenoidDriver object
+     *
+     * Does not initialize hardware - call begin() to initialize.
+     * Default configuration is applied (see SolenoidConfig).
+     */
+    SolenoidDriver();
 };
 
 #endif // SOLENOID_DRIVER_H
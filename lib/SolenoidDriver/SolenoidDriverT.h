@@ -0,0 +1,207 @@
+/**
+ * @file SolenoidDriverT.h
+ * @brief SolenoidDriver specialised for a board topology fixed at compile time
+ *
+ * SolenoidDriver reserves state for 8 boards of 16 channels whatever is
+ * connected - about 25KB, almost all of it per-channel statistics and
+ * velocity tables. SolenoidDriverT<Boards, ChannelsPerBoard> sizes that
+ * state exactly, derives the channel-to-board mapping from the template
+ * arguments, and checks the board count and addresses at compile time.
+ *
+ * The implementation is shared with SolenoidDriver through
+ * SolenoidDriverBase, so both behave identically and code taking a
+ * SolenoidDriverBase& (MidiPedals, MidiFilePlayer, SolenoidBenchmark)
+ * works with either.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_DRIVER_T_H
+#define SOLENOID_DRIVER_T_H
+
+#include "SolenoidDriver.h"
+
+/**
+ * @class SolenoidDriverT
+ * @brief Driver for exactly Boards boards of ChannelsPerBoard channels
+ *
+ * @tparam Boards Boards on the bus (1 to SOLENOID_MAX_BOARDS_PER_BUS)
+ * @tparam ChannelsPerBoard 8 (Port A) or 16 (Port A and Port B)
+ *
+ * SolenoidConfig::channelsPerBoard is pinned to ChannelsPerBoard: the
+ * constructor sets it and setConfig() keeps it.
+ *
+ * Example usage:
+ * @code
+ * // 88 keys: six 16-channel boards at 0x20-0x25
+ * SolenoidDriverT<6, 16> driver;
+ *
+ * void setup() {
+ *     Wire.begin();
+ *     driver.begin(Wire);
+ * }
+ *
+ * void handleNoteOn(byte channel, byte note, byte velocity) {
+ *     uint8_t ch = note - 21;              // A0 = channel 0
+ *     if (ch < driver.CHANNELS) {
+ *         driver.on(ch, velocity);
+ *     }
+ * }
+ * @endcode
+ */
+template <uint8_t Boards, uint8_t ChannelsPerBoard>
+class SolenoidDriverT : private SolenoidDriverStorage<Boards, Boards * ChannelsPerBoard>,
+                        public SolenoidDriverBase {
+    static_assert(Boards >= 1 && Boards <= SOLENOID_MAX_BOARDS_PER_BUS, "Boards must be 1 to 8");
+    static_assert(ChannelsPerBoard == SOLENOID_CHANNELS_PER_BOARD ||
+                  ChannelsPerBoard == SOLENOID_MAX_CHANNELS_PER_BOARD,
+                  "ChannelsPerBoard must be 8 or 16");
+
+    typedef SolenoidDriverStorage<Boards, Boards * ChannelsPerBoard> Storage;
+
+public:
+    /** Boards on the bus */
+    static constexpr uint8_t BOARDS = Boards;
+
+    /** Channels on each board */
+    static constexpr uint8_t CHANNELS_PER_BOARD = ChannelsPerBoard;
+
+    /** Channels across all boards */
+    static constexpr uint8_t CHANNELS = Boards * ChannelsPerBoard;
+
+    /** log2(ChannelsPerBoard) */
+    static constexpr uint8_t BOARD_SHIFT = (ChannelsPerBoard == SOLENOID_MAX_CHANNELS_PER_BOARD) ? 4 : 3;
+
+    /**
+     * @brief Get the board a channel is on
+     */
+    static constexpr uint8_t boardOf(uint8_t channel) {
+        return channel >> BOARD_SHIFT;
+    }
+
+    /**
+     * @brief Get a channel's pin on its board (bit in the board state)
+     */
+    static constexpr uint8_t pinOf(uint8_t channel) {
+        return channel & (ChannelsPerBoard - 1);
+    }
+
+    /**
+     * @brief Get the global channel of a board pin
+     */
+    static constexpr uint8_t channelOf(uint8_t board, uint8_t pin) {
+        return static_cast<uint8_t>((board << BOARD_SHIFT) | pin);
+    }
+
+    /**
+     * @brief Construct a driver with the default configuration
+     *
+     * Does not initialize hardware - call begin() to initialize.
+     */
+    SolenoidDriverT()
+        : Storage()
+        , SolenoidDriverBase(Storage::ref())
+    {
+        setConfig(getConfig());
+    }
+
+    /**
+     * @brief Initialize boards at consecutive addresses
+     *
+     * @param wire Reference to TwoWire instance (Wire, Wire1, or Wire2)
+     * @param firstAddress Address of board 0; board n is at firstAddress + n
+     * @return false if initialization failed (check getLastError())
+     */
+    bool begin(TwoWire& wire, uint8_t firstAddress = MCP23017_BASE_ADDRESS) {
+        uint8_t addresses[Boards];
+        for (uint8_t i = 0; i < Boards; i++) {
+            addresses[i] = firstAddress + i;
+        }
+        return SolenoidDriverBase::begin(wire, addresses, Boards);
+    }
+
+    /**
+     * @brief Initialize boards at the given addresses
+     *
+     * @param wire Reference to TwoWire instance (Wire, Wire1, or Wire2)
+     * @param addresses One I2C address per board, in board order
+     * @return false if initialization failed (check getLastError())
+     */
+    bool begin(TwoWire& wire, const uint8_t (&addresses)[Boards]) {
+        return SolenoidDriverBase::begin(wire, addresses, Boards);
+    }
+
+    /**
+     * @brief Initialize boards at consecutive addresses on any SolenoidBus
+     *
+     * @param bus Bus the boards are on (e.g. the host simulation's mock bus)
+     * @param firstAddress Address of board 0; board n is at firstAddress + n
+     * @return false if initialization failed (check getLastError())
+     */
+    bool begin(SolenoidBus& bus, uint8_t firstAddress = MCP23017_BASE_ADDRESS) {
+        uint8_t addresses[Boards];
+        for (uint8_t i = 0; i < Boards; i++) {
+            addresses[i] = firstAddress + i;
+        }
+        return SolenoidDriverBase::begin(bus, addresses, Boards);
+    }
+
+    /**
+     * @brief Initialize boards at the given addresses on any SolenoidBus
+     *
+     * @param bus Bus the boards are on
+     * @param addresses One I2C address per board, in board order
+     * @return false if initialization failed (check getLastError())
+     */
+    bool begin(SolenoidBus& bus, const uint8_t (&addresses)[Boards]) {
+        return SolenoidDriverBase::begin(bus, addresses, Boards);
+    }
+
+    /**
+     * @brief Update configuration, keeping channelsPerBoard at ChannelsPerBoard
+     *
+     * @param config Configuration structure
+     */
+    void setConfig(const SolenoidConfig& config) {
+        SolenoidConfig fixed = config;
+        fixed.channelsPerBoard = ChannelsPerBoard;
+        SolenoidDriverBase::setConfig(fixed);
+    }
+
+    /**
+     * @brief Check if a channel is on
+     *
+     * @param channel Global channel index
+     * @return true if on (false for channels above CHANNELS)
+     *
+     * One compare against a constant and a bit test.
+     */
+    bool isOn(uint8_t channel) const {
+        return (channel < CHANNELS) && channelBit(channel);
+    }
+
+    /**
+     * @brief Get the staged GPIO state of a board
+     *
+     * @param board Board index
+     * @return Bitmask with bit n = pin n (0 for boards above BOARDS)
+     */
+    uint16_t getBoardState(uint8_t board) const {
+        return (board < Boards) ? boardBits(board) : 0;
+    }
+};
+
+template <uint8_t Boards, uint8_t ChannelsPerBoard>
+constexpr uint8_t SolenoidDriverT<Boards, ChannelsPerBoard>::BOARDS;
+
+template <uint8_t Boards, uint8_t ChannelsPerBoard>
+constexpr uint8_t SolenoidDriverT<Boards, ChannelsPerBoard>::CHANNELS_PER_BOARD;
+
+template <uint8_t Boards, uint8_t ChannelsPerBoard>
+constexpr uint8_t SolenoidDriverT<Boards, ChannelsPerBoard>::CHANNELS;
+
+template <uint8_t Boards, uint8_t ChannelsPerBoard>
+constexpr uint8_t SolenoidDriverT<Boards, ChannelsPerBoard>::BOARD_SHIFT;
+
+#endif // SOLENOID_DRIVER_T_H
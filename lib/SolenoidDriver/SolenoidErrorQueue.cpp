@@ -0,0 +1,66 @@
+/**
+ * @file SolenoidErrorQueue.cpp
+ * @brief Implementation of SolenoidErrorQueue class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidErrorQueue.h"
+
+/** Ring index mask (capacity is a power of two) */
+static constexpr uint8_t ERROR_MASK = SOLENOID_ERROR_QUEUE_CAPACITY - 1;
+
+static_assert((SOLENOID_ERROR_QUEUE_CAPACITY & ERROR_MASK) == 0,
+              "SOLENOID_ERROR_QUEUE_CAPACITY must be a power of two");
+
+SolenoidErrorQueue::SolenoidErrorQueue()
+    : _head(0)
+    , _tail(0)
+    , _dropped(0)
+{
+}
+
+bool SolenoidErrorQueue::push(SolenoidError code, uint8_t channel, uint32_t timeUs) {
+    uint8_t head = _head;
+    if (static_cast<uint8_t>(head - _tail) >= SOLENOID_ERROR_QUEUE_CAPACITY) {
+        _dropped = _dropped + 1;
+        return false;
+    }
+
+    SolenoidErrorRecord& record = _ring[head & ERROR_MASK];
+    record.timeUs = timeUs;
+    record.code = code;
+    record.channel = channel;
+
+    // Publish the record only after it is fully written
+    __asm__ volatile("" ::: "memory");
+    _head = head + 1;
+    return true;
+}
+
+bool SolenoidErrorQueue::pop(SolenoidErrorRecord& record) {
+    uint8_t tail = _tail;
+    if (tail == _head) {
+        return false;
+    }
+
+    record = _ring[tail & ERROR_MASK];
+
+    // Release the slot only after it has been copied out
+    __asm__ volatile("" ::: "memory");
+    _tail = tail + 1;
+    return true;
+}
+
+uint8_t SolenoidErrorQueue::pending() const {
+    return static_cast<uint8_t>(_head - _tail);
+}
+
+uint32_t SolenoidErrorQueue::dropCount() const {
+    return _dropped;
+}
+
+void SolenoidErrorQueue::resetDropCount() {
+    _dropped = 0;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file SolenoidErrorQueue.h
+ * @brief Deferred error reporting ring for SolenoidDriver
+ *
+ * Errors raised while handling notes are recorded here instead of being
+ * printed, so a burst of failures (e.g. a cooldown storm) never blocks the
+ * caller on Serial. The application drains the ring from a low-priority
+ * point in loop() and prints or logs the records there.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_ERROR_QUEUE_H
+#define SOLENOID_ERROR_QUEUE_H
+
+#include <stdint.h>
+
+#include "SolenoidConfig.h"
+
+/**
+ * @struct SolenoidErrorRecord
+ * @brief A single reported error
+ */
+struct SolenoidErrorRecord {
+    uint32_t timeUs;       ///< SolenoidTimebase::nowUs32() when the error was reported
+    SolenoidError code;    ///< Error code
+    uint8_t channel;       ///< Channel involved, or 255 if not channel-specific
+};
+
+/**
+ * @class SolenoidErrorQueue
+ * @brief Lock-free single-producer/single-consumer ring of error records
+ *
+ * The producer (the driver) only writes _head and the consumer (the code
+ * draining the ring) only writes _tail, so push() and pop() may run in
+ * different contexts (e.g. an interrupt and loop()) without locking.
+ *
+ * When the ring is full new records are dropped and counted; the oldest
+ * records are kept because they usually describe the cause.
+ */
+class SolenoidErrorQueue {
+public:
+    /**
+     * @brief Construct an empty queue
+     */
+    SolenoidErrorQueue();
+
+    /**
+     * @brief Record an error (producer side)
+     *
+     * @param code Error code
+     * @param channel Channel involved, or 255
+     * @param timeUs Timestamp in microseconds
+     * @return true if recorded, false if the ring was full and it was dropped
+     */
+    bool push(SolenoidError code, uint8_t channel, uint32_t timeUs);
+
+    /**
+     * @brief Take the oldest record off the ring (consumer side)
+     *
+     * @param record Output: the oldest record
+     * @return true if a record was returned, false if the ring is empty
+     */
+    bool pop(SolenoidErrorRecord& record);
+
+    /**
+     * @brief Get the number of records waiting to be drained
+     *
+     * @return Pending record count
+     */
+    uint8_t pending() const;
+
+    /**
+     * @brief Get the number of records dropped because the ring was full
+     *
+     * @return Drop count since construction or the last resetDropCount()
+     */
+    uint32_t dropCount() const;
+
+    /**
+     * @brief Reset the drop counter
+     */
+    void resetDropCount();
+
+private:
+    SolenoidErrorRecord _ring[SOLENOID_ERROR_QUEUE_CAPACITY];  ///< Record storage
+    volatile uint8_t _head;                                    ///< Next slot to fill (producer)
+    volatile uint8_t _tail;                                    ///< Next slot to pop (consumer)
+    volatile uint32_t _dropped;                                ///< Records lost to a full ring
+};
+
+#endif // SOLENOID_ERROR_QUEUE_H
@@ -0,0 +1,146 @@
+/**
+ * @file SolenoidEventLog.cpp
+ * @brief Implementation of SolenoidEventLog class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidEventLog.h"
+
+#include <Arduino.h>
+
+#include "SolenoidTimebase.h"
+
+/** Ring index mask (capacity is a power of two) */
+static constexpr uint16_t LOG_MASK = SOLENOID_LOG_CAPACITY - 1;
+
+static_assert((SOLENOID_LOG_CAPACITY & LOG_MASK) == 0,
+              "SOLENOID_LOG_CAPACITY must be a power of two");
+static_assert(SOLENOID_LOG_CHUNK_RECORDS <= SOLENOID_LOG_CAPACITY,
+              "SOLENOID_LOG_CHUNK_RECORDS must fit the ring");
+
+#if defined(__IMXRT1062__)
+
+/** Disable interrupts, returning the previous PRIMASK */
+static inline uint32_t irqSave() {
+    uint32_t primask;
+    __asm__ volatile("mrs %0, primask\n\tcpsid i" : "=r"(primask) :: "memory");
+    return primask;
+}
+
+/** Restore PRIMASK saved by irqSave() */
+static inline void irqRestore(uint32_t primask) {
+    __asm__ volatile("msr primask, %0" :: "r"(primask) : "memory");
+}
+
+/** Cycle counter, read in place rather than through SolenoidTimebase::cycles() */
+static inline uint32_t readCycles() {
+    return ARM_DWT_CYCCNT;
+}
+
+#else
+
+static inline uint32_t irqSave() { return 0; }
+static inline void irqRestore(uint32_t) { }
+static inline uint32_t readCycles() { return SolenoidTimebase::cycles(); }
+
+#endif
+
+SolenoidEventLog::SolenoidEventLog()
+    : _head(0)
+    , _tail(0)
+    , _dropped(0)
+    , _recorded(0)
+    , _recording(false)
+{
+}
+
+void SolenoidEventLog::start() {
+    uint32_t primask = irqSave();
+    _head = 0;
+    _tail = 0;
+    _dropped = 0;
+    _recorded = 0;
+    _recording = true;
+    irqRestore(primask);
+
+    record(SolenoidLogType::HEADER, SOLENOID_LOG_VERSION, sizeof(SolenoidLogRecord), 0,
+           SOLENOID_LOG_MAGIC, SolenoidTimebase::cyclesPerUs());
+    sync();
+}
+
+void SolenoidEventLog::stop() {
+    _recording = false;
+}
+
+bool SolenoidEventLog::isRecording() const {
+    return _recording;
+}
+
+void SolenoidEventLog::record(SolenoidLogType type, uint8_t target, uint8_t arg0, uint8_t arg1,
+                              uint32_t value0, uint32_t value1) {
+    if (!_recording) {
+        return;
+    }
+
+    // Producers in loop() and the tick share _head, so claiming and filling
+    // a slot is one short critical section (about 25 cycles on Teensy 4.x)
+    uint32_t primask = irqSave();
+    uint16_t head = _head;
+    if (static_cast<uint16_t>(head - _tail) >= SOLENOID_LOG_CAPACITY) {
+        _dropped = _dropped + 1;
+        irqRestore(primask);
+        return;
+    }
+
+    SolenoidLogRecord& rec = _ring[head & LOG_MASK];
+    rec.cycles = readCycles();
+    rec.type = type;
+    rec.target = target;
+    rec.arg0 = arg0;
+    rec.arg1 = arg1;
+    rec.value0 = value0;
+    rec.value1 = value1;
+
+    // Publish the record only after it is fully written
+    __asm__ volatile("" ::: "memory");
+    _head = head + 1;
+    _recorded = _recorded + 1;
+    irqRestore(primask);
+}
+
+void SolenoidEventLog::sync() {
+    record(SolenoidLogType::SYNC, 0, 0, 0, SolenoidTimebase::nowUs32(), _dropped);
+}
+
+uint16_t SolenoidEventLog::read(SolenoidLogRecord* records, uint16_t count) {
+    uint16_t tail = _tail;
+    uint16_t available = static_cast<uint16_t>(_head - tail);
+    if (count > available) {
+        count = available;
+    }
+
+    // Copy the records only after seeing them published
+    __asm__ volatile("" ::: "memory");
+    for (uint16_t i = 0; i < count; i++) {
+        records[i] = _ring[(tail + i) & LOG_MASK];
+    }
+
+    // Release the slots only after they have been copied out
+    __asm__ volatile("" ::: "memory");
+    _tail = tail + count;
+    return count;
+}
+
+uint16_t SolenoidEventLog::pending() const {
+    return static_cast<uint16_t>(_head - _tail);
+}
+
+uint32_t SolenoidEventLog::dropCount() const {
+    return _dropped;
+}
+
+uint32_t SolenoidEventLog::getRecordCount() const {
+    return _recorded;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file SolenoidEventLog.h
+ * @brief Fixed-record binary log of what the driver did and why
+ *
+ * Records every MIDI message in, every scheduler decision, every safety
+ * rejection and every board write as a 16-byte record stamped with the
+ * cycle counter, into a RAM ring. The application writes the ring out in
+ * SOLENOID_LOG_CHUNK_RECORDS chunks from loop() (e.g. to the SD card), and
+ * the host simulation replays the logged MIDI to reproduce a performance
+ * exactly, with the recorded decisions to compare against.
+ *
+ * A log is a plain array of records. The first is a HEADER, and a SYNC is
+ * written at start() and then at least once per second by the application:
+ *
+ * | Type      | target  | arg0     | arg1     | value0          | value1           |
+ * |-----------|---------|----------|----------|-----------------|------------------|
+ * | HEADER    | version | rec size |          | magic           | cycles per us    |
+ * | SYNC      |         |          |          | nowUs32()       | records dropped  |
+ * | MIDI_IN   | source  | status   | data1    | data2           | arrival (us)     |
+ * | SCHEDULED | channel | action   | velocity | due (us)        |                  |
+ * | DEFERRED  | channel | action   | velocity | due (us)        |                  |
+ * | SHED      | channel | action   | velocity | due (us)        |                  |
+ * | FIRED     | channel | action   | velocity | due (us)        | late by (us)     |
+ * | REJECTED  | channel | error    |          | nowUs32()       |                  |
+ * | COMMIT    | board   | register | status   | data            | on the wire (us) |
+ * | MARK      | any     | any      | any      | any             | any              |
+ *
+ * Records are in the order they were made. cycles wraps every 7 seconds at
+ * 600MHz; readers count wraps between SYNC records, which carry the
+ * microsecond time.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_EVENT_LOG_H
+#define SOLENOID_EVENT_LOG_H
+
+#include <stdint.h>
+
+#include "SolenoidConfig.h"
+
+/**
+ * @enum SolenoidLogType
+ * @brief What a SolenoidLogRecord describes
+ */
+enum class SolenoidLogType : uint8_t {
+    /** First record of a log: format and counter rate */
+    HEADER = 0,
+
+    /** Cycle count to microseconds reference */
+    SYNC = 1,
+
+    /** Channel message handed to the application */
+    MIDI_IN = 2,
+
+    /** Note edge queued for later (scheduleNoteOn/Off) */
+    SCHEDULED = 3,
+
+    /** Strike postponed by the retrigger policy or the power budget */
+    DEFERRED = 4,
+
+    /** Queued strike dropped to make room for a stronger one */
+    SHED = 5,
+
+    /** Queued note edge carried out (hold PWM edges are not logged) */
+    FIRED = 6,
+
+    /** Call refused by the driver */
+    REJECTED = 7,
+
+    /** Board register write finished */
+    COMMIT = 8,
+
+    /** Application-defined */
+    MARK = 9
+};
+
+/**
+ * @struct SolenoidLogRecord
+ * @brief One logged event (see the table in SolenoidEventLog.h)
+ */
+struct SolenoidLogRecord {
+    uint32_t cycles;         ///< SolenoidTimebase::cycles() when recorded
+    SolenoidLogType type;    ///< What happened
+    uint8_t target;          ///< Channel, board or MIDI source
+    uint8_t arg0;            ///< Type-specific
+    uint8_t arg1;            ///< Type-specific
+    uint32_t value0;         ///< Type-specific
+    uint32_t value1;         ///< Type-specific
+};
+
+static_assert(sizeof(SolenoidLogRecord) == 16, "SolenoidLogRecord must stay 16 bytes");
+
+/**
+ * @class SolenoidEventLog
+ * @brief Ring of log records filled from any context and drained from loop()
+ *
+ * record() may be called from loop() and from interrupts (the driver's
+ * tick) at once: a slot is claimed and filled with interrupts held off for
+ * a few dozen cycles. read() is the only consumer.
+ *
+ * When the ring is full new records are dropped and counted; the next
+ * SYNC carries the count so a reader knows where the gap is.
+ *
+ * The ring is SOLENOID_LOG_CAPACITY x 16 bytes (16KB), so keep one
+ * instance (e.g. a global) and hand it to the driver with
+ * SolenoidDriver::setEventLog().
+ *
+ * Example usage:
+ * @code
+ * SolenoidEventLog eventLog;
+ * File logFile;
+ *
+ * void setup() {
+ *     driver.setEventLog(&eventLog);
+ *     logFile = SD.open("/events.log", FILE_WRITE);
+ *     eventLog.start();
+ * }
+ *
+ * void loop() {
+ *     SolenoidLogRecord chunk[SOLENOID_LOG_CHUNK_RECORDS];
+ *     if (eventLog.pending() >= SOLENOID_LOG_CHUNK_RECORDS) {
+ *         uint16_t count = eventLog.read(chunk, SOLENOID_LOG_CHUNK_RECORDS);
+ *         logFile.write(reinterpret_cast<const uint8_t*>(chunk), count * sizeof(SolenoidLogRecord));
+ *     }
+ * }
+ * @endcode
+ */
+class SolenoidEventLog {
+public:
+    /**
+     * @brief Construct an empty, stopped log
+     */
+    SolenoidEventLog();
+
+    /**
+     * @brief Empty the ring and start recording
+     *
+     * The ring then holds a HEADER and a SYNC record.
+     */
+    void start();
+
+    /**
+     * @brief Stop recording (records already made remain readable)
+     */
+    void stop();
+
+    /**
+     * @brief Check if records are being made
+     */
+    bool isRecording() const;
+
+    /**
+     * @brief Append a record (producer side, any context)
+     *
+     * @param type What happened
+     * @param target Channel, board or source
+     * @param arg0 Type-specific
+     * @param arg1 Type-specific
+     * @param value0 Type-specific
+     * @param value1 Type-specific
+     *
+     * Does nothing while stopped. Drops the record if the ring is full.
+     */
+    void record(SolenoidLogType type, uint8_t target, uint8_t arg0, uint8_t arg1,
+                uint32_t value0, uint32_t value1);
+
+    /**
+     * @brief Append a SYNC record tying the cycle count to the time
+     *
+     * Call at least once per cycle counter wrap (every few seconds).
+     */
+    void sync();
+
+    /**
+     * @brief Take the oldest records off the ring (consumer side)
+     *
+     * @param records Buffer to fill
+     * @param count Buffer size in records
+     * @return Records copied, oldest first
+     */
+    uint16_t read(SolenoidLogRecord* records, uint16_t count);
+
+    /**
+     * @brief Get the number of records waiting to be read
+     */
+    uint16_t pending() const;
+
+    /**
+     * @brief Get the number of records dropped because the ring was full
+     *
+     * @return Drop count since start()
+     */
+    uint32_t dropCount() const;
+
+    /**
+     * @brief Get the number of records made since start()
+     */
+    uint32_t getRecordCount() const;
+
+private:
+    SolenoidLogRecord _ring[SOLENOID_LOG_CAPACITY];   ///< Record storage
+    volatile uint16_t _head;                          ///< Next slot to fill (producers)
+    volatile uint16_t _tail;                          ///< Next slot to read (consumer)
+    volatile uint32_t _dropped;                       ///< Records lost to a full ring
+    volatile uint32_t _recorded;                      ///< Records made
+    volatile bool _recording;                         ///< record() stores records
+};
+
+#endif // SOLENOID_EVENT_LOG_H
@@ -0,0 +1,103 @@
+/**
+ * @file SolenoidHistogram.cpp
+ * @brief Implementation of SolenoidHistogram class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidHistogram.h"
+
+/** Sub-buckets per power of two */
+static constexpr uint32_t SUB_COUNT = 1UL << SOLENOID_HISTOGRAM_SUB_BITS;
+
+/** Sub-bucket index mask */
+static constexpr uint32_t SUB_MASK = SUB_COUNT - 1;
+
+SolenoidHistogram::SolenoidHistogram() {
+    reset();
+}
+
+void SolenoidHistogram::reset() {
+    for (uint16_t i = 0; i < SOLENOID_HISTOGRAM_BUCKETS; i++) {
+        _buckets[i] = 0;
+    }
+    _count = 0;
+    _min = UINT32_MAX;
+    _max = 0;
+    _sum = 0;
+}
+
+void SolenoidHistogram::record(uint32_t value) {
+    _buckets[bucketOf(value)]++;
+    _count++;
+    _sum += value;
+    if (value < _min) {
+        _min = value;
+    }
+    if (value > _max) {
+        _max = value;
+    }
+}
+
+uint32_t SolenoidHistogram::getCount() const {
+    return _count;
+}
+
+uint32_t SolenoidHistogram::getMin() const {
+    return (_count > 0) ? _min : 0;
+}
+
+uint32_t SolenoidHistogram::getMax() const {
+    return _max;
+}
+
+uint32_t SolenoidHistogram::getMean() const {
+    return (_count > 0) ? static_cast<uint32_t>(_sum / _count) : 0;
+}
+
+uint32_t SolenoidHistogram::getPercentile(uint8_t percent) const {
+    if (_count == 0) {
+        return 0;
+    }
+    if (percent > 100) {
+        percent = 100;
+    }
+
+    // Rank of the sample at the percentile, rounded up (at least the first)
+    uint32_t rank = static_cast<uint32_t>((static_cast<uint64_t>(_count) * percent + 99) / 100);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint32_t seen = 0;
+    for (uint16_t i = 0; i < SOLENOID_HISTOGRAM_BUCKETS; i++) {
+        seen += _buckets[i];
+        if (seen >= rank) {
+            uint32_t upper = bucketUpper(i);
+            return (upper < _max) ? upper : _max;
+        }
+    }
+    return _max;
+}
+
+uint16_t SolenoidHistogram::bucketOf(uint32_t value) {
+    if (value < SUB_COUNT) {
+        return static_cast<uint16_t>(value);
+    }
+
+    // Octave above the linear range, then the sub-bucket within it
+    uint8_t msb = 31 - __builtin_clz(value);
+    uint8_t shift = msb - SOLENOID_HISTOGRAM_SUB_BITS;
+    return static_cast<uint16_t>(((shift + 1) << SOLENOID_HISTOGRAM_SUB_BITS) | ((value >> shift) & SUB_MASK));
+}
+
+uint32_t SolenoidHistogram::bucketUpper(uint16_t bucket) {
+    if (bucket < SUB_COUNT) {
+        return bucket;
+    }
+
+    uint8_t shift = (bucket >> SOLENOID_HISTOGRAM_SUB_BITS) - 1;
+    uint32_t lower = (SUB_COUNT | (bucket & SUB_MASK)) << shift;
+    return lower + ((1UL << shift) - 1);
+}
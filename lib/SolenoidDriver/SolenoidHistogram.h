@@ -0,0 +1,109 @@
+/**
+ * @file SolenoidHistogram.h
+ * @brief Fixed-size log-linear histogram for latency and cost measurements
+ *
+ * Used by SolenoidBenchmark to collect cycle counts and latencies without
+ * storing every sample. Buckets double in width every power of two and
+ * each power of two is split into 2^SOLENOID_HISTOGRAM_SUB_BITS steps, so
+ * the relative error of a percentile is bounded whatever the magnitude.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_HISTOGRAM_H
+#define SOLENOID_HISTOGRAM_H
+
+#include <stdint.h>
+
+#include "SolenoidConfig.h"
+
+/**
+ * @class SolenoidHistogram
+ * @brief Counts of uint32_t samples in log-linear buckets
+ *
+ * record() is a count-leading-zeros, a shift and an increment, cheap
+ * enough to call inside the code being measured. Minimum, maximum and
+ * mean are exact; percentiles are the upper bound of their bucket.
+ *
+ * Example usage:
+ * @code
+ * SolenoidHistogram h;
+ * h.record(1200);
+ * h.record(1350);
+ * uint32_t p99 = h.getPercentile(99);   // >= 1350, within 12.5%
+ * @endcode
+ */
+class SolenoidHistogram {
+public:
+    /**
+     * @brief Construct an empty histogram
+     */
+    SolenoidHistogram();
+
+    /**
+     * @brief Remove every sample
+     */
+    void reset();
+
+    /**
+     * @brief Add a sample
+     *
+     * @param value Sample value (any unit)
+     */
+    void record(uint32_t value);
+
+    /**
+     * @brief Get the number of samples
+     */
+    uint32_t getCount() const;
+
+    /**
+     * @brief Get the smallest sample
+     *
+     * @return Smallest value (0 if empty)
+     */
+    uint32_t getMin() const;
+
+    /**
+     * @brief Get the largest sample
+     *
+     * @return Largest value (0 if empty)
+     */
+    uint32_t getMax() const;
+
+    /**
+     * @brief Get the mean of the samples
+     *
+     * @return Mean value (0 if empty)
+     */
+    uint32_t getMean() const;
+
+    /**
+     * @brief Get a percentile
+     *
+     * @param percent Percentile (1-100)
+     * @return Value at or below which that share of samples lies, rounded
+     *         up to its bucket and capped at getMax() (0 if empty)
+     */
+    uint32_t getPercentile(uint8_t percent) const;
+
+private:
+    uint32_t _buckets[SOLENOID_HISTOGRAM_BUCKETS];    ///< Sample counts
+    uint32_t _count;                                  ///< Samples recorded
+    uint32_t _min;                                    ///< Smallest sample
+    uint32_t _max;                                    ///< Largest sample
+    uint64_t _sum;                                    ///< Sum of the samples, for the mean
+
+    /**
+     * @brief Bucket holding a value
+     */
+    static uint16_t bucketOf(uint32_t value);
+
+    /**
+     * @brief Largest value held by a bucket
+     */
+    static uint32_t bucketUpper(uint16_t bucket);
+};
+
+#endif // SOLENOID_HISTOGRAM_H
@@ -0,0 +1,334 @@
+/**
+ * @file SolenoidMetrics.cpp
+ * @brief Implementation of SolenoidMetrics class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidMetrics.h"
+
+#include "SolenoidDriver.h"
+#include "SolenoidTimebase.h"
+
+/** Bytes of a register write besides its data: address, register pointer */
+static constexpr uint8_t WRITE_OVERHEAD_BYTES = 2;
+
+/** Bytes of a register read besides its data: + the repeated read address */
+static constexpr uint8_t READ_OVERHEAD_BYTES = 3;
+
+/** Append a little-endian value to a payload */
+static uint8_t* putLE(uint8_t* out, uint32_t value, uint8_t bytes) {
+    for (uint8_t i = 0; i < bytes; i++) {
+        *out++ = static_cast<uint8_t>(value >> (8 * i));
+    }
+    return out;
+}
+
+/** Append a stat to a payload: count, min, mean, max */
+static uint8_t* putStat(uint8_t* out, const SolenoidMetricStat& stat) {
+    out = putLE(out, stat.count, 4);
+    out = putLE(out, (stat.count > 0) ? stat.min : 0, 4);
+    out = putLE(out, stat.average(), 4);
+    return putLE(out, stat.max, 4);
+}
+
+// =============================================================================
+// SolenoidMetricStat
+// =============================================================================
+
+void SolenoidMetricStat::reset() {
+    count = 0;
+    sum = 0;
+    min = UINT32_MAX;
+    max = 0;
+}
+
+void SolenoidMetricStat::record(uint32_t value) {
+    count++;
+    sum += value;
+    if (value < min) {
+        min = value;
+    }
+    if (value > max) {
+        max = value;
+    }
+}
+
+uint32_t SolenoidMetricStat::average() const {
+    return (count > 0) ? static_cast<uint32_t>(sum / count) : 0;
+}
+
+// =============================================================================
+// SolenoidMetrics
+// =============================================================================
+
+SolenoidMetrics::SolenoidMetrics()
+    : _boardCount(0)
+{
+    reset();
+}
+
+void SolenoidMetrics::reset() {
+    for (uint8_t i = 0; i < SOLENOID_MAX_BOARDS_PER_BUS; i++) {
+        _boards[i].transactions = 0;
+        _boards[i].bytes = 0;
+        _boards[i].failures = 0;
+    }
+    for (uint8_t i = 0; i < SOLENOID_METRICS_ERROR_CODES; i++) {
+        _errors[i] = 0;
+    }
+    _latency.reset();
+    _updateCost.reset();
+    _tickCost.reset();
+    _schedulerHighWater = 0;
+    _txHighWater = 0;
+    _commandHighWater = 0;
+    _errorHighWater = 0;
+}
+
+void SolenoidMetrics::setBoardCount(uint8_t count) {
+    _boardCount = (count > SOLENOID_MAX_BOARDS_PER_BUS) ? SOLENOID_MAX_BOARDS_PER_BUS : count;
+}
+
+// =============================================================================
+// RECORDING
+// =============================================================================
+
+void SolenoidMetrics::recordWrite(uint8_t board, uint8_t dataBytes, bool ok) {
+    if (board >= SOLENOID_MAX_BOARDS_PER_BUS) {
+        return;
+    }
+    SolenoidBoardMetrics& m = _boards[board];
+    m.transactions++;
+    m.bytes += WRITE_OVERHEAD_BYTES + dataBytes;
+    if (!ok) {
+        m.failures++;
+    }
+}
+
+void SolenoidMetrics::recordRead(uint8_t board, uint8_t dataBytes, bool ok) {
+    if (board >= SOLENOID_MAX_BOARDS_PER_BUS) {
+        return;
+    }
+    SolenoidBoardMetrics& m = _boards[board];
+    m.transactions++;
+    m.bytes += READ_OVERHEAD_BYTES + dataBytes;
+    if (!ok) {
+        m.failures++;
+    }
+}
+
+void SolenoidMetrics::recordLatency(uint32_t us) {
+    _latency.record(us);
+}
+
+void SolenoidMetrics::recordError(SolenoidError error) {
+    if (error != SolenoidError::OK) {
+        _errors[errorIndex(error)]++;
+    }
+}
+
+void SolenoidMetrics::recordUpdate(uint32_t cycles) {
+    _updateCost.record(cycles);
+}
+
+void SolenoidMetrics::recordTick(uint32_t cycles) {
+    _tickCost.record(cycles);
+}
+
+void SolenoidMetrics::recordDepths(uint8_t scheduled, uint8_t frames, uint8_t commands, uint8_t errors) {
+    if (scheduled > _schedulerHighWater) {
+        _schedulerHighWater = scheduled;
+    }
+    if (frames > _txHighWater) {
+        _txHighWater = frames;
+    }
+    if (commands > _commandHighWater) {
+        _commandHighWater = commands;
+    }
+    if (errors > _errorHighWater) {
+        _errorHighWater = errors;
+    }
+}
+
+// =============================================================================
+// RESULTS
+// =============================================================================
+
+uint8_t SolenoidMetrics::getBoardCount() const {
+    return _boardCount;
+}
+
+const SolenoidBoardMetrics& SolenoidMetrics::getBoard(uint8_t board) const {
+    return _boards[(board < SOLENOID_MAX_BOARDS_PER_BUS) ? board : 0];
+}
+
+const SolenoidMetricStat& SolenoidMetrics::getLatency() const {
+    return _latency;
+}
+
+const SolenoidMetricStat& SolenoidMetrics::getUpdateCost() const {
+    return _updateCost;
+}
+
+const SolenoidMetricStat& SolenoidMetrics::getTickCost() const {
+    return _tickCost;
+}
+
+uint32_t SolenoidMetrics::getErrorCount(SolenoidError error) const {
+    return _errors[errorIndex(error)];
+}
+
+uint8_t SolenoidMetrics::getSchedulerHighWater() const {
+    return _schedulerHighWater;
+}
+
+uint8_t SolenoidMetrics::getTxQueueHighWater() const {
+    return _txHighWater;
+}
+
+uint8_t SolenoidMetrics::getCommandQueueHighWater() const {
+    return _commandHighWater;
+}
+
+uint8_t SolenoidMetrics::getErrorQueueHighWater() const {
+    return _errorHighWater;
+}
+
+// =============================================================================
+// EXPORT
+// =============================================================================
+
+uint16_t SolenoidMetrics::encodeSysEx(uint8_t* buffer, uint16_t size) const {
+    uint8_t payload[SOLENOID_METRICS_PAYLOAD_MAX];
+    uint8_t* p = payload;
+
+    p = putLE(p, SolenoidTimebase::nowMs(), 4);
+    *p++ = _boardCount;
+    *p++ = SOLENOID_METRICS_ERROR_CODES;
+    for (uint8_t i = 0; i < _boardCount; i++) {
+        p = putLE(p, _boards[i].transactions, 4);
+        p = putLE(p, _boards[i].bytes, 4);
+        p = putLE(p, _boards[i].failures, 4);
+    }
+    p = putStat(p, _latency);
+    p = putStat(p, _updateCost);
+    p = putStat(p, _tickCost);
+    p = putLE(p, SolenoidTimebase::cyclesPerUs(), 4);
+    for (uint8_t i = 0; i < SOLENOID_METRICS_ERROR_CODES; i++) {
+        p = putLE(p, _errors[i], 4);
+    }
+    *p++ = _schedulerHighWater;
+    *p++ = _txHighWater;
+    *p++ = _commandHighWater;
+    *p++ = _errorHighWater;
+
+    uint16_t payloadLength = static_cast<uint16_t>(p - payload);
+    uint16_t frameLength = 4 + payloadLength + ((payloadLength + 6) / 7) + 1;
+    if (buffer == nullptr || size < frameLength) {
+        return 0;
+    }
+
+    uint8_t* out = buffer;
+    *out++ = 0xF0;
+    *out++ = SOLENOID_METRICS_SYSEX_ID;
+    *out++ = SOLENOID_METRICS_SYSEX_TAG;
+    *out++ = SOLENOID_METRICS_VERSION;
+
+    // 7-in-8: one byte of high bits, then up to seven 7-bit bytes
+    for (uint16_t group = 0; group < payloadLength; group += 7) {
+        uint8_t* msbs = out++;
+        *msbs = 0;
+        for (uint8_t i = 0; i < 7 && (group + i) < payloadLength; i++) {
+            uint8_t value = payload[group + i];
+            *msbs |= static_cast<uint8_t>((value >> 7) << i);
+            *out++ = value & 0x7F;
+        }
+    }
+
+    *out++ = 0xF7;
+    return frameLength;
+}
+
+void SolenoidMetrics::printTo(Print& out) const {
+    for (uint8_t i = 0; i < _boardCount; i++) {
+        out.print(F("  Board "));
+        out.print(i);
+        out.print(F(": "));
+        out.print(_boards[i].transactions);
+        out.print(F(" transactions, "));
+        out.print(_boards[i].bytes);
+        out.print(F(" bytes, "));
+        out.print(_boards[i].failures);
+        out.println(F(" failed"));
+    }
+
+    printStat(out, "Write latency", _latency, "us");
+    printStat(out, "update()", _updateCost, "cyc");
+    printStat(out, "tick()", _tickCost, "cyc");
+
+    out.print(F("  Rejections:"));
+    bool any = false;
+    for (uint8_t i = 1; i < SOLENOID_METRICS_ERROR_CODES; i++) {
+        if (_errors[i] == 0) {
+            continue;
+        }
+        SolenoidError code = (i == SOLENOID_METRICS_ERROR_CODES - 1)
+            ? SolenoidError::UNKNOWN : static_cast<SolenoidError>(i);
+        out.print(any ? F(", ") : F(" "));
+        out.print(SolenoidDriver::getErrorString(code));
+        out.print(F(" "));
+        out.print(_errors[i]);
+        any = true;
+    }
+    if (!any) {
+        out.print(F(" none"));
+    }
+    out.println();
+
+    out.print(F("  High water: scheduler "));
+    out.print(_schedulerHighWater);
+    out.print(F("/"));
+    out.print(SOLENOID_SCHEDULER_CAPACITY);
+    out.print(F(", tx "));
+    out.print(_txHighWater);
+    out.print(F("/"));
+    out.print(SOLENOID_TX_QUEUE_CAPACITY);
+    out.print(F(", commands "));
+    out.print(_commandHighWater);
+    out.print(F("/"));
+    out.print(SOLENOID_COMMAND_QUEUE_CAPACITY);
+    out.print(F(", errors "));
+    out.print(_errorHighWater);
+    out.print(F("/"));
+    out.println(SOLENOID_ERROR_QUEUE_CAPACITY);
+}
+
+// =============================================================================
+// PRIVATE
+// =============================================================================
+
+uint8_t SolenoidMetrics::errorIndex(SolenoidError error) {
+    uint8_t code = static_cast<uint8_t>(error);
+    return (code < SOLENOID_METRICS_ERROR_CODES - 1) ? code : (SOLENOID_METRICS_ERROR_CODES - 1);
+}
+
+void SolenoidMetrics::printStat(Print& out, const char* label, const SolenoidMetricStat& stat, const char* unit) {
+    out.print(F("  "));
+    out.print(label);
+    out.print(F(": "));
+    if (stat.count == 0) {
+        out.println(F("no samples"));
+        return;
+    }
+    out.print(stat.count);
+    out.print(F(" samples, min/avg/max "));
+    out.print(stat.min);
+    out.print(F("/"));
+    out.print(stat.average());
+    out.print(F("/"));
+    out.print(stat.max);
+    out.print(F(" "));
+    out.println(unit);
+}
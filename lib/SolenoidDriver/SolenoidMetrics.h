@@ -0,0 +1,300 @@
+/**
+ * @file SolenoidMetrics.h
+ * @brief Fixed-size runtime counters of the SolenoidDriver
+ *
+ * Counts what a live rig needs for tuning - bus traffic per board, board
+ * write latency, rejected notes by reason, queue high-water marks and the
+ * cost of the update() and tick() passes - without storing samples. Every
+ * record call is a few additions and compares, cheap enough for the hot
+ * paths and the tick interrupt.
+ *
+ * The counters can be printed as text or packed into a SysEx frame for a
+ * host tool to graph (see encodeSysEx() for the layout).
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_METRICS_H
+#define SOLENOID_METRICS_H
+
+#include <stdint.h>
+#include <Arduino.h>
+
+#include "SolenoidConfig.h"
+
+/** Bytes of the unpacked metrics payload with every board in use */
+constexpr uint16_t SOLENOID_METRICS_PAYLOAD_MAX =
+    4 + 1 + 1                                 // Time, board count, error code count
+    + (12 * SOLENOID_MAX_BOARDS_PER_BUS)      // Transactions, bytes, failures per board
+    + (3 * 16)                                // Latency, update() and tick() stats
+    + 4                                       // Cycle counter rate
+    + (4 * SOLENOID_METRICS_ERROR_CODES)      // Rejections by error code
+    + 4;                                      // High-water marks
+
+/** Bytes of the largest SysEx frame: F0, ID, tag, version, packed payload, F7 */
+constexpr uint16_t SOLENOID_METRICS_SYSEX_MAX =
+    4 + SOLENOID_METRICS_PAYLOAD_MAX + ((SOLENOID_METRICS_PAYLOAD_MAX + 6) / 7) + 1;
+
+/**
+ * @struct SolenoidMetricStat
+ * @brief Count, minimum, mean and maximum of uint32_t samples
+ */
+struct SolenoidMetricStat {
+    uint32_t count;      ///< Samples recorded
+    uint64_t sum;        ///< Sum of the samples (for the mean)
+    uint32_t min;        ///< Smallest sample (UINT32_MAX while empty)
+    uint32_t max;        ///< Largest sample
+
+    /**
+     * @brief Remove every sample
+     */
+    void reset();
+
+    /**
+     * @brief Add a sample
+     */
+    void record(uint32_t value);
+
+    /**
+     * @brief Get the mean sample
+     *
+     * @return Mean, or 0 while empty
+     */
+    uint32_t average() const;
+};
+
+/**
+ * @struct SolenoidBoardMetrics
+ * @brief Bus traffic of one board
+ *
+ * Bytes are counted as they cross the wire, address and register pointer
+ * included, so they relate directly to bus occupancy.
+ */
+struct SolenoidBoardMetrics {
+    uint32_t transactions;   ///< Writes and reads started
+    uint32_t bytes;          ///< Bytes transferred (address, register and data)
+    uint32_t failures;       ///< Transactions not acknowledged
+};
+
+/**
+ * @class SolenoidMetrics
+ * @brief Counters updated by the driver, read as a snapshot
+ *
+ * A SolenoidDriver owns one instance and updates it from update(), tick()
+ * and the board write paths. Read it with SolenoidDriver::getMetrics(),
+ * which copies it while the tick interrupt is held off.
+ *
+ * Example usage:
+ * @code
+ * SolenoidMetrics metrics;
+ * driver.getMetrics(metrics);
+ * metrics.printTo(Serial);
+ *
+ * uint8_t frame[SOLENOID_METRICS_SYSEX_MAX];
+ * uint16_t length = metrics.encodeSysEx(frame, sizeof(frame));
+ * usbMIDI.sendSysEx(length, frame, true);
+ * @endcode
+ */
+class SolenoidMetrics {
+public:
+    /**
+     * @brief Construct with every counter cleared
+     */
+    SolenoidMetrics();
+
+    /**
+     * @brief Clear every counter
+     *
+     * The board count is kept.
+     */
+    void reset();
+
+    /**
+     * @brief Set how many boards are reported
+     *
+     * @param count Boards in use (clamped to SOLENOID_MAX_BOARDS_PER_BUS)
+     */
+    void setBoardCount(uint8_t count);
+
+    // =========================================================================
+    // RECORDING
+    // =========================================================================
+
+    /**
+     * @brief Count a register write to a board
+     *
+     * @param board Board index
+     * @param dataBytes Data bytes written (register pointer not included)
+     * @param ok true if the board acknowledged the write
+     */
+    void recordWrite(uint8_t board, uint8_t dataBytes, bool ok);
+
+    /**
+     * @brief Count a register read from a board
+     *
+     * @param board Board index
+     * @param dataBytes Data bytes read
+     * @param ok true if the board responded
+     */
+    void recordRead(uint8_t board, uint8_t dataBytes, bool ok);
+
+    /**
+     * @brief Record the time from queueing a board write to its STOP condition
+     *
+     * @param us Latency in microseconds
+     */
+    void recordLatency(uint32_t us);
+
+    /**
+     * @brief Count a rejected operation or fault
+     *
+     * @param error Error reported by the driver (OK is ignored)
+     */
+    void recordError(SolenoidError error);
+
+    /**
+     * @brief Record the cost of one update() pass
+     *
+     * @param cycles Duration in SolenoidTimebase::cycles() counts
+     */
+    void recordUpdate(uint32_t cycles);
+
+    /**
+     * @brief Record the cost of one tick() pass
+     *
+     * @param cycles Duration in SolenoidTimebase::cycles() counts
+     */
+    void recordTick(uint32_t cycles);
+
+    /**
+     * @brief Raise the queue high-water marks
+     *
+     * @param scheduled Events in the scheduler
+     * @param frames Frames in the transmit ring
+     * @param commands Calls in the command ring
+     * @param errors Records in the error ring
+     */
+    void recordDepths(uint8_t scheduled, uint8_t frames, uint8_t commands, uint8_t errors);
+
+    // =========================================================================
+    // RESULTS
+    // =========================================================================
+
+    /**
+     * @brief Get the number of boards reported
+     */
+    uint8_t getBoardCount() const;
+
+    /**
+     * @brief Get the traffic of one board
+     *
+     * @param board Board index (0 to SOLENOID_MAX_BOARDS_PER_BUS - 1)
+     */
+    const SolenoidBoardMetrics& getBoard(uint8_t board) const;
+
+    /**
+     * @brief Get the board write latency (us)
+     */
+    const SolenoidMetricStat& getLatency() const;
+
+    /**
+     * @brief Get the cost of update() (cycles)
+     */
+    const SolenoidMetricStat& getUpdateCost() const;
+
+    /**
+     * @brief Get the cost of tick() (cycles)
+     */
+    const SolenoidMetricStat& getTickCost() const;
+
+    /**
+     * @brief Get how often an error was reported
+     *
+     * @param error Error code
+     * @return Count since the last reset
+     */
+    uint32_t getErrorCount(SolenoidError error) const;
+
+    /**
+     * @brief Get the most events the scheduler has held
+     */
+    uint8_t getSchedulerHighWater() const;
+
+    /**
+     * @brief Get the most frames the transmit ring has held
+     */
+    uint8_t getTxQueueHighWater() const;
+
+    /**
+     * @brief Get the most calls the command ring has held
+     */
+    uint8_t getCommandQueueHighWater() const;
+
+    /**
+     * @brief Get the most records the error ring has held
+     */
+    uint8_t getErrorQueueHighWater() const;
+
+    // =========================================================================
+    // EXPORT
+    // =========================================================================
+
+    /**
+     * @brief Pack the counters into a SysEx frame
+     *
+     * @param buffer Output buffer
+     * @param size Buffer size (SOLENOID_METRICS_SYSEX_MAX always fits)
+     * @return Frame length, or 0 if the buffer is too small
+     *
+     * Frame: F0 7D 'M' version, the payload packed 7-in-8 (a byte holding
+     * bit 7 of the next seven bytes, bit 0 first, then those bytes with
+     * bit 7 cleared), F7. The payload is little-endian:
+     *
+     * | Field                                   | Size             |
+     * |-----------------------------------------|------------------|
+     * | nowMs()                                 | 4                |
+     * | Board count B, error code count E       | 1 + 1            |
+     * | Per board: transactions, bytes, failures| 12 x B           |
+     * | Latency us: count, min, mean, max       | 16               |
+     * | update() cycles: count, min, mean, max  | 16               |
+     * | tick() cycles: count, min, mean, max    | 16               |
+     * | Cycles per us                           | 4                |
+     * | Errors by code 0 to E - 2, then UNKNOWN | 4 x E            |
+     * | High water: scheduler, tx, cmd, error   | 4                |
+     */
+    uint16_t encodeSysEx(uint8_t* buffer, uint16_t size) const;
+
+    /**
+     * @brief Print the counters as text
+     *
+     * @param out Stream to print to (e.g. Serial)
+     */
+    void printTo(Print& out) const;
+
+private:
+    SolenoidBoardMetrics _boards[SOLENOID_MAX_BOARDS_PER_BUS];    ///< Traffic per board
+    SolenoidMetricStat _latency;                                  ///< Write latency (us)
+    SolenoidMetricStat _updateCost;                               ///< update() cost (cycles)
+    SolenoidMetricStat _tickCost;                                 ///< tick() cost (cycles)
+    uint32_t _errors[SOLENOID_METRICS_ERROR_CODES];               ///< Reports by error code
+    uint8_t _boardCount;                                          ///< Boards reported
+    uint8_t _schedulerHighWater;                                  ///< Most scheduled events
+    uint8_t _txHighWater;                                         ///< Most frames in flight
+    uint8_t _commandHighWater;                                    ///< Most queued calls
+    uint8_t _errorHighWater;                                      ///< Most queued error records
+
+    /**
+     * @brief Map an error to its counter
+     *
+     * @return Index into _errors (the last one for UNKNOWN and unlisted codes)
+     */
+    static uint8_t errorIndex(SolenoidError error);
+
+    /**
+     * @brief Print one stat line: count, min, mean, max and unit
+     */
+    static void printStat(Print& out, const char* label, const SolenoidMetricStat& stat, const char* unit);
+};
+
+#endif // SOLENOID_METRICS_H
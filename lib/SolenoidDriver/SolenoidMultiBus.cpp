@@ -0,0 +1,273 @@
+/**
+ * @file SolenoidMultiBus.cpp
+ * @brief Implementation of SolenoidMultiBus class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidMultiBus.h"
+
+SolenoidMultiBus::SolenoidMultiBus()
+    : _busCount(0)
+    , _boardCount(0)
+    , _channelCount(0)
+    , _boardShift(3)
+    , _initialized(false)
+    , _config()
+    , _lastError(SolenoidError::OK)
+{
+}
+
+bool SolenoidMultiBus::begin(TwoWire* const buses[], uint8_t busCount, const uint8_t addresses[], uint8_t boardCount) {
+    _initialized = false;
+    _busCount = 0;
+    _boardCount = 0;
+    _channelCount = 0;
+
+    if (busCount == 0 || busCount > SOLENOID_MAX_BUSES || boardCount == 0) {
+        _lastError = SolenoidError::INVALID_BOARD;
+        return false;
+    }
+
+    // Every bus must fit its share of boards
+    uint8_t boardsOnFirstBus = (boardCount + busCount - 1) / busCount;
+    if (boardsOnFirstBus > SOLENOID_MAX_BOARDS_PER_BUS) {
+        _lastError = SolenoidError::INVALID_BOARD;
+        return false;
+    }
+
+    // Need at least one board per bus, otherwise a bus would be idle
+    if (boardCount < busCount) {
+        busCount = boardCount;
+    }
+
+    for (uint8_t bus = 0; bus < busCount; bus++) {
+        if (buses[bus] == nullptr) {
+            _lastError = SolenoidError::INVALID_BOARD;
+            return false;
+        }
+
+        // Collect the round-robin share of addresses for this bus
+        uint8_t busAddresses[SOLENOID_MAX_BOARDS_PER_BUS];
+        uint8_t count = 0;
+        for (uint8_t board = bus; board < boardCount; board += busCount) {
+            busAddresses[count++] = addresses[board];
+        }
+
+        _drivers[bus].setConfig(_config);
+        if (!_drivers[bus].begin(*buses[bus], busAddresses, count)) {
+            _lastError = _drivers[bus].getLastError();
+            return false;
+        }
+    }
+
+    _busCount = busCount;
+    _boardCount = boardCount;
+    _boardShift = (_drivers[0].getChannelsPerBoard() == SOLENOID_MAX_CHANNELS_PER_BOARD) ? 4 : 3;
+    _channelCount = static_cast<uint16_t>(boardCount) << _boardShift;
+    _initialized = true;
+    _lastError = SolenoidError::OK;
+    return true;
+}
+
+void SolenoidMultiBus::setConfig(const SolenoidConfig& config) {
+    _config = config;
+    for (uint8_t bus = 0; bus < SOLENOID_MAX_BUSES; bus++) {
+        _drivers[bus].setConfig(config);
+    }
+}
+
+SolenoidConfig SolenoidMultiBus::getConfig() const {
+    return _config;
+}
+
+// =============================================================================
+// CHANNEL CONTROL
+// =============================================================================
+
+SolenoidError SolenoidMultiBus::on(uint16_t channel) {
+    uint8_t bus, local;
+    if (!route(channel, bus, local)) {
+        return _lastError;
+    }
+    _lastError = _drivers[bus].on(local);
+    return _lastError;
+}
+
+SolenoidError SolenoidMultiBus::on(uint16_t channel, uint8_t velocity) {
+    uint8_t bus, local;
+    if (!route(channel, bus, local)) {
+        return _lastError;
+    }
+    _lastError = _drivers[bus].on(local, velocity);
+    return _lastError;
+}
+
+SolenoidError SolenoidMultiBus::off(uint16_t channel) {
+    uint8_t bus, local;
+    if (!route(channel, bus, local)) {
+        return _lastError;
+    }
+    _lastError = _drivers[bus].off(local);
+    return _lastError;
+}
+
+SolenoidError SolenoidMultiBus::set(uint16_t channel, bool state) {
+    return state ? on(channel) : off(channel);
+}
+
+SolenoidError SolenoidMultiBus::pulse(uint16_t channel, uint32_t durationMs) {
+    uint8_t bus, local;
+    if (!route(channel, bus, local)) {
+        return _lastError;
+    }
+    _lastError = _drivers[bus].pulse(local, durationMs);
+    return _lastError;
+}
+
+SolenoidError SolenoidMultiBus::scheduleNoteOn(uint16_t channel, uint8_t velocity, uint32_t strikeUs) {
+    uint8_t bus, local;
+    if (!route(channel, bus, local)) {
+        return _lastError;
+    }
+    _lastError = _drivers[bus].scheduleNoteOn(local, velocity, strikeUs);
+    return _lastError;
+}
+
+SolenoidError SolenoidMultiBus::scheduleNoteOff(uint16_t channel, uint32_t releaseUs) {
+    uint8_t bus, local;
+    if (!route(channel, bus, local)) {
+        return _lastError;
+    }
+    _lastError = _drivers[bus].scheduleNoteOff(local, releaseUs);
+    return _lastError;
+}
+
+void SolenoidMultiBus::cancelScheduledNotes() {
+    for (uint8_t bus = 0; bus < _busCount; bus++) {
+        _drivers[bus].cancelScheduledNotes();
+    }
+}
+
+SolenoidError SolenoidMultiBus::allOff() {
+    SolenoidError firstError = SolenoidError::OK;
+
+    // Keep going on error - every bus must get the chance to turn off
+    for (uint8_t bus = 0; bus < _busCount; bus++) {
+        SolenoidError err = _drivers[bus].allOff();
+        if (err != SolenoidError::OK && firstError == SolenoidError::OK) {
+            firstError = err;
+        }
+    }
+
+    _lastError = firstError;
+    return _lastError;
+}
+
+void SolenoidMultiBus::emergencyStop() {
+    for (uint8_t bus = 0; bus < _busCount; bus++) {
+        _drivers[bus].emergencyStop();
+    }
+}
+
+// =============================================================================
+// TRANSACTIONS AND MAINTENANCE
+// =============================================================================
+
+void SolenoidMultiBus::beginTransaction() {
+    for (uint8_t bus = 0; bus < _busCount; bus++) {
+        _drivers[bus].beginTransaction();
+    }
+}
+
+SolenoidError SolenoidMultiBus::commit() {
+    SolenoidError firstError = SolenoidError::OK;
+
+    for (uint8_t bus = 0; bus < _busCount; bus++) {
+        SolenoidError err = _drivers[bus].commit();
+        if (err != SolenoidError::OK && firstError == SolenoidError::OK) {
+            firstError = err;
+        }
+    }
+
+    if (firstError != SolenoidError::OK) {
+        _lastError = firstError;
+    }
+    return firstError;
+}
+
+void SolenoidMultiBus::update() {
+    for (uint8_t bus = 0; bus < _busCount; bus++) {
+        _drivers[bus].update();
+    }
+}
+
+// =============================================================================
+// QUERIES
+// =============================================================================
+
+bool SolenoidMultiBus::isOn(uint16_t channel) const {
+    uint8_t bus, local;
+    if (!route(channel, bus, local)) {
+        return false;
+    }
+    return _drivers[bus].isOn(local);
+}
+
+bool SolenoidMultiBus::isInitialized() const {
+    return _initialized;
+}
+
+SolenoidError SolenoidMultiBus::getLastError() const {
+    return _lastError;
+}
+
+uint8_t SolenoidMultiBus::getBusCount() const {
+    return _busCount;
+}
+
+uint8_t SolenoidMultiBus::getBoardCount() const {
+    return _boardCount;
+}
+
+uint16_t SolenoidMultiBus::getChannelCount() const {
+    return _channelCount;
+}
+
+SolenoidDriver* SolenoidMultiBus::getDriver(uint8_t bus) {
+    if (bus >= _busCount) {
+        return nullptr;
+    }
+    return &_drivers[bus];
+}
+
+// =============================================================================
+// PRIVATE METHODS
+// =============================================================================
+
+bool SolenoidMultiBus::route(uint16_t channel, uint8_t& bus, uint8_t& localChannel) {
+    if (!_initialized) {
+        _lastError = SolenoidError::NOT_INITIALIZED;
+        return false;
+    }
+    if (!static_cast<const SolenoidMultiBus*>(this)->route(channel, bus, localChannel)) {
+        _lastError = SolenoidError::INVALID_CHANNEL;
+        return false;
+    }
+    return true;
+}
+
+bool SolenoidMultiBus::route(uint16_t channel, uint8_t& bus, uint8_t& localChannel) const {
+    if (!_initialized || channel >= _channelCount) {
+        return false;
+    }
+
+    uint8_t board = channel >> _boardShift;
+    uint8_t pin = channel & ((1U << _boardShift) - 1);
+
+    // Round-robin placement: logical board N is board (N / busCount) on bus (N % busCount)
+    bus = board % _busCount;
+    localChannel = static_cast<uint8_t>(((board / _busCount) << _boardShift) | pin);
+    return true;
+}
@@ -0,0 +1,314 @@
+/**
+ * @file SolenoidMultiBus.h
+ * @brief Front end that shards solenoid boards across several I2C buses
+ *
+ * The Teensy 4.1 has three hardware I2C controllers (Wire, Wire1, Wire2).
+ * SolenoidMultiBus owns one SolenoidDriver per bus and presents all boards
+ * as a single contiguous channel space, so a large keyboard is not limited
+ * by the bandwidth of a single 400 kHz bus.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_MULTI_BUS_H
+#define SOLENOID_MULTI_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "SolenoidConfig.h"
+#include "SolenoidDriver.h"
+
+/**
+ * @class SolenoidMultiBus
+ * @brief Drives boards on up to SOLENOID_MAX_BUSES I2C buses as one instrument
+ *
+ * Boards are assigned round-robin: logical board N lives on bus
+ * (N % busCount). Channels on a board stay together, but neighbouring boards
+ * (e.g. adjacent octaves) land on different buses, so a fast passage spreads
+ * its traffic across all controllers.
+ *
+ * Global channel numbering is the same as for a single SolenoidDriver:
+ * channel = (logicalBoard * channelsPerBoard) + localChannel.
+ *
+ * Each bus has its own driver, safety tracking and scheduler. commit() and
+ * update() visit every bus in turn. With SolenoidConfig::asyncTransmit
+ * enabled, commit() only queues each bus's frames, so all LPI2C controllers
+ * clock their boards out at the same time and note-to-strike latency stays
+ * flat as buses are added. With the blocking transport the per-bus flushes
+ * run back-to-back.
+ *
+ * Example usage:
+ * @code
+ * SolenoidMultiBus piano;
+ *
+ * void setup() {
+ *     Wire.begin();
+ *     Wire1.begin();
+ *     TwoWire* buses[] = { &Wire, &Wire1 };
+ *     uint8_t addresses[] = { 0x20, 0x20, 0x21, 0x21 };  // 4 boards, 2 per bus
+ *     piano.begin(buses, 2, addresses, 4);
+ * }
+ *
+ * void loop() {
+ *     piano.beginTransaction();
+ *     while (usbMIDI.read()) { }   // handlers call piano.on()/off()
+ *     piano.commit();
+ *     piano.update();
+ * }
+ * @endcode
+ *
+ * Thread Safety:
+ * This class is NOT thread-safe, for the same reasons as SolenoidDriver.
+ */
+class SolenoidMultiBus {
+public:
+    /**
+     * @brief Construct a new SolenoidMultiBus object
+     *
+     * Does not initialize hardware - call begin() to initialize.
+     */
+    SolenoidMultiBus();
+
+    /**
+     * @brief Initialize boards across several I2C buses
+     *
+     * @param buses Array of TwoWire pointers (e.g. &Wire, &Wire1, &Wire2)
+     * @param busCount Number of buses (1 to SOLENOID_MAX_BUSES)
+     * @param addresses I2C address of each logical board, in channel order
+     * @param boardCount Number of logical boards
+     * @return true if every bus initialized successfully
+     * @return false on failure (check getLastError())
+     *
+     * Logical board N is placed on buses[N % busCount]. Addresses only need
+     * to be unique within a bus. Each bus may hold at most
+     * SOLENOID_MAX_BOARDS_PER_BUS boards.
+     */
+    bool begin(TwoWire* const buses[], uint8_t busCount, const uint8_t addresses[], uint8_t boardCount);
+
+    /**
+     * @brief Apply a configuration to every bus
+     *
+     * @param config Configuration structure
+     *
+     * Call before begin() to set channelsPerBoard, which must be identical
+     * on all buses.
+     */
+    void setConfig(const SolenoidConfig& config);
+
+    /**
+     * @brief Get current configuration
+     *
+     * @return Copy of current configuration structure
+     */
+    SolenoidConfig getConfig() const;
+
+    // =========================================================================
+    // CHANNEL CONTROL
+    // =========================================================================
+
+    /**
+     * @brief Turn on a channel
+     *
+     * @param channel Global channel index (0 to channelCount-1)
+     * @return SolenoidError::OK on success, error code on failure
+     *
+     * Same semantics and safety checks as SolenoidDriver::on().
+     */
+    SolenoidError on(uint16_t channel);
+
+    /**
+     * @brief Strike a channel with a MIDI velocity
+     *
+     * @param channel Channel index (0 to channelCount-1)
+     * @param velocity MIDI velocity (1-127; 0 turns the channel off)
+     * @return SolenoidError::OK on success, error code on failure
+     *
+     * See SolenoidDriver::on(channel, velocity). Velocity curves are set
+     * per bus through getDriver(bus)->getVelocityMap().
+     */
+    SolenoidError on(uint16_t channel, uint8_t velocity);
+
+    /**
+     * @brief Turn off a channel
+     *
+     * @param channel Global channel index
+     * @return SolenoidError::OK on success, error code on failure
+     */
+    SolenoidError off(uint16_t channel);
+
+    /**
+     * @brief Set channel to specific state
+     *
+     * @param channel Global channel index
+     * @param state true=on, false=off
+     * @return SolenoidError::OK on success, error code on failure
+     */
+    SolenoidError set(uint16_t channel, bool state);
+
+    /**
+     * @brief Pulse a channel (non-blocking)
+     *
+     * @param channel Global channel index
+     * @param durationMs Pulse duration in milliseconds
+     * @return SolenoidError::OK on success, error code on failure
+     *
+     * See SolenoidDriver::pulse().
+     */
+    SolenoidError pulse(uint16_t channel, uint32_t durationMs);
+
+    /**
+     * @brief Queue a note to sound at a future time
+     *
+     * @param channel Channel index (0 to channelCount-1)
+     * @param velocity MIDI velocity (1-127; 0 queues a note-off instead)
+     * @param strikeUs micros() time at which the note should sound
+     * @return SolenoidError::OK if queued, error code on failure
+     *
+     * See SolenoidDriver::scheduleNoteOn().
+     */
+    SolenoidError scheduleNoteOn(uint16_t channel, uint8_t velocity, uint32_t strikeUs);
+
+    /**
+     * @brief Queue a note release at a future time
+     *
+     * @param channel Channel index (0 to channelCount-1)
+     * @param releaseUs micros() time at which the note should end
+     * @return SolenoidError::OK if queued, error code on failure
+     *
+     * See SolenoidDriver::scheduleNoteOff().
+     */
+    SolenoidError scheduleNoteOff(uint16_t channel, uint32_t releaseUs);
+
+    /**
+     * @brief Drop all queued sequenced notes on all buses
+     */
+    void cancelScheduledNotes();
+
+    /**
+     * @brief Turn off all channels on all buses
+     *
+     * @return SolenoidError::OK on success, or the first error encountered
+     */
+    SolenoidError allOff();
+
+    /**
+     * @brief Immediately turn off all channels on all buses
+     *
+     * See SolenoidDriver::emergencyStop().
+     */
+    void emergencyStop();
+
+    // =========================================================================
+    // TRANSACTIONS AND MAINTENANCE
+    // =========================================================================
+
+    /**
+     * @brief Start staging changes on every bus
+     *
+     * See SolenoidDriver::beginTransaction().
+     */
+    void beginTransaction();
+
+    /**
+     * @brief Write all staged changes on every bus
+     *
+     * @return SolenoidError::OK on success, or the first bus error
+     *
+     * Every bus is flushed even if an earlier one reports an error.
+     */
+    SolenoidError commit();
+
+    /**
+     * @brief Update function - MUST be called regularly
+     *
+     * Calls SolenoidDriver::update() on every bus.
+     */
+    void update();
+
+    // =========================================================================
+    // QUERIES
+    // =========================================================================
+
+    /**
+     * @brief Check if a channel is currently on
+     *
+     * @param channel Global channel index
+     * @return true if channel is on, false if off or invalid
+     */
+    bool isOn(uint16_t channel) const;
+
+    /**
+     * @brief Check if all buses are initialized and ready
+     *
+     * @return true if begin() succeeded
+     */
+    bool isInitialized() const;
+
+    /**
+     * @brief Get the last error that occurred
+     *
+     * @return Last error code
+     */
+    SolenoidError getLastError() const;
+
+    /**
+     * @brief Get number of buses in use
+     *
+     * @return Bus count (0 to SOLENOID_MAX_BUSES)
+     */
+    uint8_t getBusCount() const;
+
+    /**
+     * @brief Get total number of logical boards across all buses
+     *
+     * @return Board count
+     */
+    uint8_t getBoardCount() const;
+
+    /**
+     * @brief Get total number of channels across all buses
+     *
+     * @return Channel count (boards * channels per board)
+     */
+    uint16_t getChannelCount() const;
+
+    /**
+     * @brief Access the driver for one bus
+     *
+     * @param bus Bus index (0 to busCount-1)
+     * @return Pointer to the driver, or nullptr if invalid
+     *
+     * Useful for per-bus diagnostics (board states, channel statistics).
+     * Channel indices on the returned driver are bus-local.
+     */
+    SolenoidDriver* getDriver(uint8_t bus);
+
+private:
+    SolenoidDriver _drivers[SOLENOID_MAX_BUSES];   ///< One driver per bus
+    uint8_t _busCount;                             ///< Number of buses in use
+    uint8_t _boardCount;                           ///< Logical boards across all buses
+    uint16_t _channelCount;                        ///< Total channels
+    uint8_t _boardShift;                           ///< log2(channels per board)
+    bool _initialized;                             ///< Initialization status
+    SolenoidConfig _config;                        ///< Configuration shared by all buses
+    SolenoidError _lastError;                      ///< Last error code
+
+    /**
+     * @brief Map a global channel to a bus and bus-local channel
+     *
+     * @param channel Global channel index
+     * @param bus Output: bus index
+     * @param localChannel Output: channel index on that bus's driver
+     * @return true if valid, false otherwise (sets _lastError)
+     */
+    bool route(uint16_t channel, uint8_t& bus, uint8_t& localChannel);
+
+    /**
+     * @brief Const variant of route() that does not record errors
+     */
+    bool route(uint16_t channel, uint8_t& bus, uint8_t& localChannel) const;
+};
+
+#endif // SOLENOID_MULTI_BUS_H
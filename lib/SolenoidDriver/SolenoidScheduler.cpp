@@ -0,0 +1,170 @@
+/**
+ * @file SolenoidScheduler.cpp
+ * @brief Implementation of SolenoidScheduler class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidScheduler.h"
+
+SolenoidScheduler::SolenoidScheduler()
+    : _size(0)
+    , _nextSequence(0)
+{
+}
+
+bool SolenoidScheduler::push(const SolenoidEvent& event) {
+    if (_size >= SOLENOID_SCHEDULER_CAPACITY) {
+        return false;
+    }
+
+    _heap[_size].event = event;
+    _heap[_size].sequence = _nextSequence++;
+    siftUp(_size);
+    _size++;
+    return true;
+}
+
+bool SolenoidScheduler::popDue(uint32_t nowUs, SolenoidEvent& event) {
+    if (_size == 0) {
+        return false;
+    }
+
+    // Root is the earliest event - not due yet means nothing is due
+    if (static_cast<int32_t>(nowUs - _heap[0].event.dueUs) < 0) {
+        return false;
+    }
+
+    event = _heap[0].event;
+    _size--;
+    if (_size > 0) {
+        _heap[0] = _heap[_size];
+        siftDown(0);
+    }
+    return true;
+}
+
+uint8_t SolenoidScheduler::cancel(uint8_t channel, uint8_t actionMask) {
+    uint8_t removed = 0;
+    uint8_t i = 0;
+
+    // Compact the array, then rebuild the heap if anything was removed
+    for (uint8_t j = 0; j < _size; j++) {
+        bool channelMatch = (channel == SOLENOID_ANY_CHANNEL) || (_heap[j].event.channel == channel);
+        if (channelMatch && (solenoidActionBit(_heap[j].event.action) & actionMask) != 0) {
+            removed++;
+        } else {
+            _heap[i++] = _heap[j];
+        }
+    }
+
+    if (removed > 0) {
+        _size = i;
+        for (int16_t k = (_size / 2) - 1; k >= 0; k--) {
+            siftDown(static_cast<uint8_t>(k));
+        }
+    }
+
+    return removed;
+}
+
+bool SolenoidScheduler::shedWeakestStrike(uint8_t priority, SolenoidEvent& event) {
+    uint8_t weakest = _size;
+
+    for (uint8_t i = 0; i < _size; i++) {
+        const SolenoidEvent& candidate = _heap[i].event;
+        if (!isStrike(candidate.action) || strikePriority(candidate) > priority) {
+            continue;
+        }
+        if (weakest == _size ||
+            strikePriority(candidate) < strikePriority(_heap[weakest].event) ||
+            (strikePriority(candidate) == strikePriority(_heap[weakest].event) &&
+             isEarlier(_heap[i], _heap[weakest]))) {
+            weakest = i;
+        }
+    }
+
+    if (weakest == _size) {
+        return false;
+    }
+
+    event = _heap[weakest].event;
+    removeAt(weakest);
+    return true;
+}
+
+void SolenoidScheduler::clear() {
+    _size = 0;
+}
+
+uint8_t SolenoidScheduler::size() const {
+    return _size;
+}
+
+bool SolenoidScheduler::isFull() const {
+    return _size >= SOLENOID_SCHEDULER_CAPACITY;
+}
+
+bool SolenoidScheduler::isEarlier(const Entry& a, const Entry& b) {
+    int32_t diff = static_cast<int32_t>(a.event.dueUs - b.event.dueUs);
+    if (diff != 0) {
+        return diff < 0;
+    }
+    // Same due time: the order they were pushed in (wrap-safe as well)
+    return static_cast<int32_t>(a.sequence - b.sequence) < 0;
+}
+
+bool SolenoidScheduler::isStrike(SolenoidAction action) {
+    return action == SolenoidAction::NOTE_ON || action == SolenoidAction::DEFERRED_ON;
+}
+
+uint8_t SolenoidScheduler::strikePriority(const SolenoidEvent& event) {
+    return (event.velocity == 0) ? 128 : event.velocity;
+}
+
+void SolenoidScheduler::removeAt(uint8_t index) {
+    _size--;
+    if (index < _size) {
+        // Moved-in last element can belong either above or below this slot
+        _heap[index] = _heap[_size];
+        siftDown(index);
+        siftUp(index);
+    }
+}
+
+void SolenoidScheduler::siftUp(uint8_t index) {
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!isEarlier(_heap[index], _heap[parent])) {
+            break;
+        }
+        Entry tmp = _heap[index];
+        _heap[index] = _heap[parent];
+        _heap[parent] = tmp;
+        index = parent;
+    }
+}
+
+void SolenoidScheduler::siftDown(uint8_t index) {
+    while (true) {
+        uint16_t left = (2 * index) + 1;
+        uint16_t right = left + 1;
+        uint8_t smallest = index;
+
+        if (left < _size && isEarlier(_heap[left], _heap[smallest])) {
+            smallest = left;
+        }
+        if (right < _size && isEarlier(_heap[right], _heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+
+        Entry tmp = _heap[index];
+        _heap[index] = _heap[smallest];
+        _heap[smallest] = tmp;
+        index = smallest;
+    }
+}
@@ -0,0 +1,227 @@
+/**
+ * @file SolenoidScheduler.h
+ * @brief Timed event queue for non-blocking solenoid operations
+ *
+ * This class holds future channel actions (such as the off-edge of a pulse)
+ * in a fixed-capacity binary min-heap ordered by due time. It is used
+ * internally by SolenoidDriver, which fires due events from update().
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_SCHEDULER_H
+#define SOLENOID_SCHEDULER_H
+
+#include <stdint.h>
+
+#include "SolenoidConfig.h"
+
+/**
+ * @enum SolenoidAction
+ * @brief Action performed when a scheduled event fires
+ */
+enum class SolenoidAction : uint8_t {
+    /** Turn the channel off (e.g. end of a pulse) */
+    OFF = 0,
+
+    /** Hold phase: de-energize the coil (channel stays logically on) */
+    HOLD_OFF = 1,
+
+    /** Hold phase: re-energize the coil */
+    HOLD_ON = 2,
+
+    /** Sequenced note start (strike with SolenoidEvent::velocity) */
+    NOTE_ON = 3,
+
+    /** Sequenced note end */
+    NOTE_OFF = 4,
+
+    /**
+     * Strike delayed by the driver (power budget or retrigger cooldown):
+     * on(channel, velocity), or on() at full power if velocity is 0
+     */
+    DEFERRED_ON = 5
+};
+
+/**
+ * @brief Bit for an action in a cancel() mask
+ *
+ * @param action Action
+ * @return Mask with only that action's bit set
+ */
+constexpr uint8_t solenoidActionBit(SolenoidAction action) {
+    return static_cast<uint8_t>(1U << static_cast<uint8_t>(action));
+}
+
+/** Edges that belong to the current note (pulse end, hold PWM) */
+constexpr uint8_t SOLENOID_NOTE_EDGE_ACTIONS =
+    solenoidActionBit(SolenoidAction::OFF) |
+    solenoidActionBit(SolenoidAction::HOLD_OFF) |
+    solenoidActionBit(SolenoidAction::HOLD_ON);
+
+/** Future notes queued by the sequencer interface */
+constexpr uint8_t SOLENOID_SEQUENCED_ACTIONS =
+    solenoidActionBit(SolenoidAction::NOTE_ON) |
+    solenoidActionBit(SolenoidAction::NOTE_OFF);
+
+/** Channel value matching every channel in cancel() */
+constexpr uint8_t SOLENOID_ANY_CHANNEL = 255;
+
+/**
+ * @struct SolenoidEvent
+ * @brief A single scheduled channel action
+ */
+struct SolenoidEvent {
+    uint32_t dueUs;          ///< SolenoidTimebase::nowUs32() time at which the event fires
+    uint8_t channel;         ///< Global channel index
+    SolenoidAction action;   ///< What to do when the event fires
+    uint8_t velocity;        ///< NOTE_ON/DEFERRED_ON velocity (unused by other actions)
+};
+
+/**
+ * @class SolenoidScheduler
+ * @brief Fixed-capacity min-heap of scheduled solenoid events
+ *
+ * Push and pop are O(log n); checking whether anything is due is O(1).
+ * No dynamic allocation is performed - capacity is fixed by
+ * SOLENOID_SCHEDULER_CAPACITY.
+ *
+ * Due times are compared using signed 32-bit differences, so ordering is
+ * correct across micros() overflow (wraps every ~71.6 minutes) as long as
+ * events are scheduled less than ~35 minutes ahead. Events due at the same
+ * time come out in the order they were pushed, so a zero-length note (on
+ * and off on one tick) is struck before it is released, and a note ending
+ * and the same key restriking at one timestamp are played as queued.
+ *
+ * Example usage (internal to SolenoidDriver):
+ * @code
+ * SolenoidScheduler scheduler;
+ * scheduler.push({ micros() + 20000, 3, SolenoidAction::OFF, 0 });
+ *
+ * SolenoidEvent event;
+ * while (scheduler.popDue(micros(), event)) {
+ *     // Fire event
+ * }
+ * @endcode
+ */
+class SolenoidScheduler {
+public:
+    /**
+     * @brief Construct an empty scheduler
+     */
+    SolenoidScheduler();
+
+    /**
+     * @brief Add an event to the queue
+     *
+     * @param event Event to schedule
+     * @return true if queued, false if the queue is full
+     */
+    bool push(const SolenoidEvent& event);
+
+    /**
+     * @brief Remove the earliest event if it is due
+     *
+     * @param nowUs Current time from micros()
+     * @param event Output: the event that was removed
+     * @return true if an event was due and removed, false otherwise
+     */
+    bool popDue(uint32_t nowUs, SolenoidEvent& event);
+
+    /**
+     * @brief Remove pending events for a channel
+     *
+     * @param channel Global channel index, or SOLENOID_ANY_CHANNEL
+     * @param actionMask Actions to remove (solenoidActionBit() values ORed)
+     * @return Number of events removed
+     */
+    uint8_t cancel(uint8_t channel, uint8_t actionMask = 0xFF);
+
+    /**
+     * @brief Remove the weakest pending strike to make room for a stronger one
+     *
+     * Strikes (NOTE_ON, DEFERRED_ON) are ranked by velocity, a velocity 0
+     * full-power strike ranking above 127. Of equal strikes the earliest is
+     * shed, since it is the one already furthest behind the music.
+     *
+     * @param priority Rank of the incoming event (velocity, or 255 to shed any strike)
+     * @param event Output: the strike that was removed
+     * @return true if a strike ranked at or below priority was removed
+     */
+    bool shedWeakestStrike(uint8_t priority, SolenoidEvent& event);
+
+    /**
+     * @brief Remove all pending events
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of pending events
+     *
+     * @return Event count (0 to SOLENOID_SCHEDULER_CAPACITY)
+     */
+    uint8_t size() const;
+
+    /**
+     * @brief Check if the queue is full
+     *
+     * @return true if no more events can be pushed
+     */
+    bool isFull() const;
+
+private:
+    /** A queued event and when it was pushed */
+    struct Entry {
+        SolenoidEvent event;    ///< The scheduled action
+        uint32_t sequence;      ///< Push count when queued (ties between equal due times)
+    };
+
+    Entry _heap[SOLENOID_SCHEDULER_CAPACITY];   ///< Binary min-heap storage
+    uint8_t _size;                              ///< Number of events in heap
+    uint32_t _nextSequence;                     ///< Sequence number of the next push
+
+    /**
+     * @brief Wrap-safe ordering of two events by due time, then push order
+     *
+     * @return true if a is due before b
+     */
+    static bool isEarlier(const Entry& a, const Entry& b);
+
+    /**
+     * @brief Check if an action starts a note
+     *
+     * @return true for NOTE_ON and DEFERRED_ON
+     */
+    static bool isStrike(SolenoidAction action);
+
+    /**
+     * @brief Rank of a strike for shedWeakestStrike()
+     *
+     * @return Velocity, or 128 for a full-power (velocity 0) strike
+     */
+    static uint8_t strikePriority(const SolenoidEvent& event);
+
+    /**
+     * @brief Remove the element at a heap index and restore heap order
+     *
+     * @param index Heap index (must be < size)
+     */
+    void removeAt(uint8_t index);
+
+    /**
+     * @brief Restore heap order by moving an element towards the root
+     *
+     * @param index Heap index of the element
+     */
+    void siftUp(uint8_t index);
+
+    /**
+     * @brief Restore heap order by moving an element towards the leaves
+     *
+     * @param index Heap index of the element
+     */
+    void siftDown(uint8_t index);
+};
+
+#endif // SOLENOID_SCHEDULER_H
@@ -0,0 +1,148 @@
+/**
+ * @file SolenoidTimebase.cpp
+ * @brief Implementation of SolenoidTimebase class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidTimebase.h"
+
+SolenoidTimebaseSource SolenoidTimebase::s_source = SolenoidTimebaseSource::MICROS;
+uint32_t SolenoidTimebase::s_lastRaw = 0;
+uint32_t SolenoidTimebase::s_remainder = 0;
+uint64_t SolenoidTimebase::s_totalUs = 0;
+bool SolenoidTimebase::s_started = false;
+
+#if defined(__IMXRT1062__)
+
+/** Disable interrupts, returning the previous PRIMASK */
+static inline uint32_t irqSave() {
+    uint32_t primask;
+    __asm__ volatile("mrs %0, primask\n\tcpsid i" : "=r"(primask) :: "memory");
+    return primask;
+}
+
+/** Restore PRIMASK saved by irqSave() */
+static inline void irqRestore(uint32_t primask) {
+    __asm__ volatile("msr primask, %0" :: "r"(primask) : "memory");
+}
+
+#else
+
+static inline uint32_t irqSave() { return 0; }
+static inline void irqRestore(uint32_t) { }
+
+#endif
+
+void SolenoidTimebase::begin(SolenoidTimebaseSource source) {
+#if !defined(__IMXRT1062__)
+    source = SolenoidTimebaseSource::MICROS;
+#endif
+
+    uint32_t primask = irqSave();
+
+    if (!s_started || source != s_source) {
+        // Bring the total up to date on the old source, then continue from
+        // there on the new one
+        if (s_started) {
+            advance();
+        } else {
+            s_totalUs = micros();
+            s_started = true;
+        }
+
+#if defined(__IMXRT1062__)
+        if (source == SolenoidTimebaseSource::CYCLE_COUNTER) {
+            ARM_DEMCR |= ARM_DEMCR_TRCENA;
+            ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+        }
+#endif
+        s_source = source;
+        s_lastRaw = readRaw();
+        s_remainder = 0;
+    }
+
+    irqRestore(primask);
+}
+
+SolenoidTimebaseSource SolenoidTimebase::source() {
+    return s_source;
+}
+
+uint64_t SolenoidTimebase::nowUs() {
+    uint32_t primask = irqSave();
+
+    if (!s_started) {
+        s_totalUs = micros();
+        s_lastRaw = readRaw();
+        s_started = true;
+    } else {
+        advance();
+    }
+    uint64_t now = s_totalUs;
+
+    irqRestore(primask);
+    return now;
+}
+
+uint32_t SolenoidTimebase::nowUs32() {
+    return static_cast<uint32_t>(nowUs());
+}
+
+uint32_t SolenoidTimebase::nowMs() {
+    return static_cast<uint32_t>(nowUs() / 1000);
+}
+
+uint32_t SolenoidTimebase::usToMs(uint64_t us) {
+    uint64_t ms = us / 1000;
+    return (ms > UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(ms);
+}
+
+uint32_t SolenoidTimebase::cycles() {
+#if defined(__IMXRT1062__)
+    return ARM_DWT_CYCCNT;
+#else
+    return micros();
+#endif
+}
+
+uint32_t SolenoidTimebase::cyclesPerUs() {
+#if defined(__IMXRT1062__)
+    return F_CPU_ACTUAL / 1000000;
+#else
+    return 1;
+#endif
+}
+
+uint32_t SolenoidTimebase::readRaw() {
+#if defined(__IMXRT1062__)
+    if (s_source == SolenoidTimebaseSource::CYCLE_COUNTER) {
+        return ARM_DWT_CYCCNT;
+    }
+#endif
+    return micros();
+}
+
+void SolenoidTimebase::advance() {
+    uint32_t raw = readRaw();
+    uint32_t delta = raw - s_lastRaw;   // Correct across one counter wrap
+    s_lastRaw = raw;
+
+#if defined(__IMXRT1062__)
+    if (s_source == SolenoidTimebaseSource::CYCLE_COUNTER) {
+        // Whole microseconds only; carry the leftover cycles to the next read
+        uint32_t perUs = cyclesPerUs();
+        uint32_t us = delta / perUs;
+        uint32_t rem = s_remainder + (delta % perUs);
+        if (rem >= perUs) {
+            us++;
+            rem -= perUs;
+        }
+        s_remainder = rem;
+        s_totalUs += us;
+        return;
+    }
+#endif
+    s_totalUs += delta;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file SolenoidTimebase.h
+ * @brief Microsecond timebase shared by the SolenoidDriver library
+ *
+ * All channel timestamps, timeouts and scheduled events are taken from this
+ * timebase. It returns a 64-bit microsecond count that never wraps in
+ * practice, backed either by micros() or by the ARM DWT cycle counter
+ * (ARM_DWT_CYCCNT, Teensy 4.x). Millisecond helpers are provided for the
+ * parts of the API that are specified in milliseconds.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_TIMEBASE_H
+#define SOLENOID_TIMEBASE_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "SolenoidConfig.h"
+
+/**
+ * @class SolenoidTimebase
+ * @brief Wrap-free microsecond clock with a millisecond facade
+ *
+ * The hardware counter is 32 bits wide and wraps (micros() every ~71.6
+ * minutes, ARM_DWT_CYCCNT every ~7.2 seconds at 600MHz). Each read adds the
+ * counter's progress since the previous read to a 64-bit total, so the
+ * result is monotonic as long as the timebase is read at least once per
+ * counter wrap - SolenoidDriver::update() and tick() take care of that.
+ *
+ * The cycle counter source is aligned with micros() when selected, so
+ * nowUs32() can be compared with micros() values in either mode.
+ *
+ * Reads are safe from interrupts on Teensy 4.x. On other platforms only
+ * read it from one context.
+ *
+ * Example usage:
+ * @code
+ * SolenoidTimebase::begin(SolenoidTimebaseSource::CYCLE_COUNTER);
+ * uint64_t t0 = SolenoidTimebase::nowUs();
+ * // ...
+ * uint32_t elapsedUs = static_cast<uint32_t>(SolenoidTimebase::nowUs() - t0);
+ * @endcode
+ */
+class SolenoidTimebase {
+public:
+    /**
+     * @brief Select the hardware counter
+     *
+     * @param source Counter to use
+     *
+     * The time keeps counting from its current value, so switching sources
+     * never makes the timebase jump. Selecting the current source is a no-op.
+     */
+    static void begin(SolenoidTimebaseSource source);
+
+    /**
+     * @brief Get the counter in use
+     *
+     * @return Active source (MICROS if the cycle counter is unavailable)
+     */
+    static SolenoidTimebaseSource source();
+
+    /**
+     * @brief Get the current time
+     *
+     * @return Microseconds since start-up (64-bit, does not wrap)
+     */
+    static uint64_t nowUs();
+
+    /**
+     * @brief Get the low 32 bits of the current time
+     *
+     * @return Microseconds, wrapping like micros() - compare with signed
+     *         32-bit differences
+     */
+    static uint32_t nowUs32();
+
+    /**
+     * @brief Get the current time in milliseconds
+     *
+     * @return Milliseconds since start-up (wraps like millis())
+     */
+    static uint32_t nowMs();
+
+    /**
+     * @brief Convert a microsecond span to milliseconds
+     *
+     * @param us Span in microseconds
+     * @return Span in milliseconds, saturated at UINT32_MAX
+     */
+    static uint32_t usToMs(uint64_t us);
+
+    /**
+     * @brief Read a free-running counter for short cost measurements
+     *
+     * @return ARM_DWT_CYCCNT on Teensy 4.x, micros() elsewhere (wraps -
+     *         take unsigned differences)
+     *
+     * Independent of the selected source; the cycle counter is enabled by
+     * the Teensy start-up code.
+     */
+    static uint32_t cycles();
+
+    /**
+     * @brief Get the rate of cycles()
+     *
+     * @return Counts per microsecond (1 when cycles() falls back to micros())
+     */
+    static uint32_t cyclesPerUs();
+
+private:
+    /**
+     * @brief Read the raw 32-bit counter of the active source
+     */
+    static uint32_t readRaw();
+
+    /**
+     * @brief Advance the 64-bit total to the current counter value
+     *
+     * Must be called with interrupts disabled (or from a single context).
+     */
+    static void advance();
+
+    static SolenoidTimebaseSource s_source;    ///< Active counter
+    static uint32_t s_lastRaw;                 ///< Counter value at the previous read
+    static uint32_t s_remainder;               ///< Counter ticks not yet turned into a whole us
+    static uint64_t s_totalUs;                 ///< Microseconds up to s_lastRaw
+    static bool s_started;                     ///< s_lastRaw is valid
+};
+
+#endif // SOLENOID_TIMEBASE_H
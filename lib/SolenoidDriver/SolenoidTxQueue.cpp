@@ -0,0 +1,358 @@
+/**
+ * @file SolenoidTxQueue.cpp
+ * @brief Implementation of SolenoidTxQueue class
+ *
+ * The interrupt path drives the i.MX RT1062 LPI2C master directly through
+ * its command FIFO (MTDR). A board frame is at most 5 commands:
+ * START+address, register, data byte(s), STOP. The FIFO holds 4 words, so
+ * the rest of the frame is loaded from the TX-data interrupt.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidTxQueue.h"
+#include "SolenoidTimebase.h"
+
+/** Ring index mask (capacity is a power of two) */
+static constexpr uint8_t TX_MASK = SOLENOID_TX_QUEUE_CAPACITY - 1;
+
+static_assert((SOLENOID_TX_QUEUE_CAPACITY & TX_MASK) == 0,
+              "SOLENOID_TX_QUEUE_CAPACITY must be a power of two");
+
+#if defined(__IMXRT1062__)
+
+/** LPI2C TX FIFO depth on the i.MX RT1062 */
+static constexpr uint8_t LPI2C_TX_FIFO_SIZE = 4;
+
+/** Error flags that end a frame early */
+static constexpr uint32_t LPI2C_ERROR_FLAGS =
+    LPI2C_MSR_NDF | LPI2C_MSR_ALF | LPI2C_MSR_FEF | LPI2C_MSR_PLTF;
+
+/** Interrupts used while a frame is on the wire */
+static constexpr uint32_t LPI2C_FRAME_IRQS =
+    LPI2C_MIER_TDIE | LPI2C_MIER_SDIE | LPI2C_MIER_NDIE |
+    LPI2C_MIER_ALIE | LPI2C_MIER_FEIE | LPI2C_MIER_PLTIE;
+
+/** Queues bound to Wire, Wire1, Wire2 (for the interrupt trampolines) */
+static SolenoidTxQueue* s_queues[3] = { nullptr, nullptr, nullptr };
+
+static void lpi2c1Isr() { if (s_queues[0]) s_queues[0]->isr(); asm volatile("dsb"); }
+static void lpi2c3Isr() { if (s_queues[1]) s_queues[1]->isr(); asm volatile("dsb"); }
+static void lpi2c4Isr() { if (s_queues[2]) s_queues[2]->isr(); asm volatile("dsb"); }
+
+static inline IMXRT_LPI2C_t* lpi2c(void* port) {
+    return static_cast<IMXRT_LPI2C_t*>(port);
+}
+
+#endif
+
+SolenoidTxQueue::SolenoidTxQueue()
+    : _head(0)
+    , _sent(0)
+    , _tail(0)
+    , _active(false)
+    , _frameStatus(0)
+    , _step(0)
+    , _startUs(0)
+    , _bus(nullptr)
+    , _port(nullptr)
+    , _irq(0)
+{
+}
+
+bool SolenoidTxQueue::begin(SolenoidBus& bus) {
+    waitIdle();
+
+    _bus = &bus;
+    _head = 0;
+    _sent = 0;
+    _tail = 0;
+    _active = false;
+    _port = nullptr;
+
+#if defined(__IMXRT1062__)
+    // Wire = LPI2C1, Wire1 = LPI2C3, Wire2 = LPI2C4 on Teensy 4.x
+    TwoWire* wire = bus.getWire();
+    uint8_t slot;
+    void (*vector)();
+    if (wire == &Wire) {
+        _port = &LPI2C1;
+        _irq = IRQ_LPI2C1;
+        slot = 0;
+        vector = lpi2c1Isr;
+    } else if (wire == &Wire1) {
+        _port = &LPI2C3;
+        _irq = IRQ_LPI2C3;
+        slot = 1;
+        vector = lpi2c3Isr;
+    } else if (wire == &Wire2) {
+        _port = &LPI2C4;
+        _irq = IRQ_LPI2C4;
+        slot = 2;
+        vector = lpi2c4Isr;
+    } else {
+        return false;
+    }
+
+    s_queues[slot] = this;
+    lpi2c(_port)->MIER = 0;
+    attachInterruptVector(static_cast<IRQ_NUMBER_t>(_irq), vector);
+    NVIC_ENABLE_IRQ(_irq);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SolenoidTxQueue::push(const SolenoidFrame& frame) {
+    if (isFull()) {
+        return false;
+    }
+
+    SolenoidFrame& slot = _ring[_head & TX_MASK];
+    slot = frame;
+    slot.status = 0;
+    slot.wireUs = 0;
+    _head = _head + 1;
+
+#if defined(__IMXRT1062__)
+    if (_port != nullptr) {
+        // The interrupt also starts frames - keep it out while we check
+        NVIC_DISABLE_IRQ(_irq);
+        startNext();
+        NVIC_ENABLE_IRQ(_irq);
+    }
+#endif
+
+    return true;
+}
+
+bool SolenoidTxQueue::popCompleted(SolenoidFrame& frame) {
+    if (_tail == _sent) {
+        return false;
+    }
+
+    frame = _ring[_tail & TX_MASK];
+    _tail = _tail + 1;
+    return true;
+}
+
+void SolenoidTxQueue::poll() {
+    if (_port == nullptr) {
+        // Synchronous fallback - send everything that is pending
+        while (_sent != _head) {
+            sendBlocking(_ring[_sent & TX_MASK]);
+            _sent = _sent + 1;
+        }
+        return;
+    }
+
+#if defined(__IMXRT1062__)
+    // Watchdog: a frame that never finishes (e.g. SCL held low) is aborted
+    if (_active && (SolenoidTimebase::nowUs32() - _startUs) > SOLENOID_TX_TIMEOUT_US) {
+        NVIC_DISABLE_IRQ(_irq);
+        if (_active) {
+            IMXRT_LPI2C_t* port = lpi2c(_port);
+            port->MIER = 0;
+            port->MCR |= LPI2C_MCR_RTF;
+            _frameStatus = SOLENOID_I2C_TIMEOUT;
+            finishFrame();
+        }
+        NVIC_ENABLE_IRQ(_irq);
+    }
+#endif
+}
+
+void SolenoidTxQueue::abort() {
+#if defined(__IMXRT1062__)
+    if (_port != nullptr) {
+        NVIC_DISABLE_IRQ(_irq);
+        IMXRT_LPI2C_t* port = lpi2c(_port);
+        port->MIER = 0;
+        port->MCR |= LPI2C_MCR_RTF;
+        if (_active) {
+            // End the cut-off frame so the next blocking write finds the bus free
+            port->MTDR = LPI2C_MTDR_CMD_STOP;
+        }
+    }
+#endif
+
+    uint32_t nowUs = SolenoidTimebase::nowUs32();
+    while (_sent != _head) {
+        SolenoidFrame& frame = _ring[_sent & TX_MASK];
+        frame.status = SOLENOID_I2C_OTHER_ERROR;
+        frame.wireUs = nowUs;
+        _sent = _sent + 1;
+    }
+    _active = false;
+    _frameStatus = 0;
+
+#if defined(__IMXRT1062__)
+    if (_port != nullptr) {
+        NVIC_ENABLE_IRQ(_irq);
+    }
+#endif
+}
+
+bool SolenoidTxQueue::waitIdle(uint32_t timeoutUs) {
+    uint32_t start = SolenoidTimebase::nowUs32();
+
+    while (!isIdle()) {
+        poll();
+        if ((SolenoidTimebase::nowUs32() - start) > timeoutUs) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SolenoidTxQueue::isIdle() const {
+    return (_sent == _head) && !_active;
+}
+
+bool SolenoidTxQueue::isFull() const {
+    return static_cast<uint8_t>(_head - _tail) >= SOLENOID_TX_QUEUE_CAPACITY;
+}
+
+uint8_t SolenoidTxQueue::pending() const {
+    return static_cast<uint8_t>(_head - _sent);
+}
+
+uint8_t SolenoidTxQueue::space() const {
+    return SOLENOID_TX_QUEUE_CAPACITY - static_cast<uint8_t>(_head - _tail);
+}
+
+bool SolenoidTxQueue::isHardwareAsync() const {
+    return _port != nullptr;
+}
+
+// =============================================================================
+// INTERRUPT PATH
+// =============================================================================
+
+void SolenoidTxQueue::isr() {
+#if defined(__IMXRT1062__)
+    IMXRT_LPI2C_t* port = lpi2c(_port);
+    uint32_t status = port->MSR;
+
+    if (!_active) {
+        // Spurious (e.g. flags left over from blocking Wire use)
+        port->MIER = 0;
+        return;
+    }
+
+    if (status & LPI2C_ERROR_FLAGS) {
+        // NACK, arbitration loss or FIFO error - drop the rest of the frame
+        port->MSR = status & LPI2C_ERROR_FLAGS;
+        port->MCR |= LPI2C_MCR_RTF;
+        _frameStatus = (status & LPI2C_MSR_NDF) ? SOLENOID_I2C_NACK : SOLENOID_I2C_OTHER_ERROR;
+
+        if ((status & LPI2C_MSR_ALF) || !(port->MSR & LPI2C_MSR_MBF)) {
+            // Bus is no longer ours - nothing more will complete
+            finishFrame();
+            return;
+        }
+
+        // Still own the bus - release it and finish on STOP detect
+        port->MTDR = LPI2C_MTDR_CMD_STOP;
+        _step = 3 + _ring[_sent & TX_MASK].length;
+        port->MIER = LPI2C_FRAME_IRQS & ~LPI2C_MIER_TDIE;
+        return;
+    }
+
+    if (status & LPI2C_MSR_SDF) {
+        port->MSR = LPI2C_MSR_SDF;
+        finishFrame();
+        return;
+    }
+
+    if (status & LPI2C_MSR_TDF) {
+        feedFifo();
+    }
+#endif
+}
+
+void SolenoidTxQueue::startNext() {
+#if defined(__IMXRT1062__)
+    IMXRT_LPI2C_t* port = lpi2c(_port);
+
+    if (_active) {
+        return;
+    }
+    if (_sent == _head) {
+        port->MIER = 0;
+        return;
+    }
+
+    // Clear stale flags (write-1-to-clear) and start the frame
+    port->MSR = LPI2C_MSR_EPF | LPI2C_MSR_SDF | LPI2C_ERROR_FLAGS;
+    _active = true;
+    _frameStatus = 0;
+    _step = 0;
+    _startUs = SolenoidTimebase::nowUs32();
+    port->MIER = LPI2C_FRAME_IRQS;
+    feedFifo();
+#endif
+}
+
+void SolenoidTxQueue::feedFifo() {
+#if defined(__IMXRT1062__)
+    IMXRT_LPI2C_t* port = lpi2c(_port);
+    const SolenoidFrame& frame = _ring[_sent & TX_MASK];
+
+    // Command words: START|address, register, data byte(s), STOP
+    const uint8_t words = 3 + frame.length;
+
+    while (_step < words && (port->MFSR & 0x07) < LPI2C_TX_FIFO_SIZE) {
+        uint8_t step = _step;
+        if (step == 0) {
+            port->MTDR = LPI2C_MTDR_CMD_START | (static_cast<uint32_t>(frame.address) << 1);
+        } else if (step == 1) {
+            port->MTDR = LPI2C_MTDR_CMD_TRANSMIT | frame.reg;
+        } else if (step < 2 + frame.length) {
+            uint8_t byteIndex = step - 2;
+            port->MTDR = LPI2C_MTDR_CMD_TRANSMIT | ((frame.data >> (8 * byteIndex)) & 0xFF);
+        } else {
+            port->MTDR = LPI2C_MTDR_CMD_STOP;
+        }
+        _step = step + 1;
+    }
+
+    if (_step >= words) {
+        // Everything loaded - only STOP/error interrupts are needed now
+        port->MIER = LPI2C_FRAME_IRQS & ~LPI2C_MIER_TDIE;
+    }
+#endif
+}
+
+void SolenoidTxQueue::finishFrame() {
+    SolenoidFrame& frame = _ring[_sent & TX_MASK];
+    frame.status = _frameStatus;
+    frame.wireUs = SolenoidTimebase::nowUs32();
+
+    _frameStatus = 0;
+    _active = false;
+    _sent = _sent + 1;
+
+    startNext();
+}
+
+// =============================================================================
+// SYNCHRONOUS PATH
+// =============================================================================
+
+void SolenoidTxQueue::sendBlocking(SolenoidFrame& frame) {
+    if (_bus == nullptr) {
+        frame.status = SOLENOID_I2C_OTHER_ERROR;
+        frame.wireUs = SolenoidTimebase::nowUs32();
+        return;
+    }
+
+    uint8_t bytes[2] = {
+        static_cast<uint8_t>(frame.data),
+        static_cast<uint8_t>(frame.data >> 8)
+    };
+    frame.status = _bus->writeRegisters(frame.address, frame.reg, bytes, frame.length);
+    frame.wireUs = SolenoidTimebase::nowUs32();
+}
@@ -0,0 +1,202 @@
+/**
+ * @file SolenoidTxQueue.h
+ * @brief Asynchronous I2C transmit queue for board frames
+ *
+ * This class holds a fixed-size ring of pending register writes ("frames")
+ * for one I2C bus. On Teensy 4.x the LPI2C peripheral is driven directly
+ * from its interrupt, so frames are clocked out while the CPU keeps running
+ * loop(). On other platforms (or on a bus without a TwoWire, such as the
+ * simulation bus) frames are sent with SolenoidBus::writeRegisters() from
+ * poll(), which keeps the same interface everywhere.
+ *
+ * It is used internally by SolenoidDriver when SolenoidConfig::asyncTransmit
+ * is enabled.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_TX_QUEUE_H
+#define SOLENOID_TX_QUEUE_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "SolenoidBus.h"
+#include "SolenoidConfig.h"
+
+/**
+ * @struct SolenoidFrame
+ * @brief A single register write to one MCP23017
+ *
+ * When the frame has been sent, status and wireUs are filled in by the
+ * queue before it is handed back through popCompleted().
+ */
+struct SolenoidFrame {
+    uint8_t address;     ///< 7-bit I2C address
+    uint8_t reg;         ///< First register to write
+    uint8_t length;      ///< Number of data bytes (1 or 2)
+    uint8_t board;       ///< Board index (for the completion handler)
+    uint16_t data;       ///< Data bytes (low byte first)
+    uint8_t status;      ///< 0 = ACKed, otherwise a TwoWire::endTransmission() error code
+    uint32_t queuedUs;   ///< SolenoidTimebase::nowUs32() when the frame was pushed
+    uint32_t wireUs;     ///< SolenoidTimebase::nowUs32() when the STOP condition completed
+};
+
+/**
+ * @class SolenoidTxQueue
+ * @brief Single-producer ring of I2C frames drained by the LPI2C interrupt
+ *
+ * The ring is split by three free-running indices:
+ * - [tail, sent): frames on the wire have finished, waiting for popCompleted()
+ * - [sent, head): frames waiting to be sent (the first may be in flight)
+ *
+ * Only the producer (main context) writes head and tail, and only the
+ * interrupt writes sent, so no locking is needed on the indices.
+ *
+ * While frames are in flight the bus must not be used directly.
+ * Call waitIdle() before any blocking SolenoidBus transaction.
+ *
+ * @note The interrupt vector of the LPI2C port is claimed in begin(), so
+ *       Wire slave mode cannot be used on the same port.
+ */
+class SolenoidTxQueue {
+public:
+    /**
+     * @brief Construct an unbound queue
+     */
+    SolenoidTxQueue();
+
+    /**
+     * @brief Bind the queue to an I2C bus
+     *
+     * @param bus Bus to send on; interrupt-driven transfers need its
+     *            getWire() to be Wire, Wire1 or Wire2 on Teensy 4.x
+     * @return true if interrupt-driven transfers are available for this
+     *         bus, false if frames will be sent synchronously by poll()
+     */
+    bool begin(SolenoidBus& bus);
+
+    /**
+     * @brief Queue a frame for transmission
+     *
+     * @param frame Frame to send (status and wireUs are ignored)
+     * @return true if queued, false if the ring is full
+     *
+     * Starts the transfer immediately if the bus is idle.
+     */
+    bool push(const SolenoidFrame& frame);
+
+    /**
+     * @brief Take the oldest finished frame off the ring
+     *
+     * @param frame Output: the finished frame with status and wireUs set
+     * @return true if a frame was returned
+     */
+    bool popCompleted(SolenoidFrame& frame);
+
+    /**
+     * @brief Service the queue from the main loop
+     *
+     * Without interrupt support, sends all pending frames on the bus.
+     * With interrupt support, aborts a transfer that has stalled for longer
+     * than SOLENOID_TX_TIMEOUT_US and restarts the queue.
+     */
+    void poll();
+
+    /**
+     * @brief Wait until no frames are pending or in flight
+     *
+     * @param timeoutUs Maximum time to wait in microseconds
+     * @return true if idle, false on timeout
+     */
+    bool waitIdle(uint32_t timeoutUs = SOLENOID_TX_TIMEOUT_US);
+
+    /**
+     * @brief Stop the frame on the wire and fail every pending frame
+     *
+     * The dropped frames are handed back through popCompleted() with
+     * status 4, so their boards can be rewritten later. Used before the bus
+     * is recovered and by the emergency stop.
+     */
+    void abort();
+
+    /**
+     * @brief Check if no frames are pending or in flight
+     *
+     * @return true if the bus is free for blocking use
+     */
+    bool isIdle() const;
+
+    /**
+     * @brief Check if a frame can be pushed
+     *
+     * @return true if the ring is full (completions must be popped first)
+     */
+    bool isFull() const;
+
+    /**
+     * @brief Get the number of frames waiting to be sent
+     *
+     * @return Pending frame count, including one in flight
+     */
+    uint8_t pending() const;
+
+    /**
+     * @brief Get the number of frames that can be pushed now
+     *
+     * @return Free slots (completions not yet popped still take a slot)
+     */
+    uint8_t space() const;
+
+    /**
+     * @brief Check if transfers are interrupt-driven
+     *
+     * @return true if the LPI2C interrupt path is active
+     */
+    bool isHardwareAsync() const;
+
+    /**
+     * @brief Interrupt handler (called from the LPI2C vector)
+     */
+    void isr();
+
+private:
+    SolenoidFrame _ring[SOLENOID_TX_QUEUE_CAPACITY];   ///< Frame storage
+    volatile uint8_t _head;                            ///< Next slot to fill (producer)
+    volatile uint8_t _sent;                            ///< Next slot to send (interrupt)
+    volatile uint8_t _tail;                            ///< Next completed slot to pop (producer)
+    volatile bool _active;                             ///< A frame is on the wire
+    volatile uint8_t _frameStatus;                     ///< Error code of the current frame (0 = none yet)
+    volatile uint8_t _step;                            ///< Words of current frame loaded into FIFO
+    volatile uint32_t _startUs;                        ///< SolenoidTimebase::nowUs32() when current frame started
+    SolenoidBus* _bus;                                 ///< Bus for the synchronous path
+    void* _port;                                       ///< LPI2C register block (nullptr if none)
+    uint8_t _irq;                                      ///< LPI2C interrupt number
+
+    /**
+     * @brief Start the next pending frame if the bus is idle
+     *
+     * Must be called with the port interrupt masked or from the interrupt.
+     */
+    void startNext();
+
+    /**
+     * @brief Load as many words of the current frame as fit into the TX FIFO
+     */
+    void feedFifo();
+
+    /**
+     * @brief Record the result of the current frame and start the next one
+     */
+    void finishFrame();
+
+    /**
+     * @brief Send one frame with a blocking bus write
+     *
+     * @param frame Frame to send; status and wireUs are filled in
+     */
+    void sendBlocking(SolenoidFrame& frame);
+};
+
+#endif // SOLENOID_TX_QUEUE_H
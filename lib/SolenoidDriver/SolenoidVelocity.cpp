@@ -0,0 +1,138 @@
+/**
+ * @file SolenoidVelocity.cpp
+ * @brief Implementation of SolenoidVelocityMap class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidVelocity.h"
+
+/** Velocity distance between curve breakpoints (1, 19, ... 127) */
+static constexpr uint8_t VELOCITY_STEP = 126 / (SOLENOID_VELOCITY_POINTS - 1);
+
+static_assert(VELOCITY_STEP * (SOLENOID_VELOCITY_POINTS - 1) == 126,
+              "SOLENOID_VELOCITY_POINTS must split velocities 1-127 evenly");
+
+SolenoidVelocityMap::SolenoidVelocityMap()
+    : _kickUs(nullptr)
+    , _holdDuty(nullptr)
+    , _latencyUs(nullptr)
+    , _channelCount(0)
+{
+}
+
+void SolenoidVelocityMap::attach(uint16_t (*kickUs)[SOLENOID_VELOCITY_POINTS], uint8_t* holdDuty,
+                                 uint16_t* latencyUs, uint8_t channelCount) {
+    _kickUs = kickUs;
+    _holdDuty = holdDuty;
+    _latencyUs = latencyUs;
+    _channelCount = channelCount;
+    reset();
+}
+
+void SolenoidVelocityMap::reset() {
+    uint16_t curve[SOLENOID_VELOCITY_POINTS];
+    for (uint8_t i = 0; i < SOLENOID_VELOCITY_POINTS; i++) {
+        curve[i] = SOLENOID_DEFAULT_KICK_MIN_US +
+                   static_cast<uint32_t>(SOLENOID_DEFAULT_KICK_MAX_US - SOLENOID_DEFAULT_KICK_MIN_US) * i /
+                   (SOLENOID_VELOCITY_POINTS - 1);
+    }
+    setCurveAll(curve);
+    setHoldDutyAll(SOLENOID_DEFAULT_HOLD_DUTY);
+    setLatencyAll(0);
+}
+
+bool SolenoidVelocityMap::setCurve(uint8_t channel, const uint16_t kickUs[SOLENOID_VELOCITY_POINTS]) {
+    if (channel >= _channelCount) {
+        return false;
+    }
+    for (uint8_t i = 0; i < SOLENOID_VELOCITY_POINTS; i++) {
+        _kickUs[channel][i] = kickUs[i];
+    }
+    return true;
+}
+
+void SolenoidVelocityMap::setCurveAll(const uint16_t kickUs[SOLENOID_VELOCITY_POINTS]) {
+    for (uint8_t ch = 0; ch < _channelCount; ch++) {
+        setCurve(ch, kickUs);
+    }
+}
+
+bool SolenoidVelocityMap::setHoldDuty(uint8_t channel, uint8_t duty) {
+    if (channel >= _channelCount) {
+        return false;
+    }
+    _holdDuty[channel] = duty;
+    return true;
+}
+
+void SolenoidVelocityMap::setHoldDutyAll(uint8_t duty) {
+    for (uint8_t ch = 0; ch < _channelCount; ch++) {
+        _holdDuty[ch] = duty;
+    }
+}
+
+const uint16_t* SolenoidVelocityMap::getCurve(uint8_t channel) const {
+    if (channel >= _channelCount) {
+        return nullptr;
+    }
+    return _kickUs[channel];
+}
+
+uint8_t SolenoidVelocityMap::getHoldDuty(uint8_t channel) const {
+    if (channel >= _channelCount) {
+        return 255;
+    }
+    return _holdDuty[channel];
+}
+
+bool SolenoidVelocityMap::setLatency(uint8_t channel, uint16_t latencyUs) {
+    if (channel >= _channelCount) {
+        return false;
+    }
+    _latencyUs[channel] = latencyUs;
+    return true;
+}
+
+void SolenoidVelocityMap::setLatencyAll(uint16_t latencyUs) {
+    for (uint8_t ch = 0; ch < _channelCount; ch++) {
+        _latencyUs[ch] = latencyUs;
+    }
+}
+
+uint16_t SolenoidVelocityMap::getLatency(uint8_t channel) const {
+    if (channel >= _channelCount) {
+        return 0;
+    }
+    return _latencyUs[channel];
+}
+
+SolenoidStrike SolenoidVelocityMap::lookup(uint8_t channel, uint8_t velocity) const {
+    SolenoidStrike strike = { 0, 255 };
+    if (channel >= _channelCount) {
+        return strike;
+    }
+
+    // Clamp to 1-127 and find the breakpoint at or below the velocity
+    if (velocity < 1) {
+        velocity = 1;
+    } else if (velocity > 127) {
+        velocity = 127;
+    }
+    uint8_t pos = velocity - 1;
+    uint8_t index = pos / VELOCITY_STEP;
+    uint8_t frac = pos % VELOCITY_STEP;
+
+    const uint16_t* curve = _kickUs[channel];
+    if (index >= SOLENOID_VELOCITY_POINTS - 1) {
+        strike.kickUs = curve[SOLENOID_VELOCITY_POINTS - 1];
+    } else {
+        // Linear interpolation (curves may also fall between breakpoints)
+        int32_t span = static_cast<int32_t>(curve[index + 1]) - curve[index];
+        strike.kickUs = static_cast<uint16_t>(curve[index] + span * frac / VELOCITY_STEP);
+    }
+
+    strike.holdDuty = _holdDuty[channel];
+    return strike;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file SolenoidVelocity.h
+ * @brief Velocity-to-strike lookup tables for SolenoidDriver
+ *
+ * A strike is a short full-power "kick" that throws the plunger, followed
+ * by a lower-duty "hold" that keeps it seated while the note sounds. This
+ * file holds the per-channel tables that turn a MIDI velocity into a kick
+ * length and hold duty. It is used by SolenoidDriver::on(channel, velocity).
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_VELOCITY_H
+#define SOLENOID_VELOCITY_H
+
+#include <stdint.h>
+
+#include "SolenoidConfig.h"
+
+/**
+ * @struct SolenoidStrike
+ * @brief How to drive a coil for one note
+ */
+struct SolenoidStrike {
+    uint16_t kickUs;     ///< Full-power time at the start of the note (us)
+    uint8_t holdDuty;    ///< Hold duty after the kick (0 = release, 255 = full power)
+};
+
+/**
+ * @class SolenoidVelocityMap
+ * @brief Per-channel velocity curves
+ *
+ * Each channel has SOLENOID_VELOCITY_POINTS kick lengths at evenly spaced
+ * velocities (1, 19, 37, ... 127); velocities in between are linearly
+ * interpolated. Each channel also has one hold duty, since the force needed
+ * to keep a key down does not depend on how hard it was struck.
+ *
+ * Each channel also stores its strike latency, used to fire sequenced
+ * notes early. The tables are plain arrays (19 bytes per channel, about
+ * 2.4KB for 128) so they can be calibrated per key and stored as a block.
+ * The map points at arrays owned by the driver, sized for its channel
+ * count (see SolenoidDriverStorage).
+ *
+ * Example usage:
+ * @code
+ * const uint16_t curve[SOLENOID_VELOCITY_POINTS] = {
+ *     1500, 2500, 3500, 4500, 6000, 7500, 9500, 12000
+ * };
+ * driver.getVelocityMap().setCurve(5, curve);
+ * driver.getVelocityMap().setHoldDuty(5, 96);
+ * driver.on(5, 100);   // Kick for ~8.4ms, then hold at 96/255
+ * @endcode
+ */
+class SolenoidVelocityMap {
+public:
+    /**
+     * @brief Construct a map with no tables (every channel out of range)
+     */
+    SolenoidVelocityMap();
+
+    /**
+     * @brief Use caller-owned tables and fill them with the default curve
+     *
+     * @param kickUs Kick curves, one row per channel
+     * @param holdDuty Hold duties, one per channel
+     * @param latencyUs Strike latencies, one per channel
+     * @param channelCount Rows in each table
+     *
+     * The tables must outlive the map.
+     */
+    void attach(uint16_t (*kickUs)[SOLENOID_VELOCITY_POINTS], uint8_t* holdDuty, uint16_t* latencyUs,
+                uint8_t channelCount);
+
+    /**
+     * @brief Restore the default curve and hold duty on every channel
+     *
+     * The default kick rises linearly from SOLENOID_DEFAULT_KICK_MIN_US at
+     * velocity 1 to SOLENOID_DEFAULT_KICK_MAX_US at velocity 127, and the
+     * hold duty is SOLENOID_DEFAULT_HOLD_DUTY. Latencies are cleared to 0.
+     */
+    void reset();
+
+    /**
+     * @brief Set the kick curve for one channel
+     *
+     * @param channel Global channel index
+     * @param kickUs Kick length at each breakpoint velocity (us)
+     * @return true if set, false if channel is out of range
+     */
+    bool setCurve(uint8_t channel, const uint16_t kickUs[SOLENOID_VELOCITY_POINTS]);
+
+    /**
+     * @brief Set the same kick curve on every channel
+     *
+     * @param kickUs Kick length at each breakpoint velocity (us)
+     */
+    void setCurveAll(const uint16_t kickUs[SOLENOID_VELOCITY_POINTS]);
+
+    /**
+     * @brief Set the hold duty for one channel
+     *
+     * @param channel Global channel index
+     * @param duty Hold duty (0 = release after the kick, 255 = full power)
+     * @return true if set, false if channel is out of range
+     */
+    bool setHoldDuty(uint8_t channel, uint8_t duty);
+
+    /**
+     * @brief Set the same hold duty on every channel
+     *
+     * @param duty Hold duty (0-255)
+     */
+    void setHoldDutyAll(uint8_t duty);
+
+    /**
+     * @brief Get the kick curve of a channel
+     *
+     * @param channel Global channel index
+     * @return Pointer to SOLENOID_VELOCITY_POINTS kick lengths, or nullptr
+     */
+    const uint16_t* getCurve(uint8_t channel) const;
+
+    /**
+     * @brief Get the hold duty of a channel
+     *
+     * @param channel Global channel index
+     * @return Hold duty (0-255), or 255 if channel is out of range
+     */
+    uint8_t getHoldDuty(uint8_t channel) const;
+
+    /**
+     * @brief Set the strike latency of one channel
+     *
+     * @param channel Global channel index
+     * @param latencyUs Time from energizing the coil to the hammer hitting
+     *        the string (us)
+     * @return true if set, false if channel is out of range
+     *
+     * Sequenced notes (SolenoidDriver::scheduleNoteOn()) fire this much
+     * before their target time so every key sounds on time.
+     */
+    bool setLatency(uint8_t channel, uint16_t latencyUs);
+
+    /**
+     * @brief Set the same strike latency on every channel
+     *
+     * @param latencyUs Strike latency (us)
+     */
+    void setLatencyAll(uint16_t latencyUs);
+
+    /**
+     * @brief Get the strike latency of a channel
+     *
+     * @param channel Global channel index
+     * @return Strike latency (us), or 0 if channel is out of range
+     */
+    uint16_t getLatency(uint8_t channel) const;
+
+    /**
+     * @brief Look up the strike for a note
+     *
+     * @param channel Global channel index
+     * @param velocity MIDI velocity (1-127; 0 is treated as 1)
+     * @return Kick length and hold duty
+     */
+    SolenoidStrike lookup(uint8_t channel, uint8_t velocity) const;
+
+private:
+    uint16_t (*_kickUs)[SOLENOID_VELOCITY_POINTS];    ///< Kick curves
+    uint8_t* _holdDuty;                               ///< Hold duties
+    uint16_t* _latencyUs;                             ///< Strike latencies
+    uint8_t _channelCount;                            ///< Rows in each table
+};
+
+#endif // SOLENOID_VELOCITY_H
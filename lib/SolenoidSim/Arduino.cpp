@@ -0,0 +1,237 @@
+/**
+ * @file Arduino.cpp
+ * @brief Implementation of the simulation's Arduino core
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "Arduino.h"
+
+#include <stdio.h>
+
+SimSerial Serial;
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+
+// =============================================================================
+// TIMING
+// =============================================================================
+
+uint32_t micros() {
+    return static_cast<uint32_t>(SolenoidSimClock::nowUs());
+}
+
+uint32_t millis() {
+    return static_cast<uint32_t>(SolenoidSimClock::nowUs() / 1000);
+}
+
+void delay(uint32_t ms) {
+    SolenoidSimClock::advanceUs(static_cast<uint64_t>(ms) * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+    SolenoidSimClock::advanceUs(us);
+}
+
+void yield() {
+}
+
+// =============================================================================
+// PINS
+// =============================================================================
+
+static SimPinHook s_pinHook = nullptr;
+
+void setPinHook(SimPinHook hook) {
+    s_pinHook = hook;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (s_pinHook != nullptr) {
+        s_pinHook(pin, value);
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    (void)pin;
+    return LOW;
+}
+
+// =============================================================================
+// PRINT
+// =============================================================================
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    for (size_t i = 0; i < size; i++) {
+        n += write(buffer[i]);
+    }
+    return n;
+}
+
+size_t Print::print(const char* str) {
+    return write(str);
+}
+
+size_t Print::print(char value) {
+    return write(static_cast<uint8_t>(value));
+}
+
+size_t Print::print(int value, int base) {
+    return print(static_cast<long long>(value), base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+    return printNumber(value, false, base);
+}
+
+size_t Print::print(long value, int base) {
+    return print(static_cast<long long>(value), base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    return printNumber(value, false, base);
+}
+
+size_t Print::print(long long value, int base) {
+    if (value < 0 && base == DEC) {
+        return printNumber(0ULL - static_cast<unsigned long long>(value), true, base);
+    }
+    return printNumber(static_cast<unsigned long long>(value), false, base);
+}
+
+size_t Print::print(unsigned long long value, int base) {
+    return printNumber(value, false, base);
+}
+
+size_t Print::print(double value, int digits) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return write(buffer);
+}
+
+size_t Print::println() {
+    return write(static_cast<uint8_t>('\r')) + write(static_cast<uint8_t>('\n'));
+}
+
+size_t Print::println(const char* str) {
+    return print(str) + println();
+}
+
+size_t Print::println(char value) {
+    return print(value) + println();
+}
+
+size_t Print::println(int value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(unsigned int value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(long value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(unsigned long value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(long long value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(unsigned long long value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(double value, int digits) {
+    return print(value, digits) + println();
+}
+
+size_t Print::printNumber(unsigned long long value, bool negative, int base) {
+    if (base < 2) {
+        base = DEC;
+    }
+
+    // Digits are produced backwards into the end of the buffer
+    char buffer[66];
+    char* p = &buffer[sizeof(buffer) - 1];
+    *p = '\0';
+    do {
+        uint8_t digit = static_cast<uint8_t>(value % base);
+        *--p = static_cast<char>((digit < 10) ? ('0' + digit) : ('A' + digit - 10));
+        value /= base;
+    } while (value > 0);
+    if (negative) {
+        *--p = '-';
+    }
+    return write(p);
+}
+
+// =============================================================================
+// SERIAL
+// =============================================================================
+
+size_t SimSerial::write(uint8_t value) {
+    // Arduino line endings are CR LF - the console wants LF only
+    if (value != '\r') {
+        fputc(value, stdout);
+    }
+    return 1;
+}
+
+size_t SimSerial::write(const uint8_t* buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        write(buffer[i]);
+    }
+    return size;
+}
+
+HardwareSerial::HardwareSerial()
+    : _head(0)
+    , _tail(0)
+    , _count(0)
+    , _overruns(0)
+{
+}
+
+int HardwareSerial::available() {
+    return _count;
+}
+
+int HardwareSerial::read() {
+    if (_count == 0) {
+        return -1;
+    }
+    uint8_t value = _rx[_tail];
+    _tail = (_tail + 1) % SIM_SERIAL_RX_BYTES;
+    _count--;
+    return value;
+}
+
+int HardwareSerial::peek() {
+    return (_count > 0) ? _rx[_tail] : -1;
+}
+
+bool HardwareSerial::receive(uint8_t value) {
+    if (_count >= SIM_SERIAL_RX_BYTES) {
+        _overruns++;
+        return false;
+    }
+    _rx[_head] = value;
+    _head = (_head + 1) % SIM_SERIAL_RX_BYTES;
+    _count++;
+    return true;
+}
+
+uint32_t HardwareSerial::getOverrunCount() const {
+    return _overruns;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core for the host simulation build
+ *
+ * Provides just what the SolenoidDriver and PianoMidi libraries use off
+ * Teensy: timing on SolenoidSimClock, Print/Stream, a Serial that writes
+ * to stdout, and HardwareSerial ports whose receive side the simulation
+ * fills (a simulated DIN MIDI input). Pin functions are no-ops.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_SIM_ARDUINO_H
+#define SOLENOID_SIM_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "SolenoidSimClock.h"
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define F(string_literal) (string_literal)
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LED_BUILTIN 13
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+// =============================================================================
+// TIMING (virtual)
+// =============================================================================
+
+/** Virtual microseconds, wrapping like the real counter */
+uint32_t micros();
+
+/** Virtual milliseconds */
+uint32_t millis();
+
+/** Advance virtual time by ms milliseconds */
+void delay(uint32_t ms);
+
+/** Advance virtual time by us microseconds */
+void delayMicroseconds(uint32_t us);
+
+/** No-op */
+void yield();
+
+// =============================================================================
+// PINS (no-ops unless hooked)
+// =============================================================================
+
+/** Receives every digitalWrite(), to model what a pin is wired to */
+typedef void (*SimPinHook)(uint8_t pin, uint8_t value);
+
+/**
+ * @brief Route digitalWrite() calls to a hook
+ *
+ * @param hook Function to call, or nullptr for no-ops
+ */
+void setPinHook(SimPinHook hook);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+// =============================================================================
+// PRINT / STREAM
+// =============================================================================
+
+/**
+ * @class Print
+ * @brief Formatted output over write()
+ */
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return write(reinterpret_cast<const uint8_t*>(str), strlen(str)); }
+
+    size_t print(const char* str);
+    size_t print(char value);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(long long value, int base = DEC);
+    size_t print(unsigned long long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println();
+    size_t println(const char* str);
+    size_t println(char value);
+    size_t println(int value, int base = DEC);
+    size_t println(unsigned int value, int base = DEC);
+    size_t println(long value, int base = DEC);
+    size_t println(unsigned long value, int base = DEC);
+    size_t println(long long value, int base = DEC);
+    size_t println(unsigned long long value, int base = DEC);
+    size_t println(double value, int digits = 2);
+
+private:
+    size_t printNumber(unsigned long long value, bool negative, int base);
+};
+
+/**
+ * @class Stream
+ * @brief Print with a receive side
+ */
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    void setTimeout(unsigned long timeoutMs) { (void)timeoutMs; }
+};
+
+/**
+ * @class SimSerial
+ * @brief USB serial console: output to stdout, no input
+ */
+class SimSerial : public Stream {
+public:
+    void begin(uint32_t baud) { (void)baud; }
+    explicit operator bool() const { return true; }
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+};
+
+/** Receive buffer of a simulated UART (bytes) */
+constexpr uint16_t SIM_SERIAL_RX_BYTES = 256;
+
+/**
+ * @class HardwareSerial
+ * @brief UART whose received bytes are supplied by the simulation
+ *
+ * Output is discarded. Bytes beyond the receive buffer are dropped, as a
+ * UART overruns when it is not read in time.
+ */
+class HardwareSerial : public Stream {
+public:
+    HardwareSerial();
+
+    void begin(uint32_t baud) { (void)baud; }
+    void addMemoryForRead(void* buffer, size_t size) { (void)buffer; (void)size; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t value) override { (void)value; return 1; }
+    using Print::write;
+
+    /**
+     * @brief Make a byte available to read(), as if it had just arrived
+     *
+     * @param value Received byte
+     * @return false if the receive buffer was full (byte lost)
+     */
+    bool receive(uint8_t value);
+
+    /**
+     * @brief Get the number of bytes lost to a full receive buffer
+     */
+    uint32_t getOverrunCount() const;
+
+private:
+    uint8_t _rx[SIM_SERIAL_RX_BYTES];    ///< Receive ring
+    uint16_t _head;                      ///< Next write position
+    uint16_t _tail;                      ///< Next read position
+    uint16_t _count;                     ///< Bytes buffered
+    uint32_t _overruns;                  ///< Bytes lost
+};
+
+extern SimSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+#endif // SOLENOID_SIM_ARDUINO_H
@@ -0,0 +1,123 @@
+/**
+ * @file SD.cpp
+ * @brief Implementation of the simulation's SD card stand-in
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SD.h"
+
+SDClass SD;
+
+// =============================================================================
+// FILE
+// =============================================================================
+
+bool File::seek(uint64_t position) {
+    return _fp != nullptr && fseek(_fp, static_cast<long>(position), SEEK_SET) == 0;
+}
+
+uint64_t File::position() {
+    if (_fp == nullptr) {
+        return 0;
+    }
+    long pos = ftell(_fp);
+    return (pos < 0) ? 0 : static_cast<uint64_t>(pos);
+}
+
+uint64_t File::size() {
+    if (_fp == nullptr) {
+        return 0;
+    }
+    long pos = ftell(_fp);
+    fseek(_fp, 0, SEEK_END);
+    long end = ftell(_fp);
+    fseek(_fp, pos, SEEK_SET);
+    return (end < 0) ? 0 : static_cast<uint64_t>(end);
+}
+
+int File::read(void* buffer, size_t length) {
+    if (_fp == nullptr) {
+        return -1;
+    }
+    return static_cast<int>(fread(buffer, 1, length, _fp));
+}
+
+int File::read() {
+    uint8_t value;
+    return (read(&value, 1) == 1) ? value : -1;
+}
+
+int File::available() {
+    uint64_t remaining = size() - position();
+    return (remaining > 0x7FFFFFFF) ? 0x7FFFFFFF : static_cast<int>(remaining);
+}
+
+size_t File::write(uint8_t value) {
+    return write(&value, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (_fp == nullptr) {
+        return 0;
+    }
+    return fwrite(buffer, 1, size, _fp);
+}
+
+void File::flush() {
+    if (_fp != nullptr) {
+        fflush(_fp);
+    }
+}
+
+void File::close() {
+    if (_fp != nullptr) {
+        fclose(_fp);
+        _fp = nullptr;
+    }
+}
+
+// =============================================================================
+// CARD
+// =============================================================================
+
+File SDClass::open(const char* path, uint8_t mode) {
+    char buffer[SIM_SD_MAX_PATH];
+    // FILE_WRITE appends, as on the card
+    return File(fopen(hostPath(path, buffer), (mode == FILE_WRITE) ? "ab+" : "rb"));
+}
+
+bool SDClass::exists(const char* path) {
+    char buffer[SIM_SD_MAX_PATH];
+    FILE* fp = fopen(hostPath(path, buffer), "rb");
+    if (fp == nullptr) {
+        return false;
+    }
+    fclose(fp);
+    return true;
+}
+
+bool SDClass::remove(const char* path) {
+    char buffer[SIM_SD_MAX_PATH];
+    return ::remove(hostPath(path, buffer)) == 0;
+}
+
+void SDClass::setRoot(const char* root) {
+    snprintf(_root, sizeof(_root), "%s", root);
+}
+
+const char* SDClass::hostPath(const char* path, char* buffer) {
+    if (_root[0] == '\0') {
+        return path;
+    }
+    const char* relative = (path[0] == '/') ? path + 1 : path;
+    size_t rootLength = strlen(_root);
+    if (rootLength + 1 + strlen(relative) >= SIM_SD_MAX_PATH) {
+        return path;   // Too long to prefix - use as given
+    }
+    memcpy(buffer, _root, rootLength);
+    buffer[rootLength] = '/';
+    strcpy(buffer + rootLength + 1, relative);
+    return buffer;
+}
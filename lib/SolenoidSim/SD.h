@@ -0,0 +1,86 @@
+/**
+ * @file SD.h
+ * @brief SD card stand-in for the host simulation build
+ *
+ * Files are opened from the host file system. Paths are used as given,
+ * or below the root set with SDClass::setRoot().
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_SIM_SD_H
+#define SOLENOID_SIM_SD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "Arduino.h"
+
+#define FILE_READ 0
+#define FILE_WRITE 1
+#define BUILTIN_SDCARD 254
+
+/** Longest host path SDClass builds (bytes) */
+constexpr uint16_t SIM_SD_MAX_PATH = 512;
+
+/**
+ * @class File
+ * @brief Handle to an open host file
+ *
+ * Copies share the handle, as on the Arduino API; close() once.
+ */
+class File : public Stream {
+public:
+    File() : _fp(nullptr) {}
+    explicit File(FILE* fp) : _fp(fp) {}
+
+    bool seek(uint64_t position);
+    uint64_t position();
+    uint64_t size();
+    int read(void* buffer, size_t length);
+    int read() override;
+    int available() override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    void flush();
+    void close();
+    explicit operator bool() const { return _fp != nullptr; }
+
+private:
+    FILE* _fp;    ///< Host file, or nullptr if not open
+};
+
+/**
+ * @class SDClass
+ * @brief Card interface over the host file system
+ */
+class SDClass {
+public:
+    SDClass() { _root[0] = '\0'; }
+
+    bool begin(uint8_t csPin) { (void)csPin; return true; }
+    File open(const char* path, uint8_t mode = FILE_READ);
+    bool exists(const char* path);
+    bool remove(const char* path);
+
+    /**
+     * @brief Set the host directory card paths are relative to
+     *
+     * @param root Directory, or "" to use paths as given
+     */
+    void setRoot(const char* root);
+
+private:
+    char _root[SIM_SD_MAX_PATH];    ///< Host directory of the card
+
+    /**
+     * @brief Build the host path of a card path
+     */
+    const char* hostPath(const char* path, char* buffer);
+};
+
+extern SDClass SD;
+
+#endif // SOLENOID_SIM_SD_H
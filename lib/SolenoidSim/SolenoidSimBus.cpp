@@ -0,0 +1,270 @@
+/**
+ * @file SolenoidSimBus.cpp
+ * @brief Implementation of SolenoidSimBus class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidSimBus.h"
+
+#include "SolenoidSimClock.h"
+
+// MCP23017 registers with side effects (IOCON.BANK = 0)
+static constexpr uint8_t REG_IODIRA = 0x00;
+static constexpr uint8_t REG_IOCON = 0x0A;
+static constexpr uint8_t REG_IOCON_ALT = 0x0B;
+static constexpr uint8_t REG_INTFA = 0x0E;
+static constexpr uint8_t REG_INTCAPB = 0x11;
+static constexpr uint8_t REG_GPIOA = 0x12;
+static constexpr uint8_t REG_GPIOB = 0x13;
+static constexpr uint8_t REG_OLATA = 0x14;
+
+/** SCL periods of an address phase: START, address + R/W, ACK, STOP */
+static constexpr uint32_t ADDRESS_ONLY_BITS = 1 + 9 + 1;
+
+/** SCL periods of a register write besides its data: START, address, register, STOP */
+static constexpr uint32_t WRITE_OVERHEAD_BITS = 1 + 9 + 9 + 1;
+
+/** SCL periods of a register read besides its data: + repeated START and read address */
+static constexpr uint32_t READ_OVERHEAD_BITS = WRITE_OVERHEAD_BITS + 1 + 9;
+
+/** SCL periods per data byte (8 data + ACK) */
+static constexpr uint32_t BITS_PER_BYTE = 9;
+
+SolenoidSimBus::SolenoidSimBus()
+    : _boardCount(0)
+    , _clockHz(SIM_DEFAULT_BUS_CLOCK_HZ)
+    , _stuck(false)
+    , _transactionCount(0)
+    , _byteCount(0)
+    , _nackCount(0)
+    , _busyNs(0)
+{
+}
+
+bool SolenoidSimBus::addBoard(uint8_t address, uint32_t maxClockHz) {
+    if (_boardCount >= SOLENOID_MAX_BOARDS_PER_BUS || find(address) != nullptr) {
+        return false;
+    }
+
+    Board& board = _boards[_boardCount++];
+    board.address = address;
+    board.online = true;
+    board.maxClockHz = maxClockHz;
+    powerOn(board);
+    return true;
+}
+
+void SolenoidSimBus::setBoardOnline(uint8_t address, bool online) {
+    Board* board = const_cast<Board*>(find(address));
+    if (board != nullptr) {
+        board->online = online;
+    }
+}
+
+void SolenoidSimBus::resetBoard(uint8_t address) {
+    Board* board = const_cast<Board*>(find(address));
+    if (board != nullptr) {
+        powerOn(*board);
+    }
+}
+
+void SolenoidSimBus::resetAll() {
+    for (uint8_t i = 0; i < _boardCount; i++) {
+        powerOn(_boards[i]);
+    }
+}
+
+void SolenoidSimBus::setStuck(bool stuck) {
+    _stuck = stuck;
+}
+
+bool SolenoidSimBus::isStuck() const {
+    return _stuck;
+}
+
+uint16_t SolenoidSimBus::getOutputs(uint8_t address) const {
+    const Board* board = find(address);
+    if (board == nullptr) {
+        return 0;
+    }
+    uint8_t a = readRegister(*board, REG_GPIOA);
+    uint8_t b = readRegister(*board, REG_GPIOB);
+    return static_cast<uint16_t>(a | (b << 8));
+}
+
+uint8_t SolenoidSimBus::getRegister(uint8_t address, uint8_t reg) const {
+    const Board* board = find(address);
+    if (board == nullptr || reg >= SIM_MCP23017_REGISTER_COUNT) {
+        return 0;
+    }
+    return board->regs[reg];
+}
+
+uint32_t SolenoidSimBus::getClockHz() const {
+    return _clockHz;
+}
+
+uint32_t SolenoidSimBus::getTransactionCount() const {
+    return _transactionCount;
+}
+
+uint32_t SolenoidSimBus::getByteCount() const {
+    return _byteCount;
+}
+
+uint32_t SolenoidSimBus::getNackCount() const {
+    return _nackCount;
+}
+
+uint64_t SolenoidSimBus::getBusyUs() const {
+    return _busyNs / 1000;
+}
+
+void SolenoidSimBus::resetStats() {
+    _transactionCount = 0;
+    _byteCount = 0;
+    _nackCount = 0;
+    _busyNs = 0;
+}
+
+// =============================================================================
+// BUS
+// =============================================================================
+
+bool SolenoidSimBus::probe(uint8_t address) {
+    _transactionCount++;
+    clockBits(ADDRESS_ONLY_BITS);
+    if (respond(address) == nullptr) {
+        _nackCount++;
+        return false;
+    }
+    return true;
+}
+
+uint8_t SolenoidSimBus::writeRegisters(uint8_t address, uint8_t reg, const uint8_t* data, uint8_t length) {
+    _transactionCount++;
+
+    if (_stuck) {
+        // No START can be generated - the master gives up
+        clockBits(ADDRESS_ONLY_BITS);
+        _nackCount++;
+        return SOLENOID_I2C_TIMEOUT;
+    }
+
+    Board* board = respond(address);
+    if (board == nullptr) {
+        // Address NACKed - the master sends STOP straight away
+        clockBits(ADDRESS_ONLY_BITS);
+        _nackCount++;
+        return 2;
+    }
+
+    clockBits(WRITE_OVERHEAD_BITS + (BITS_PER_BYTE * length));
+    _byteCount += length;
+
+    // Sequential mode: the register pointer advances and wraps
+    uint8_t pointer = reg % SIM_MCP23017_REGISTER_COUNT;
+    for (uint8_t i = 0; i < length; i++) {
+        writeRegister(*board, pointer, data[i]);
+        pointer = (pointer + 1) % SIM_MCP23017_REGISTER_COUNT;
+    }
+    return 0;
+}
+
+bool SolenoidSimBus::readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length) {
+    _transactionCount++;
+
+    const Board* board = respond(address);
+    if (board == nullptr) {
+        clockBits(ADDRESS_ONLY_BITS);
+        _nackCount++;
+        return false;
+    }
+
+    clockBits(READ_OVERHEAD_BITS + (BITS_PER_BYTE * length));
+    _byteCount += length;
+
+    uint8_t pointer = reg % SIM_MCP23017_REGISTER_COUNT;
+    for (uint8_t i = 0; i < length; i++) {
+        data[i] = readRegister(*board, pointer);
+        pointer = (pointer + 1) % SIM_MCP23017_REGISTER_COUNT;
+    }
+    return true;
+}
+
+void SolenoidSimBus::setClock(uint32_t hz) {
+    if (hz > 0) {
+        _clockHz = hz;
+    }
+}
+
+bool SolenoidSimBus::recoverBus() {
+    // SCL pulses, then a STOP
+    clockBits(SOLENOID_BUS_RECOVERY_CLOCKS + 1);
+    _stuck = false;
+    return true;
+}
+
+// =============================================================================
+// PRIVATE
+// =============================================================================
+
+SolenoidSimBus::Board* SolenoidSimBus::respond(uint8_t address) {
+    Board* board = const_cast<Board*>(find(address));
+    if (_stuck || board == nullptr || !board->online || _clockHz > board->maxClockHz) {
+        return nullptr;
+    }
+    return board;
+}
+
+void SolenoidSimBus::powerOn(Board& board) {
+    for (uint8_t i = 0; i < SIM_MCP23017_REGISTER_COUNT; i++) {
+        board.regs[i] = 0x00;
+    }
+    // Every pin is an input at power-on
+    board.regs[REG_IODIRA] = 0xFF;
+    board.regs[REG_IODIRA + 1] = 0xFF;
+}
+
+const SolenoidSimBus::Board* SolenoidSimBus::find(uint8_t address) const {
+    for (uint8_t i = 0; i < _boardCount; i++) {
+        if (_boards[i].address == address) {
+            return &_boards[i];
+        }
+    }
+    return nullptr;
+}
+
+void SolenoidSimBus::clockBits(uint32_t bits) {
+    uint64_t ns = (static_cast<uint64_t>(bits) * 1000000000ULL) / _clockHz;
+    _busyNs += ns;
+    SolenoidSimClock::advanceNs(ns);
+}
+
+void SolenoidSimBus::writeRegister(Board& board, uint8_t reg, uint8_t value) {
+    if (reg >= REG_INTFA && reg <= REG_INTCAPB) {
+        return;   // Read-only
+    }
+
+    if (reg == REG_GPIOA || reg == REG_GPIOB) {
+        // Writing a port writes its output latch
+        board.regs[reg + (REG_OLATA - REG_GPIOA)] = value;
+    } else if (reg == REG_IOCON || reg == REG_IOCON_ALT) {
+        // One register at two addresses
+        board.regs[REG_IOCON] = value;
+        board.regs[REG_IOCON_ALT] = value;
+    } else {
+        board.regs[reg] = value;
+    }
+}
+
+uint8_t SolenoidSimBus::readRegister(const Board& board, uint8_t reg) {
+    if (reg == REG_GPIOA || reg == REG_GPIOB) {
+        // Output pins read back their latch; nothing drives the inputs
+        uint8_t port = reg - REG_GPIOA;
+        return board.regs[REG_OLATA + port] & static_cast<uint8_t>(~board.regs[REG_IODIRA + port]);
+    }
+    return board.regs[reg];
+}
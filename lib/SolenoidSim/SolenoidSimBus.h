@@ -0,0 +1,222 @@
+/**
+ * @file SolenoidSimBus.h
+ * @brief Mock I2C bus of MCP23017 boards with a bit-level timing model
+ *
+ * Each board is a register file with MCP23017 semantics in IOCON.BANK = 0
+ * mode: power-on IODIR = 0xFF, sequential addressing, GPIO writes landing
+ * in OLAT. Every transaction advances SolenoidSimClock by the time its
+ * bits take at the current SCL frequency (9 bits per byte with ACK, plus
+ * START, repeated START and STOP), so the driver sees the bus occupancy of
+ * 100 kHz, 400 kHz or 1 MHz operation.
+ *
+ * A board can be given a maximum clock above which it does not respond,
+ * to exercise the driver's clock fallback, and can be taken offline to
+ * inject bus faults. The whole bus can be made to hang, as when a slave
+ * holds SDA low, until recoverBus() is called.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_SIM_BUS_H
+#define SOLENOID_SIM_BUS_H
+
+#include <stdint.h>
+
+#include "SolenoidBus.h"
+#include "SolenoidConfig.h"
+
+/** Registers of an MCP23017 in IOCON.BANK = 0 mode (0x00-0x15) */
+constexpr uint8_t SIM_MCP23017_REGISTER_COUNT = 0x16;
+
+/** Fastest clock a simulated board answers at by default (Hz) */
+constexpr uint32_t SIM_DEFAULT_BOARD_MAX_CLOCK_HZ = 1700000;
+
+/** SCL frequency before setClock() (Hz) */
+constexpr uint32_t SIM_DEFAULT_BUS_CLOCK_HZ = 100000;
+
+/**
+ * @class SolenoidSimBus
+ * @brief SolenoidBus over simulated MCP23017 boards
+ *
+ * Example usage:
+ * @code
+ * SolenoidSimBus bus;
+ * bus.addBoard(0x20);
+ * bus.addBoard(0x21, 400000);     // This board only manages 400 kHz
+ * driver.begin(bus, addresses, 2);
+ * @endcode
+ */
+class SolenoidSimBus : public SolenoidBus {
+public:
+    /**
+     * @brief Construct a bus with no boards
+     */
+    SolenoidSimBus();
+
+    /**
+     * @brief Attach a board at its power-on register state
+     *
+     * @param address 7-bit I2C address
+     * @param maxClockHz Fastest clock the board responds at
+     * @return false if the address is taken or the bus is full
+     */
+    bool addBoard(uint8_t address, uint32_t maxClockHz = SIM_DEFAULT_BOARD_MAX_CLOCK_HZ);
+
+    /**
+     * @brief Connect or disconnect a board (fault injection)
+     *
+     * @param address Board address
+     * @param online false to make the board NACK everything
+     *
+     * Registers keep their contents while offline, like a board whose
+     * cable was pulled without losing power.
+     */
+    void setBoardOnline(uint8_t address, bool online);
+
+    /**
+     * @brief Return a board to its power-on register state (brown-out)
+     *
+     * @param address Board address
+     */
+    void resetBoard(uint8_t address);
+
+    /**
+     * @brief Pulse the boards' shared RESET line
+     *
+     * Every board returns to its power-on register state, online or not.
+     */
+    void resetAll();
+
+    /**
+     * @brief Hang or release the bus (fault injection)
+     *
+     * @param stuck true to make every transaction time out, as with SDA
+     *              held low, until recoverBus() or setStuck(false)
+     */
+    void setStuck(bool stuck);
+
+    /**
+     * @brief Check if the bus is hung
+     */
+    bool isStuck() const;
+
+    /**
+     * @brief Get the levels a board drives on its output pins
+     *
+     * @param address Board address
+     * @return OLATA/OLATB masked to pins configured as outputs (GPA0 = bit 0)
+     */
+    uint16_t getOutputs(uint8_t address) const;
+
+    /**
+     * @brief Read a board register without a bus transaction
+     *
+     * @param address Board address
+     * @param reg Register (0x00-0x15)
+     * @return Register value (0 for unknown boards or registers)
+     */
+    uint8_t getRegister(uint8_t address, uint8_t reg) const;
+
+    /**
+     * @brief Get the current SCL frequency
+     *
+     * @return Clock in Hz
+     */
+    uint32_t getClockHz() const;
+
+    /**
+     * @brief Get the number of transactions (including NACKed ones)
+     */
+    uint32_t getTransactionCount() const;
+
+    /**
+     * @brief Get the number of data bytes written and read
+     */
+    uint32_t getByteCount() const;
+
+    /**
+     * @brief Get the number of NACKed transactions
+     */
+    uint32_t getNackCount() const;
+
+    /**
+     * @brief Get the time the bus spent clocking bits
+     *
+     * @return Busy time in microseconds
+     */
+    uint64_t getBusyUs() const;
+
+    /**
+     * @brief Clear the transaction, byte, NACK and busy counters
+     */
+    void resetStats();
+
+    bool probe(uint8_t address) override;
+    uint8_t writeRegisters(uint8_t address, uint8_t reg, const uint8_t* data, uint8_t length) override;
+    bool readRegisters(uint8_t address, uint8_t reg, uint8_t* data, uint8_t length) override;
+    void setClock(uint32_t hz) override;
+
+    /**
+     * @brief Clock SCL until SDA is released - always frees a hung bus
+     */
+    bool recoverBus() override;
+
+private:
+    /**
+     * @struct Board
+     * @brief One simulated MCP23017
+     */
+    struct Board {
+        uint8_t address;                                 ///< 7-bit I2C address
+        bool online;                                     ///< Responds on the bus
+        uint32_t maxClockHz;                             ///< Fastest clock it responds at
+        uint8_t regs[SIM_MCP23017_REGISTER_COUNT];       ///< Register file
+    };
+
+    Board _boards[SOLENOID_MAX_BOARDS_PER_BUS];          ///< Attached boards
+    uint8_t _boardCount;                                 ///< Boards in use
+    uint32_t _clockHz;                                   ///< SCL frequency
+    bool _stuck;                                         ///< SDA held low: nothing gets through
+    uint32_t _transactionCount;                          ///< Transactions started
+    uint32_t _byteCount;                                 ///< Data bytes transferred
+    uint32_t _nackCount;                                 ///< Transactions NACKed
+    uint64_t _busyNs;                                    ///< Time spent clocking bits
+
+    /**
+     * @brief Find the board that answers an address now
+     *
+     * @return The board, or nullptr if none responds (absent, offline, or
+     *         the clock is too fast for it)
+     */
+    Board* respond(uint8_t address);
+
+    /**
+     * @brief Load the power-on register values
+     */
+    static void powerOn(Board& board);
+
+    /**
+     * @brief Find a board by address regardless of its state
+     */
+    const Board* find(uint8_t address) const;
+
+    /**
+     * @brief Account for bits clocked on the bus and advance virtual time
+     *
+     * @param bits SCL periods
+     */
+    void clockBits(uint32_t bits);
+
+    /**
+     * @brief Write one register with MCP23017 side effects
+     */
+    static void writeRegister(Board& board, uint8_t reg, uint8_t value);
+
+    /**
+     * @brief Read one register with MCP23017 semantics
+     */
+    static uint8_t readRegister(const Board& board, uint8_t reg);
+};
+
+#endif // SOLENOID_SIM_BUS_H
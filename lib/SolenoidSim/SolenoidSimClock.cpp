@@ -0,0 +1,31 @@
+/**
+ * @file SolenoidSimClock.cpp
+ * @brief Implementation of SolenoidSimClock class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SolenoidSimClock.h"
+
+uint64_t SolenoidSimClock::s_nowNs = 0;
+
+void SolenoidSimClock::reset() {
+    s_nowNs = 0;
+}
+
+uint64_t SolenoidSimClock::nowNs() {
+    return s_nowNs;
+}
+
+uint64_t SolenoidSimClock::nowUs() {
+    return s_nowNs / 1000;
+}
+
+void SolenoidSimClock::advanceNs(uint64_t ns) {
+    s_nowNs += ns;
+}
+
+void SolenoidSimClock::advanceUs(uint64_t us) {
+    s_nowNs += us * 1000;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file SolenoidSimClock.h
+ * @brief Virtual time for the host simulation build
+ *
+ * micros(), millis() and delay() of the simulation's Arduino shim read and
+ * advance this clock instead of the host's, so the driver's timebase, the
+ * scheduler and every timeout run on simulated time. Time only moves when
+ * the simulation advances it (once per loop pass) or when a bus
+ * transaction clocks bits, which makes runs deterministic and lets them
+ * go as fast as the host can execute the code.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_SIM_CLOCK_H
+#define SOLENOID_SIM_CLOCK_H
+
+#include <stdint.h>
+
+/**
+ * @class SolenoidSimClock
+ * @brief Global nanosecond-resolution virtual clock
+ */
+class SolenoidSimClock {
+public:
+    /**
+     * @brief Restart virtual time at zero
+     */
+    static void reset();
+
+    /**
+     * @brief Get the virtual time
+     *
+     * @return Nanoseconds since reset()
+     */
+    static uint64_t nowNs();
+
+    /**
+     * @brief Get the virtual time
+     *
+     * @return Microseconds since reset()
+     */
+    static uint64_t nowUs();
+
+    /**
+     * @brief Move virtual time forward
+     *
+     * @param ns Nanoseconds to advance
+     */
+    static void advanceNs(uint64_t ns);
+
+    /**
+     * @brief Move virtual time forward
+     *
+     * @param us Microseconds to advance
+     */
+    static void advanceUs(uint64_t us);
+
+private:
+    static uint64_t s_nowNs;    ///< Virtual time (ns)
+};
+
+#endif // SOLENOID_SIM_CLOCK_H
@@ -0,0 +1,13 @@
+/**
+ * @file Wire.cpp
+ * @brief Bus instances of the simulation's TwoWire stand-in
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "Wire.h"
+
+TwoWire Wire;
+TwoWire Wire1;
+TwoWire Wire2;
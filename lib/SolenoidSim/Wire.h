@@ -0,0 +1,47 @@
+/**
+ * @file Wire.h
+ * @brief TwoWire stand-in for the host simulation build
+ *
+ * Nothing answers on these buses: every transmission is NACKed. The
+ * simulation drives its boards through SolenoidSimBus instead; this only
+ * lets code written against TwoWire compile.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SOLENOID_SIM_WIRE_H
+#define SOLENOID_SIM_WIRE_H
+
+#include "Arduino.h"
+
+/**
+ * @class TwoWire
+ * @brief I2C bus with no devices
+ */
+class TwoWire : public Stream {
+public:
+    void begin() {}
+    void end() {}
+    void setClock(uint32_t hz) { (void)hz; }
+    void setSDA(uint8_t pin) { (void)pin; }
+    void setSCL(uint8_t pin) { (void)pin; }
+
+    void beginTransmission(uint8_t address) { (void)address; }
+    uint8_t endTransmission(bool sendStop = true) { (void)sendStop; return 2; }   // Address NACK
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true) {
+        (void)address;
+        (void)quantity;
+        (void)sendStop;
+        return 0;
+    }
+
+    size_t write(uint8_t value) override { (void)value; return 1; }
+    using Print::write;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+extern TwoWire Wire2;
+
+#endif // SOLENOID_SIM_WIRE_H
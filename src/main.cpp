@@ -10,8 +10,9 @@
  *   - Adafruit I2C Solenoid Driver (Product ID 6318)
  *   - I2C: SDA=Pin 18, SCL=Pin 19 (Wire)
  *   - Default I2C Address: 0x20
+ *   - DIN MIDI IN: Serial1 RX (Pin 0) through the usual 6N138 optocoupler
  *
- * MIDI Mapping:
+ * MIDI Mapping (KEYMAP_RANGES, any MIDI channel):
  *   - Note 60 (C4)  -> Solenoid Channel 0
  *   - Note 61 (C#4) -> Solenoid Channel 1
  *   - Note 62 (D4)  -> Solenoid Channel 2
@@ -20,10 +21,35 @@
  *   - Note 65 (F4)  -> Solenoid Channel 5
  *   - Note 66 (F#4) -> Solenoid Channel 6
  *   - Note 67 (G4)  -> Solenoid Channel 7
+ *   - CC64 (sustain) and CC66 (sostenuto) hold released notes; their coils
+ *     are let go after PEDAL_HOLD_MS
+ *   - USB and DIN messages are merged in arrival order
+ *
+ * Unattended playback:
+ *   - SMF_PATH on the built-in SD card plays at startup if present
+ *   - The file's own pedals hold the file's notes with the same
+ *     PEDAL_HOLD_MS, independently of the live MIDI pedals
+ *
+ * Stored settings:
+ *   - The driver configuration, velocity curves, strike latencies, coil
+ *     currents and key ranges saved with 'w' replace the constants below
+ *     at every boot, until erased with 'e'
+ *   - FAST_BOOT skips the serial monitor wait for a sub-second start
+ *
+ * Event log:
+ *   - 'l' records every MIDI message, scheduler decision, rejection and
+ *     board write to EVENT_LOG_PATH on the SD card, 16 bytes per event,
+ *     for replay with the host simulation (src/sim)
  *
  * Serial Commands (for debugging):
  *   'x' - Emergency stop (all off)
- *   's' - Print status
+ *   'w' - Save the current settings to EEPROM
+ *   'e' - Erase the stored settings (constants are used from the next boot)
+ *   'p' - Play SMF_PATH from the start / stop playback
+ *   'b' - Run the latency benchmarks (teensy41_bench build only)
+ *   'm' - Start/stop streaming driver metrics as USB MIDI SysEx
+ *   'l' - Start/stop recording the event log to the SD card
+ *   's' - Print status (including the driver metrics)
  *   'h' - Show help menu
  *
  * @author Mechanical MIDI Piano Project
@@ -33,7 +59,16 @@
 
 #include <Arduino.h>
 #include <Wire.h>
-#include "SolenoidDriver.h"
+#include "SolenoidDriverT.h"
+#include "SolenoidConfigStore.h"
+#include "MidiKeymap.h"
+#include "MidiPedals.h"
+#include "MidiInput.h"
+#include "MidiFilePlayer.h"
+
+#if defined(SOLENOID_BENCHMARK)
+#include "SolenoidBenchmark.h"
+#endif
 
 // =============================================================================
 // CONFIGURATION CONSTANTS
@@ -44,12 +79,22 @@
  * @{
  */
 
-/** I2C bus speed in Hz (400kHz recommended for MCP23017) */
-constexpr uint32_t I2C_CLOCK_SPEED = 400000;
+/**
+ * Fastest I2C bus speed to try in Hz (1MHz Fast-mode Plus).
+ * The driver verifies every board and falls back to 400kHz/100kHz if needed.
+ */
+constexpr uint32_t I2C_CLOCK_SPEED = 1000000;
 
 /** Default I2C address for MCP23017 (A0=A1=A2=0) */
 constexpr uint8_t MCP23017_DEFAULT_ADDRESS = 0x20;
 
+/**
+ * Pin wired to the boards' shared RESET line (active low).
+ * With the line connected, an emergency stop releases every coil with one
+ * pulse; SOLENOID_NO_PIN clears the boards over I2C instead.
+ */
+constexpr uint8_t BOARD_RESET_PIN = SOLENOID_NO_PIN;
+
 /** @} */
 
 /**
@@ -57,7 +102,10 @@ constexpr uint8_t MCP23017_DEFAULT_ADDRESS = 0x20;
  * @{
  */
 
-/** Number of solenoid channels on the driver board */
+/** Number of solenoid driver boards */
+constexpr uint8_t NUM_BOARDS = 1;
+
+/** Number of solenoid channels on the driver board (8 = Port A only) */
 constexpr uint8_t NUM_CHANNELS = 8;
 
 /** @note Timing calculations use unsigned 32-bit subtraction which is safe
@@ -76,6 +124,20 @@ constexpr uint32_t MAX_ON_TIME_MS = 2000;
  */
 constexpr uint32_t MIN_OFF_TIME_MS = 15;
 
+/**
+ * Timing core tick rate in Hz (hardware IntervalTimer)
+ * Scheduled edges and timeouts run at 100us resolution, independent of
+ * how long loop() spends on serial I/O
+ */
+constexpr uint32_t TICK_HZ = 10000;
+
+/**
+ * Maximum solenoids energized at once
+ * Larger chords are staggered by a few hundred microseconds so the
+ * supply is not browned out
+ */
+constexpr uint8_t MAX_ACTIVE_COILS = 6;
+
 /** @} */
 
 /**
@@ -95,8 +157,73 @@ constexpr uint8_t MIDI_NOTE_LOW = 60;
  */
 constexpr uint8_t MIDI_NOTE_HIGH = 67;
 
+/**
+ * Note-to-solenoid wiring, one entry per run of consecutive keys
+ * Add entries for more boards, splits by MIDI channel, or keys wired out
+ * of order; later entries override earlier ones
+ */
+constexpr MidiKeyRange KEYMAP_RANGES[] = {
+    { MIDI_OMNI, MIDI_NOTE_LOW, MIDI_NOTE_HIGH, 0, 1 },   // C4-G4 -> channels 0-7
+};
+
+/**
+ * Longest a pedal-held note keeps its coil energized after the strike (ms)
+ * The note still counts as sounding until the pedal is lifted, but the
+ * coil cools down in the meantime
+ */
+constexpr uint32_t PEDAL_HOLD_MS = 250;
+
+/** Read DIN MIDI from Serial1 as well as USB */
+constexpr bool DIN_MIDI_ENABLED = true;
+
+/**
+ * Rate of the interrupt that drains the DIN port (Hz)
+ * Timestamps each message within 250us of its arrival, however long
+ * loop() is busy elsewhere
+ */
+constexpr uint32_t MIDI_POLL_HZ = 4000;
+
 /** @} */
 
+/**
+ * @defgroup PlaybackConfig SD Card Playback Configuration
+ * @{
+ */
+
+/** Standard MIDI File (type 0 or 1) played from the built-in SD slot */
+constexpr const char* SMF_PATH = "/piano.mid";
+
+/** Start playing SMF_PATH at power-up, for unattended operation */
+constexpr bool SMF_AUTOPLAY = true;
+
+/**
+ * How far ahead file notes are queued in the driver (us)
+ * Covers the strike latency and the slowest loop() pass (serial output)
+ */
+constexpr uint32_t SMF_LOOKAHEAD_US = 50000;
+
+/** @} */
+
+#if defined(SOLENOID_BENCHMARK)
+
+/**
+ * @defgroup BenchConfig Benchmark Configuration
+ * @{
+ */
+
+/** Event rates each workload is run at (Hz) */
+constexpr uint32_t BENCH_RATES_HZ[] = { 10, 40, 100 };
+
+/** Length of each benchmark run (ms) */
+constexpr uint32_t BENCH_DURATION_MS = 1000;
+
+/** Strike velocity of benchmark notes - low, the coils may be connected */
+constexpr uint8_t BENCH_VELOCITY = 16;
+
+/** @} */
+
+#endif
+
 /**
  * @defgroup Pins Pin Definitions
  * @{
@@ -107,12 +234,128 @@ constexpr uint8_t LED_PIN = LED_BUILTIN;
 
 /** @} */
 
+/**
+ * @defgroup DiagConfig Diagnostics Configuration
+ * @{
+ */
+
+/**
+ * Maximum deferred error records printed per loop() pass
+ * Keeps a burst of errors from stalling MIDI processing
+ */
+constexpr uint8_t MAX_ERRORS_PER_LOOP = 4;
+
+/**
+ * Rate of the driver metrics SysEx frames while streaming is on (Hz)
+ * Each frame is about 200 bytes - a small share of USB MIDI bandwidth
+ */
+constexpr uint32_t METRICS_STREAM_HZ = 10;
+
+/** Stream metrics from power-up rather than waiting for the 'm' command */
+constexpr bool METRICS_STREAM_AT_STARTUP = false;
+
+/** Event log file on the SD card, replaced each time recording starts */
+constexpr const char* EVENT_LOG_PATH = "/events.log";
+
+/** Record the event log from power-up rather than waiting for the 'l' command */
+constexpr bool EVENT_LOG_AT_STARTUP = false;
+
+/** Longest gap between SYNC records (ms) - well inside the 7s cycle counter wrap */
+constexpr uint32_t EVENT_LOG_SYNC_MS = 1000;
+
+/**
+ * How often the log file's directory entry is brought up to date (ms)
+ * A power cut loses at most this much of the log
+ */
+constexpr uint32_t EVENT_LOG_FLUSH_MS = 2000;
+
+/** @} */
+
+/**
+ * @defgroup BootConfig Startup and Stored Settings
+ * @{
+ */
+
+/**
+ * Start playing as soon as the hardware is up: no wait for the serial
+ * monitor and no settle delays. Startup messages printed before a monitor
+ * attaches are lost.
+ */
+constexpr bool FAST_BOOT = false;
+
+/** Longest wait for the serial monitor to attach without FAST_BOOT (ms) */
+constexpr uint32_t SERIAL_WAIT_MS = 3000;
+
+/** EEPROM offset of the stored settings blob */
+constexpr uint16_t SETTINGS_EEPROM_ADDRESS = SOLENOID_STORE_DEFAULT_ADDRESS;
+
+/** Key ranges the stored settings can hold */
+constexpr uint8_t MAX_KEY_RANGES = 16;
+
+/** @} */
+
 // =============================================================================
 // GLOBAL OBJECTS
 // =============================================================================
 
-/** SolenoidDriver instance for MCP23017 control */
-SolenoidDriver solenoidDriver;
+/** SolenoidDriver for MCP23017 control, sized for exactly this rig at compile time */
+SolenoidDriverT<NUM_BOARDS, NUM_CHANNELS / NUM_BOARDS> solenoidDriver;
+
+/**
+ * (MIDI channel, note) -> solenoid table, generated at compile time and
+ * rebuilt at startup if the stored settings hold other key ranges
+ */
+MidiKeymap keymap(KEYMAP_RANGES);
+
+/**
+ * @struct StoredSettings
+ * @brief This sketch's part of the settings blob (SolenoidConfigStore user data)
+ */
+struct StoredSettings
+{
+    uint8_t keyRangeCount;                     ///< Entries used in keyRanges
+    MidiKeyRange keyRanges[MAX_KEY_RANGES];    ///< Note-to-solenoid wiring
+};
+
+static_assert(sizeof(StoredSettings) <= SOLENOID_STORE_USER_BYTES, "StoredSettings does not fit the blob");
+static_assert(sizeof(KEYMAP_RANGES) / sizeof(KEYMAP_RANGES[0]) <= MAX_KEY_RANGES, "Too many KEYMAP_RANGES");
+
+/** Settings in use; saved with 'w' */
+StoredSettings settings;
+
+/** Tuned settings in EEPROM: driver configuration, calibration and keymap */
+SolenoidConfigStore settingsStore(SETTINGS_EEPROM_ADDRESS);
+
+/** USB and DIN MIDI sources, merged in arrival order */
+MidiInput midiInput;
+
+/** Sustain/sostenuto state between the MIDI handlers and the driver */
+MidiPedals pedals(solenoidDriver);
+
+/** Standard MIDI File player feeding the driver's note scheduler */
+MidiFilePlayer player(solenoidDriver, keymap);
+
+/** SD card found at startup */
+bool sdReady = false;
+
+/** Metrics SysEx frames are being sent */
+bool metricsStreaming = METRICS_STREAM_AT_STARTUP;
+
+/** MIDI in and driver decisions, waiting to be written to eventLogFile */
+SolenoidEventLog eventLog;
+
+/** EVENT_LOG_PATH while the event log is being written */
+File eventLogFile;
+
+#if defined(SOLENOID_BENCHMARK)
+
+/** Latency/throughput benchmark driving the MIDI note handlers */
+SolenoidBenchmark benchmark(solenoidDriver);
+
+/** MIDI note of each solenoid channel, for the benchmark (0xFF = none) */
+uint8_t benchNotes[NUM_CHANNELS];
+
+#endif
 
 // =============================================================================
 // FUNCTION PROTOTYPES
@@ -124,15 +367,39 @@ void initI2C();
 bool initMCP23017();
 
 // MIDI Handlers
-int8_t noteToChannel(uint8_t note);
+uint8_t noteToChannel(uint8_t channel, uint8_t note);
+void initMidiInput();
+void handleMidiMessage(const MidiMessage& message);
 void handleNoteOn(byte channel, byte note, byte velocity);
 void handleNoteOff(byte channel, byte note, byte velocity);
+void handleControlChange(byte channel, byte control, byte value);
+
+// SD Card Playback
+void initPlayer();
+void startPlayback();
+
+// Stored Settings
+void loadSettings();
+void saveSettings();
+void eraseSettings();
 
 // Solenoid Control
 void deactivateAllChannels();
 
+// Diagnostics
+void drainErrors();
+void streamMetrics();
+void startEventLog();
+void stopEventLog();
+void flushEventLog();
+#if defined(SOLENOID_BENCHMARK)
+void benchNote(uint8_t channel, uint8_t velocity);
+void runBenchmarks();
+#endif
+
 // Utility Functions
 void printSeparator();
+void printChannelNote(uint8_t channel);
 void printHelp();
 void printStatus();
 void handleSerialInput();
@@ -162,6 +429,9 @@ void setup()
     printSeparator();
     Serial.println();
 
+    // Stored tuning replaces the defaults before the driver starts
+    loadSettings();
+
     // Initialize I2C bus
     initI2C();
 
@@ -176,15 +446,33 @@ void setup()
         Serial.println(F("Check wiring and I2C address."));
     }
 
-    // Register MIDI callbacks
-    usbMIDI.setHandleNoteOn(handleNoteOn);
-    usbMIDI.setHandleNoteOff(handleNoteOff);
-    Serial.println(F("[OK] MIDI handlers registered"));
-    Serial.print(F("  Listening for notes "));
-    Serial.print(MIDI_NOTE_LOW);
-    Serial.print(F("-"));
-    Serial.print(MIDI_NOTE_HIGH);
-    Serial.println(F(" (C4-G4)"));
+    // Open the MIDI inputs
+    initMidiInput();
+    solenoidDriver.setEventLog(&eventLog);
+    pedals.setPedalHoldMs(PEDAL_HOLD_MS);
+    for (uint8_t i = 0; i < settings.keyRangeCount; i++)
+    {
+        const MidiKeyRange& range = settings.keyRanges[i];
+        Serial.print(F("  Notes "));
+        Serial.print(range.firstNote);
+        Serial.print(F("-"));
+        Serial.print(range.lastNote);
+        if (range.midiChannel == MIDI_OMNI)
+        {
+            Serial.print(F(" (any channel)"));
+        }
+        else
+        {
+            Serial.print(F(" (channel "));
+            Serial.print(range.midiChannel);
+            Serial.print(F(")"));
+        }
+        Serial.print(F(" -> solenoid "));
+        Serial.println(range.firstSolenoid);
+    }
+
+    // Unattended playback from the SD card
+    initPlayer();
 
     // Print help menu
     Serial.println();
@@ -204,16 +492,34 @@ void setup()
  */
 void loop()
 {
-    // Process all pending MIDI messages
-    // This calls handleNoteOn/handleNoteOff callbacks as needed
-    while (usbMIDI.read()) { }
-
-    // SolenoidDriver safety update - handles auto-shutoff for max on-time
+    // Process pending MIDI messages from every source, oldest first
+    // This calls handleNoteOn/handleNoteOff as needed. Notes are staged and
+    // committed together so a chord costs one write per board (with the
+    // hardware tick, the next tick applies them together instead).
+    solenoidDriver.beginTransaction();
+    midiInput.update(handleMidiMessage);
+    pedals.update(); // Let go of pedal-held coils whose hold time is over
+    solenoidDriver.commit();
+
+    // Queue the file notes coming due (and refill the SD read buffers)
+    player.update();
+
+    // SolenoidDriver update - auto-shutoff and scheduled edges when polled,
+    // only the periodic latch check when the hardware tick is active
     if (solenoidDriver.isInitialized())
     {
         solenoidDriver.update();
     }
 
+    // Print errors recorded during note handling (low priority)
+    drainErrors();
+
+    // Telemetry for a host tool, when enabled
+    streamMetrics();
+
+    // Write out the event log a sector at a time, when recording
+    flushEventLog();
+
     // Handle incoming serial commands (emergency stop, status, help)
     handleSerialInput();
 }
@@ -225,16 +531,20 @@ void loop()
 /**
  * @brief Initialize serial communication
  *
- * Waits for serial port to be ready (up to 3 seconds).
- * Uses 115200 baud rate as configured in platformio.ini.
+ * Waits for serial port to be ready (up to SERIAL_WAIT_MS) unless
+ * FAST_BOOT is set. Uses 115200 baud rate as configured in platformio.ini.
  */
 void initSerial()
 {
     Serial.begin(115200);
+    if (FAST_BOOT)
+    {
+        return;
+    }
 
     // Wait for serial port to connect (with timeout for standalone operation)
     uint32_t startTime = millis();
-    while (!Serial && (millis() - startTime < 3000))
+    while (!Serial && (millis() - startTime < SERIAL_WAIT_MS))
     {
         delay(10);
     }
@@ -259,7 +569,12 @@ void initI2C()
     Wire.begin();
     Wire.setClock(I2C_CLOCK_SPEED);
 
-    delay(100); // Allow bus to stabilize
+    // The driver probes every board before using it, so the bus needs no
+    // settle time on a fast boot
+    if (!FAST_BOOT)
+    {
+        delay(100); // Allow bus to stabilize
+    }
 
     Serial.println(F("[OK] I2C bus initialized"));
 }
@@ -284,11 +599,22 @@ bool initMCP23017()
     config.maxOnTimeMs = MAX_ON_TIME_MS;
     config.minOffTimeMs = MIN_OFF_TIME_MS;
     config.i2cClockHz = I2C_CLOCK_SPEED;
+    config.i2cSpeedFallback = true;
     config.safetyEnabled = true;
     config.debugEnabled = false;
     config.maxDutyCycle = 0.75f; // 75% maximum duty cycle for solenoid protection
+    config.asyncTransmit = true; // Keep polling USB MIDI while the I2C bus is busy
+    config.resyncIntervalMs = 5000; // Check output latches for drift every 5 seconds
+    config.tickHz = TICK_HZ; // Run the timing core from a hardware timer
+    config.maxActiveCoils = MAX_ACTIVE_COILS; // Stagger strikes beyond the supply's capacity
+    config.timebase = SolenoidTimebaseSource::CYCLE_COUNTER; // Sub-microsecond edge timestamps
+    config.retrigger = SolenoidRetriggerPolicy::DEFER; // Repeated notes restrike instead of being dropped
+    config.resetPin = BOARD_RESET_PIN; // Emergency stop by hardware reset when wired
     solenoidDriver.setConfig(config);
 
+    // Tuned configuration and calibration saved with 'w' take precedence
+    settingsStore.apply(solenoidDriver);
+
     // Initialize with SolenoidDriver library
     if (!solenoidDriver.begin(Wire, MCP23017_DEFAULT_ADDRESS))
     {
@@ -299,6 +625,19 @@ bool initMCP23017()
     }
 
     Serial.println(F("  SolenoidDriver initialized, all channels OFF"));
+    Serial.print(F("  I2C clock: "));
+    Serial.print(solenoidDriver.getI2CClockHz() / 1000);
+    Serial.println(F(" kHz"));
+    Serial.print(F("  Timing core: "));
+    if (solenoidDriver.isTickActive())
+    {
+        Serial.print(TICK_HZ);
+        Serial.println(F(" Hz hardware tick"));
+    }
+    else
+    {
+        Serial.println(F("loop() polled"));
+    }
 
     return true;
 }
@@ -308,30 +647,80 @@ bool initMCP23017()
 // =============================================================================
 
 /**
- * @brief Convert MIDI note number to solenoid channel
+ * @brief Convert MIDI channel and note number to solenoid channel
  *
+ * @param channel MIDI channel (1-16)
  * @param note MIDI note number (0-127)
- * @return Channel number (0-7) if note is in range, -1 otherwise
+ * @return Solenoid channel, or MIDI_KEYMAP_UNMAPPED if the note is not wired
  *
- * Maps notes 60-67 (C4 through G4) to channels 0-7.
+ * A single table read - see KEYMAP_RANGES.
  */
-int8_t noteToChannel(uint8_t note)
+uint8_t noteToChannel(uint8_t channel, uint8_t note)
 {
-    if (note < MIDI_NOTE_LOW || note > MIDI_NOTE_HIGH)
+    return keymap.lookup(channel, note);
+}
+
+/**
+ * @brief Open the USB and DIN MIDI inputs
+ *
+ * USB is read from loop(); the DIN port is drained by a timer interrupt so
+ * its messages keep their arrival time.
+ */
+void initMidiInput()
+{
+    if (midiInput.addUsb() != MIDI_INPUT_NO_SOURCE)
+    {
+        Serial.println(F("[OK] USB MIDI input"));
+    }
+    if (DIN_MIDI_ENABLED && midiInput.addSerial(Serial1) != MIDI_INPUT_NO_SOURCE)
     {
-        return -1;
+        Serial.println(F("[OK] DIN MIDI input on Serial1"));
+    }
+
+    if (!midiInput.begin(MIDI_POLL_HZ))
+    {
+        Serial.println(F("[WARN] No timer for MIDI input - polling from loop()"));
+    }
+}
+
+/**
+ * @brief Dispatch one merged MIDI message
+ *
+ * @param message Channel message from any source
+ *
+ * Called by midiInput.update() for each message, oldest first.
+ */
+void handleMidiMessage(const MidiMessage& message)
+{
+    uint8_t channel = (message.status & 0x0F) + 1;
+
+    eventLog.record(SolenoidLogType::MIDI_IN, message.source, message.status, message.data1,
+                    message.data2, message.timeUs);
+
+    switch (message.status & 0xF0)
+    {
+        case 0x90:
+            handleNoteOn(channel, message.data1, message.data2);
+            break;
+        case 0x80:
+            handleNoteOff(channel, message.data1, message.data2);
+            break;
+        case 0xB0:
+            handleControlChange(channel, message.data1, message.data2);
+            break;
+        default:
+            break;  // Other messages do not drive solenoids
     }
-    return note - MIDI_NOTE_LOW;
 }
 
 /**
  * @brief Handle MIDI Note On messages
  *
- * @param channel MIDI channel (1-16, ignored - we respond to all channels)
+ * @param channel MIDI channel (1-16, used by the keymap)
  * @param note MIDI note number (0-127)
  * @param velocity Note velocity (0-127, 0 treated as note-off)
  *
- * Called automatically by usbMIDI when a Note On message is received.
+ * Called by handleMidiMessage() when a Note On message is received.
  * Velocity 0 is treated as Note Off per MIDI specification.
  */
 void handleNoteOn(byte channel, byte note, byte velocity)
@@ -343,10 +732,10 @@ void handleNoteOn(byte channel, byte note, byte velocity)
         return;
     }
 
-    int8_t ch = noteToChannel(note);
-    if (ch < 0)
+    uint8_t ch = noteToChannel(channel, note);
+    if (ch == MIDI_KEYMAP_UNMAPPED)
     {
-        return;  // Note not in our range
+        return;  // Note not wired to a solenoid
     }
 
     if (!solenoidDriver.isInitialized())
@@ -354,34 +743,29 @@ void handleNoteOn(byte channel, byte note, byte velocity)
         return;
     }
 
-    // Turn on the solenoid
-    SolenoidError err = solenoidDriver.on(ch);
-    if (err != SolenoidError::OK)
-    {
-        Serial.print(F("[MIDI] Note "));
-        Serial.print(note);
-        Serial.print(F(" ON failed: "));
-        Serial.println(SolenoidDriver::getErrorString(err));
-    }
+    // Strike with the note's velocity (kick, then reduced-power hold).
+    // Failures are recorded by the driver and printed later by
+    // drainErrors(), never from here
+    pedals.noteOn(channel, ch, velocity);
 }
 
 /**
  * @brief Handle MIDI Note Off messages
  *
- * @param channel MIDI channel (1-16, ignored)
+ * @param channel MIDI channel (1-16, used by the keymap)
  * @param note MIDI note number (0-127)
  * @param velocity Release velocity (0-127, ignored)
  *
- * Called automatically by usbMIDI when a Note Off message is received.
+ * Called by handleMidiMessage() when a Note Off message is received.
  */
 void handleNoteOff(byte channel, byte note, byte velocity)
 {
     (void)velocity;  // Unused parameter
 
-    int8_t ch = noteToChannel(note);
-    if (ch < 0)
+    uint8_t ch = noteToChannel(channel, note);
+    if (ch == MIDI_KEYMAP_UNMAPPED)
     {
-        return;  // Note not in our range
+        return;  // Note not wired to a solenoid
     }
 
     if (!solenoidDriver.isInitialized())
@@ -389,15 +773,185 @@ void handleNoteOff(byte channel, byte note, byte velocity)
         return;
     }
 
-    // Turn off the solenoid
-    SolenoidError err = solenoidDriver.off(ch);
-    if (err != SolenoidError::OK)
+    // Turn off the solenoid, unless a pedal holds the note (failures are
+    // reported by drainErrors())
+    pedals.noteOff(channel, ch);
+}
+
+/**
+ * @brief Handle MIDI Control Change messages
+ *
+ * @param channel MIDI channel (1-16)
+ * @param control Controller number (0-127)
+ * @param value Controller value (0-127)
+ *
+ * Called by handleMidiMessage() when a Control Change message is received,
+ * and by the SMF player for the controllers it does not apply itself.
+ * Sustain, sostenuto and the all-notes/all-sound-off channel mode messages
+ * are applied by MidiPedals; other controllers are ignored.
+ */
+void handleControlChange(byte channel, byte control, byte value)
+{
+    if (!solenoidDriver.isInitialized())
     {
-        Serial.print(F("[MIDI] Note "));
-        Serial.print(note);
-        Serial.print(F(" OFF failed: "));
-        Serial.println(SolenoidDriver::getErrorString(err));
+        return;
+    }
+
+    pedals.controlChange(channel, control, value);
+}
+
+// =============================================================================
+// SD CARD PLAYBACK FUNCTIONS
+// =============================================================================
+
+/**
+ * @brief Initialize the SD card and start SMF_PATH if SMF_AUTOPLAY is set
+ *
+ * The file's pedals are applied by the player on the file's timeline, so
+ * they hold only the file's notes; live pedals hold only live notes.
+ */
+void initPlayer()
+{
+    player.setLookaheadUs(SMF_LOOKAHEAD_US);
+    player.setPedalHoldMs(PEDAL_HOLD_MS);
+    player.setControlChangeHandler(handleControlChange);
+
+    sdReady = SD.begin(BUILTIN_SDCARD);
+    if (!sdReady)
+    {
+        Serial.println(F("[--] No SD card - USB MIDI only"));
+        return;
+    }
+    Serial.println(F("[OK] SD card found"));
+
+    if (EVENT_LOG_AT_STARTUP)
+    {
+        startEventLog();
+    }
+
+    if (SMF_AUTOPLAY)
+    {
+        startPlayback();
+    }
+}
+
+/**
+ * @brief Open SMF_PATH and play it from the start
+ */
+void startPlayback()
+{
+    if (!sdReady || !solenoidDriver.isInitialized())
+    {
+        Serial.println(F("[ERROR] Playback needs the SD card and the driver"));
+        return;
+    }
+
+    if (!player.open(SMF_PATH) || !player.play())
+    {
+        Serial.print(F("[ERROR] Cannot play "));
+        Serial.print(SMF_PATH);
+        Serial.print(F(": "));
+        Serial.println(MidiFilePlayer::getErrorString(player.getError()));
+        return;
+    }
+
+    Serial.print(F("[OK] Playing "));
+    Serial.print(SMF_PATH);
+    Serial.print(F(" (format "));
+    Serial.print(player.getFormat());
+    Serial.print(F(", "));
+    Serial.print(player.getTrackCount());
+    Serial.println(F(" tracks)"));
+}
+
+// =============================================================================
+// STORED SETTINGS FUNCTIONS
+// =============================================================================
+
+/**
+ * @brief Read the stored settings and rebuild the keymap from them
+ *
+ * One bulk EEPROM read; the driver part is applied by initMCP23017(). A
+ * missing, stale or corrupt blob leaves the compiled-in defaults.
+ */
+void loadSettings()
+{
+    settings.keyRangeCount = 0;
+    for (const MidiKeyRange& range : KEYMAP_RANGES)
+    {
+        settings.keyRanges[settings.keyRangeCount++] = range;
+    }
+
+    uint32_t startUs = micros();
+    SolenoidStoreStatus status = settingsStore.load();
+    uint32_t elapsedUs = micros() - startUs;
+
+    if (status != SolenoidStoreStatus::OK)
+    {
+        Serial.print(F("[--] Default settings: "));
+        Serial.println(SolenoidConfigStore::getStatusString(status));
+        return;
     }
+
+    StoredSettings stored;
+    if (settingsStore.getUserData(&stored, sizeof(stored)) == sizeof(stored) &&
+        stored.keyRangeCount <= MAX_KEY_RANGES)
+    {
+        settings = stored;
+        keymap.build(settings.keyRanges, settings.keyRangeCount);
+    }
+
+    Serial.print(F("[OK] Settings loaded from EEPROM ("));
+    Serial.print(settingsStore.getLength());
+    Serial.print(F(" bytes in "));
+    Serial.print(elapsedUs);
+    Serial.println(F(" us)"));
+}
+
+/**
+ * @brief Save the driver's current settings and the key ranges
+ *
+ * Programming flash holds off interrupts, the safety tick included, so the
+ * coils are turned off first.
+ */
+void saveSettings()
+{
+    if (!solenoidDriver.isInitialized())
+    {
+        Serial.println(F("[ERROR] Settings can only be saved from a running driver"));
+        return;
+    }
+
+    deactivateAllChannels();
+
+    settingsStore.setUserData(&settings, sizeof(settings));
+    settingsStore.capture(solenoidDriver);
+    SolenoidStoreStatus status = settingsStore.save();
+    if (status != SolenoidStoreStatus::OK)
+    {
+        Serial.print(F("[ERROR] Settings not saved: "));
+        Serial.println(SolenoidConfigStore::getStatusString(status));
+        return;
+    }
+
+    Serial.print(F("[OK] Settings saved ("));
+    Serial.print(settingsStore.getLength());
+    Serial.println(F(" bytes)"));
+}
+
+/**
+ * @brief Erase the stored settings - the constants apply from the next boot
+ */
+void eraseSettings()
+{
+    SolenoidStoreStatus status = settingsStore.erase();
+    if (status != SolenoidStoreStatus::OK)
+    {
+        Serial.print(F("[ERROR] Settings not erased: "));
+        Serial.println(SolenoidConfigStore::getStatusString(status));
+        return;
+    }
+    Serial.println(F("[OK] Stored settings erased (defaults from the next boot)"));
 }
 
 // =============================================================================
@@ -413,15 +967,295 @@ void handleNoteOff(byte channel, byte note, byte velocity)
  */
 void deactivateAllChannels()
 {
+    if (player.isPlaying())
+    {
+        player.stop();
+    }
+
     if (solenoidDriver.isInitialized())
     {
         solenoidDriver.emergencyStop();
         solenoidDriver.resetAllStats();
     }
 
+    // Every coil is off - forget sounding notes and pedals too
+    pedals.reset();
+
     Serial.println(F("[OK] All channels deactivated"));
 }
 
+// =============================================================================
+// DIAGNOSTIC FUNCTIONS
+// =============================================================================
+
+/**
+ * @brief Print deferred driver errors
+ *
+ * Errors raised inside the MIDI handlers are queued by the driver rather
+ * than printed, so a burst of cooldown rejections cannot block the USB
+ * stack. This prints at most MAX_ERRORS_PER_LOOP records per call, plus a
+ * notice whenever records were dropped because the ring overflowed.
+ */
+void drainErrors()
+{
+    static uint32_t reportedDrops = 0;
+
+    SolenoidErrorRecord rec;
+    for (uint8_t i = 0; i < MAX_ERRORS_PER_LOOP && solenoidDriver.popError(rec); i++)
+    {
+        Serial.print(F("[ERROR] t="));
+        Serial.print(rec.timeUs);
+        Serial.print(F("us "));
+        Serial.print(SolenoidDriver::getErrorString(rec.code));
+        if (rec.channel != 255)
+        {
+            Serial.print(F(" on channel "));
+            Serial.print(rec.channel);
+            printChannelNote(rec.channel);
+        }
+        Serial.println();
+    }
+
+    uint32_t drops = solenoidDriver.getDroppedErrorCount();
+    if (drops != reportedDrops)
+    {
+        Serial.print(F("[ERROR] "));
+        Serial.print(drops - reportedDrops);
+        Serial.println(F(" error record(s) dropped (queue full)"));
+        reportedDrops = drops;
+    }
+}
+
+/**
+ * @brief Send the driver metrics as a SysEx frame at METRICS_STREAM_HZ
+ *
+ * Goes out over USB MIDI rather than the serial console so the binary
+ * frames never mix with the text output. Does nothing until streaming is
+ * turned on with the 'm' command (or METRICS_STREAM_AT_STARTUP). If the
+ * host is not reading, the USB stack gives up on the frame instead of
+ * stalling loop().
+ */
+void streamMetrics()
+{
+#if defined(MIDI_INTERFACE)
+    static uint32_t lastSendMs = 0;
+
+    if (!metricsStreaming || !solenoidDriver.isInitialized() ||
+        (millis() - lastSendMs) < (1000 / METRICS_STREAM_HZ))
+    {
+        return;
+    }
+    lastSendMs = millis();
+
+    static SolenoidMetrics snapshot;
+    static uint8_t frame[SOLENOID_METRICS_SYSEX_MAX];
+    solenoidDriver.getMetrics(snapshot);
+    uint16_t length = snapshot.encodeSysEx(frame, sizeof(frame));
+    if (length > 0)
+    {
+        usbMIDI.sendSysEx(length, frame, true);
+        usbMIDI.send_now();
+    }
+#endif
+}
+
+/**
+ * @brief Replace EVENT_LOG_PATH with a new log and start recording
+ */
+void startEventLog()
+{
+    if (!sdReady)
+    {
+        Serial.println(F("[ERROR] The event log needs the SD card"));
+        return;
+    }
+
+    // A log still being written out is ended first
+    if (eventLogFile)
+    {
+        eventLogFile.close();
+    }
+    SD.remove(EVENT_LOG_PATH);
+    eventLogFile = SD.open(EVENT_LOG_PATH, FILE_WRITE);
+    if (!eventLogFile)
+    {
+        Serial.print(F("[ERROR] Cannot create "));
+        Serial.println(EVENT_LOG_PATH);
+        return;
+    }
+
+    eventLog.start();
+    Serial.print(F("[OK] Recording the event log to "));
+    Serial.println(EVENT_LOG_PATH);
+}
+
+/**
+ * @brief Stop recording; flushEventLog() writes out the rest and closes the file
+ */
+void stopEventLog()
+{
+    eventLog.sync();
+    eventLog.stop();
+    Serial.print(F("[OK] Event log stopped: "));
+    Serial.print(eventLog.getRecordCount());
+    Serial.print(F(" records, "));
+    Serial.print(eventLog.dropCount());
+    Serial.println(F(" dropped"));
+}
+
+/**
+ * @brief Write one chunk of the event log to the SD card
+ *
+ * Full SOLENOID_LOG_CHUNK_RECORDS chunks only, one per loop() pass, so each
+ * write is a single SD sector and the card never holds up MIDI handling for
+ * long; the ring absorbs the bursts in between. Once recording has
+ * stopped the remainder is written and the file closed.
+ */
+void flushEventLog()
+{
+    static uint32_t lastSyncMs = 0;
+    static uint32_t lastFlushMs = 0;
+    static SolenoidLogRecord chunk[SOLENOID_LOG_CHUNK_RECORDS];
+
+    if (!eventLogFile)
+    {
+        return;
+    }
+
+    bool recording = eventLog.isRecording();
+    if (recording && (millis() - lastSyncMs) >= EVENT_LOG_SYNC_MS)
+    {
+        lastSyncMs = millis();
+        eventLog.sync();
+    }
+
+    uint16_t pending = eventLog.pending();
+    if (pending >= SOLENOID_LOG_CHUNK_RECORDS || (!recording && pending > 0))
+    {
+        uint16_t count = eventLog.read(chunk, SOLENOID_LOG_CHUNK_RECORDS);
+        eventLogFile.write(reinterpret_cast<const uint8_t*>(chunk), count * sizeof(SolenoidLogRecord));
+    }
+
+    if (!recording && eventLog.pending() == 0)
+    {
+        eventLogFile.close();
+        return;
+    }
+    if ((millis() - lastFlushMs) >= EVENT_LOG_FLUSH_MS)
+    {
+        lastFlushMs = millis();
+        eventLogFile.flush();
+    }
+}
+
+#if defined(SOLENOID_BENCHMARK)
+
+// =============================================================================
+// BENCHMARK FUNCTIONS
+// =============================================================================
+
+/**
+ * @brief Benchmark note handler
+ *
+ * @param channel Solenoid channel
+ * @param velocity Strike velocity, or 0 to release
+ *
+ * Goes through handleNoteOn()/handleNoteOff() like live MIDI, so the
+ * measurement includes the keymap and pedal handling.
+ */
+void benchNote(uint8_t channel, uint8_t velocity)
+{
+    uint8_t note = benchNotes[channel];
+    if (note == 0xFF)
+    {
+        return;  // No note drives this channel
+    }
+
+    if (velocity > 0)
+    {
+        handleNoteOn(1, note, velocity);
+    }
+    else
+    {
+        handleNoteOff(1, note, 0);
+    }
+}
+
+/**
+ * @brief Run every workload at every BENCH_RATES_HZ rate and print results
+ *
+ * Blocks for about BENCH_DURATION_MS per run; MIDI received meanwhile is
+ * discarded.
+ */
+void runBenchmarks()
+{
+    if (!solenoidDriver.isInitialized())
+    {
+        Serial.println(F("[ERROR] Driver not initialized"));
+        return;
+    }
+    if (player.isPlaying())
+    {
+        player.stop();
+    }
+    pedals.reset();
+
+    // Reverse keymap, built once per run so benchNote() is a table read
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ch++)
+    {
+        benchNotes[ch] = 0xFF;
+    }
+    for (uint8_t note = 0; note < 128; note++)
+    {
+        uint8_t ch = keymap.lookup(1, note);
+        if (ch < NUM_CHANNELS && benchNotes[ch] == 0xFF)
+        {
+            benchNotes[ch] = note;
+        }
+    }
+
+    printSeparator();
+    Serial.println(F("BENCHMARK"));
+    printSeparator();
+
+    const SolenoidBenchWorkload workloads[] = {
+        SolenoidBenchWorkload::CHORD,
+        SolenoidBenchWorkload::TRILL,
+        SolenoidBenchWorkload::GLISSANDO,
+    };
+
+    for (SolenoidBenchWorkload workload : workloads)
+    {
+        for (uint32_t rateHz : BENCH_RATES_HZ)
+        {
+            SolenoidBenchConfig config;
+            config.workload = workload;
+            config.rateHz = rateHz;
+            config.durationMs = BENCH_DURATION_MS;
+            config.channelCount = NUM_CHANNELS;
+            config.velocity = BENCH_VELOCITY;
+
+            if (benchmark.run(config, benchNote))
+            {
+                benchmark.printReport(Serial);
+            }
+            else
+            {
+                Serial.println(F("[ERROR] Benchmark run refused"));
+            }
+            drainErrors();
+        }
+    }
+
+    // Safety refusals during the runs are expected - start clean
+    solenoidDriver.resetAllStats();
+    pedals.reset();
+    midiInput.flush();
+    printSeparator();
+}
+
+#endif
+
 // =============================================================================
 // UTILITY FUNCTIONS
 // =============================================================================
@@ -434,6 +1268,24 @@ void printSeparator()
     Serial.println(F("============================================================"));
 }
 
+/**
+ * @brief Print the MIDI note that drives a solenoid, e.g. " (Note 60)"
+ *
+ * @param channel Solenoid channel
+ *
+ * Prints nothing if no note is mapped to the channel.
+ */
+void printChannelNote(uint8_t channel)
+{
+    uint8_t midiChannel, note;
+    if (keymap.findNote(channel, midiChannel, note))
+    {
+        Serial.print(F(" (Note "));
+        Serial.print(note);
+        Serial.print(F(")"));
+    }
+}
+
 /**
  * @brief Print the help menu
  */
@@ -441,10 +1293,20 @@ void printHelp()
 {
     Serial.println(F("SERIAL COMMANDS:"));
     Serial.println(F("  'x' - Emergency stop (all solenoids off)"));
+    Serial.println(F("  'p' - Play/stop the SD card MIDI file"));
+    Serial.println(F("  'w' - Save the current settings to EEPROM"));
+    Serial.println(F("  'e' - Erase the stored settings"));
+#if defined(SOLENOID_BENCHMARK)
+    Serial.println(F("  'b' - Run the latency/throughput benchmarks"));
+#endif
+    Serial.println(F("  'm' - Start/stop streaming metrics (USB MIDI SysEx)"));
+    Serial.println(F("  'l' - Start/stop recording the event log (SD card)"));
     Serial.println(F("  's' - Print status"));
     Serial.println(F("  'h' - Show this help menu"));
     Serial.println();
-    Serial.println(F("MIDI: Listening for notes 60-67 (C4-G4) on all channels"));
+    Serial.println(F("MIDI: Notes mapped by the key ranges (see startup log)"));
+    Serial.println(F("      Sustain (CC64) and sostenuto (CC66) pedals supported"));
+    Serial.println(F("      USB and DIN (Serial1) inputs are merged"));
     Serial.println();
     Serial.println(F("Ready for MIDI input..."));
 }
@@ -460,6 +1322,21 @@ void printStatus()
 
     Serial.print(F("Driver initialized: "));
     Serial.println(solenoidDriver.isInitialized() ? F("Yes") : F("No"));
+    Serial.print(F("Settings: "));
+    Serial.println(settingsStore.isValid() ? F("stored (EEPROM)") : F("defaults"));
+    Serial.print(F("Event log: "));
+    if (eventLog.isRecording())
+    {
+        Serial.print(F("recording ("));
+        Serial.print(eventLog.getRecordCount());
+        Serial.print(F(" records, "));
+        Serial.print(eventLog.dropCount());
+        Serial.println(F(" dropped)"));
+    }
+    else
+    {
+        Serial.println(F("off"));
+    }
 
     if (solenoidDriver.isInitialized())
     {
@@ -467,15 +1344,84 @@ void printStatus()
         Serial.println(solenoidDriver.getBoardCount());
         Serial.print(F("Channels: "));
         Serial.println(solenoidDriver.getChannelCount());
+        Serial.print(F("I2C clock: "));
+        Serial.print(solenoidDriver.getI2CClockHz() / 1000);
+        Serial.print(F(" kHz (bus recoveries: "));
+        Serial.print(solenoidDriver.getBusRecoveryCount());
+        Serial.print(F(", latch drifts corrected: "));
+        Serial.print(solenoidDriver.getDriftCount());
+        Serial.println(F(")"));
+        for (uint8_t board = 0; board < solenoidDriver.getBoardCount(); board++)
+        {
+            SolenoidBoardHealth health = solenoidDriver.getBoardHealth(board);
+            Serial.print(F("Board "));
+            Serial.print(board);
+            Serial.print(F(": "));
+            Serial.print(health == SolenoidBoardHealth::ONLINE ? F("online") :
+                         health == SolenoidBoardHealth::RETRYING ? F("retrying") : F("offline"));
+            Serial.print(F(" (recoveries: "));
+            Serial.print(solenoidDriver.getBoardRecoveryCount(board));
+            Serial.println(F(")"));
+        }
+        Serial.print(F("Errors pending/dropped: "));
+        Serial.print(solenoidDriver.getPendingErrorCount());
+        Serial.print(F("/"));
+        Serial.println(solenoidDriver.getDroppedErrorCount());
+        Serial.print(F("Coils energized: "));
+        Serial.print(solenoidDriver.getActiveCoilCount());
+        Serial.print(F(" (staggered strikes: "));
+        Serial.print(solenoidDriver.getStaggeredStrikeCount());
+        Serial.println(F(")"));
+        Serial.print(F("Notes sounding: "));
+        Serial.print(pedals.getSoundingCount());
+        Serial.print(F(" (held by pedal: "));
+        Serial.print(pedals.getPedalHeldCount());
+        Serial.println(F(")"));
+        Serial.print(F("Notes deferred/dropped: "));
+        Serial.print(solenoidDriver.getDeferredNoteCount());
+        Serial.print(F("/"));
+        Serial.println(solenoidDriver.getDroppedNoteCount());
+        for (uint8_t i = 0; i < midiInput.getSourceCount(); i++)
+        {
+            Serial.print(midiInput.getSourceType(i) == MidiSourceType::DIN ? F("DIN") : F("USB"));
+            Serial.print(F(" MIDI: "));
+            Serial.print(midiInput.getMessageCount(i));
+            Serial.print(F(" msgs, latency avg/max "));
+            Serial.print(midiInput.getAverageLatencyUs(i));
+            Serial.print(F("/"));
+            Serial.print(midiInput.getMaxLatencyUs(i));
+            Serial.print(F(" us, overflows "));
+            Serial.println(midiInput.getOverflowCount(i));
+        }
+        Serial.print(F("SD playback: "));
+        if (player.isPlaying())
+        {
+            Serial.print(player.getPositionMs() / 1000);
+            Serial.print(F("s, "));
+            Serial.print(player.getEventCount());
+            Serial.print(F(" events (underruns: "));
+            Serial.print(player.getUnderrunCount());
+            Serial.println(F(")"));
+        }
+        else
+        {
+            Serial.println(F("stopped"));
+        }
+
+        static SolenoidMetrics snapshot;
+        solenoidDriver.getMetrics(snapshot);
+        Serial.print(F("Metrics (streaming "));
+        Serial.print(metricsStreaming ? F("on") : F("off"));
+        Serial.println(F("):"));
+        snapshot.printTo(Serial);
 
         Serial.println(F("Channel states:"));
         for (uint8_t i = 0; i < NUM_CHANNELS; i++)
         {
             Serial.print(F("  Ch "));
             Serial.print(i);
-            Serial.print(F(" (Note "));
-            Serial.print(MIDI_NOTE_LOW + i);
-            Serial.print(F("): "));
+            printChannelNote(i);
+            Serial.print(F(": "));
             Serial.println(solenoidDriver.isOn(i) ? F("ON") : F("off"));
         }
     }
@@ -513,6 +1459,60 @@ void handleSerialInput()
             printStatus();
             break;
 
+        case 'w':
+        case 'W':
+            saveSettings();
+            break;
+
+        case 'e':
+        case 'E':
+            eraseSettings();
+            break;
+
+        case 'p':
+        case 'P':
+            if (player.isPlaying())
+            {
+                player.stop();
+                pedals.reset(); // Every channel is off
+                Serial.println(F("[OK] Playback stopped"));
+            }
+            else
+            {
+                startPlayback();
+            }
+            break;
+
+        case 'm':
+        case 'M':
+#if defined(MIDI_INTERFACE)
+            metricsStreaming = !metricsStreaming;
+            Serial.print(F("[OK] Metrics streaming "));
+            Serial.println(metricsStreaming ? F("on") : F("off"));
+#else
+            Serial.println(F("[ERROR] Metrics streaming needs a USB MIDI build"));
+#endif
+            break;
+
+        case 'l':
+        case 'L':
+            if (eventLog.isRecording())
+            {
+                stopEventLog();
+            }
+            else
+            {
+                startEventLog();
+            }
+            break;
+
+#if defined(SOLENOID_BENCHMARK)
+        case 'b':
+        case 'B':
+            runBenchmarks();
+            break;
+#endif
+
         case 'h':
         case 'H':
         case '?':
@@ -0,0 +1,325 @@
+/**
+ * @file SimCapture.cpp
+ * @brief Implementation of SimCapture class
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include "SimCapture.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include <MidiFileTrack.h>
+#include <MidiFilePlayer.h>
+#include <MidiTempoMap.h>
+
+/** Records read from an event log at a time */
+static constexpr size_t LOG_READ_RECORDS = SOLENOID_LOG_CHUNK_RECORDS;
+
+/** load() error for a file that is neither a MIDI file nor a usable log */
+static const char STR_BAD_LOG[] = "Not an event log of this firmware version";
+
+/** A message before its tick is converted to time */
+struct TickedEvent
+{
+    uint32_t tick;
+    SimCaptureEvent event;
+};
+
+SimCapture::SimCapture()
+    : _trackCount(0)
+    , _error(nullptr)
+    , _eventLog(false)
+    , _logDropped(0)
+{
+    memset(_logCounts, 0, sizeof(_logCounts));
+}
+
+bool SimCapture::load(const char* path)
+{
+    _events.clear();
+    _trackCount = 0;
+    _error = nullptr;
+    _eventLog = false;
+    _logDropped = 0;
+    memset(_logCounts, 0, sizeof(_logCounts));
+
+    File file = SD.open(path, FILE_READ);
+    if (!file)
+    {
+        _error = MidiFilePlayer::getErrorString(MidiFileError::OPEN_FAILED);
+        return false;
+    }
+
+    // Anything but "MThd" is taken for an event log
+    uint32_t id = 0;
+    if (readBigEndian(file, 4, id) && id != 0x4D546864)
+    {
+        bool ok = loadEventLog(file);
+        file.close();
+        return ok;
+    }
+
+    // MThd: format, track count, division
+    uint32_t length = 0;
+    uint32_t format = 0;
+    uint32_t tracks = 0;
+    uint32_t division = 0;
+    if (id != 0x4D546864 || !readBigEndian(file, 4, length) || length < 6 ||
+        !readBigEndian(file, 2, format) || !readBigEndian(file, 2, tracks) || !readBigEndian(file, 2, division))
+    {
+        _error = MidiFilePlayer::getErrorString(MidiFileError::NOT_SMF);
+        file.close();
+        return false;
+    }
+    if (format > 1)
+    {
+        _error = MidiFilePlayer::getErrorString(MidiFileError::UNSUPPORTED_FORMAT);
+        file.close();
+        return false;
+    }
+
+    MidiTempoMap tempoMap;
+    tempoMap.reset(static_cast<uint16_t>(division));
+    std::vector<TickedEvent> ticked;
+
+    // Read each MTrk in turn; unknown chunk types are skipped per the spec
+    MidiFileTrack track;
+    uint32_t offset = 8 + length;
+    while (_trackCount < tracks)
+    {
+        if (!file.seek(offset) || !readBigEndian(file, 4, id) || !readBigEndian(file, 4, length))
+        {
+            _error = MidiFilePlayer::getErrorString(MidiFileError::READ_FAILED);
+            file.close();
+            return false;
+        }
+        offset += 8;
+        if (id != 0x4D54726B)   // "MTrk"
+        {
+            offset += length;
+            continue;
+        }
+
+        if (!track.begin(&file, offset, length))
+        {
+            _error = MidiFilePlayer::getErrorString(MidiFileError::READ_FAILED);
+            file.close();
+            return false;
+        }
+
+        MidiFileEvent event;
+        while (track.next(event))
+        {
+            if (event.status == MIDI_SMF_STATUS_TEMPO)
+            {
+                // The tempo track is the first one (format 0: the only one)
+                if (_trackCount == 0)
+                {
+                    tempoMap.addTempo(event.tick, event.tempo);
+                }
+            }
+            else
+            {
+                TickedEvent entry;
+                entry.tick = event.tick;
+                entry.event.timeUs = 0;
+                entry.event.status = event.status;
+                entry.event.data1 = event.data1;
+                entry.event.data2 = event.data2;
+                ticked.push_back(entry);
+            }
+            track.service();
+        }
+        if (track.hasFailed())
+        {
+            _error = MidiFilePlayer::getErrorString(track.getError());
+            file.close();
+            return false;
+        }
+
+        offset += length;
+        _trackCount++;
+    }
+    file.close();
+
+    // Merge the tracks: earlier tick first, lower track first on a tie (as
+    // the player orders them)
+    std::stable_sort(ticked.begin(), ticked.end(), [](const TickedEvent& a, const TickedEvent& b)
+    {
+        return a.tick < b.tick;
+    });
+
+    _events.reserve(ticked.size());
+    for (TickedEvent& entry : ticked)
+    {
+        entry.event.timeUs = tempoMap.tickToUs(entry.tick);
+        _events.push_back(entry.event);
+    }
+    return true;
+}
+
+void SimCapture::generateChords(uint8_t firstNote, uint8_t keys, uint16_t count, uint32_t periodUs)
+{
+    _events.clear();
+    _trackCount = 1;
+    _error = nullptr;
+    _eventLog = false;
+
+    for (uint16_t chord = 0; chord < count; chord++)
+    {
+        uint64_t startUs = static_cast<uint64_t>(chord) * periodUs;
+        uint8_t velocity = static_cast<uint8_t>(64 + (chord * 63) / (count > 1 ? count - 1 : 1));
+        for (uint8_t key = 0; key < keys; key++)
+        {
+            SimCaptureEvent on = { startUs, 0x90, static_cast<uint8_t>(firstNote + key), velocity };
+            _events.push_back(on);
+        }
+        for (uint8_t key = 0; key < keys; key++)
+        {
+            SimCaptureEvent off = { startUs + periodUs / 2, 0x80, static_cast<uint8_t>(firstNote + key), 0 };
+            _events.push_back(off);
+        }
+    }
+}
+
+const char* SimCapture::getError() const
+{
+    return _error;
+}
+
+size_t SimCapture::getEventCount() const
+{
+    return _events.size();
+}
+
+const SimCaptureEvent& SimCapture::getEvent(size_t index) const
+{
+    return _events[index];
+}
+
+uint8_t SimCapture::getTrackCount() const
+{
+    return _trackCount;
+}
+
+bool SimCapture::isEventLog() const
+{
+    return _eventLog;
+}
+
+uint32_t SimCapture::getLogCount(SolenoidLogType type) const
+{
+    uint8_t index = static_cast<uint8_t>(type);
+    return (index <= static_cast<uint8_t>(SolenoidLogType::MARK)) ? _logCounts[index] : 0;
+}
+
+uint32_t SimCapture::getLogDropCount() const
+{
+    return _logDropped;
+}
+
+uint64_t SimCapture::getLengthUs() const
+{
+    return _events.empty() ? 0 : _events.back().timeUs;
+}
+
+uint8_t SimCapture::dataLength(uint8_t status)
+{
+    uint8_t type = status & 0xF0;
+    return (type == 0xC0 || type == 0xD0) ? 1 : 2;
+}
+
+bool SimCapture::readBigEndian(File& file, uint8_t bytes, uint32_t& value)
+{
+    uint8_t buffer[4];
+    if (bytes > 4 || file.read(buffer, bytes) != bytes)
+    {
+        return false;
+    }
+
+    value = 0;
+    for (uint8_t i = 0; i < bytes; i++)
+    {
+        value = (value << 8) | buffer[i];
+    }
+    return true;
+}
+
+bool SimCapture::loadEventLog(File& file)
+{
+    SolenoidLogRecord records[LOG_READ_RECORDS];
+    bool first = true;
+    bool started = false;
+    uint32_t lastUs = 0;
+    uint64_t timeUs = 0;
+
+    file.seek(0);
+    while (true)
+    {
+        int bytes = file.read(records, sizeof(records));
+        if (bytes <= 0)
+        {
+            break;
+        }
+
+        // A trailing partial record (power cut mid-write) is ignored
+        size_t count = static_cast<size_t>(bytes) / sizeof(SolenoidLogRecord);
+        for (size_t i = 0; i < count; i++)
+        {
+            const SolenoidLogRecord& rec = records[i];
+            if (first)
+            {
+                first = false;
+                if (rec.type != SolenoidLogType::HEADER || rec.value0 != SOLENOID_LOG_MAGIC ||
+                    rec.target != SOLENOID_LOG_VERSION || rec.arg0 != sizeof(SolenoidLogRecord))
+                {
+                    _error = STR_BAD_LOG;
+                    return false;
+                }
+            }
+
+            uint8_t type = static_cast<uint8_t>(rec.type);
+            if (type <= static_cast<uint8_t>(SolenoidLogType::MARK))
+            {
+                _logCounts[type]++;
+            }
+            // Times count from the SYNC made by start(), so the messages
+            // keep their phase to the driver's periodic work
+            if (rec.type == SolenoidLogType::SYNC)
+            {
+                _logDropped = rec.value1;
+                if (!started)
+                {
+                    started = true;
+                    lastUs = rec.value0;
+                }
+            }
+            if (rec.type != SolenoidLogType::MIDI_IN || !started)
+            {
+                continue;
+            }
+
+            // Arrival times are 32-bit microseconds; the differences are not
+            timeUs += static_cast<uint32_t>(rec.value1 - lastUs);
+            lastUs = rec.value1;
+
+            SimCaptureEvent event;
+            event.timeUs = timeUs;
+            event.status = rec.arg0;
+            event.data1 = rec.arg1;
+            event.data2 = static_cast<uint8_t>(rec.value0);
+            _events.push_back(event);
+        }
+    }
+
+    if (first)
+    {
+        _error = STR_BAD_LOG;
+        return false;
+    }
+    _eventLog = true;
+    return true;
+}
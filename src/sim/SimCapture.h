@@ -0,0 +1,154 @@
+/**
+ * @file SimCapture.h
+ * @brief MIDI capture loaded for replay by the host simulation
+ *
+ * Reads a Standard MIDI File (type 0 or 1) with the firmware's own track
+ * reader and tempo map, and flattens it into one time-ordered list of
+ * channel messages in microseconds from the start of the capture.
+ *
+ * A SolenoidEventLog recorded by the firmware is read too: its MIDI_IN
+ * records become the messages, at the times they arrived, and the other
+ * records are counted by type so a replay can be compared with the run
+ * that was recorded.
+ *
+ * A capture can also be generated (generateChords()) to exercise the
+ * power budget without a file.
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#ifndef SIM_CAPTURE_H
+#define SIM_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <SD.h>
+#include <SolenoidEventLog.h>
+
+/**
+ * @struct SimCaptureEvent
+ * @brief One channel message of the capture
+ */
+struct SimCaptureEvent
+{
+    uint64_t timeUs;   ///< Time from the start of the capture
+    uint8_t status;    ///< Channel message status byte
+    uint8_t data1;     ///< First data byte
+    uint8_t data2;     ///< Second data byte (0 for one-byte messages)
+};
+
+/**
+ * @class SimCapture
+ * @brief Time-ordered channel messages of a MIDI file
+ */
+class SimCapture
+{
+public:
+    /**
+     * @brief Construct an empty capture
+     */
+    SimCapture();
+
+    /**
+     * @brief Load a Standard MIDI File or an event log
+     *
+     * @param path Host path of the file
+     * @return false on error (see getError())
+     */
+    bool load(const char* path);
+
+    /**
+     * @brief Build a capture of repeated block chords instead of loading one
+     *
+     * @param firstNote Lowest note of each chord
+     * @param keys Notes per chord (consecutive from firstNote)
+     * @param count Number of chords
+     * @param periodUs Time from one chord to the next (held for half of it)
+     *
+     * Every note of a chord starts at the same time, at rising velocities.
+     */
+    void generateChords(uint8_t firstNote, uint8_t keys, uint16_t count, uint32_t periodUs);
+
+    /**
+     * @brief Get why load() failed
+     *
+     * @return Error description, or nullptr
+     */
+    const char* getError() const;
+
+    /**
+     * @brief Get the number of channel messages
+     */
+    size_t getEventCount() const;
+
+    /**
+     * @brief Get a channel message
+     *
+     * @param index 0 to getEventCount() - 1, in time order
+     */
+    const SimCaptureEvent& getEvent(size_t index) const;
+
+    /**
+     * @brief Get the number of tracks of the file
+     */
+    uint8_t getTrackCount() const;
+
+    /**
+     * @brief Check if the file was an event log rather than a MIDI file
+     */
+    bool isEventLog() const;
+
+    /**
+     * @brief Get the number of records of a type in the event log
+     *
+     * @param type Record type
+     * @return Record count (0 for a MIDI file)
+     */
+    uint32_t getLogCount(SolenoidLogType type) const;
+
+    /**
+     * @brief Get the number of records the recording dropped
+     *
+     * @return Drop count of the last SYNC record (0 for a MIDI file)
+     */
+    uint32_t getLogDropCount() const;
+
+    /**
+     * @brief Get the time of the last message
+     *
+     * @return Microseconds from the start of the capture
+     */
+    uint64_t getLengthUs() const;
+
+    /**
+     * @brief Get the number of data bytes a message carries
+     *
+     * @param status Channel message status byte
+     * @return 1 for program change and channel pressure, otherwise 2
+     */
+    static uint8_t dataLength(uint8_t status);
+
+private:
+    std::vector<SimCaptureEvent> _events;   ///< Messages in time order
+    uint8_t _trackCount;                    ///< Tracks in the file
+    const char* _error;                     ///< Why load() failed
+    bool _eventLog;                         ///< The file was an event log
+    uint32_t _logCounts[static_cast<uint8_t>(SolenoidLogType::MARK) + 1];   ///< Records by type
+    uint32_t _logDropped;                   ///< Records the recording dropped
+
+    /**
+     * @brief Read an event log from the start of the file
+     */
+    bool loadEventLog(File& file);
+
+    /**
+     * @brief Read a big-endian value from the file
+     */
+    static bool readBigEndian(File& file, uint8_t bytes, uint32_t& value);
+};
+
+#endif // SIM_CAPTURE_H
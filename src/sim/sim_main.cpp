@@ -0,0 +1,1026 @@
+/**
+ * @file sim_main.cpp
+ * @brief Host simulation of the Mechanical MIDI Piano firmware
+ *
+ * Replays a MIDI capture (Standard MIDI File) through the same pipeline
+ * the firmware runs - DIN MIDI bytes into MidiInput, the keymap, the
+ * pedals and SolenoidDriver - against simulated MCP23017 boards on a
+ * simulated I2C bus, and reports the input-to-wire latency, throughput,
+ * safety rejections and bus occupancy.
+ *
+ * Everything runs on virtual time (SolenoidSimClock): each loop pass
+ * advances it by --loop-us, and every bus transaction by the time its
+ * bits take at the bus clock. A run is deterministic and goes as fast as
+ * the host executes the code, typically far faster than real time.
+ *
+ * The simulated bus has no interrupt-driven transmitter, so board writes
+ * are made from update() and the CPU waits for them, as the firmware does
+ * off Teensy 4.x. The driver's hardware tick is likewise not simulated:
+ * the timing core is polled from the loop.
+ *
+ * Faults can be injected to exercise the driver's recovery: --drop-board
+ * browns out one board and keeps it off the bus for --fault-ms, and
+ * --stuck-bus hangs the bus (SDA held low) until the driver recovers it.
+ * Both start --fault-at into the replay. --stop-at calls emergencyStop()
+ * mid-replay and reports how long the coils took to release, over I2C or,
+ * with --reset-line, through the boards' RESET line.
+ *
+ * The capture may also be an event log recorded by the firmware (its 'l'
+ * command): the logged MIDI is replayed at the times it arrived, and the
+ * recorded scheduler decisions, rejections and board writes are reported
+ * next to the replay's own. --log records the replay in the same format,
+ * so a run can be replayed again or compared record by record.
+ *
+ * --chord N replays generated block chords of N keys instead of a file
+ * and checks that every note reached the wire - with N above the driver's
+ * active coil limit this exercises the power budget's staggering. The
+ * exit status is 3 if the check fails.
+ *
+ * Build and run (PlatformIO):
+ * @code
+ * pio run -e native
+ * .pio/build/native/program capture.mid --clock 400000 --boards 2
+ * @endcode
+ *
+ * @author Mechanical MIDI Piano Project
+ * @version 1.0.0
+ */
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SolenoidDriver.h>
+#include <SolenoidHistogram.h>
+#include <SolenoidSimBus.h>
+#include <SolenoidSimClock.h>
+#include <MidiInput.h>
+#include <MidiKeymap.h>
+#include <MidiPedals.h>
+
+#include "SimCapture.h"
+
+// =============================================================================
+// CONFIGURATION CONSTANTS
+// =============================================================================
+
+/**
+ * @defgroup SimConfig Simulation Defaults
+ * @{
+ */
+
+/** Bus clock to start from in Hz; the driver falls back if boards fail */
+constexpr uint32_t SIM_DEFAULT_CLOCK_HZ = 1000000;
+
+/** Boards on the bus */
+constexpr uint8_t SIM_DEFAULT_BOARDS = 1;
+
+/** Virtual time one pass of the main loop takes (us) */
+constexpr uint32_t SIM_DEFAULT_LOOP_US = 20;
+
+/** Lowest MIDI note mapped; following notes map to consecutive solenoids */
+constexpr uint8_t SIM_DEFAULT_FIRST_NOTE = 60;
+
+/** Time one DIN MIDI byte takes on the wire (10 bits at 31250 baud, us) */
+constexpr uint32_t SIM_DIN_BYTE_US = 320;
+
+/** Longest the run continues after the last message to let coils release (ms) */
+constexpr uint32_t SIM_DRAIN_MS = 5000;
+
+/** Time into the replay at which an injected fault starts (ms) */
+constexpr uint32_t SIM_DEFAULT_FAULT_AT_MS = 1000;
+
+/** Time a dropped board stays off the bus (ms) */
+constexpr uint32_t SIM_DEFAULT_FAULT_MS = 500;
+
+/** SimOptions::dropBoard value for no dropped board */
+constexpr uint8_t SIM_NO_BOARD = 0xFF;
+
+/** Pin the boards' RESET line is wired to with --reset-line */
+constexpr uint8_t SIM_RESET_PIN = 9;
+
+/** Virtual time between SYNC records of the replay's event log (us) */
+constexpr uint32_t SIM_LOG_SYNC_US = 1000000;
+
+/** Chords played by --chord */
+constexpr uint16_t SIM_CHORD_COUNT = 16;
+
+/** Time from one --chord chord to the next (ms) */
+constexpr uint32_t SIM_CHORD_PERIOD_MS = 400;
+
+/** Exit status of a run whose --chord check failed */
+constexpr int SIM_EXIT_CHECK_FAILED = 3;
+
+/** Record types counted in the report (HEADER to MARK) */
+constexpr uint8_t SIM_LOG_TYPES = static_cast<uint8_t>(SolenoidLogType::MARK) + 1;
+
+/** @} */
+
+/**
+ * @defgroup SimDriverConfig Driver Settings (as the firmware sets them)
+ * @{
+ */
+
+constexpr uint32_t MAX_ON_TIME_MS = 2000;
+constexpr uint32_t MIN_OFF_TIME_MS = 15;
+constexpr uint8_t MAX_ACTIVE_COILS = 6;
+constexpr uint32_t PEDAL_HOLD_MS = 250;
+
+/** @} */
+
+/** Error codes counted separately (SolenoidError values 0-9) */
+constexpr uint8_t SIM_ERROR_CODES = 10;
+
+// =============================================================================
+// GLOBAL OBJECTS
+// =============================================================================
+
+/**
+ * @struct SimOptions
+ * @brief Command line settings
+ */
+struct SimOptions
+{
+    const char* capturePath = nullptr;
+    uint32_t clockHz = SIM_DEFAULT_CLOCK_HZ;
+    uint32_t boardMaxClockHz = SIM_DEFAULT_BOARD_MAX_CLOCK_HZ;
+    uint8_t boards = SIM_DEFAULT_BOARDS;
+    uint8_t channelsPerBoard = SOLENOID_CHANNELS_PER_BOARD;
+    uint32_t loopUs = SIM_DEFAULT_LOOP_US;
+    uint8_t firstNote = SIM_DEFAULT_FIRST_NOTE;
+    bool usbTiming = false;
+    uint8_t dropBoard = SIM_NO_BOARD;
+    bool stuckBus = false;
+    uint32_t faultAtMs = SIM_DEFAULT_FAULT_AT_MS;
+    uint32_t faultMs = SIM_DEFAULT_FAULT_MS;
+    bool stop = false;
+    uint32_t stopAtMs = 0;
+    bool resetLine = false;
+    const char* logPath = nullptr;
+    uint8_t chordKeys = 0;
+};
+
+SimOptions options;
+SimCapture capture;
+SolenoidSimBus simBus;
+SolenoidDriver solenoidDriver;
+MidiKeymap keymap;
+MidiInput midiInput;
+MidiPedals pedals(solenoidDriver);
+
+/** The replay's MIDI in and driver decisions */
+SolenoidEventLog eventLog;
+
+/** Input (message off the UART) to STOP of the write carrying the strike */
+SolenoidHistogram inputToWire;
+
+uint32_t strikeUs[SOLENOID_MAX_CHANNELS];      ///< Input time of each awaited strike
+uint32_t awaiting[SOLENOID_MASK_WORDS];        ///< Strikes not yet seen on the wire
+uint32_t strikeCount = 0;                      ///< Note-ons that reached the driver
+uint32_t writeCount = 0;                       ///< Board writes completed
+uint32_t failedWriteCount = 0;                 ///< Board writes NACKed
+uint32_t errorCounts[SIM_ERROR_CODES + 1];     ///< Rejections per code (last = other)
+
+// DIN line state
+size_t nextEvent = 0;                          ///< Next capture message to send
+uint8_t messageBytes[3];                       ///< Bytes of the message being sent
+uint8_t messageLength = 0;                     ///< Bytes in messageBytes
+uint8_t messagePos = 0;                        ///< Next byte of messageBytes to send
+uint64_t messageDueUs = 0;                     ///< Capture time of the message being sent
+uint64_t lineFreeUs = 0;                       ///< When the last byte finished arriving
+uint8_t runningStatus = 0;                     ///< Status the receiver is following
+uint64_t maxLineDelayUs = 0;                   ///< Longest message wait for the line
+
+// Fault injection state
+bool faultStarted = false;                     ///< The injected fault has begun
+bool faultEnded = false;                       ///< The dropped board is back on the bus
+
+// Emergency stop state
+bool stopDone = false;                         ///< emergencyStop() has been called
+uint8_t stopCoilsOn = 0;                       ///< Coils on when it was called
+uint64_t stopCallUs = 0;                       ///< Time the call took
+uint64_t stopReleaseUs = 0;                    ///< Call to every output reading 0
+bool stopCleared = false;                      ///< Every output read 0 after the call
+uint64_t resetPulseUs = 0;                     ///< Time of the last RESET pulse
+
+// Event log state
+File logFile;                                  ///< --log output, if open
+uint32_t logCounts[SIM_LOG_TYPES];             ///< Replay records by type
+uint64_t lastSyncUs = 0;                       ///< Time of the last SYNC record
+
+// =============================================================================
+// FUNCTION PROTOTYPES
+// =============================================================================
+
+bool parseArguments(int argc, char** argv);
+void printUsage();
+bool initDriver();
+bool inputDone();
+void deliverInput(uint64_t replayUs);
+void injectFaults(uint64_t replayUs);
+void injectStop(uint64_t replayUs);
+void onPinWrite(uint8_t pin, uint8_t value);
+void handleMidiMessage(const MidiMessage& message);
+void onWrite(uint8_t board, uint16_t states, uint32_t wireUs, bool ok);
+void drainErrors();
+void drainEventLog(uint64_t nowUs);
+void printLogCounts(const char* label, const uint32_t counts[SIM_LOG_TYPES], uint32_t dropped);
+void printReport(uint64_t virtualUs, double wallSeconds);
+bool checkChords();
+
+// =============================================================================
+// MAIN
+// =============================================================================
+
+int main(int argc, char** argv)
+{
+    if (!parseArguments(argc, argv))
+    {
+        printUsage();
+        return 2;
+    }
+
+    if (options.chordKeys > 0)
+    {
+        capture.generateChords(options.firstNote, options.chordKeys, SIM_CHORD_COUNT,
+                               SIM_CHORD_PERIOD_MS * 1000);
+    }
+    else if (!capture.load(options.capturePath))
+    {
+        fprintf(stderr, "%s: %s\n", options.capturePath, capture.getError());
+        return 1;
+    }
+
+    // Logged times are arrival times - the DIN line delay is already in them
+    if (capture.isEventLog())
+    {
+        options.usbTiming = true;
+    }
+
+    SolenoidSimClock::reset();
+    if (!initDriver())
+    {
+        return 1;
+    }
+
+    // Measure the replay only, not the clock negotiation
+    simBus.resetStats();
+    midiInput.resetStats();
+    if (options.logPath != nullptr)
+    {
+        SD.remove(options.logPath);
+        logFile = SD.open(options.logPath, FILE_WRITE);
+        if (!logFile)
+        {
+            fprintf(stderr, "%s: cannot create\n", options.logPath);
+            return 1;
+        }
+    }
+    solenoidDriver.setEventLog(&eventLog);
+    eventLog.start();
+    uint64_t startUs = SolenoidSimClock::nowUs();
+    lastSyncUs = startUs;
+    auto wallStart = std::chrono::steady_clock::now();
+
+    // The firmware's loop(), with virtual time standing in for the CPU
+    uint64_t inputEndUs = 0;
+    while (true)
+    {
+        uint64_t nowUs = SolenoidSimClock::nowUs();
+        deliverInput(nowUs - startUs);
+        injectFaults(nowUs - startUs);
+        injectStop(nowUs - startUs);
+
+        solenoidDriver.beginTransaction();
+        midiInput.update(handleMidiMessage);
+        pedals.update();
+        solenoidDriver.commit();
+
+        solenoidDriver.update();
+        drainErrors();
+        drainEventLog(nowUs);
+
+        if (inputDone() && Serial1.available() == 0 && midiInput.getPendingCount(0) == 0)
+        {
+            if (inputEndUs == 0)
+            {
+                inputEndUs = nowUs;
+            }
+            bool quiet = solenoidDriver.getActiveCoilCount() == 0 &&
+                         solenoidDriver.getScheduledEventCount() == 0 &&
+                         solenoidDriver.getPendingFrameCount() == 0 &&
+                         pedals.getPedalHeldCount() == 0;
+            if (quiet || (nowUs - inputEndUs) > (static_cast<uint64_t>(SIM_DRAIN_MS) * 1000))
+            {
+                break;
+            }
+        }
+
+        SolenoidSimClock::advanceUs(options.loopUs);
+    }
+
+    eventLog.sync();
+    eventLog.stop();
+    drainEventLog(SolenoidSimClock::nowUs());
+    if (logFile)
+    {
+        logFile.close();
+    }
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wallStart;
+    printReport(SolenoidSimClock::nowUs() - startUs, wall.count());
+    if (options.chordKeys > 0 && !checkChords())
+    {
+        return SIM_EXIT_CHECK_FAILED;
+    }
+    return 0;
+}
+
+// =============================================================================
+// INITIALIZATION
+// =============================================================================
+
+/**
+ * @brief Parse the command line into options
+ *
+ * @return false if the arguments are invalid
+ */
+bool parseArguments(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--usb") == 0)
+        {
+            options.usbTiming = true;
+            continue;
+        }
+        if (strcmp(arg, "--stuck-bus") == 0)
+        {
+            options.stuckBus = true;
+            continue;
+        }
+        if (strcmp(arg, "--reset-line") == 0)
+        {
+            options.resetLine = true;
+            continue;
+        }
+        if (arg[0] != '-')
+        {
+            options.capturePath = arg;
+            continue;
+        }
+        if (value == nullptr)
+        {
+            return false;
+        }
+
+        unsigned long number = strtoul(value, nullptr, 0);
+        i++;
+        if (strcmp(arg, "--clock") == 0)
+        {
+            options.clockHz = static_cast<uint32_t>(number);
+        }
+        else if (strcmp(arg, "--board-max-clock") == 0)
+        {
+            options.boardMaxClockHz = static_cast<uint32_t>(number);
+        }
+        else if (strcmp(arg, "--boards") == 0)
+        {
+            options.boards = static_cast<uint8_t>(number);
+        }
+        else if (strcmp(arg, "--channels") == 0)
+        {
+            options.channelsPerBoard = static_cast<uint8_t>(number);
+        }
+        else if (strcmp(arg, "--loop-us") == 0)
+        {
+            options.loopUs = static_cast<uint32_t>(number);
+        }
+        else if (strcmp(arg, "--first-note") == 0)
+        {
+            options.firstNote = static_cast<uint8_t>(number);
+        }
+        else if (strcmp(arg, "--drop-board") == 0)
+        {
+            options.dropBoard = static_cast<uint8_t>(number);
+        }
+        else if (strcmp(arg, "--fault-at") == 0)
+        {
+            options.faultAtMs = static_cast<uint32_t>(number);
+        }
+        else if (strcmp(arg, "--fault-ms") == 0)
+        {
+            options.faultMs = static_cast<uint32_t>(number);
+        }
+        else if (strcmp(arg, "--log") == 0)
+        {
+            options.logPath = value;
+        }
+        else if (strcmp(arg, "--stop-at") == 0)
+        {
+            options.stop = true;
+            options.stopAtMs = static_cast<uint32_t>(number);
+        }
+        else if (strcmp(arg, "--chord") == 0)
+        {
+            options.chordKeys = static_cast<uint8_t>(number);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if (options.chordKeys > 0)
+    {
+        if (options.capturePath != nullptr ||
+            options.chordKeys > options.boards * options.channelsPerBoard ||
+            options.firstNote + options.chordKeys > MIDI_NOTE_COUNT)
+        {
+            return false;
+        }
+        options.capturePath = "chords";
+    }
+
+    return options.capturePath != nullptr && options.clockHz > 0 && options.loopUs > 0 &&
+           options.boards >= 1 && options.boards <= SOLENOID_MAX_BOARDS_PER_BUS &&
+           options.firstNote < MIDI_NOTE_COUNT &&
+           (options.dropBoard == SIM_NO_BOARD || options.dropBoard < options.boards);
+}
+
+/**
+ * @brief Print the command line help
+ */
+void printUsage()
+{
+    fprintf(stderr,
+            "Usage: program <capture.mid|events.log|--chord N> [options]\n"
+            "  --clock HZ            Fastest I2C clock to try (default %u)\n"
+            "  --board-max-clock HZ  Fastest clock the boards answer at (default %u)\n"
+            "  --boards N            Boards on the bus, 1-%u (default %u)\n"
+            "  --channels 8|16       Channels per board (default %u)\n"
+            "  --loop-us US          Virtual time per loop pass (default %u)\n"
+            "  --first-note N        MIDI note of solenoid 0 (default %u)\n"
+            "  --usb                 Messages arrive at their capture time instead of\n"
+            "                        being serialized at DIN speed\n"
+            "  --drop-board N        Brown out board N and keep it off the bus\n"
+            "  --stuck-bus           Hang the bus (SDA held low) until it is recovered\n"
+            "  --fault-at MS         Time into the replay the fault starts (default %u)\n"
+            "  --fault-ms MS         Time a dropped board stays off the bus (default %u)\n"
+            "  --stop-at MS          Call emergencyStop() MS into the replay\n"
+            "  --reset-line          Wire the boards' RESET line to the driver\n"
+            "  --log PATH            Record the replay as an event log\n"
+            "  --chord N             Play %u generated chords of N keys and check that\n"
+            "                        every note reaches the wire\n",
+            static_cast<unsigned>(SIM_DEFAULT_CLOCK_HZ),
+            static_cast<unsigned>(SIM_DEFAULT_BOARD_MAX_CLOCK_HZ),
+            static_cast<unsigned>(SOLENOID_MAX_BOARDS_PER_BUS),
+            static_cast<unsigned>(SIM_DEFAULT_BOARDS),
+            static_cast<unsigned>(SOLENOID_CHANNELS_PER_BOARD),
+            static_cast<unsigned>(SIM_DEFAULT_LOOP_US),
+            static_cast<unsigned>(SIM_DEFAULT_FIRST_NOTE),
+            static_cast<unsigned>(SIM_DEFAULT_FAULT_AT_MS),
+            static_cast<unsigned>(SIM_DEFAULT_FAULT_MS),
+            static_cast<unsigned>(SIM_CHORD_COUNT));
+}
+
+/**
+ * @brief Build the boards, configure the driver as the firmware does
+ *
+ * @return false if the driver failed to initialize
+ */
+bool initDriver()
+{
+    uint8_t addresses[SOLENOID_MAX_BOARDS_PER_BUS];
+    for (uint8_t i = 0; i < options.boards; i++)
+    {
+        addresses[i] = MCP23017_BASE_ADDRESS + i;
+        simBus.addBoard(addresses[i], options.boardMaxClockHz);
+    }
+
+    SolenoidConfig config;
+    config.maxOnTimeMs = MAX_ON_TIME_MS;
+    config.minOffTimeMs = MIN_OFF_TIME_MS;
+    config.i2cClockHz = options.clockHz;
+    config.i2cSpeedFallback = true;
+    config.safetyEnabled = true;
+    config.maxDutyCycle = 0.75f;
+    config.asyncTransmit = true;
+    config.resyncIntervalMs = 5000;
+    config.maxActiveCoils = MAX_ACTIVE_COILS;
+    config.retrigger = SolenoidRetriggerPolicy::DEFER;
+    config.channelsPerBoard = options.channelsPerBoard;
+    if (options.resetLine)
+    {
+        config.resetPin = SIM_RESET_PIN;
+        setPinHook(onPinWrite);
+    }
+    solenoidDriver.setConfig(config);
+
+    if (!solenoidDriver.begin(simBus, addresses, options.boards))
+    {
+        fprintf(stderr, "Driver init failed: %s\n",
+                SolenoidDriver::getErrorString(solenoidDriver.getLastError()));
+        return false;
+    }
+    solenoidDriver.setTransmitCallback(onWrite);
+
+    // Consecutive notes to consecutive solenoids, any MIDI channel
+    uint8_t channels = solenoidDriver.getChannelCount();
+    uint8_t lastNote = (options.firstNote + channels - 1 < MIDI_NOTE_COUNT)
+        ? options.firstNote + channels - 1
+        : MIDI_NOTE_COUNT - 1;
+    MidiKeyRange range = { MIDI_OMNI, options.firstNote, lastNote, 0, 1 };
+    keymap.build(&range, 1);
+
+    midiInput.addSerial(Serial1);
+    pedals.setPedalHoldMs(PEDAL_HOLD_MS);
+    return true;
+}
+
+// =============================================================================
+// MIDI INPUT
+// =============================================================================
+
+/**
+ * @brief Check if every capture byte has been received
+ */
+bool inputDone()
+{
+    return nextEvent >= capture.getEventCount() && messagePos >= messageLength;
+}
+
+/**
+ * @brief Put the capture bytes that have arrived by now into the UART
+ *
+ * @param replayUs Virtual time since the replay started
+ *
+ * Bytes are serialized one after another at DIN speed (unless --usb), with
+ * running status as a keyboard sends it, so dense chords queue on the line
+ * as they do on a real cable.
+ */
+void deliverInput(uint64_t replayUs)
+{
+    uint32_t byteUs = options.usbTiming ? 0 : SIM_DIN_BYTE_US;
+
+    while (true)
+    {
+        if (messagePos >= messageLength)
+        {
+            if (nextEvent >= capture.getEventCount() || capture.getEvent(nextEvent).timeUs > replayUs)
+            {
+                return;
+            }
+
+            const SimCaptureEvent& event = capture.getEvent(nextEvent++);
+            messageLength = 0;
+            messagePos = 0;
+            if (event.status != runningStatus || options.usbTiming)
+            {
+                messageBytes[messageLength++] = event.status;
+                runningStatus = event.status;
+            }
+            messageBytes[messageLength++] = event.data1;
+            if (SimCapture::dataLength(event.status) == 2)
+            {
+                messageBytes[messageLength++] = event.data2;
+            }
+            messageDueUs = event.timeUs;
+        }
+
+        uint64_t startUs = (lineFreeUs > messageDueUs) ? lineFreeUs : messageDueUs;
+        uint64_t arrivalUs = startUs + byteUs;
+        if (arrivalUs > replayUs)
+        {
+            return;
+        }
+
+        if (messagePos == 0 && startUs - messageDueUs > maxLineDelayUs)
+        {
+            maxLineDelayUs = startUs - messageDueUs;
+        }
+        Serial1.receive(messageBytes[messagePos++]);
+        lineFreeUs = arrivalUs;
+    }
+}
+
+/**
+ * @brief Start and end the injected fault
+ *
+ * @param replayUs Virtual time since the replay started
+ */
+void injectFaults(uint64_t replayUs)
+{
+    uint64_t startUs = static_cast<uint64_t>(options.faultAtMs) * 1000;
+    uint64_t endUs = startUs + static_cast<uint64_t>(options.faultMs) * 1000;
+    uint8_t address = MCP23017_BASE_ADDRESS + options.dropBoard;
+
+    if (!faultStarted && replayUs >= startUs)
+    {
+        faultStarted = true;
+        if (options.dropBoard != SIM_NO_BOARD)
+        {
+            // Power spike: the board resets and drops off the bus
+            simBus.resetBoard(address);
+            simBus.setBoardOnline(address, false);
+        }
+        if (options.stuckBus)
+        {
+            simBus.setStuck(true);
+        }
+    }
+
+    if (faultStarted && !faultEnded && replayUs >= endUs)
+    {
+        faultEnded = true;
+        if (options.dropBoard != SIM_NO_BOARD)
+        {
+            simBus.setBoardOnline(address, true);
+        }
+    }
+}
+
+/**
+ * @brief Call emergencyStop() once, when --stop-at is reached
+ *
+ * @param replayUs Virtual time since the replay started
+ */
+void injectStop(uint64_t replayUs)
+{
+    if (!options.stop || stopDone || replayUs < static_cast<uint64_t>(options.stopAtMs) * 1000)
+    {
+        return;
+    }
+    stopDone = true;
+    stopCoilsOn = solenoidDriver.getActiveCoilCount();
+
+    resetPulseUs = 0;
+    uint64_t startUs = SolenoidSimClock::nowUs();
+    solenoidDriver.emergencyStop();
+    uint64_t endUs = SolenoidSimClock::nowUs();
+
+    stopCallUs = endUs - startUs;
+    stopReleaseUs = (resetPulseUs != 0) ? resetPulseUs - startUs : stopCallUs;
+    stopCleared = true;
+    for (uint8_t board = 0; board < options.boards; board++)
+    {
+        stopCleared = stopCleared && simBus.getOutputs(MCP23017_BASE_ADDRESS + board) == 0;
+    }
+}
+
+/**
+ * @brief Pin hook: the RESET line resets every board while low
+ */
+void onPinWrite(uint8_t pin, uint8_t value)
+{
+    if (pin == SIM_RESET_PIN && value == LOW)
+    {
+        simBus.resetAll();
+        resetPulseUs = SolenoidSimClock::nowUs();
+    }
+}
+
+/**
+ * @brief Route a merged MIDI message, as the firmware's handler does
+ *
+ * @param message Message from MidiInput
+ */
+void handleMidiMessage(const MidiMessage& message)
+{
+    uint8_t channel = (message.status & 0x0F) + 1;
+    uint8_t type = message.status & 0xF0;
+
+    eventLog.record(SolenoidLogType::MIDI_IN, message.source, message.status, message.data1,
+                    message.data2, message.timeUs);
+
+    if (type == 0xB0)
+    {
+        pedals.controlChange(channel, message.data1, message.data2);
+        return;
+    }
+    if (type != 0x80 && type != 0x90)
+    {
+        return;  // Other messages do not drive solenoids
+    }
+
+    uint8_t solenoid = keymap.lookup(channel, message.data1);
+    if (solenoid == MIDI_KEYMAP_UNMAPPED)
+    {
+        return;
+    }
+
+    if (type == 0x90 && message.data2 > 0)
+    {
+        strikeUs[solenoid] = message.timeUs;
+        awaiting[solenoid >> 5] |= (1UL << (solenoid & 31));
+        strikeCount++;
+        pedals.noteOn(channel, solenoid, message.data2);
+    }
+    else
+    {
+        pedals.noteOff(channel, solenoid);
+    }
+}
+
+// =============================================================================
+// MEASUREMENT
+// =============================================================================
+
+/**
+ * @brief Transmit callback: match completed writes against awaited strikes
+ */
+void onWrite(uint8_t board, uint16_t states, uint32_t wireUs, bool ok)
+{
+    if (!ok)
+    {
+        failedWriteCount++;
+        return;
+    }
+    writeCount++;
+
+    uint8_t perBoard = solenoidDriver.getChannelsPerBoard();
+    uint8_t base = board * perBoard;
+    for (uint8_t bit = 0; bit < perBoard; bit++)
+    {
+        uint8_t ch = base + bit;
+        uint32_t mask = 1UL << (ch & 31);
+        if (((states >> bit) & 0x01) == 0 || (awaiting[ch >> 5] & mask) == 0)
+        {
+            continue;
+        }
+
+        // First write carrying the channel's bit is the strike
+        awaiting[ch >> 5] &= ~mask;
+        int32_t latencyUs = static_cast<int32_t>(wireUs - strikeUs[ch]);
+        inputToWire.record((latencyUs > 0) ? static_cast<uint32_t>(latencyUs) : 0);
+    }
+}
+
+/**
+ * @brief Count the errors the driver recorded, by code
+ */
+void drainErrors()
+{
+    SolenoidErrorRecord rec;
+    while (solenoidDriver.popError(rec))
+    {
+        uint8_t code = static_cast<uint8_t>(rec.code);
+        errorCounts[(code < SIM_ERROR_CODES) ? code : SIM_ERROR_CODES]++;
+
+        // A refused strike will never reach the wire
+        if (rec.channel < SOLENOID_MAX_CHANNELS)
+        {
+            awaiting[rec.channel >> 5] &= ~(1UL << (rec.channel & 31));
+        }
+    }
+}
+
+/**
+ * @brief Count the replay's log records by type and write them to --log
+ *
+ * @param nowUs Current virtual time
+ */
+void drainEventLog(uint64_t nowUs)
+{
+    if (eventLog.isRecording() && nowUs - lastSyncUs >= SIM_LOG_SYNC_US)
+    {
+        lastSyncUs = nowUs;
+        eventLog.sync();
+    }
+
+    SolenoidLogRecord chunk[SOLENOID_LOG_CHUNK_RECORDS];
+    uint16_t count;
+    while ((count = eventLog.read(chunk, SOLENOID_LOG_CHUNK_RECORDS)) > 0)
+    {
+        for (uint16_t i = 0; i < count; i++)
+        {
+            uint8_t type = static_cast<uint8_t>(chunk[i].type);
+            if (type < SIM_LOG_TYPES)
+            {
+                logCounts[type]++;
+            }
+        }
+        if (logFile)
+        {
+            logFile.write(reinterpret_cast<const uint8_t*>(chunk), count * sizeof(SolenoidLogRecord));
+        }
+    }
+}
+
+/**
+ * @brief Print one line of event log record counts
+ *
+ * @param label Line label
+ * @param counts Records by type
+ * @param dropped Records lost to a full ring
+ */
+void printLogCounts(const char* label, const uint32_t counts[SIM_LOG_TYPES], uint32_t dropped)
+{
+    Serial.print(label);
+    Serial.print(counts[static_cast<uint8_t>(SolenoidLogType::MIDI_IN)]);
+    Serial.print(F(" MIDI in, "));
+    Serial.print(counts[static_cast<uint8_t>(SolenoidLogType::SCHEDULED)]);
+    Serial.print(F(" scheduled, "));
+    Serial.print(counts[static_cast<uint8_t>(SolenoidLogType::DEFERRED)]);
+    Serial.print(F(" deferred, "));
+    Serial.print(counts[static_cast<uint8_t>(SolenoidLogType::SHED)]);
+    Serial.print(F(" shed, "));
+    Serial.print(counts[static_cast<uint8_t>(SolenoidLogType::FIRED)]);
+    Serial.print(F(" fired, "));
+    Serial.print(counts[static_cast<uint8_t>(SolenoidLogType::REJECTED)]);
+    Serial.print(F(" rejected, "));
+    Serial.print(counts[static_cast<uint8_t>(SolenoidLogType::COMMIT)]);
+    Serial.print(F(" writes, "));
+    Serial.print(dropped);
+    Serial.println(F(" dropped"));
+}
+
+/**
+ * @brief Print the results of the run
+ *
+ * @param virtualUs Simulated time the replay took
+ * @param wallSeconds Host time the replay took
+ */
+void printReport(uint64_t virtualUs, double wallSeconds)
+{
+    Serial.print(F("Capture: "));
+    Serial.print(options.capturePath);
+    Serial.print(F(" ("));
+    if (capture.isEventLog())
+    {
+        Serial.print(F("event log, "));
+    }
+    else
+    {
+        Serial.print(capture.getTrackCount());
+        Serial.print(F(" tracks, "));
+    }
+    Serial.print(static_cast<unsigned long>(capture.getEventCount()));
+    Serial.print(F(" messages, "));
+    Serial.print(static_cast<double>(capture.getLengthUs()) / 1e6, 3);
+    Serial.println(F(" s)"));
+
+    Serial.print(F("Bus: "));
+    Serial.print(options.boards);
+    Serial.print(F(" x "));
+    Serial.print(solenoidDriver.getChannelsPerBoard());
+    Serial.print(F(" channels at "));
+    Serial.print(solenoidDriver.getI2CClockHz() / 1000);
+    Serial.print(F(" kHz, input "));
+    Serial.println(options.usbTiming ? F("USB") : F("DIN"));
+    Serial.println();
+
+    uint32_t missed = strikeCount - inputToWire.getCount();
+    Serial.print(F("Strikes: "));
+    Serial.print(strikeCount);
+    Serial.print(F(" ("));
+    Serial.print(missed);
+    Serial.println(F(" never reached the wire)"));
+
+    Serial.println(F("                    p50      p99      max     mean"));
+    Serial.print(F("  Input to wire"));
+    uint32_t values[4] = { inputToWire.getPercentile(50), inputToWire.getPercentile(99),
+                           inputToWire.getMax(), inputToWire.getMean() };
+    for (uint32_t value : values)
+    {
+        char column[16];
+        snprintf(column, sizeof(column), "%9u", static_cast<unsigned>(value));
+        Serial.print(column);
+    }
+    Serial.println(F(" us"));
+
+    Serial.print(F("  MIDI input: "));
+    Serial.print(midiInput.getMessageCount(0));
+    Serial.print(F(" messages, max forward "));
+    Serial.print(midiInput.getMaxLatencyUs(0));
+    Serial.print(F(" us, "));
+    Serial.print(midiInput.getOverflowCount(0) + Serial1.getOverrunCount());
+    Serial.print(F(" lost, max line wait "));
+    Serial.print(static_cast<unsigned long>(maxLineDelayUs));
+    Serial.println(F(" us"));
+
+    Serial.println(F("Rejections:"));
+    bool any = false;
+    for (uint8_t code = 1; code <= SIM_ERROR_CODES; code++)
+    {
+        if (errorCounts[code] == 0)
+        {
+            continue;
+        }
+        any = true;
+        SolenoidError error = (code < SIM_ERROR_CODES) ? static_cast<SolenoidError>(code) : SolenoidError::UNKNOWN;
+        Serial.print(F("  "));
+        Serial.print(SolenoidDriver::getErrorString(error));
+        Serial.print(F(": "));
+        Serial.println(errorCounts[code]);
+    }
+    if (!any)
+    {
+        Serial.println(F("  none"));
+    }
+    if (solenoidDriver.getDroppedErrorCount() > 0)
+    {
+        Serial.print(F("  ("));
+        Serial.print(solenoidDriver.getDroppedErrorCount());
+        Serial.println(F(" error records dropped)"));
+    }
+
+    Serial.print(F("I2C: "));
+    Serial.print(simBus.getTransactionCount());
+    Serial.print(F(" transactions, "));
+    Serial.print(simBus.getByteCount());
+    Serial.print(F(" data bytes, "));
+    Serial.print(writeCount);
+    Serial.print(F(" board writes ("));
+    Serial.print(failedWriteCount);
+    Serial.print(F(" failed), busy "));
+    Serial.print((virtualUs > 0) ? (100.0 * static_cast<double>(simBus.getBusyUs()) / static_cast<double>(virtualUs)) : 0.0, 2);
+    Serial.println(F("%"));
+
+    Serial.print(F("Links:"));
+    for (uint8_t board = 0; board < solenoidDriver.getBoardCount(); board++)
+    {
+        SolenoidBoardHealth health = solenoidDriver.getBoardHealth(board);
+        Serial.print(F(" board "));
+        Serial.print(board);
+        Serial.print(health == SolenoidBoardHealth::ONLINE ? F(" online") :
+                     health == SolenoidBoardHealth::RETRYING ? F(" retrying") : F(" offline"));
+        Serial.print(F(" ("));
+        Serial.print(solenoidDriver.getBoardRecoveryCount(board));
+        Serial.print(F(" recoveries),"));
+    }
+    Serial.print(F(" bus recovered "));
+    Serial.print(solenoidDriver.getBusRecoveryCount());
+    Serial.println(F(" times"));
+
+    if (stopDone)
+    {
+        Serial.print(F("Emergency stop: "));
+        Serial.print(stopCoilsOn);
+        Serial.print(F(" coils on, released "));
+        Serial.print(options.resetLine ? F("by RESET after ") : F("over I2C within "));
+        Serial.print(static_cast<unsigned long>(stopReleaseUs));
+        Serial.print(F(" us, call took "));
+        Serial.print(static_cast<unsigned long>(stopCallUs));
+        Serial.print(F(" us, outputs "));
+        Serial.println(stopCleared ? F("all 0") : F("NOT CLEARED"));
+    }
+
+    if (capture.isEventLog() || options.logPath != nullptr)
+    {
+        Serial.println(F("Event log:"));
+        if (capture.isEventLog())
+        {
+            uint32_t recorded[SIM_LOG_TYPES];
+            for (uint8_t type = 0; type < SIM_LOG_TYPES; type++)
+            {
+                recorded[type] = capture.getLogCount(static_cast<SolenoidLogType>(type));
+            }
+            printLogCounts("  Recorded: ", recorded, capture.getLogDropCount());
+        }
+        printLogCounts("  Replay:   ", logCounts, eventLog.dropCount());
+    }
+
+    SolenoidMetrics metrics;
+    solenoidDriver.getMetrics(metrics);
+    Serial.println(F("Driver metrics:"));
+    metrics.printTo(Serial);
+
+    Serial.print(F("Time: "));
+    Serial.print(static_cast<double>(virtualUs) / 1e6, 3);
+    Serial.print(F(" s simulated in "));
+    Serial.print(wallSeconds, 3);
+    Serial.print(F(" s ("));
+    Serial.print((wallSeconds > 0.0) ? (static_cast<double>(virtualUs) / 1e6) / wallSeconds : 0.0, 1);
+    Serial.println(F("x real time)"));
+}
+
+/**
+ * @brief Report whether every note of the --chord run was played
+ *
+ * @return true if every strike reached the wire and none was refused
+ */
+bool checkChords()
+{
+    uint32_t expected = static_cast<uint32_t>(options.chordKeys) * SIM_CHORD_COUNT;
+    uint32_t played = inputToWire.getCount();
+    bool passed = strikeCount == expected && played == expected;
+
+    Serial.print(F("Chord check: "));
+    Serial.print(played);
+    Serial.print(F(" of "));
+    Serial.print(expected);
+    Serial.print(F(" notes played, "));
+    Serial.print(options.chordKeys);
+    Serial.print(F(" keys per chord, "));
+    Serial.print(MAX_ACTIVE_COILS);
+    Serial.print(F(" coils at a time - "));
+    Serial.println(passed ? F("PASS") : F("FAIL"));
+    return passed;
+}